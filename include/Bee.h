@@ -10,9 +10,11 @@
 #include "Tunnel.h"
 #include "utils.h"
 #include "Params.h"
+#include "SimFeatures.h"
 #include <random>
 #include <vector>
 #include <deque>
+#include <memory_resource>
 #include <optional>
 #include <cassert>
 
@@ -51,6 +53,8 @@ struct TryingToCrossEntranceState
     const pb::Line2D* pWallLine { nullptr }; // pointer to the line representing the wall that the bee is trying to cross
     pb::Pos2D normalUnitVector;          // unit vector perpendicular to the wall line, pointing outwards from the tunnel
 
+    const Tunnel* tunnel() const { return pTunnel; } // the tunnel whose boundary the bee is trying to cross
+
 private:
     float reboundToNetLen {0.0f};       // perpendicular distance from the bee's rebound position to the net line
     const Tunnel* pTunnel { nullptr };  // pointer to the tunnel
@@ -65,6 +69,7 @@ struct CrossingInfo
     NetType netType {NetType::NONE};
     int entranceID {0};
     bool isEntry {false}; // whether the crossing attempt was an attempt to enter the tunnel (as opposed to exit)
+    const TunnelEntranceInfo* pEntrance {nullptr}; // the entrance being crossed, whose crossing stats are updated when the attempt finishes
 
     void reset() {
         success = false;
@@ -72,6 +77,7 @@ struct CrossingInfo
         netType = NetType::NONE;
         entranceID = 0;
         isEntry = false;
+        pEntrance = nullptr;
     }
 
     void incrementReboundCount() { numRebounds++; }
@@ -100,60 +106,65 @@ public:
     Bee(Hive* pHive, Environment* pEnv);
     ~Bee() {}
 
-    void update();
+    template<typename Features>
+    void update(); // instantiated in Bee.cpp for every SimFeatures bundle
 
     // Getters
     float x() const { return m_pos.x; }
     float y() const { return m_pos.y; }
-    float angle() const { return m_angle; }
+    float angle() const { return m_heading.angle(); } // only calculated when needed (e.g. for visualisation)
+    const pb::Pos2D& heading() const { return m_heading; }
     pb::Pos2D deltaMovement() const { return m_pos - m_prevPos; }
     static float visualRange() { return Params::beeVisualRange; }
+    static float tunnelWallBuffer() { return m_sTunnelWallBuffer; }
     float colorHue() const { return m_colorHue; }
-    bool inTunnel() const { return m_inTunnel; }
+    bool inTunnel() const { return m_pTunnel != nullptr; }
+    const Tunnel* tunnel() const { return m_pTunnel; } // the tunnel the bee is in (nullptr if it is outside all tunnels)
     const std::vector<pb::Pos2D>& path() const { return m_path; }
     BeeState state() const { return m_state; }
     const TunnelEntranceInfo* entranceUsed() const { return m_pLastTunnelEntrance; }
-    const std::vector<CrossingInfo>& entranceCrossingRecords() const { return m_entranceCrossingRecords; }
+    const std::pmr::vector<CrossingInfo>& entranceCrossingRecords() const { return m_entranceCrossingRecords; }
 
     // Setters
     void setState(BeeState state) { m_state = state; }
 
 private:
-    void forage();
-    bool normalForagingUpdate();
+    template<typename Features> void forage();
+    template<typename Features> bool normalForagingUpdate();
     void continueTryingToCrossEntrance();
-    void attemptToCrossTunnelBoundaryWhileForaging(pb::PosAndDir2D& desiredMove);
+    template<typename Features> void attemptToCrossTunnelBoundaryWhileForaging(pb::PosAndDir2D& desiredMove, const Tunnel& tunnel);
     void switchToReturnToHive();
-    void switchToOnFlower(Plant* pPlant);
-    void returnToHiveInsideTunnel();
-    void returnToHiveOutsideTunnel();
-    void stayOnFlower();
-    void stayInHive();
+    template<typename Features> void switchToOnFlower(Plant* pPlant);
+    template<typename Features> void returnToHiveInsideTunnel();
+    template<typename Features> void returnToHiveOutsideTunnel();
+    template<typename Features> void stayOnFlower();
+    template<typename Features> void stayInHive();
     void keepMoveWithinEnvironment(pb::PosAndDir2D& desiredMove) const;
     void nudgeAwayFromTunnelWalls();
-    float alignAngleWithLine(float desiredAngle, float line_dx, float line_dy) const;
-    std::optional<ForageNextStepInfo> forageNearestFlower();
-    pb::PosAndDir2D moveInRandomDirection(int attemptNumber = 0);
+    pb::Pos2D alignDirWithLine(const pb::Pos2D& desiredDir, float line_dx, float line_dy) const;
+    template<typename Features> std::optional<ForageNextStepInfo> forageNearestFlower();
+    template<typename Features> pb::PosAndDir2D moveInRandomDirection(int attemptNumber = 0);
     void addToRecentlyVisitedPlants(Plant* pPlant);
-    bool lineIntersectsTunnel(float x1, float y1, float x2, float y2) const;
     void calculateWaypointsAroundTunnel();
     void calculateWaypointsInsideTunnel();
-    bool headToNextWaypoint();
+    const TunnelEntranceInfo* nearestEntrance(const Tunnel& tunnel) const;
+    template<typename Features> bool headToNextWaypoint();
     bool nextWaypointIsTunnelEntrance() const;
-    void updatePathHistory();
+    template<typename Features> void updatePathHistory();
     void setDirAccordingToHive();
     void unsetTryingToCrossEntranceState();
     void recordCurrentCrossingInfo(bool success);
 
     pb::Pos2D m_pos;     // position of bee in environment coordinates
     pb::Pos2D m_prevPos; // position of bee in the previous iteration
-    float m_angle;      // direction of travel in radians
+    pb::Pos2D m_heading;// direction of travel as a unit vector
     float m_energy;     // energy level of the bee
     float m_colorHue;   // hue value for coloring the bee in visualisation (between 0.0 and 360.0)
-    bool  m_inTunnel;   // is the bee currently in the tunnel
+    const Tunnel* m_pTunnel { nullptr }; // the tunnel the bee is currently in (nullptr if it is outside all tunnels)
 
     const TunnelEntranceInfo* m_pLastTunnelEntrance { nullptr }; // info about the last tunnel entrance used by the bee
-    std::deque<pb::Pos2D> m_homingWaypoints; // waypoints for returning to hive
+    std::pmr::deque<pb::Pos2D> m_homingWaypoints; // waypoints for returning to hive (allocated from the episode arena)
+    const Tunnel* m_pHomingTunnel { nullptr };    // the tunnel the bee is making its way through while in state RETURN_TO_HIVE_INSIDE_TUNNEL
 
     int   m_currentBoutDuration { 0 };  // duration (number of iterations) of the current foraging bout
     int   m_currentHiveDuration { 0 };  // duration (number of iterations) of the current stay in the hive
@@ -165,7 +176,7 @@ private:
     TryingToCrossEntranceState m_tryCrossState;
 
     CrossingInfo m_currentCrossingInfo;
-    std::vector<CrossingInfo> m_entranceCrossingRecords; // record of the bee's attempts to enter or exit the tunnel, for calculating stats
+    std::pmr::vector<CrossingInfo> m_entranceCrossingRecords; // (allocated from the episode arena) record of the bee's attempts to enter or exit the tunnel (only kept if Params::recordBeeCrossings)
 
     std::vector<Plant*> m_recentlyVisitedPlants;         // the last N plants visited by the bee
     std::vector<pb::Pos2D> m_path;                       // record of the path taken by the bee
@@ -0,0 +1,163 @@
+/**
+ * @file
+ *
+ * Declaration of the BeeGrid class
+ */
+
+#ifndef _BEEGRID_H
+#define _BEEGRID_H
+
+#include "Bee.h"
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+
+
+/**
+ * A spatial index over the bees' positions, so that a bee can find the other bees near it without
+ * looking at every bee in the environment.
+ *
+ * The bees move every step, so the index is rebuilt from scratch at the start of each step (see
+ * Environment::update()). Like PlantStore, it is a uniform grid whose contents are held in flat arrays
+ * sorted by cell (column-major), built with a counting sort. A rebuild therefore takes time proportional
+ * to the number of bees plus the number of cells, and once the arrays have grown to the number of bees
+ * it allocates nothing.
+ *
+ * A rebuild can be restricted to the bees that an interaction cares about (e.g. only those on a flower),
+ * so that a query only looks at those. Otherwise, in a fixed area, the bees in each 3x3 block of cells
+ * grow in number with the population, and so would the cost of each query.
+ *
+ * A radius query looks at the 3x3 cells around the query point, so the radius must be no larger than
+ * the cell size. Queries take a callback rather than returning a list, so they don't allocate either.
+ * Bees are identified by their index in the vector that was passed to rebuild(). Their positions and
+ * states are those at the time of the rebuild, so what a bee sees doesn't depend on which bees have
+ * already moved in the current step.
+ */
+class BeeGrid {
+
+public:
+    BeeGrid() {}
+    ~BeeGrid() {}
+
+    void initialise(float width, float height, float cellSize);
+    void rebuild(const std::vector<Bee>& bees);
+
+    // Index only the bees for which include(bee) is true (the states of all the bees are still recorded)
+    template<typename Include>
+    void rebuild(const std::vector<Bee>& bees, Include&& include);
+    void clear();
+
+    float cellSize() const { return m_cellSize; }
+    std::size_t size() const { return m_beeIndices.size(); } // number of bees indexed
+    BeeState state(std::uint32_t beeIndex) const { return m_states[beeIndex]; } // state of a bee at the time of the rebuild
+
+    // Call pred(beeIndex, distSq) for each bee within radius of (x,y), stopping as soon as it returns
+    // true. Returns true if it did.
+    template<typename Pred>
+    bool anyWithinRange(float x, float y, float radius, Pred&& pred) const;
+
+    // Call f(beeIndex, distSq) for every bee within radius of (x,y)
+    template<typename F>
+    void forEachWithinRange(float x, float y, float radius, F&& f) const {
+        anyWithinRange(x, y, radius, [&f](std::uint32_t beeIndex, float distSq) { f(beeIndex, distSq); return false; });
+    }
+
+private:
+    std::size_t cellIndex(float x, float y) const {
+        int i = std::clamp(static_cast<int>(x / m_cellSize), 0, static_cast<int>(m_gridW) - 1);
+        int j = std::clamp(static_cast<int>(y / m_cellSize), 0, static_cast<int>(m_gridH) - 1);
+        return static_cast<std::size_t>(i) * m_gridH + static_cast<std::size_t>(j);
+    }
+
+    float m_cellSize {1.0f};
+    std::size_t m_gridW {1};
+    std::size_t m_gridH {1};
+
+    std::vector<float> m_x;                     // bee x positions, sorted by cell
+    std::vector<float> m_y;                     // bee y positions, sorted by cell
+    std::vector<std::uint32_t> m_beeIndices;    // the bees' indices, in the same order
+    std::vector<std::uint32_t> m_cellStart;     // index of the first bee in each cell, plus one past the last
+    std::vector<BeeState> m_states;             // the bees' states, indexed by bee (not sorted by cell)
+
+    // scratch buffers for rebuild(), kept between steps so they are only allocated once
+    std::vector<std::uint32_t> m_includedBees;  // indices of the bees being indexed
+    std::vector<std::uint32_t> m_beeCells;      // the cell of each of those bees
+    std::vector<std::uint32_t> m_nextInCell;
+};
+
+
+// Counting sort of the included bees by cell, keeping bees within a cell in the order they appear in
+// the vector
+template<typename Include>
+void BeeGrid::rebuild(const std::vector<Bee>& bees, Include&& include)
+{
+    const std::size_t numBees = bees.size();
+    const std::size_t numCells = m_gridW * m_gridH;
+
+    m_states.resize(numBees);
+    m_includedBees.clear();
+    m_beeCells.clear();
+    std::fill(m_cellStart.begin(), m_cellStart.end(), 0);
+    for (std::size_t b = 0; b < numBees; ++b) {
+        m_states[b] = bees[b].state();
+        if (!include(bees[b])) {
+            continue;
+        }
+        const auto cell = static_cast<std::uint32_t>(cellIndex(bees[b].x(), bees[b].y()));
+        m_includedBees.push_back(static_cast<std::uint32_t>(b));
+        m_beeCells.push_back(cell);
+        ++m_cellStart[cell + 1];
+    }
+    for (std::size_t c = 0; c < numCells; ++c) {
+        m_cellStart[c + 1] += m_cellStart[c];
+    }
+
+    const std::size_t numIncluded = m_includedBees.size();
+    m_x.resize(numIncluded);
+    m_y.resize(numIncluded);
+    m_beeIndices.resize(numIncluded);
+    m_nextInCell.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+    for (std::size_t k = 0; k < numIncluded; ++k) {
+        const Bee& bee = bees[m_includedBees[k]];
+        std::uint32_t index = m_nextInCell[m_beeCells[k]]++;
+        m_x[index] = bee.x();
+        m_y[index] = bee.y();
+        m_beeIndices[index] = m_includedBees[k];
+    }
+}
+
+
+template<typename Pred>
+bool BeeGrid::anyWithinRange(float x, float y, float radius, Pred&& pred) const
+{
+    assert(radius <= m_cellSize);
+
+    if (m_beeIndices.empty()) {
+        return false;
+    }
+
+    const float radiusSq = radius * radius;
+    const std::size_t cell = cellIndex(x, y);
+    const std::size_t i = cell / m_gridH;
+    const std::size_t j = cell % m_gridH;
+
+    for (std::size_t ci = (i > 0 ? i - 1 : 0); ci <= std::min(i + 1, m_gridW - 1); ++ci) {
+        // the cells (ci, j-1), (ci, j) and (ci, j+1) are one contiguous range
+        const std::uint32_t first = m_cellStart[ci * m_gridH + (j > 0 ? j - 1 : 0)];
+        const std::uint32_t last = m_cellStart[ci * m_gridH + std::min(j + 1, m_gridH - 1) + 1];
+        for (std::uint32_t k = first; k < last; ++k) {
+            float dx = m_x[k] - x;
+            float dy = m_y[k] - y;
+            float distSq = dx * dx + dy * dy;
+            if (distSq <= radiusSq && pred(m_beeIndices[k], distSq)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+#endif /* _BEEGRID_H */
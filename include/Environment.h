@@ -11,10 +11,19 @@
 #include "Hive.h"
 #include "Tunnel.h"
 #include "Plant.h"
+#include "PlantStore.h"
+#include "BeeGrid.h"
+#include "VisitCountHistogram.h"
 #include "Heatmap.h"
 #include "Flowmap.h"
+#include "HomingRouteTable.h"
+#include "StartupCache.h"
 #include "utils.h"
+#include "SimFeatures.h"
 #include <vector>
+#include <memory_resource>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <cassert>
 
@@ -31,8 +40,10 @@ struct NearbyPlantInfo {
 
 
 struct EntranceCrossingStats {
+    long numAttempts {0};       // number of crossing attempts
     float successRate {0.0f};   // fraction of crossing attempts that were successful (one "attempt" might involve multiple rebounds)
     float meanRebounds {0.0f};  // mean number of rebounds
+    float sdRebounds {0.0f};    // standard deviation of number of rebounds
 };
 
 
@@ -48,6 +59,27 @@ struct Barrier {
 };
 
 
+// A cell of the obstacle grid: the barriers whose midpoints are in the cell, and the indices (in the
+// environment's list of tunnels) of the tunnels whose walls (plus the bees' wall buffer) overlap the cell
+struct ObstacleGridCell {
+    std::vector<const Barrier*> barriers;
+    std::vector<int> tunnels;
+};
+
+
+// The barriers, and the obstacle grid that indexes them and the tunnels by position. A layout is never
+// changed once built, so environments with the same barriers can share one (see Environment::initialiseBarriers()).
+struct ObstacleLayout {
+    std::vector<Barrier> barriers;                          // Owns all Barrier objects
+    std::vector<std::vector<ObstacleGridCell>> grid;        // Spatial index for barriers and tunnels, with pointers into barriers
+    float cellSize {1.0f};
+    size_t gridW {1};
+    size_t gridH {1};
+
+    pb::Pos2D gridIndex(float x, float y) const;            // grid cell containing environment position (x,y)
+};
+
+
 enum class EntranceCrossingType {
     ENTRY,
     EXIT,
@@ -65,42 +97,59 @@ public:
     ~Environment() {}
 
     void initialise(PolyBeeCore* pCore);
+    template<typename Features>
     void update(int timestep);
+    SimFeatureFlags simFeatureFlags() const; // which optional simulation features the current configuration uses
     void resetForNewRun(const std::vector<HiveSpec>& hiveSpecs, const std::vector<PatchSpec>& bridgeSpecs);
+    void clearBees() { m_bees.clear(); }
 
-    bool inTunnel(float x, float y) const;
+    bool inTunnel(float x, float y) const { return tunnelAt(x, y) != nullptr; }
+    const Tunnel* tunnelAt(float x, float y) const; // the tunnel containing the given point, or nullptr if it is outside all tunnels
+    const std::vector<int>& getNearbyTunnels(float x, float y) const; // indices of tunnels whose walls are within a wall buffer of the grid cell containing the point
 
-    Tunnel& getTunnel() { return m_tunnel; }
+    Tunnel& getTunnel() { return m_tunnels.front(); } // the main tunnel (the one whose entrances and hives are evolved)
+    Tunnel& getTunnel(std::size_t index) { assert(index < m_tunnels.size()); return m_tunnels[index]; }
+    const std::vector<Tunnel>& getTunnels() const { return m_tunnels; }
     const Heatmap& getHeatmap() const { return m_heatmap; }
     const Flowmap& getFlowmapConst() const { return m_flowmap; }
     Flowmap& getFlowmap() { return m_flowmap; }
-    const std::vector<std::vector<double>>& getRawTargetHeatmapNormalised() const { return m_rawTargetHeatmapNormalised; }
+    const std::vector<std::vector<double>>& getRawTargetHeatmapNormalised() const { return m_pInvariants->targetHeatmapNormalised; } // empty if no target heatmap
     const std::vector<Bee>& getBees() const { return m_bees; }
+    const BeeGrid& getOnFlowerBeeGrid() const { return m_onFlowerBeeGrid; } // only rebuilt each step when bee interactions are in use
     const std::vector<Hive>& getHives() const { return m_hives; }
+    const HomingRouteTable& getHomingRoutes() const { return m_homingRoutes; }
 
     const std::vector<Plant>& getAllPlants() const { return m_allPlants; }
     const std::vector<Plant*>& getPlantsForSVFCalc() const { return m_plantsForSVFCalc; }
-    std::vector<Plant*> getNearbyPlants(float x, float y) const;
+    template<bool CheckBarriers = true, bool AvoidOccupied = false>
     std::optional<Plant*> selectNearbyUnvisitedPlant(float x, float y, const std::vector<Plant*>& visited) const; // get nearest plant to a given position within maxDistance
 
-    const std::vector<Barrier>& getAllBarriers() const { return m_allBarriers; }
-    std::vector<Barrier*> getNearbyBarriers(float x, float y) const;
+    const std::vector<Barrier>& getAllBarriers() const { return m_pObstacles->barriers; }
+    std::pmr::vector<const Barrier*> getNearbyBarriers(float x, float y) const; // allocated from the episode arena
     bool pathObstructedByBarrier(float x1, float y1, float x2, float y2) const;
     std::optional<float> distanceToNearestObstructingBarrier(float x1, float y1, float x2, float y2) const;
 
     double getSuccessfulVisitFraction() const;  // fraction of plants that have a visit count in the successful visit range
                                                 // (between minVisitCountSuccess and maxVisitCountSuccess, inclusive)
+    const VisitCountHistogram& getVisitCountHistogram() const { return m_visitCountHistogram; } // over the plants counted for SVF
+    void recordFlowerVisit(Plant* pPlant);      // a bee has landed on the plant
 
     PolyBeeCore* getPolyBeeCore() { assert(m_pPolyBeeCore != nullptr); return m_pPolyBeeCore; }
+    std::pmr::memory_resource* episodeArena() const;
 
     void initialiseBarriers(const std::vector<BarrierSpec>& barrierSpecs);
     void initialiseHivesAndBees(const std::vector<HiveSpec>& hiveSpecs);
     void initialisePlants(const std::vector<PatchSpec>& patchSpecs, bool extraPlantsForEvolvingBridges = false);
 
-    EntranceCrossingStats getEntranceCrossingStats(EntranceCrossingType type) const; // get stats on tunnel entrance crossing attempts across all bees, for current state of the environment
+    void setBeeFraction(float fraction) { m_beeFraction = fraction; } // fraction of Params::numBees created by initialiseBees()
+
+    EntranceCrossingStats getEntranceCrossingStats(EntranceCrossingType type,
+        std::optional<NetType> netType = std::nullopt) const; // get stats on tunnel entrance crossing attempts across all bees so far in the current run
 
 private:
-    void initialiseTunnel();
+    void initialiseTunnels();
+    std::shared_ptr<const ObstacleLayout> buildObstacleLayout(const std::vector<BarrierSpec>& barrierSpecs) const;
+    void addTunnelsToObstacleGrid(ObstacleLayout& layout) const;
     void initialiseBarriers();
     void initialisePlants();
     void initialiseHivesAndBees();
@@ -108,37 +157,63 @@ private:
     void initialiseHeatmap();
     void initialiseTargetHeatmap();
     void initialiseFlowmap();
+    void initialiseBeeGrid();
     void resetHivesAndBees(const std::vector<HiveSpec>& hiveSpecs);
     void resetPlants(const std::vector<PatchSpec>& bridgeSpecs);
-    pb::Pos2D envPosToPlantGridIndex(float x, float y) const;
-    pb::Pos2D envPosToBarrierGridIndex(float x, float y) const;
-    Plant* pickRandomPlantWeightedByDistance(const std::vector<NearbyPlantInfo>& plants) const;
+    Plant* pickRandomPlantWeightedByDistance(const std::pmr::vector<NearbyPlantInfo>& plants) const;
+    bool flowerOccupied(const Plant* pPlant) const;
 
     float m_width;
     float m_height;
     std::vector<Bee> m_bees;
+    BeeGrid m_onFlowerBeeGrid;                                      // Spatial index of the bees on a flower, rebuilt at the start of each step
     std::vector<Hive> m_hives;
-    Tunnel m_tunnel;
+    std::vector<Tunnel> m_tunnels;                                  // The main tunnel, followed by any extra tunnels (never resized after initialisation)
+    HomingRouteTable m_homingRoutes;                                // Routes around the tunnel to the hives and entrances, rebuilt with the hives
 
     std::vector<Plant> m_allPlants;                                 // Owns all Plant objects
     std::vector<Plant*> m_plantsForSVFCalc;                         // Pointers to plants for Successful Visit Fraction calculation
-    std::vector<std::vector<std::vector<Plant*>>> m_plantGrid;      // Spatial index for plants, with pointers into m_allPlants
-    float m_plantGridCellSize {1.0f};
-    size_t m_plantGridW {1};
-    size_t m_plantGridH {1};
+    VisitCountHistogram m_visitCountHistogram;                      // Visit counts of the plants in m_plantsForSVFCalc, updated on each visit
+    PlantStore m_plantStore;                                        // Spatial index for plants, with pointers into m_allPlants
 
-    std::vector<Barrier> m_allBarriers;                             // Owns all Barrier objects
-    std::vector<std::vector<std::vector<Barrier*>>> m_barrierGrid;  // Spatial index for barriers, with pointers into m_allBarriers
-    float m_barrierGridCellSize {1.0f};
-    size_t m_barrierGridW {1};
-    size_t m_barrierGridH {1};
+    std::shared_ptr<const ObstacleLayout> m_pObstacles;             // Barriers and obstacle grid, shared by all cores whose barriers come from Params
 
     Heatmap m_heatmap;
-    std::vector<std::vector<double>> m_rawTargetHeatmapNormalised;  // target heatmap for use in PolyBeeEvolve, and for calculating EMD in one-off runs
+    std::shared_ptr<const EnvironmentInvariants> m_pInvariants;      // target heatmap (for use in PolyBeeEvolve, and for calculating EMD in one-off runs)
+                                                                    // and reference heatmaps, shared by all cores in the process
 
     Flowmap m_flowmap;
 
+    float m_beeFraction {1.0f};                                     // < 1 only for reduced-fidelity screening runs in PolyBeeEvolve
+
     PolyBeeCore* m_pPolyBeeCore { nullptr };
+
+    static std::mutex s_paramsObstaclesMutex;
+    static std::shared_ptr<const ObstacleLayout> s_pParamsObstacles; // layout of the barriers in Params, built by the first core to need it
 };
 
+
+// Advance the environment by one timestep. Features is the SimFeatures bundle chosen for the
+// current configuration by PolyBeeCore::run()
+template<typename Features>
+void Environment::update(int timestep) {
+    if constexpr (Features::hasBeeInteractions) {
+        // index the positions of the bees on a flower at the start of the step, for the bees to query as they
+        // move (only those are indexed, so that a query costs the same however many bees are flying nearby)
+        m_onFlowerBeeGrid.rebuild(m_bees, [](const Bee& bee) { return bee.state() == BeeState::ON_FLOWER; });
+    }
+
+    // update bee positions
+    for (Bee& bee : m_bees) {
+        bee.update<Features>();
+    }
+
+    m_heatmap.update();
+    if constexpr (Features::recordFlowmap) {
+        if (timestep % Params::flowmapUpdatePeriod == 0) {
+            m_flowmap.update();
+        }
+    }
+}
+
 #endif /* _ENVIRONMENT_H */
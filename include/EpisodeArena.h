@@ -0,0 +1,73 @@
+/**
+ * @file
+ *
+ * Declaration of the EpisodeArena class, a memory resource for the short-lived
+ * allocations made during a single simulation run (an "episode")
+ */
+
+#ifndef _EPISODEARENA_H
+#define _EPISODEARENA_H
+
+#include <memory_resource>
+#include <cstddef>
+
+
+/**
+ * Allocation counts for an EpisodeArena
+ */
+struct EpisodeArenaStats {
+    std::size_t numAllocations {0};         // allocations served by the arena (each of which would otherwise have gone to the global heap)
+    std::size_t numHeapAllocations {0};     // allocations the arena itself made from the global heap
+    std::size_t heapBytes {0};              // bytes currently held by the arena from the global heap
+    std::size_t peakHeapBytes {0};          // maximum value of heapBytes
+
+    void reset() { *this = EpisodeArenaStats{}; }
+};
+
+
+/**
+ * Each PolyBeeCore owns an EpisodeArena. It backs the transient containers used while stepping the
+ * simulation (the bees' homing waypoints, the scratch vectors used when looking for nearby plants
+ * and barriers, and so on), so that these are served from blocks owned by this core rather than
+ * by the global allocator, which is shared by every thread in a multi-island run.
+ *
+ * Freed blocks are recycled (it is a pool, not a pure bump allocator), so a long run doesn't keep
+ * growing. Everything is given back at once by release(), which PolyBeeCore::resetForNewRun() calls
+ * between runs. Anything allocated from the arena must have been destroyed by then. The arena is
+ * not thread safe, which is fine as a PolyBeeCore is only ever used by one thread at a time.
+ */
+class EpisodeArena : public std::pmr::memory_resource {
+
+public:
+    EpisodeArena();
+    EpisodeArena(const EpisodeArena&) = delete;
+    EpisodeArena& operator=(const EpisodeArena&) = delete;
+
+    void release(); // give back all memory, and start a new set of episode stats
+
+    const EpisodeArenaStats& episodeStats() const { return m_episodeStats; } // since the last release()
+    const EpisodeArenaStats& totalStats() const { return m_totalStats; }     // since the arena was created
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    // passes the pool's own requests on to the global heap, counting them as it goes
+    class HeapResource : public std::pmr::memory_resource {
+    public:
+        explicit HeapResource(EpisodeArena* pArena) : m_pArena(pArena) {}
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+        EpisodeArena* m_pArena;
+    };
+
+    EpisodeArenaStats m_episodeStats;
+    EpisodeArenaStats m_totalStats;
+    HeapResource m_heap;
+    std::pmr::unsynchronized_pool_resource m_pool;
+};
+
+#endif /* _EPISODEARENA_H */
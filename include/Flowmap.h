@@ -16,13 +16,15 @@ struct FlowmapCell {
     float axis {0.0f};          // predominant movement axis for this cell
     float strength {0.0f};      // strength of alignment to the predominant axis (between 0 and 1)
     int count {0};              // number of bee movements recorded in this cell
-    std::vector<float> thetas;  // record of all movement angles for bees in this cell
+    double sumCosTwoTheta {0.0};// running sums of cos(2*theta) and sin(2*theta) over the movement angles theta
+    double sumSinTwoTheta {0.0};// of all bee movements recorded in this cell
 
     void reset() {
         axis = 0.0f;
         strength = 0.0f;
         count = 0;
-        thetas.clear();
+        sumCosTwoTheta = 0.0;
+        sumSinTwoTheta = 0.0;
     }
 };
 
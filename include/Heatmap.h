@@ -7,7 +7,9 @@
 #ifndef _HEATMAP_H
 #define _HEATMAP_H
 
+#include "Params.h"
 #include <vector>
+#include <memory>
 class Bee;
 
 /**
@@ -32,23 +34,39 @@ public:
     int size_x() const { return m_numCellsX; }
     int size_y() const { return m_numCellsY; }
 
-    // compute and return the "earth mover's distance" between this heatmap and the target heatmap
-    float emd(const std::vector<std::vector<double>>& target) const;
-    float emd(const std::vector<std::vector<double>>& heatmap1, const std::vector<std::vector<double>>& heatmap2) const;
+    // compute and return the "earth mover's distance" between this heatmap and the target heatmap, exactly
+    // or with one of the cheaper approximations (see the emd_* implementations for their error bounds)
+    float emd(const std::vector<std::vector<double>>& target, EmdBackend backend = EmdBackend::EXACT) const;
+    float emd(const std::vector<std::vector<double>>& heatmap1, const std::vector<std::vector<double>>& heatmap2,
+              EmdBackend backend = EmdBackend::EXACT) const;
 
     float high_emd() const { return m_highEmd; }
 
+    // return a copy of a (normalised) heatmap with each block of factor x factor cells merged into one
+    static std::vector<std::vector<double>> coarsened(const std::vector<std::vector<double>>& heatmap, int factor);
+
     const std::vector<std::vector<int>>& cells() const { return m_cells; }
     const std::vector<std::vector<double>>& cellsNormalised() const { return m_cellsNormalised; }
 
-    const std::vector<std::vector<double>>& uniformTargetNormalised() const { return m_uniformTargetNormalised; }
-    const std::vector<std::vector<double>>& antiTargetNormalised() const { return m_antiTargetNormalised; } // for use in PolyBeeEvolve
+    // The reference heatmaps and the EMD between them are the same for every heatmap of the same size, so
+    // they are computed once (by StartupCache) and shared
+    void setReferenceHeatmaps(std::shared_ptr<const std::vector<std::vector<double>>> pUniformTargetNormalised,
+                              std::shared_ptr<const std::vector<std::vector<double>>> pAntiTargetNormalised,
+                              float highEmd);
+
+    const std::vector<std::vector<double>>& uniformTargetNormalised() const { return *m_pUniformTargetNormalised; }
+    const std::vector<std::vector<double>>& antiTargetNormalised() const { return *m_pAntiTargetNormalised; } // for use in PolyBeeEvolve
 
 private:
     void calcNormalised(); // calculate the normalised version of the heatmap
 
     // various implementations of EMD calculation
     float emd_opencv(const std::vector<std::vector<double>>& heatmap1, const std::vector<std::vector<double>>& heatmap2) const;
+    float emd_sinkhorn(const std::vector<std::vector<double>>& heatmap1, const std::vector<std::vector<double>>& heatmap2) const;
+    float emd_sliced(const std::vector<std::vector<double>>& heatmap1, const std::vector<std::vector<double>>& heatmap2) const;
+    float emd_multiscale(const std::vector<std::vector<double>>& heatmap1, const std::vector<std::vector<double>>& heatmap2) const;
+    void checkEmdArguments(const std::vector<std::vector<double>>& heatmap1, const std::vector<std::vector<double>>& heatmap2,
+                           const char* method) const;
 
     template<typename T>
     void print_backend(std::ostream& os, std::vector<std::vector<T>> const& heatmap) const;
@@ -58,14 +76,14 @@ private:
     int m_numCellsX;
     int m_numCellsY;
     int m_cellSize;
-    float m_highEmd; // a high EMD value for this environment (as measured between uniform target and anti-target heatmaps)
+    float m_highEmd {0.0f}; // a high EMD value for this environment (as measured between uniform target and anti-target heatmaps)
     bool m_bCalcNormalised; // whether to calculate and store a normalised version of the heatmap
 
     std::vector<std::vector<int>> m_cells; // 2D array of cell counts
     std::vector<std::vector<double>> m_cellsNormalised; // 2D array of normalised cell counts
 
-    std::vector<std::vector<double>> m_uniformTargetNormalised; // Normalised uniform target heatmap
-    std::vector<std::vector<double>> m_antiTargetNormalised; // Normlised heatmap with top left cell = 1, all others = 0
+    std::shared_ptr<const std::vector<std::vector<double>>> m_pUniformTargetNormalised; // Normalised uniform target heatmap
+    std::shared_ptr<const std::vector<std::vector<double>>> m_pAntiTargetNormalised; // Normlised heatmap with top left cell = 1, all others = 0
 };
 
 #endif /* _HEATMAP_H */
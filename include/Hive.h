@@ -10,6 +10,7 @@
 #include "utils.h"
 
 class Environment;
+class Tunnel;
 
 /**
  * The Hive class ...
@@ -25,14 +26,15 @@ public:
     float y() const { return m_pos.y; }
     const pb::Pos2D& pos() const { return m_pos; }
     int direction() const { return m_direction; }
-    bool inTunnel() const { return m_inTunnel; }
+    bool inTunnel() const { return m_pTunnel != nullptr; }
+    const Tunnel* tunnel() const { return m_pTunnel; } // the tunnel the hive is in, or nullptr if it is outside
 
 private:
     pb::Pos2D m_pos; // position of hive in environment coordinates
     int m_direction; // 0=North, 1=East, 2=South, 3=West, 4=Random
 
     const Environment* m_pEnv { nullptr };
-    bool m_inTunnel { false };
+    const Tunnel* m_pTunnel { nullptr };
 };
 
 #endif /* _HIVE_H */
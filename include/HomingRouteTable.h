@@ -0,0 +1,101 @@
+/**
+ * @file
+ *
+ * Declaration of the HomingRouteTable class
+ */
+
+#ifndef _HOMINGROUTETABLE_H
+#define _HOMINGROUTETABLE_H
+
+#include "utils.h"
+#include <vector>
+#include <deque>
+#include <memory_resource>
+#include <cstddef>
+
+class Tunnel;
+class Hive;
+
+
+/**
+ * Precomputed routes for bees homing around the outside of the tunnels.
+ *
+ * The table is a visibility graph over a fixed set of nodes: the tunnels' corners (pushed outwards
+ * by a buffer distance), the midpoints of the tunnel entrances, and the hive positions. Shortest
+ * paths between every pair of nodes, going via corners only, are worked out once when the table is
+ * initialised. A bee's route home then only needs a visibility test from its own position to the
+ * destination and to a few corners, followed by a lookup in the table.
+ *
+ * Visibility tests go through a bounding volume hierarchy over the tunnels, so a segment is only
+ * tested against the tunnels whose boxes it passes through: O(log N) for N tunnels, rather than O(N).
+ * When the direct line home is blocked, only the corners of the tunnels that block it are considered
+ * as the first waypoint, rather than every corner. With a single tunnel this gives the same routes as
+ * trying every corner. With several, the route may be slightly longer when the best first corner
+ * belongs to a tunnel that isn't in the direct line; if none of the blocking tunnels' corners can be
+ * seen, every corner is tried.
+ *
+ * The routes are the same as those bees have always taken: edges between neighbouring corners of
+ * a tunnel only run clockwise around it, and as an entrance midpoint lies on the tunnel wall it
+ * never passes the visibility test, so bees heading for an entrance fly straight to it.
+ *
+ * The table must be re-initialised whenever the tunnel entrances or the hives change (this is done
+ * by Environment::initialiseHivesAndBees()).
+ */
+class HomingRouteTable {
+
+public:
+    HomingRouteTable() {}
+    ~HomingRouteTable() {}
+
+    void initialise(const std::vector<Tunnel>& tunnels, const std::vector<Hive>& hives, float buffer);
+
+    // destination node for the given hive, or entrance of the given tunnel, in the order they were given to initialise()
+    int hiveNode(std::size_t hiveIndex) const;
+    int entranceNode(std::size_t tunnelIndex, std::size_t entranceIndex) const;
+
+    // Append the waypoints of the shortest route from pos to the given destination node. If no
+    // route can be found, a single waypoint at the destination is appended.
+    void route(const pb::Pos2D& pos, int destNode, std::pmr::deque<pb::Pos2D>& waypoints) const;
+
+    // is the straight line between the two points clear of all the tunnels?
+    bool segmentIsClear(const pb::Pos2D& p1, const pb::Pos2D& p2) const;
+
+    std::size_t numNodes() const { return m_nodes.size(); }
+
+private:
+    float dist(int from, int to) const { return m_dist[from * m_nodes.size() + to]; }
+    int next(int from, int to) const { return m_next[from * m_nodes.size() + to]; }
+
+    struct Rect {
+        float x, y, w, h;
+    };
+    bool segmentIntersectsRect(const pb::Pos2D& p1, const pb::Pos2D& p2, const Rect& rect) const;
+
+    // A node of the bounding volume hierarchy over m_tunnelRects. Leaves hold a range of m_bvhRects;
+    // internal nodes have count == 0 and children at index left and left + 1.
+    struct BvhNode {
+        float minX, minY, maxX, maxY;
+        int left;
+        int first;
+        int count;
+    };
+    void buildBvh();
+    void buildBvhNode(int index, int first, int count);
+    template<typename Pred>
+    bool anyRectOnSegment(const pb::Pos2D& p1, const pb::Pos2D& p2, Pred&& pred) const;
+    void tryCorner(const pb::Pos2D& pos, int corner, int destNode, int& bestCorner, float& bestDist) const;
+
+    std::vector<Rect> m_tunnelRects;
+    std::vector<BvhNode> m_bvhNodes;    // root first
+    std::vector<int> m_bvhRects;        // indices into m_tunnelRects, in leaf order
+    std::vector<bool> m_reachableFromCorners; // for each node, whether any corner has a route to it
+
+    std::vector<pb::Pos2D> m_nodes;     // corners first (four per tunnel, clockwise from top-left), then entrances, then hives
+    std::size_t m_numCorners {0};
+    std::vector<std::size_t> m_firstEntranceNodes; // index of the first entrance node of each tunnel, plus one past the last
+    std::size_t m_firstHiveNode {0};
+    std::vector<float> m_dist;          // shortest distances between nodes (row-major, infinity if there is no route)
+    std::vector<int> m_next;            // first node after the start on the shortest route (row-major, -1 if none)
+};
+
+#endif /* _HOMINGROUTETABLE_H */
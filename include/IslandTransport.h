@@ -0,0 +1,131 @@
+/**
+ * @file
+ *
+ * Declaration of the IslandTransport class and its implementations, used to pass
+ * messages between the coordinator and worker processes in multi-process island mode
+ */
+
+#ifndef _ISLANDTRANSPORT_H
+#define _ISLANDTRANSPORT_H
+
+#include <pagmo/types.hpp>
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+
+enum class IslandMessageType : std::uint32_t {
+    EMIGRANTS,  // worker -> coordinator: individuals selected for migration from one island
+    IMMIGRANTS, // coordinator -> worker: individuals arriving at one island
+    RESULT,     // worker -> coordinator: final population of one island at the end of the run
+};
+
+
+// A single message passed between the coordinator and a worker process. Every message refers to one island.
+struct IslandMessage {
+    IslandMessageType type {IslandMessageType::EMIGRANTS};
+    std::uint32_t islandNum {0};
+    std::int32_t gen {0};               // generation at which the message was sent
+    std::string text;                   // free text (the island's algorithm name in RESULT messages)
+    pagmo::individuals_group_t inds;    // (IDs, decision vectors, fitness vectors)
+    pagmo::vector_double championX;     // best individual ever found on the island (RESULT messages only)
+    pagmo::vector_double championF;
+    std::uint64_t numFitnessCalls {0};  // work done by the island over the run (RESULT messages only)
+    std::uint64_t numEpisodes {0};
+
+    std::vector<char> encode() const;
+    static IslandMessage decode(const std::vector<char>& buf);
+};
+
+
+/**
+ * Abstract transport between one coordinator and a number of worker processes.
+ *
+ * A transport is created with IslandTransport::create() before any islands are built. On return, the
+ * calling process is either the coordinator or one of the workers (as reported by isCoordinator() and
+ * workerId()). The coordinator only talks to the workers and each worker only talks to the coordinator.
+ */
+class IslandTransport {
+
+public:
+    virtual ~IslandTransport() {}
+
+    // Create a transport of the named type ("unix" or "mpi") connecting numWorkers worker processes
+    static std::unique_ptr<IslandTransport> create(const std::string& type, int numWorkers);
+
+    bool isCoordinator() const { return m_workerId < 0; }
+    int workerId() const { return m_workerId; }
+    int numWorkers() const { return m_numWorkers; }
+
+    // coordinator side
+    virtual void sendToWorker(int workerId, const IslandMessage& msg) = 0;
+    virtual IslandMessage receiveFromWorker(int workerId) = 0;
+
+    // worker side
+    virtual void sendToCoordinator(const IslandMessage& msg) = 0;
+    virtual IslandMessage receiveFromCoordinator() = 0;
+
+    virtual std::string name() const = 0;
+
+protected:
+    int m_workerId {-1}; // -1 for the coordinator
+    int m_numWorkers {0};
+};
+
+
+/**
+ * Default transport: the coordinator forks one child process per worker, and each is
+ * connected to the coordinator by its own Unix domain socket pair. All processes therefore
+ * share the coordinator's fully initialised Params and only ever run on a single host.
+ */
+class UnixSocketTransport : public IslandTransport {
+
+public:
+    UnixSocketTransport(int numWorkers);
+    ~UnixSocketTransport();
+
+    void sendToWorker(int workerId, const IslandMessage& msg) override;
+    IslandMessage receiveFromWorker(int workerId) override;
+    void sendToCoordinator(const IslandMessage& msg) override;
+    IslandMessage receiveFromCoordinator() override;
+
+    std::string name() const override { return "unix"; }
+
+private:
+    void sendFrame(int fd, const std::vector<char>& payload);
+    std::vector<char> receiveFrame(int fd, const std::string& peer);
+
+    std::vector<int> m_workerFds;   // coordinator only: one socket per worker
+    std::vector<int> m_workerPids;  // coordinator only: process ID of each worker
+    int m_coordinatorFd {-1};       // worker only
+};
+
+
+#ifdef POLYBEE_USE_MPI
+/**
+ * Optional MPI transport (build with -DPOLYBEE_USE_MPI=ON and launch with e.g.
+ * mpirun -np <island-procs + 1> polybee ...). Rank 0 is the coordinator and ranks
+ * 1..N are the workers, so the islands can span several nodes.
+ */
+class MpiTransport : public IslandTransport {
+
+public:
+    MpiTransport(int numWorkers);
+    ~MpiTransport();
+
+    void sendToWorker(int workerId, const IslandMessage& msg) override;
+    IslandMessage receiveFromWorker(int workerId) override;
+    void sendToCoordinator(const IslandMessage& msg) override;
+    IslandMessage receiveFromCoordinator() override;
+
+    std::string name() const override { return "mpi"; }
+
+private:
+    void sendTo(int rank, const IslandMessage& msg);
+    IslandMessage receiveFrom(int rank);
+};
+#endif
+
+#endif /* _ISLANDTRANSPORT_H */
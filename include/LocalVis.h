@@ -8,8 +8,19 @@
 #define _LOCALVIS_H
 
 #include "raylib.h"
+#include "VisSnapshot.h"
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 class PolyBeeCore;
+class Environment;
+class Tunnel;
+class TrajectoryReader;
 
 enum class DrawState {
     BEES,
@@ -24,6 +35,12 @@ enum class TrailColourMode {
 
 /**
  * The LocalVis class ...
+ *
+ * During a run, the simulation runs on its own thread and LocalVis draws snapshots of it on the main
+ * thread (which owns the window). The simulation thread offers a snapshot after each step via
+ * offerSnapshot(), which only captures one when the previous snapshot has been taken by the renderer,
+ * and renderWhileRunning() draws the latest snapshot each display frame. The EMD between the heatmap
+ * and its target is computed on a background worker thread and shown when it is ready.
  */
 class LocalVis {
 
@@ -32,7 +49,15 @@ public:
     ~LocalVis();
 
     void updateDrawFrame();
+    void renderWhileRunning(const std::atomic<bool>& bSimFinished); // draw frames until the simulation thread has finished
     void continueUntilClosed();
+    void replay(const TrajectoryReader& reader); // play back a recorded trajectory until the window is closed
+
+    bool replaying() const { return m_pReplay != nullptr; }
+
+    // called by the simulation thread after each step
+    void offerSnapshot(int iteration, Environment& env);
+    int delayPerStep() const { return m_delayPerStep.load(std::memory_order_relaxed); }
 
     bool showBees() const { return m_drawState == DrawState::BEES || m_drawState == DrawState::BEES_AND_HEATMAP; }
     bool showHeatmap() const { return m_drawState == DrawState::HEATMAP || m_drawState == DrawState::BEES_AND_HEATMAP; }
@@ -44,16 +69,29 @@ public:
 
 private:
     void drawBees();
+    void drawBeeShape(float x, float y, float angle, float hue);
     void drawHeatmap();
     void drawFlowmap();
-    void drawTunnel();
+    void drawTunnels();
+    void drawTunnel(const Tunnel& tunnel);
     void drawBarriers();
     void drawPatches();
     void drawPlants();
     void drawStatusText();
     void processKeyboardInput();
+    void processSimulationInput();
     void rotateDrawState();
     void showHelpOverlay();
+    void requestEMD(const VisSnapshot& snapshot);
+    void emdWorkerLoop();
+
+    // replay mode
+    void advanceReplay();
+    void drawReplayBees();
+    void drawReplayPlants();
+    void drawReplayStatusText();
+    void processReplayInput();
+    std::size_t replayFrame() const { return static_cast<std::size_t>(m_replayFramePos); }
 
     Color entranceColorFromNetType(NetType netType) const;
     Color entranceColorFromEntranceID(int entranceID) const;
@@ -67,15 +105,38 @@ private:
     bool m_bShowEMD { true };   // Earth Mover's Distance between current heatmap and target heatmap
     bool m_bShowSVF { false };  // Successful Visits Fraction
     bool m_bShowHelpOverlay { false };
-    bool m_bShowFlowmap { false };
+    std::atomic<bool> m_bShowFlowmap { false }; // also read by the simulation thread, to decide whether to capture the flowmap
 
     TrailColourMode m_trailColourMode { TrailColourMode::RANDOM };
 
     Camera2D m_camera;
     Vector2 m_displayOffset { 0.0f, 0.0f };
 
+    VisSnapshotBuffer m_snapshots;
+    std::atomic<int> m_delayPerStep;                    // copy of Params::visDelayPerStep for the simulation thread
+
+    Texture2D m_heatmapTexture {};                      // one texel per heatmap cell
+    std::vector<Color> m_heatmapPixels;
+    std::uint64_t m_heatmapTextureSerial {0};           // serial of the snapshot last uploaded to the texture
+
+    // EMD worker thread, and the state it shares with the render thread (guarded by m_emdMutex)
+    std::thread m_emdWorker;
+    std::mutex m_emdMutex;
+    std::condition_variable m_emdCv;
+    std::vector<std::vector<double>> m_emdInput;        // normalised heatmap to compare with the target
+    int m_emdInputIteration { -1 };
+    bool m_bEmdRequested { false };
+    bool m_bEmdBusy { false };
+    bool m_bStopEmdWorker { false };
     float m_currentEMD;
     int64_t m_currentEMDTime;
+    int m_currentEMDIteration { -1 };                   // iteration that m_currentEMD was computed for
+
+    const TrajectoryReader* m_pReplay { nullptr };      // the trajectory being replayed (nullptr if not in replay mode)
+    double m_replayFramePos { 0.0 };                    // current frame (fractional, so that slow playback speeds work)
+    double m_replaySpeed { 1.0 };                       // frames to advance per display frame
+    std::size_t m_replayCountsFrame { SIZE_MAX };       // the frame that m_replayVisitCounts was filled for
+    std::vector<std::uint32_t> m_replayVisitCounts;     // plant visit counts at the current frame
 };
 
 #endif /* _LOCALVIS_H */
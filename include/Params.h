@@ -58,7 +58,17 @@ struct HiveSpec {
 
 enum class EvolveObjective {
     EMD_TO_TARGET_HEATMAP = 0,
-    FRACTION_FLOWERS_SUCCESSFUL_VISIT_RANGE = 1
+    FRACTION_FLOWERS_SUCCESSFUL_VISIT_RANGE = 1,
+    ENTRANCE_CROSSING_SUCCESS_RATE = 2,
+    VISIT_COUNT_VARIANCE = 3
+};
+
+
+enum class EmdBackend {
+    EXACT,          // OpenCV's exact EMD
+    SINKHORN,       // entropy-regularised optimal transport (Sinkhorn iterations), an upper bound
+    SLICED,         // sum of the 1D distances between the row and column marginals, a lower bound
+    MULTISCALE      // exact EMD on the coarsest grid whose error bound is within tolerance
 };
 
 
@@ -75,9 +85,22 @@ struct EntranceSpec {
     int side;           // 0=North, 1=East, 2=South, 3=West
     int id {0};         // unique ID for this entrance, assigned automatically in Tunnel::addEntrance()
     NetType netType;
+    int tunnel {0};     // which tunnel the entrance belongs to (0=the main tunnel, n=the nth extra tunnel)
 
     EntranceSpec(float e1, float e2, int side) : e1(e1), e2(e2), side(side), netType(NetType::NONE) {}
     EntranceSpec(float e1, float e2, int side, NetType netType) : e1(e1), e2(e2), side(side), netType(netType) {}
+    EntranceSpec(float e1, float e2, int side, NetType netType, int tunnel) :
+        e1(e1), e2(e2), side(side), netType(netType), tunnel(tunnel) {}
+};
+
+
+struct TunnelSpec {
+    float x;    // top-left x position of tunnel in environment coordinates
+    float y;    // top-left y position of tunnel in environment coordinates
+    float w;    // width of tunnel
+    float h;    // height of tunnel
+
+    TunnelSpec(float x, float y, float w, float h) : x(x), y(y), w(w), h(h) {}
 };
 
 
@@ -201,6 +224,43 @@ struct EvolveSpec {
 };
 
 
+enum class NectarRegenCurve {
+    LINEAR,         // a fixed amount of nectar per step, up to the cap
+    SATURATING      // a fixed fraction of the shortfall below the cap per step, so refilling slows as the flower fills
+};
+
+
+// How flowers regenerate nectar after bees have taken it (see the flower-nectar-regen-* parameters)
+struct NectarRegenSpec {
+    // s:c,r,m
+    int   speciesID {0};                            // species this applies to (0 = the default for all species)
+    NectarRegenCurve curve {NectarRegenCurve::LINEAR};
+    float rate {0.0f};                              // amount per step (LINEAR) or fraction of the shortfall per step (SATURATING); 0 = no regeneration
+    float cap {0.0f};                               // amount at which regeneration stops
+
+    NectarRegenSpec() = default;
+    NectarRegenSpec(int speciesID, NectarRegenCurve curve, float rate, float cap) :
+        speciesID(speciesID), curve(curve), rate(rate), cap(cap)
+    {}
+};
+
+
+// One screening stage of a multi-fidelity evaluation schedule (see the fidelity-schedule parameter)
+struct FidelityStage {
+    // i,b,c:p
+    float iterationFraction {1.0f}; // fraction of num-iterations run in each screening trial
+    float beeFraction {1.0f};       // fraction of num-bees used in each screening trial
+    int   heatmapCoarsening {1};    // number of heatmap cells merged along each axis before computing the EMD
+    float promoteFraction {1.0f};   // fraction of candidates (the best scoring ones) promoted to the next stage
+
+    FidelityStage() = default;
+    FidelityStage(float iterationFraction, float beeFraction, int heatmapCoarsening, float promoteFraction) :
+        iterationFraction(iterationFraction), beeFraction(beeFraction),
+        heatmapCoarsening(heatmapCoarsening), promoteFraction(promoteFraction)
+    {}
+};
+
+
 /**
  * @brief Class for flexibily dealing with system parameters
  *
@@ -215,6 +275,10 @@ public:
     // Simulation control
     static std::string strRngSeed;        ///< Seed string used to seed RNG
     static int numIterations;
+    static int numReplicates;   // number of independent runs of a normal simulation, each with a seed derived from strRngSeed
+    static int replicateThreads; // number of threads to run replicates across (0 = one per hardware thread)
+    static bool replicateOutputFiles; // whether to write each replicate's own heatmap, flowmap and run info files
+    static std::string threadAffinity; // how to pin island and replicate threads to CPUs: none, compact, scatter, or a list of CPU sets
 
     // Environment configuration
     static float envW;
@@ -226,6 +290,7 @@ public:
     static float tunnelX; // top-left x position of tunnel in environment coordinates
     static float tunnelY; // top-left y position of tunnel in environment coordinates
     static std::vector<EntranceSpec> entranceSpecs;
+    static std::vector<TunnelSpec> extraTunnelSpecs; // any tunnels in addition to the main one defined by tunnelX, tunnelY etc.
 
     // Tunnel exit net properties
     static float netAntibirdExitProb;       // probability of bee exiting through antibird net
@@ -244,6 +309,12 @@ public:
 
     // Flower configuration
     static float flowerInitialNectar; // initial nectar amount for each flower
+    static float flowerNectarRegenRate; // nectar regenerated per step (linear) or fraction of shortfall regenerated per step (saturating); 0 = none
+    static float flowerNectarCap; // nectar amount at which regeneration stops (0 = flowerInitialNectar)
+    static std::string flowerNectarRegenCurvePvt; // string form of flower-nectar-regen-curve parameter: linear or saturating
+    static std::string flowerNectarRegenSpeciesPvt; // string form of flower-nectar-regen-species parameter, format: s:c,r,m[;s:c,r,m...]
+    static NectarRegenSpec flowerNectarRegen; // regeneration for species not listed in flowerNectarRegenSpecies, set in calculateDerivedParams()
+    static std::vector<NectarRegenSpec> flowerNectarRegenSpecies; // per-species regeneration, parsed from flowerNectarRegenSpeciesPvt in calculateDerivedParams()
     static int minVisitCountSuccess; // minimum number of bee visits for successful pollination
     static int maxVisitCountSuccess; // maximum number of bee visits for successful pollination
 
@@ -263,6 +334,8 @@ public:
     static int beeOnFlowerDuration; // number of simulation steps a bee will stay on a flower having landed on it
     static float beeEnergyMinThreshold; // lower threshold of bee's energy below which it will return to hive
     static float beeEnergyMaxThreshold; // upper threshold of bee's energy above which it will return to hive
+    static bool beeAvoidOccupiedFlowers; // bees don't choose a flower that another bee is already on
+    static float beeOccupiedFlowerRadius; // distance from a flower within which a bee on a flower makes it occupied
 
     // Hive configuration
     static std::vector<HiveSpec> hiveSpecs;
@@ -270,18 +343,37 @@ public:
     // Optimization
     static bool bEvolve; // determines whether to run optimization to match output heatmap against target
     static EvolveObjective evolveObjective; // this is the public-facing version of evolveObjectivePvt that is set in calculateDerivedParams()
-    static int evolveObjectivePvt; // 0 = EMD to target heatmap, 1 = fraction of flowers in successful visit range
+    static int evolveObjectivePvt; // 0 = EMD to target heatmap, 1 = fraction of flowers in successful visit range, 2 = entrance crossing success rate, 3 = visit count variance
+    static std::vector<EvolveObjective> evolveObjectives; // objectives optimised together, parsed from evolveObjectivesPvt in calculateDerivedParams() (just evolveObjective if that is empty)
+    static std::string evolveObjectivesPvt; // string form of evolve-objectives parameter, format: o,o[,o...] (empty = single objective given by evolve-objective)
+    static std::string evolveMoAlgorithm; // Pareto optimiser used when there is more than one objective ("nsga2" or "moead")
+    static EmdBackend evolveEmdApprox; // approximation to the EMD objective used before evolveEmdExactGen, parsed from evolveEmdApproxPvt in calculateDerivedParams()
+    static std::string evolveEmdApproxPvt; // string form of evolve-emd-approx parameter ("none", "sinkhorn", "sliced" or "multiscale")
+    static int evolveEmdExactGen; // generation from which the EMD objective is computed exactly (when evolveEmdApprox is not EXACT; 0 = never)
+    static float emdSinkhornEpsilon; // entropic regularisation of the Sinkhorn EMD approximation, in heatmap cells
+    static int emdSinkhornMaxIterations; // maximum number of Sinkhorn iterations per EMD approximation
+    static float emdMultiscaleTolerance; // largest error bound accepted by the multiscale EMD, as a fraction of the EMD
     static EvolveSpec evolveSpec; // specifications for the optimization process, parsed from evolveSpecPvt in calculateDerivedParams()
     static std::string evolveSpecPvt; // string form of evolve-spec parameter, format: [E:n,w][;][H:i,o,f]]
     static std::string strTargetHeatmapFilename; // CSV file containing target heatmap for optimization
     static int numConfigsPerGen; // number of trials to run during each generation of optimization
     static int numTrialsPerConfig; // number of trials to run for each configuration/individual in each generation
+    static std::vector<FidelityStage> fidelitySchedule; // screening stages run before full-fidelity evaluation, parsed from fidelitySchedulePvt in calculateDerivedParams()
+    static std::string fidelitySchedulePvt; // string form of fidelity-schedule parameter, format: i,b,c:p[;i,b,c:p...] (empty = no screening)
+    static bool surrogate; // pre-screen candidates with a Gaussian process model of fitness, simulating only promising or uncertain ones
+    static float surrogateSimulateFraction; // quantile of archived fitnesses a candidate's lower confidence bound must reach to be simulated
+    static float surrogateKappa; // number of predicted standard deviations subtracted from the predicted fitness to give its lower confidence bound
+    static int surrogateMaxArchive; // maximum number of simulated candidates (the most recent) used to fit the surrogate model
+    static bool commonRandomNumbers; // reseed trial k of every configuration in a generation from the same (generation, k) seed
     static int numGenerations; // number of generations to run the optimization process
     static int numIslands; // number of islands of evolving populations (when num-islands=1, there is just a single population with no migration)
     static int migrationPeriod; // period (number of generations) between each migration event when using multiple islands
     static int migrationNumReplace; // number of individuals on an Island that can be replaced by migrants at each migration event
     static int migrationNumSelect; // number of individuals on an Island that can be selected for migration at each migration event
     static bool useDiverseAlgorithms; // use diverse optimisation algorithms on each island (when num-islands > 1)
+    static bool asyncIslands; // let each island evolve at its own pace, migrating via a shared pool at its own generation milestones (when num-islands > 1)
+    static int islandProcs; // number of worker processes to distribute the islands across (0 = all islands run as threads in this process)
+    static std::string islandTransport; // transport used between worker processes when island-procs > 0 ("unix" or "mpi")
     static bool bridgeOverlapsAllowed; // if false, attempt to resolve overlaps of bridges with patches/other bridges by shifting; if unsuccessful, remove the bridge
 
     // Logging and output
@@ -291,6 +383,10 @@ public:
     static std::string logDir; // directory for output files
     static std::string logFilenamePrefix; // prefix for output file names
     static bool logging; // determines whether output files are written at the end of a run
+    static bool recordBeeCrossings; // keep a record of every tunnel entrance crossing attempt for each bee (for debugging; crossing stats don't need it)
+    static bool recordTrajectory; // write a trajectory file of the run for later replay in the visualiser
+    static int trajectoryFrameInterval; // record a trajectory frame every N iterations
+    static std::string startupCacheDir; // directory in which to cache environment invariants between runs (empty = no disk cache)
     static bool bCommandLineQuiet;
 
     // Visualisation
@@ -298,6 +394,7 @@ public:
     static float visCellSize;
     static int visDelayPerStep;
     static int visBeePathDrawLen; // maximum number of path segments to draw for each bee
+    static std::string replayFilename; // trajectory file to replay in the visualiser instead of running a simulation
 
     // Options that can be specified on command line but are not in a config file
     static std::string strConfigFilename;
@@ -313,6 +410,8 @@ public:
 
     // public helper methods
     static bool initialised() { return bInitialised; }
+    static const NectarRegenSpec& nectarRegenSpec(int speciesID); // how flowers of the given species regenerate nectar
+    static bool multiObjective() { return evolveObjectives.size() > 1; }
     static void calculateDerivedParams();
     static void print(std::ostream& os, bool bGenerateForConfigFile = false);
     static void setAllDefault();
@@ -7,8 +7,16 @@
 #ifndef _PLANT_H
 #define _PLANT_H
 
+struct NectarRegenSpec;
+
+
 /**
  * The Plant class ...
+ *
+ * A flower's nectar regenerates over time (if a regeneration rate is set for its species), but
+ * plants are not updated every step. Instead each plant records the amount it had at the last step
+ * it was updated, and works out its current amount from that in closed form when asked. The cost of
+ * regeneration therefore depends on how often bees visit flowers, not on how many flowers there are.
  */
 class Plant {
 
@@ -21,15 +29,21 @@ public:
     int speciesID() const { return m_speciesID; }
     bool visited() const { return (m_visitCount > 0); }
     int visitCount() const { return m_visitCount; }
-    void incrementVisitCount() { m_visitCount++; }
-    float extractNectar(float amountWanted);
+    void incrementVisitCount() { m_visitCount++; } // (bee visits should go through Environment::recordFlowerVisit())
+    bool countedForSVF() const { return m_bCountedForSVF; }
+    void setCountedForSVF(bool counted) { m_bCountedForSVF = counted; }
+    float nectarAmount(int timestep) const;             // amount of nectar available at the given step
+    float extractNectar(float amountWanted, int timestep);
 
 private:
     float m_x { 0.0f };
     float m_y { 0.0f };
     int m_speciesID { 0 };
     int m_visitCount { 0 };         // number of times this plant has been visited
-    float m_nectarAmount { 0.0f };  // amount of nectar available in the flower
+    bool m_bCountedForSVF { false };// whether this plant is included in the successful visit fraction calculation
+    float m_nectarAmount { 0.0f };  // amount of nectar available in the flower at step m_nectarStep
+    int m_nectarStep { 0 };         // step at which m_nectarAmount was last brought up to date
+    const NectarRegenSpec* m_pNectarRegen { nullptr }; // how this plant's species regenerates nectar
 };
 
 #endif /* _PLANT_H */
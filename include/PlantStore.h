@@ -0,0 +1,74 @@
+/**
+ * @file
+ *
+ * Declaration of the PlantStore class
+ */
+
+#ifndef _PLANTSTORE_H
+#define _PLANTSTORE_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+class Plant;
+
+
+/**
+ * A spatial index over the plants, laid out for the bees' nearby-plant searches.
+ *
+ * The plants' positions are held in separate contiguous x and y arrays, sorted by grid cell
+ * (column-major, i.e. cell (i,j) comes before cell (i,j+1), which comes before cell (i+1,0)),
+ * and within each cell in the order the plants were created. Each cell is therefore a
+ * contiguous range of indices, and the three cells of a 3x3 neighbourhood that share a column
+ * are one contiguous range, so a neighbourhood search runs over just three runs of floats.
+ *
+ * The search itself (gatherWithinRange()) first computes the squared distance to every
+ * candidate in a tight loop over the arrays, which the compiler vectorises, and then compacts
+ * the indices of those within range into a scratch buffer without branching. The scratch buffer
+ * is sized once, when the store is initialised, to the largest 3x3 neighbourhood.
+ *
+ * Plants are visited in the same order as the old per-cell vectors of Plant pointers, so the
+ * candidates (and therefore the bees' random choices among them) are unchanged.
+ */
+class PlantStore {
+
+public:
+    PlantStore() {}
+    ~PlantStore() {}
+
+    // build the store over the given plants, which must not move while the store is in use
+    void initialise(std::vector<Plant>& plants, float width, float height, float cellSize);
+    void clear();
+
+    // Find the plants in the 3x3 grid cells around (x,y) whose squared distance from (x,y) is at most
+    // rangeSq. Their store indices and squared distances are written to scratch buffers, which can be
+    // read with index() and distSq() until the next call. Returns the number found.
+    std::size_t gatherWithinRange(float x, float y, float rangeSq) const;
+
+    std::uint32_t index(std::size_t n) const { return m_scratchIndices[n]; }
+    float distSq(std::size_t n) const { return m_scratchDistSq[n]; }
+
+    Plant* plant(std::uint32_t index) const { return m_plants[index]; }
+    float x(std::uint32_t index) const { return m_x[index]; }
+    float y(std::uint32_t index) const { return m_y[index]; }
+    std::size_t size() const { return m_plants.size(); }
+
+private:
+    std::size_t cellIndex(float x, float y) const;
+
+    float m_cellSize {1.0f};
+    std::size_t m_gridW {1};
+    std::size_t m_gridH {1};
+
+    std::vector<float> m_x;                     // plant x positions, sorted by cell
+    std::vector<float> m_y;                     // plant y positions, sorted by cell
+    std::vector<Plant*> m_plants;               // the plants themselves, in the same order
+    std::vector<std::uint32_t> m_cellStart;     // index of the first plant in each cell, plus one past the last
+
+    // scratch buffers for gatherWithinRange() (a PlantStore is only used by one thread at a time)
+    mutable std::vector<float> m_scratchDistSq;
+    mutable std::vector<std::uint32_t> m_scratchIndices;
+};
+
+#endif /* _PLANTSTORE_H */
@@ -14,12 +14,15 @@
 #include <memory>
 #include <vector>
 #include <string>
+#include <atomic>
 #include "Environment.h"
 #include "Params.h"
 #include "LocalVis.h"
 #include "Bee.h"
 #include "Tunnel.h"
 #include "Heatmap.h"
+#include "EpisodeArena.h"
+#include "Trajectory.h"
 
 using State = unsigned char;
 
@@ -33,12 +36,13 @@ public:
     // constructors and destructors
     PolyBeeCore(int argc, char* argv[]);
     PolyBeeCore(const PolyBeeCore& other) = delete; // disable copy constructor
-    PolyBeeCore(const PolyBeeCore& other, const std::string& rngSeedStr);
+    PolyBeeCore(const PolyBeeCore& other, const std::string& rngSeedStr, std::size_t islandNum);
     ~PolyBeeCore() {}
 
     //////////////////////////////////////////////////////////////
     // public methods
     void run(bool logIfRequested = true);
+    void replay(); // replay the trajectory file given by Params::replayFilename in the visualiser
     void earlyExit();
     void resetForNewRun(const std::vector<HiveSpec>& hiveSpecs, const std::vector<PatchSpec>& bridgeSpecs);
 
@@ -47,6 +51,8 @@ public:
     const Heatmap& getHeatmap() const { return m_env.getHeatmap(); }
     double getSuccessfulVisitFraction() const { return m_env.getSuccessfulVisitFraction(); }
     Tunnel& getTunnel() { return m_env.getTunnel(); }
+    EpisodeArena& getEpisodeArena() { return m_episodeArena; }
+    const EpisodeArena& getEpisodeArena() const { return m_episodeArena; }
     const std::vector<Hive>& getHives() const { return m_env.getHives(); }
     const std::vector<Bee>& getBees() const { return m_env.getBees(); }
 
@@ -56,10 +62,19 @@ public:
 
     const std::string& getTimestampStr() const { return m_timestampStr; }
 
+    int currentIteration() const { return m_iIteration; } // the step currently being run (-1 before the first)
     std::size_t getIslandNum() const { return m_islandNum; }
     bool isMasterCore() const { return m_islandNum == 0; }
     std::size_t evaluationCount() const { return m_evaluationCount; }
-    void incrementEvaluationCount() { ++m_evaluationCount; }
+    void incrementEvaluationCount(std::size_t n = 1) { m_evaluationCount += n; }
+    void setEvaluationCount(std::size_t n) { m_evaluationCount = n; }
+    std::size_t fitnessCallCount() const { return m_fitnessCallCount; }
+    void incrementFitnessCallCount() { ++m_fitnessCallCount; }
+    std::size_t episodeCount() const { return m_episodeCount; }
+    void incrementEpisodeCount() { ++m_episodeCount; }
+    bool isRescoring() const { return m_bRescoring; }
+    void setRescoring(bool rescoring) { m_bRescoring = rescoring; }
+    void setFidelity(float iterationFraction, float beeFraction); // reduced-fidelity runs for multi-fidelity screening
 
     //////////////////////////////////////////////////////////////
     // public members
@@ -81,12 +96,17 @@ private:
     //////////////////////////////////////////////////////////////
     // private methods
     void generateTimestampString();
+    template<typename Features> void runSimulationLoop();
     bool stopCriteriaReached();
+    int iterationLimit() const;
     void writeOutputFiles() const;
+    void writeResultFiles() const; // the output files other than the config file
+    std::string outputFilename(const std::string& tag, const std::string& extension) const;
     void printRunInfo(std::ostream& os, const std::string& filename) const;
 
     //////////////////////////////////////////////////////////////
     // private members
+    EpisodeArena m_episodeArena; // must be declared before m_env, as the bees allocate from it
     Environment m_env;
 
     bool m_bRngInitialised;
@@ -95,14 +115,22 @@ private:
 
     int m_iIteration {-1};
     std::unique_ptr<LocalVis> m_pLocalVis;
+    std::unique_ptr<TrajectoryRecorder> m_pTrajectoryRecorder; // only exists while a run is being recorded
 
-    bool m_bEarlyExitRequested {false};
-    bool m_bPaused {false};
+    std::atomic<bool> m_bEarlyExitRequested {false};   // (atomic as LocalVis sets these from the render thread
+    std::atomic<bool> m_bPaused {false};               // while the simulation thread is running)
+
+    float m_iterationFraction {1.0f};   // fraction of Params::numIterations to run (< 1 only when screening in PolyBeeEvolve)
 
     std::size_t m_islandNum {0};        // island number for this PolyBeeCore instance (used in pagmo archipelago runs)
 
     std::size_t m_evaluationCount {0};  // count of number of fitness evaluations performed for this PolyBeeCore instance
                                         // (only used when running PolyBeeEvolve)
+    std::size_t m_fitnessCallCount {0}; // number of calls to the fitness function, however each one was evaluated
+    std::size_t m_episodeCount {0};     // number of episodes actually simulated, at any fidelity (only used when
+                                        // running PolyBeeEvolve; unlike m_evaluationCount, excludes candidates
+                                        // skipped by the surrogate or rejected before full-fidelity evaluation)
+    bool m_bRescoring {false};          // set while PolyBeeEvolve re-evaluates a population with the exact EMD
 
     //////////////////////////////////////////////////////////////
     // private static members
@@ -112,6 +140,7 @@ private:
     //////////////////////////////////////////////////////////////
     // friends
     friend LocalVis;
+    friend class PolyBeeReplicates;
 };
 
 #endif /* _PolyBeeCore_H */
@@ -9,14 +9,21 @@
 
 #include "PolyBeeCore.h"
 #include "Params.h"
+#include "IslandTransport.h"
+#include "Surrogate.h"
 #include <pagmo/population.hpp>
 #include <pagmo/algorithm.hpp>
 #include <pagmo/archipelago.hpp>
 #include <pagmo/rng.hpp>
+#include <pagmo/island.hpp>
 
 #include <vector>
+#include <string>
 #include <memory>
 #include <ostream>
+#include <mutex>
+#include <deque>
+#include <optional>
 
 class PolyBeeEvolve;
 
@@ -40,6 +47,9 @@ struct PolyBeeOptimization {
     // Define the number of integer (as opposed to continuous) decision variables
     inline pagmo::vector_double::size_type get_nix() const;
 
+    // Define the number of objectives (more than one when Params::evolveObjectives lists several)
+    pagmo::vector_double::size_type get_nobj() const { return Params::evolveObjectives.size(); }
+
     // Pointer back to the PolyBeeEvolve object
     PolyBeeEvolve* m_pPolyBeeEvolve {nullptr};
 
@@ -74,6 +84,9 @@ private:
         PolyBeeCore& core, const pagmo::vector_double& dv, const std::vector<float>& tunnelLengths,
         std::vector<EntranceSpec>& entranceSpecs, std::vector<HiveSpec>& hiveSpecs,
         std::vector<PatchSpec>& bridgeSpecs, std::vector<BarrierSpec>& barrierSpecs) const;
+    std::vector<pagmo::vector_double> runTrials(PolyBeeCore& core, const std::vector<HiveSpec>& hiveSpecs,
+        const std::vector<PatchSpec>& bridgeSpecs, int gen, int heatmapCoarsening) const;
+    double objectiveValue(const PolyBeeCore& core, EvolveObjective objective, int gen, int heatmapCoarsening) const;
 
     void initialiseEntrancesFromDV(
         PolyBeeCore& core, const pagmo::vector_double& dv, const std::vector<float>& tunnelLengths,
@@ -162,6 +175,79 @@ private:
 };
 
 
+// Thread-safe pool of migrants used in asynchronous island mode (async-islands=true).
+// Each island has its own inbox. An island posts its emigrants to the inboxes of its ring
+// neighbours, and collects whatever has arrived in its own inbox, whenever it reaches one
+// of its own migration milestones - no island ever waits for any other.
+class MigrantPool {
+public:
+    MigrantPool(std::size_t numIslands);
+
+    // Add migrants to the inbox of the specified destination island
+    void post(std::size_t destIsland, const pagmo::individuals_group_t& migrants);
+
+    // Remove and return all migrants currently waiting in the inbox of the specified island
+    pagmo::individuals_group_t collect(std::size_t islandNum);
+
+    // Islands to which the specified island sends its emigrants (same ring as used by the synchronous archipelago)
+    std::vector<std::size_t> ringNeighbours(std::size_t islandNum) const;
+
+    // Share out the given emigrants from the specified island in turn among its ring neighbours (so a single
+    // migrant only goes to one other island, as with migrant_handling::evict in the synchronous archipelago).
+    // Returns the destination island of each emigrant.
+    std::vector<std::size_t> postToNeighbours(std::size_t srcIsland, const pagmo::individuals_group_t& emigrants);
+
+private:
+    std::mutex m_mutex;
+    std::vector<pagmo::individuals_group_t> m_inboxes; // one per island
+};
+
+
+// Per-island record of the per-trial fitness values of every configuration evaluated in the current
+// generation, used to measure the variance reduction achieved in common-random-numbers mode
+struct CrnStats {
+    int gen {-1};                                       // generation currently being recorded
+    std::vector<std::vector<double>> trialValues;       // per-trial fitness values of each configuration in gen
+    double sumVarDiff {0.0};                            // running totals over all generations so far of var(a-b)
+    double sumVarIndep {0.0};                           // and of var(a)+var(b), across all pairs of configurations
+};
+
+
+// Per-island record used to make promotion decisions in multi-fidelity mode: the most recent screening
+// scores at each stage of the fidelity schedule (one generation's worth), and the worst full-fidelity
+// fitness seen so far, below which rejected candidates are ranked
+struct FidelityStats {
+    std::vector<std::deque<double>> recentScores;       // one per stage of Params::fidelitySchedule
+    std::optional<double> worstFullFidelityValue;
+};
+
+
+// Surrogate model's view of one candidate, as returned by PolyBeeEvolve::surrogatePreScreen()
+struct SurrogatePrediction {
+    bool valid {false};     // false if the model has not been fitted yet
+    double mean {0.0};
+    double stdDev {0.0};
+    double threshold {0.0}; // fitness a candidate's lower confidence bound must reach to be simulated
+};
+
+
+// Per-island surrogate model and archive of simulated candidates (surrogate-assisted mode), plus counts
+// of candidates and of predicted vs actual fitness values used to report on the model each generation
+struct SurrogateStats {
+    std::unique_ptr<Surrogate> model;
+    std::deque<pagmo::vector_double> archiveX;  // decision vectors of the most recent simulated candidates
+    std::deque<double> archiveY;                // and their (median) fitness values
+    double threshold {0.0};
+    int gen {-1};
+    int numCandidates {0};
+    int numSimulated {0};
+    long totalCandidates {0};
+    long totalSimulated {0};
+    std::vector<double> predicted;              // predicted and actual fitness of each simulated candidate in gen
+    std::vector<double> actual;                 // (only those for which the model had been fitted)
+};
+
+
 /**
  * The PolyBeeEvolve class ...
  */
@@ -175,17 +261,71 @@ public:
 
     PolyBeeCore& polyBeeCore(std::size_t islandNum = 0);
 
+    // Called from PolyBeeOptimization::fitness() in common-random-numbers mode with the per-trial fitness
+    // values of each configuration. These are empty for candidates rejected by screening or the surrogate,
+    // so only the candidates simulated in full are counted. (Each island's fitness evaluations are only
+    // ever run from one thread at a time, and each island has its own CrnStats, so no locking is needed.)
+    void recordTrialValues(std::size_t islandNum, int gen, int configNum, const std::vector<double>& values);
+
+    // Called from PolyBeeOptimization::fitness() in multi-fidelity mode (again, each island has its own
+    // FidelityStats). promoteCandidate() records a candidate's screening score at the given stage and
+    // returns whether it is among the best promote-fraction of the latest num-configs-per-gen scores at that
+    // stage, setting threshold to the cut-off score. Until a full generation of scores has been seen at a
+    // stage, every candidate is promoted.
+    bool promoteCandidate(std::size_t islandNum, std::size_t stage, double screenValue, double& threshold);
+    void recordFullFidelityValue(std::size_t islandNum, double value);
+    double rejectedFitness(std::size_t islandNum, double screenValue, double threshold) const;
+
+    // Called from PolyBeeOptimization::fitness() in surrogate-assisted mode (each island has its own
+    // SurrogateStats). surrogatePreScreen() returns whether the candidate should be simulated, and
+    // recordSurrogateResult() adds simulated candidates to the island's archive (the generation is the one
+    // surrogatePreScreen() was last called for, which resets the per-generation counts).
+    bool surrogatePreScreen(std::size_t islandNum, int gen, const pagmo::vector_double& dv,
+        const pagmo::vector_double& lowerBounds, const pagmo::vector_double& upperBounds, SurrogatePrediction& prediction);
+    void recordSurrogateResult(std::size_t islandNum, int configNum, const pagmo::vector_double& dv,
+        const SurrogatePrediction& prediction, bool simulated, double value);
+
 private:
     void evolveSinglePop();
     void evolveArchipelago();
+    void evolveArchipelagoAsync();
+    void evolveMultiProcess();
+    std::vector<std::size_t> addIslandsToArchipelago(pagmo::archipelago& arc, int numProcs = 1, int procId = 0);
+    void evolveIslandAsync(pagmo::island& isl, std::size_t islandNum, MigrantPool& pool, int& gensCompleted);
+    void migrateAsync(pagmo::island& isl, std::size_t islandNum, int gen, MigrantPool& pool);
+    void runIslandCoordinator(IslandTransport& transport);
+    void runIslandWorker(IslandTransport& transport);
+    pagmo::individuals_group_t selectEmigrants(const pagmo::population& pop, std::size_t islandNum);
+    int receiveImmigrants(pagmo::island& isl, std::size_t islandNum, const pagmo::individuals_group_t& immigrants);
+    void logEmigration(const pagmo::individuals_group_t& emigrants, const std::vector<std::size_t>& destinations,
+        std::size_t srcIsland, int gen) const;
+    bool isMigrationGen(int gen) const;
+    bool isEmdSwitchGen(int gen) const;
+    pagmo::population rescoredWithExactEmd(const pagmo::population& pop, std::size_t islandNum);
+    pagmo::algorithm multiObjectiveAlgorithm(unsigned int numGens) const;
+    void writeParetoFront(std::ostream& os, const std::vector<pagmo::vector_double>& dvs,
+        const std::vector<pagmo::vector_double>& fvs) const;
+    static std::string paretoSummary(const std::vector<pagmo::vector_double>& fvs);
     void writeResultsFile(const pagmo::algorithm& algo, const pagmo::population& pop, bool alsoToStdout) const;
     void writeResultsFileHelper(std::ostream& os, const pagmo::algorithm& algo, const pagmo::population& pop) const;
-    void writeResultsFileArchipelago(const pagmo::archipelago& arc, bool alsoToStdout) const;
-    void writeResultsFileArchipelagoHelper(std::ostream& os, const pagmo::archipelago& arc) const;
+    void writeResultsFileArchipelago(const pagmo::archipelago& arc, bool alsoToStdout,
+        const std::vector<int>& islandGens = {}) const;
+    void writeResultsFileArchipelagoHelper(std::ostream& os, const pagmo::archipelago& arc,
+        const std::vector<int>& islandGens) const;
     void showBestIndividuals(const pagmo::archipelago& arc, int gen) const;
+    void showBestIndividual(const pagmo::population& pop, std::size_t islandNum, int gen) const;
+    void reportCrnStats(std::size_t islandNum);
+    void reportSurrogateStats(std::size_t islandNum) const;
+    void writeResultsFileMultiProcess(const std::vector<IslandMessage>& results, bool alsoToStdout) const;
+    void writeResultsFileMultiProcessHelper(std::ostream& os, const std::vector<IslandMessage>& results) const;
 
     PolyBeeCore& m_masterPolyBeeCore;
     std::vector<std::unique_ptr<PolyBeeCore>> m_islandPolyBeeCores; // one per island
+    std::vector<CrnStats> m_crnStats; // one per island (only used in common-random-numbers mode)
+    std::vector<FidelityStats> m_fidelityStats; // one per island (only used in multi-fidelity mode)
+    std::vector<SurrogateStats> m_surrogateStats; // one per island (only used in surrogate-assisted mode)
+    std::size_t m_workerFitnessCallCount {0}; // fitness calls and episodes reported by the worker processes
+    std::size_t m_workerEpisodeCount {0};     // (only used by the coordinator in multi-process island mode)
 };
 
 #endif /* _POLYBEEEVOLVE_H */
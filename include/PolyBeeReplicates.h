@@ -0,0 +1,65 @@
+/**
+ * @file
+ *
+ * Declaration of the PolyBeeReplicates class
+ */
+
+#ifndef _POLYBEEREPLICATES_H
+#define _POLYBEEREPLICATES_H
+
+#include "PolyBeeCore.h"
+#include "ReplicateAggregator.h"
+#include <vector>
+#include <memory>
+#include <string>
+#include <ostream>
+#include <fstream>
+#include <mutex>
+#include <cstddef>
+
+
+/**
+ * Runs Params::numReplicates independent replicates of a normal simulation in one process, spread across
+ * a pool of threads.
+ *
+ * Each thread has its own PolyBeeCore (the first is the master core passed to the constructor, the rest
+ * are copies of it), which is reset and reseeded for every replicate it runs, so the cost of setting up
+ * an environment is paid once per thread rather than once per replicate. Replicate r is seeded with
+ * "<rng-seed>-rep-<r>", so its results don't depend on how many threads there are or which thread
+ * runs it.
+ *
+ * As each replicate finishes, its results are folded into its thread's ReplicateAggregator, and the
+ * aggregators are merged at the end, so memory use doesn't grow with the number of replicates. (With
+ * more than one thread, the order in which results are folded in depends on scheduling, so the last
+ * digits of the aggregates can vary from run to run.)
+ *
+ * If logging is enabled, the config file is written once, a CSV with one line per replicate is written
+ * as they finish, and the aggregate file is written at the end. Each replicate's own heatmap, flowmap
+ * and run info files (tagged "-rep-<r>") are only written if Params::replicateOutputFiles is set.
+ */
+class PolyBeeReplicates {
+
+public:
+    PolyBeeReplicates(PolyBeeCore& core);
+    ~PolyBeeReplicates() {}
+
+    void run();
+
+private:
+    void runReplicate(PolyBeeCore& core, ReplicateAggregator& aggregator, std::size_t replicateNum);
+    void printSummary(std::ostream& os, const ReplicateAggregator& aggregate, double seconds) const;
+
+    PolyBeeCore& m_masterPolyBeeCore;
+    std::string m_baseTimestampStr;     // the master core's timestamp, which each replicate's output filenames extend
+    std::vector<std::unique_ptr<PolyBeeCore>> m_threadPolyBeeCores;  // cores for threads other than the first
+    std::size_t m_numThreads {1};
+    bool m_bHasTarget {false};          // whether a target heatmap was given, so EMD can be reported
+
+    std::vector<std::string> m_scalarNames;             // the results recorded for each replicate
+    std::vector<ReplicateAggregator> m_aggregators;     // one per thread
+
+    std::ofstream m_resultsFile;        // one line per replicate, in the order they finish
+    std::mutex m_resultsFileMutex;
+};
+
+#endif /* _POLYBEEREPLICATES_H */
@@ -0,0 +1,75 @@
+/**
+ * @file
+ *
+ * Declaration of the ReplicateAggregator class
+ */
+
+#ifndef _REPLICATEAGGREGATOR_H
+#define _REPLICATEAGGREGATOR_H
+
+#include "RunningStats.h"
+#include <vector>
+#include <string>
+#include <ostream>
+#include <cstddef>
+
+class Environment;
+
+
+/**
+ * Accumulates statistics over replicate runs as they finish, in memory that doesn't grow with the
+ * number of replicates.
+ *
+ * For each scalar result (such as the SVF or final EMD) and for each cell of the normalised heatmap it
+ * keeps a RunningStats and a QuantileSketch. The flowmap's per-cell movement counts and double-angle
+ * sums are simply added up, which gives exactly the flowmap of all the replicates' movements together
+ * (as tools/merge_flowmaps.py does from the per-replicate files), and the per-cell counts also get a
+ * RunningStats.
+ *
+ * Aggregators for different sets of replicates (e.g. one per thread) can be merged.
+ */
+class ReplicateAggregator {
+
+public:
+    // scalarNames gives the name of each value that will be passed to addRun()
+    ReplicateAggregator(const std::vector<std::string>& scalarNames, const Environment& env);
+
+    void addRun(const Environment& env, const std::vector<double>& scalars);
+    void merge(const ReplicateAggregator& other);
+
+    std::size_t count() const { return m_numRuns; }
+
+    void printScalarSummary(std::ostream& os) const;
+    void write(std::ostream& os) const; // scalar summary, then one grid per section (see user guide)
+
+private:
+    struct CellStats {
+        RunningStats stats;
+        QuantileSketch sketch;
+    };
+
+    struct FlowmapCellSums {
+        long count {0};
+        double sumCosTwoTheta {0.0};
+        double sumSinTwoTheta {0.0};
+        RunningStats countStats;
+    };
+
+    template<typename F>
+    void writeGrid(std::ostream& os, const std::string& section, int sizeX, int sizeY, F cellValue) const;
+
+    std::size_t m_numRuns {0};
+
+    std::vector<std::string> m_scalarNames;
+    std::vector<CellStats> m_scalars;
+
+    int m_heatmapW {0};
+    int m_heatmapH {0};
+    std::vector<CellStats> m_heatmapCells;          // indexed by x * m_heatmapH + y
+
+    int m_flowmapW {0};
+    int m_flowmapH {0};
+    std::vector<FlowmapCellSums> m_flowmapCells;    // indexed by x * m_flowmapH + y
+};
+
+#endif /* _REPLICATEAGGREGATOR_H */
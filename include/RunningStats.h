@@ -0,0 +1,77 @@
+/**
+ * @file
+ *
+ * Declaration of the RunningStats and QuantileSketch classes, which summarise a stream of values in
+ * constant (or logarithmic) memory and can be merged
+ */
+
+#ifndef _RUNNINGSTATS_H
+#define _RUNNINGSTATS_H
+
+#include <vector>
+#include <cstddef>
+#include <limits>
+
+
+/**
+ * Count, mean, variance, minimum and maximum of a stream of values, using Welford's algorithm (so the
+ * variance is accurate even when the values are large compared with their spread). Two RunningStats
+ * can be merged, giving the same result (up to rounding) as if all the values had been added to one.
+ */
+class RunningStats {
+
+public:
+    void add(double x);
+    void merge(const RunningStats& other);
+
+    std::size_t count() const { return m_count; }
+    double mean() const { return m_mean; }
+    double variance() const; // sample variance (0 if fewer than 2 values)
+    double sd() const;
+    double min() const { return m_min; }
+    double max() const { return m_max; }
+
+private:
+    std::size_t m_count {0};
+    double m_mean {0.0};
+    double m_m2 {0.0};      // sum of squared differences from the mean
+    double m_min {std::numeric_limits<double>::infinity()};
+    double m_max {-std::numeric_limits<double>::infinity()};
+};
+
+
+/**
+ * An approximate, mergeable quantile sketch.
+ *
+ * Values are kept in levels, where each value at level i stands for 2^i of the values added. When a
+ * level holds k values it is sorted and every other value is promoted to the next level (alternating
+ * between the odd and even ones, so the result isn't biased). If a level has an odd number of values,
+ * one is left behind, alternately the smallest and the largest, for the same reason. Memory is
+ * O(k log(n/k)) for n values, and quantiles are exact while fewer than k values have been added (the
+ * first compaction happens when the k-th is added). Compaction is deterministic, so the same values
+ * added in the same order always give the same sketch.
+ */
+class QuantileSketch {
+
+public:
+    explicit QuantileSketch(std::size_t k = 64) : m_k(k) {}
+
+    void add(double x);
+    void merge(const QuantileSketch& other);
+
+    std::size_t count() const { return m_count; }
+
+    // the value at quantile q (between 0 and 1) by the nearest-rank method, or NaN if the sketch is empty
+    double quantile(double q) const;
+
+private:
+    void compact();
+
+    std::size_t m_k;
+    std::size_t m_count {0};
+    std::vector<std::vector<double>> m_levels;
+    bool m_bKeepOdd {false};    // which half of a level to promote at the next compaction
+    bool m_bLeaveLargest {true}; // which end of a level with an odd number of values to leave behind next
+};
+
+#endif /* _RUNNINGSTATS_H */
@@ -0,0 +1,98 @@
+/**
+ * @file
+ *
+ * Compile-time bundles of optional simulation features, used to specialise the
+ * simulation step loop for the features that a particular configuration actually uses
+ */
+
+#ifndef _SIMFEATURES_H
+#define _SIMFEATURES_H
+
+#include <utility>
+
+
+/**
+ * The step loop (Environment::update() and Bee::update(), plus the Bee methods they call) is
+ * templated on one of these bundles. Checks for features that are not in use are then removed
+ * at compile time, rather than being made for every bee on every step. The run-time choice of
+ * bundle is made once per run in PolyBeeCore::run(), via dispatchSimFeatures().
+ */
+template<bool Barriers, bool Nets, bool Energetics, bool Paths, bool Flowmap, bool BeeInteractions>
+struct SimFeatures {
+    static constexpr bool hasBarriers = Barriers;       // the environment contains at least one barrier
+    static constexpr bool hasNets = Nets;               // at least one tunnel entrance has a net over it
+    static constexpr bool hasEnergetics = Energetics;   // bees' energy levels change, and can send them home
+    static constexpr bool recordPaths = Paths;          // bees keep a record of their recent positions
+    static constexpr bool recordFlowmap = Flowmap;      // the flowmap is updated during the run
+    static constexpr bool hasBeeInteractions = BeeInteractions; // bees sense each other (via the bee grid, rebuilt every step)
+};
+
+
+/**
+ * The same set of flags as SimFeatures, but known only at run time
+ * (see Environment::simFeatureFlags())
+ */
+struct SimFeatureFlags {
+    bool hasBarriers {true};
+    bool hasNets {true};
+    bool hasEnergetics {true};
+    bool recordPaths {true};
+    bool recordFlowmap {true};
+    bool hasBeeInteractions {true};
+};
+
+
+namespace Polybee {
+namespace detail {
+
+    template<bool... Fixed, typename Fn, typename... Rest>
+    void dispatchSimFeatures(Fn&& fn, bool first, Rest... rest) {
+        if constexpr (sizeof...(Rest) == 0) {
+            if (first) {
+                fn.template operator()<SimFeatures<Fixed..., true>>();
+            }
+            else {
+                fn.template operator()<SimFeatures<Fixed..., false>>();
+            }
+        }
+        else {
+            if (first) {
+                dispatchSimFeatures<Fixed..., true>(std::forward<Fn>(fn), rest...);
+            }
+            else {
+                dispatchSimFeatures<Fixed..., false>(std::forward<Fn>(fn), rest...);
+            }
+        }
+    }
+
+} // namespace detail
+} // namespace Polybee
+
+
+// Call fn.template operator()<Features>(), where Features is the SimFeatures instantiation that
+// matches the given flags. fn is typically a lambda of the form []<typename Features>() { ... }
+template<typename Fn>
+void dispatchSimFeatures(const SimFeatureFlags& flags, Fn&& fn) {
+    Polybee::detail::dispatchSimFeatures<>(std::forward<Fn>(fn),
+        flags.hasBarriers, flags.hasNets, flags.hasEnergetics, flags.recordPaths, flags.recordFlowmap,
+        flags.hasBeeInteractions);
+}
+
+
+// Expand X(SimFeatures<...>) for every possible SimFeatures instantiation. This is used to
+// explicitly instantiate templates that are defined in a .cpp file. X must be a variadic macro,
+// as the template argument list contains commas.
+#define POLYBEE_SIM_FEATURES_6(X, a, b, c, d, e) \
+    X(SimFeatures<a, b, c, d, e, false>) X(SimFeatures<a, b, c, d, e, true>)
+#define POLYBEE_SIM_FEATURES_5(X, a, b, c, d) \
+    POLYBEE_SIM_FEATURES_6(X, a, b, c, d, false) POLYBEE_SIM_FEATURES_6(X, a, b, c, d, true)
+#define POLYBEE_SIM_FEATURES_4(X, a, b, c) \
+    POLYBEE_SIM_FEATURES_5(X, a, b, c, false) POLYBEE_SIM_FEATURES_5(X, a, b, c, true)
+#define POLYBEE_SIM_FEATURES_3(X, a, b) \
+    POLYBEE_SIM_FEATURES_4(X, a, b, false) POLYBEE_SIM_FEATURES_4(X, a, b, true)
+#define POLYBEE_SIM_FEATURES_2(X, a) \
+    POLYBEE_SIM_FEATURES_3(X, a, false) POLYBEE_SIM_FEATURES_3(X, a, true)
+#define POLYBEE_FOR_EACH_SIM_FEATURES(X) \
+    POLYBEE_SIM_FEATURES_2(X, false) POLYBEE_SIM_FEATURES_2(X, true)
+
+#endif /* _SIMFEATURES_H */
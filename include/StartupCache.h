@@ -0,0 +1,62 @@
+/**
+ * @file
+ *
+ * Declaration of the StartupCache class
+ */
+
+#ifndef _STARTUPCACHE_H
+#define _STARTUPCACHE_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <map>
+#include <cstdint>
+
+class Heatmap;
+
+
+/**
+ * The parts of an environment's set-up that depend only on the heatmap dimensions and the target
+ * heatmap file, and so are the same for every PolyBeeCore in a process. They are never changed once
+ * computed, so every core holds a pointer to the same copy.
+ */
+struct EnvironmentInvariants {
+    int numCellsX {0};
+    int numCellsY {0};
+    float highEmd {0.0f};                                           // EMD between the uniform target and anti-target heatmaps
+    std::vector<std::vector<double>> targetHeatmapNormalised;       // indexed [x][y]; empty if no target heatmap was given
+    std::vector<std::vector<double>> uniformTargetNormalised;       // equal density in every cell
+    std::vector<std::vector<double>> antiTargetNormalised;          // all density in the top-left cell
+};
+
+
+/**
+ * Computes the EnvironmentInvariants once per process, however many cores (islands, replicate threads)
+ * are created.
+ *
+ * If Params::startupCacheDir is set, the invariants are also saved there, in a file named after a hash
+ * of the heatmap dimensions and the contents of the target heatmap file, so later runs with the same
+ * set-up can load them instead of parsing the target file and computing the high EMD again. A cache
+ * file that can't be read, or was written for a different set-up, is ignored and rewritten.
+ */
+class StartupCache {
+
+public:
+    // Return the invariants for the given (initialised) heatmap and the current target heatmap file
+    static std::shared_ptr<const EnvironmentInvariants> environmentInvariants(const Heatmap& heatmap);
+
+private:
+    static std::shared_ptr<const EnvironmentInvariants> compute(const Heatmap& heatmap);
+    static void initialiseReferenceHeatmaps(EnvironmentInvariants& invariants);
+    static std::uint64_t diskKey(const Heatmap& heatmap);
+    static std::shared_ptr<const EnvironmentInvariants> load(const std::string& filename, std::uint64_t key,
+        const Heatmap& heatmap);
+    static void save(const std::string& filename, std::uint64_t key, const EnvironmentInvariants& invariants);
+
+    static std::mutex s_mutex;
+    static std::map<std::string, std::shared_ptr<const EnvironmentInvariants>> s_entries;  // keyed by dimensions and target filename
+};
+
+#endif /* _STARTUPCACHE_H */
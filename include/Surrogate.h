@@ -0,0 +1,61 @@
+/**
+ * @file
+ *
+ * Declaration of the Surrogate class, a Gaussian process regression model of the fitness
+ * landscape used by PolyBeeEvolve to pre-screen candidates before simulating them
+ */
+
+#ifndef _SURROGATE_H
+#define _SURROGATE_H
+
+#include <pagmo/types.hpp>
+
+#include <vector>
+#include <utility>
+
+
+/**
+ * Gaussian process regression with a squared exponential kernel.
+ *
+ * Decision vectors are scaled to the unit box using the problem bounds and fitness values are
+ * standardised before fitting. The kernel length scale and the noise level are chosen from a small
+ * grid by maximising the log marginal likelihood each time the model is fitted, so there are no
+ * hyperparameters to tune by hand. Integer decision variables are simply treated as continuous.
+ */
+class Surrogate {
+
+public:
+    Surrogate(const pagmo::vector_double& lowerBounds, const pagmo::vector_double& upperBounds);
+
+    // fit the model to the given (decision vector, fitness) pairs, replacing any previous fit
+    void fit(const std::vector<pagmo::vector_double>& xs, const std::vector<double>& ys);
+
+    bool isFitted() const { return !m_alpha.empty(); }
+
+    // return the predicted mean and standard deviation of the fitness at x
+    std::pair<double, double> predict(const pagmo::vector_double& x) const;
+
+    double lengthScale() const { return m_lengthScale; }
+    double noiseVariance() const { return m_noiseVariance; }
+
+private:
+    std::vector<double> scaled(const pagmo::vector_double& x) const;
+    double kernel(const std::vector<double>& a, const std::vector<double>& b) const;
+    bool choleskyFactorise(std::vector<double>& k, std::size_t n) const;
+    void choleskySolve(const std::vector<double>& l, std::size_t n, std::vector<double>& b) const;
+    void forwardSubstitute(const std::vector<double>& l, std::size_t n, std::vector<double>& b) const;
+
+    pagmo::vector_double m_lowerBounds;
+    pagmo::vector_double m_upperBounds;
+
+    double m_lengthScale {1.0};
+    double m_noiseVariance {0.01};  // relative to the (unit) signal variance of the standardised fitness values
+    double m_yMean {0.0};
+    double m_yStd {1.0};
+
+    std::vector<std::vector<double>> m_xs;  // scaled training inputs
+    std::vector<double> m_chol;             // lower triangular Cholesky factor of the kernel matrix (row major)
+    std::vector<double> m_alpha;            // K^-1 y for the standardised training targets
+};
+
+#endif /* _SURROGATE_H */
@@ -0,0 +1,61 @@
+/**
+ * @file
+ *
+ * Declaration of the ThreadAffinity class
+ */
+
+#ifndef _THREADAFFINITY_H
+#define _THREADAFFINITY_H
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <thread>
+#include <cstddef>
+
+
+/**
+ * Pins worker threads to CPUs according to Params::threadAffinity, so that each island (or replicate
+ * thread) keeps running on the same CPUs, and the memory for its PolyBeeCore can be allocated on the
+ * NUMA node it runs on (Linux puts a page on the node of the CPU that first touches it).
+ *
+ * Threads are identified by a slot number: the island number when evolving, or the thread number when
+ * running replicates. The policy maps slot k to:
+ *  - compact: the k-th CPU, taking all the CPUs of one NUMA node before moving on to the next, so that
+ *    consecutive slots share a node;
+ *  - scatter: a CPU on node k % (number of nodes), so that consecutive slots are spread over the nodes;
+ *  - an explicit list of CPU sets, such as "0-3;8-11": set k % (number of sets).
+ * If there are more slots than CPUs (or sets), the mapping wraps round. With the default policy "none",
+ * no thread is pinned.
+ *
+ * Only CPUs the process was allowed to run on when it started (e.g. by taskset or a batch scheduler)
+ * are used. Pinning relies on sched_setaffinity, so on other platforms every policy acts as "none".
+ */
+class ThreadAffinity {
+
+public:
+    // Work out the CPUs for each slot from Params::threadAffinity. Must be called from the main thread.
+    static void initialise();
+
+    static bool enabled() { return !s_slotCpus.empty(); }
+    static const std::string& policyName() { return s_policyName; }  // "none", "compact", "scatter" or "explicit"
+
+    // Pin the calling thread to the CPUs for the given slot. This does nothing on the main thread, which
+    // does work for many slots (such as evaluating every island's initial population).
+    static void pinCurrentThread(std::size_t slot);
+
+    // Call f on a new thread pinned to the given slot's CPUs, and wait for it to return, so that memory
+    // first touched by f is placed on that slot's NUMA node. If no policy is set, f is called directly.
+    static void runOnPinnedThread(std::size_t slot, const std::function<void()>& f);
+
+private:
+    static std::vector<int> parseCpuList(const std::string& list);
+    static std::vector<int> allowedCpus();
+    static std::vector<std::vector<int>> numaNodeCpus(const std::vector<int>& allowed);
+
+    static std::string s_policyName;
+    static std::vector<std::vector<int>> s_slotCpus;    // CPUs for each slot, indexed modulo its size (empty = no pinning)
+    static std::thread::id s_mainThreadId;
+};
+
+#endif /* _THREADAFFINITY_H */
@@ -0,0 +1,172 @@
+/**
+ * @file
+ *
+ * Declaration of the TrajectoryRecorder and TrajectoryReader classes, which write and read
+ * binary recordings of a run for later replay in LocalVis
+ */
+
+#ifndef _TRAJECTORY_H
+#define _TRAJECTORY_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class Environment;
+
+
+// A trajectory file is laid out as follows (all values in the native representation, as the file is
+// only ever read back by the same polybee executable on the same machine type):
+//
+//   TrajectoryFileHeader
+//   numBees x float                     colour hue of each bee
+//   numPlants x (float, float)          x and y position of each plant
+//   frames, each being:
+//     TrajectoryFrameHeader
+//     numBees x TrajectoryBeeRecord
+//     numPlantUpdates x TrajectoryPlantUpdate   plants whose visit count changed since the previous frame
+//
+// A frame is recorded every frameInterval iterations.
+
+constexpr char TRAJECTORY_MAGIC[8] = {'P', 'B', 'T', 'R', 'A', 'J', '0', '1'};
+
+struct TrajectoryFileHeader {
+    char magic[8];
+    std::uint32_t numBees;
+    std::uint32_t numPlants;
+    std::uint32_t frameInterval;
+    float envW;
+    float envH;
+};
+
+struct TrajectoryFrameHeader {
+    std::int32_t iteration;
+    std::uint32_t numPlantUpdates;
+};
+
+struct TrajectoryBeeRecord {
+    float x;
+    float y;
+    float angle;
+    std::uint32_t state;    // a BeeState
+};
+
+struct TrajectoryPlantUpdate {
+    std::uint32_t plantIndex;   // index into Environment::getAllPlants()
+    std::uint32_t visitCount;   // the plant's visit count at this frame
+};
+
+
+/**
+ * Records the bees' positions and states, and the plants' visit counts, to a trajectory file as a run
+ * proceeds.
+ *
+ * recordFrame() just copies the frame into a staging buffer, so it adds very little to the time of a
+ * step. Full buffers are handed to a background thread, which copies them into the file through a
+ * memory mapping (grown as needed), so the simulation never waits on the disk. finish() flushes
+ * everything and trims the file to its final size; it is also called by the destructor.
+ */
+class TrajectoryRecorder {
+
+public:
+    TrajectoryRecorder(const std::string& filename, const Environment& env, int frameInterval);
+    TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+    TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+    ~TrajectoryRecorder();
+
+    // record the current state of the environment if iteration is a multiple of the frame interval
+    void update(int iteration, const Environment& env) {
+        if (iteration % m_frameInterval == 0) {
+            recordFrame(iteration, env);
+        }
+    }
+    void finish();
+
+    const std::string& filename() const { return m_filename; }
+    std::size_t numFrames() const { return m_numFrames; }
+
+private:
+    void recordFrame(int iteration, const Environment& env);
+    void append(const void* p, std::size_t bytes);
+    void handOver(); // pass the staging buffer to the writer thread
+    void writerLoop();
+    void writeToMapping(const std::vector<char>& buf);
+
+    std::string m_filename;
+    int m_frameInterval {1};
+    std::size_t m_numFrames {0};
+    std::vector<std::uint32_t> m_lastVisitCounts;   // visit count of each plant at the last recorded frame
+    std::vector<TrajectoryPlantUpdate> m_plantUpdates; // scratch buffer for the current frame
+
+    std::vector<char> m_staging;                    // frames not yet handed to the writer thread
+
+    // shared with the writer thread
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::vector<char>> m_fullBuffers;    // waiting to be written
+    std::vector<std::vector<char>> m_spareBuffers;  // written, and ready to be reused for staging
+    bool m_bFinishing {false};
+    std::thread m_writer;
+
+    // only used by the writer thread (and by finish(), once the writer thread has stopped)
+    int m_fd {-1};
+    char* m_pMapping {nullptr};
+    std::size_t m_mappingSize {0};
+    std::size_t m_fileSize {0};                     // number of bytes written so far
+};
+
+
+/**
+ * Gives random access to the frames of a trajectory file, which is memory-mapped read-only.
+ *
+ * The file is scanned once when it is opened to find the start of each frame. To save replaying
+ * every plant update from the start of the file when seeking, the plants' visit counts are also
+ * saved at regular checkpoints during the scan.
+ */
+class TrajectoryReader {
+
+public:
+    explicit TrajectoryReader(const std::string& filename);
+    TrajectoryReader(const TrajectoryReader&) = delete;
+    TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+    ~TrajectoryReader();
+
+    const std::string& filename() const { return m_filename; }
+    const TrajectoryFileHeader& header() const { return m_header; }
+    std::size_t numBees() const { return m_header.numBees; }
+    std::size_t numPlants() const { return m_header.numPlants; }
+    std::size_t numFrames() const { return m_frameOffsets.size(); }
+
+    float beeHue(std::size_t bee) const { return m_beeHues[bee]; }
+    float plantX(std::size_t plant) const { return m_plantPositions[2 * plant]; }
+    float plantY(std::size_t plant) const { return m_plantPositions[2 * plant + 1]; }
+
+    int iteration(std::size_t frame) const { return frameHeader(frame).iteration; }
+    const TrajectoryBeeRecord* beeRecords(std::size_t frame) const; // numBees() records
+
+    // fill counts with the visit count of each plant as it was at the given frame
+    void visitCountsAt(std::size_t frame, std::vector<std::uint32_t>& counts) const;
+
+private:
+    const TrajectoryFrameHeader& frameHeader(std::size_t frame) const;
+    void applyPlantUpdates(std::size_t frame, std::vector<std::uint32_t>& counts) const;
+
+    std::string m_filename;
+    int m_fd {-1};
+    const char* m_pData {nullptr};
+    std::size_t m_size {0};
+
+    TrajectoryFileHeader m_header {};
+    std::vector<float> m_beeHues;
+    std::vector<float> m_plantPositions;
+    std::vector<std::size_t> m_frameOffsets;                // offset of each frame in the file
+    std::size_t m_checkpointInterval {1};                   // frames between visit count checkpoints
+    std::vector<std::vector<std::uint32_t>> m_checkpoints;  // visit counts at frames 0, interval, 2*interval, ...
+};
+
+#endif /* _TRAJECTORY_H */
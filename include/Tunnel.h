@@ -14,11 +14,56 @@
 #include <optional>
 #include <tuple>
 #include <cassert>
+#include <array>
+#include <algorithm>
 
 class Environment;
 class Tunnel;
 
 
+// Running totals of bee attempts to cross a tunnel entrance (one "attempt" might involve multiple rebounds),
+// updated as each attempt finishes so that crossing stats can be queried without keeping per-attempt records
+struct CrossingAccumulator {
+    static constexpr int NUM_HISTOGRAM_BINS = 16; // rebound counts 0..14, plus a final bin for 15 or more
+
+    long attempts {0};
+    long successes {0};
+    long reboundSum {0};
+    long reboundSumSq {0};
+    std::array<long, NUM_HISTOGRAM_BINS> reboundHistogram {};
+
+    void add(bool success, int numRebounds) {
+        ++attempts;
+        if (success) {
+            ++successes;
+        }
+        reboundSum += numRebounds;
+        reboundSumSq += static_cast<long>(numRebounds) * numRebounds;
+        ++reboundHistogram[std::min(numRebounds, NUM_HISTOGRAM_BINS - 1)];
+    }
+
+    void merge(const CrossingAccumulator& other) {
+        attempts += other.attempts;
+        successes += other.successes;
+        reboundSum += other.reboundSum;
+        reboundSumSq += other.reboundSumSq;
+        for (int i = 0; i < NUM_HISTOGRAM_BINS; ++i) {
+            reboundHistogram[i] += other.reboundHistogram[i];
+        }
+    }
+
+    void reset() { *this = CrossingAccumulator(); }
+
+    float successRate() const { return attempts > 0 ? static_cast<float>(successes) / attempts : 0.0f; }
+    float meanRebounds() const { return attempts > 0 ? static_cast<float>(reboundSum) / attempts : 0.0f; }
+    float reboundVariance() const {
+        if (attempts == 0) return 0.0f;
+        double mean = static_cast<double>(reboundSum) / attempts;
+        return static_cast<float>(std::max(0.0, static_cast<double>(reboundSumSq) / attempts - mean * mean));
+    }
+};
+
+
 struct TunnelEntranceInfo {
     int id;     // unique ID for this entrance, assigned based on order in which entrances are specified in Params::entranceSpecs
     float x1;   // x position of first edge of entrance (in environment coordinates)
@@ -26,7 +71,10 @@ struct TunnelEntranceInfo {
     float x2;   // x position of second edge of entrance (in environment coordinates)
     float y2;   // y position of second edge of entrance (in environment coordinates)
     int side;   // 0=North, 1=East, 2=South, 3=West
+    int tunnelIndex;                    // index of the tunnel this entrance belongs to (see Environment::getTunnels())
     NetType netType { NetType::NONE };  // type of net at this entrance
+    CrossingAccumulator entryStats;     // attempts to enter the tunnel through this entrance in the current run
+    CrossingAccumulator exitStats;      // attempts to exit the tunnel through this entrance in the current run
 
     static int nextID; // static variable to keep track of the next ID to assign to a new entrance
 
@@ -76,13 +124,19 @@ public:
     Tunnel();
     ~Tunnel() {}
 
-    // initiailise the tunnel and entrances
-    void initialise(float x, float y, float width, float height, Environment* pEnv);
+    // initiailise the tunnel and entrances (index is the tunnel's position in Environment::getTunnels())
+    void initialise(float x, float y, float width, float height, Environment* pEnv, int index = 0);
 
-    // initialise entrances only (for resetting between simulation runs)
+    // initialise entrances only (for resetting between simulation runs); only the specs
+    // whose tunnel number matches this tunnel's index are used
     void initialiseEntrances();
     void initialiseEntrances(const std::vector<EntranceSpec>& specs);
 
+    // is the given point inside the tunnel (or on its boundary)?
+    bool contains(float x, float y) const {
+        return (x >= m_x && x <= m_x + m_width && y >= m_y && y <= m_y + m_height);
+    }
+
     /// @brief Check if the line from point (x1, y1) to point (x2, y2) intersects any tunnel entrance
     /// @param x1 x position of point 1 in environment coordinates
     /// @param y1 y position of point 1 in environment coordinates
@@ -95,8 +149,18 @@ public:
     float y() const { return m_y; }
     float width() const { return m_width; }
     float height() const { return m_height; }
+    int index() const { return m_index; }
     const std::vector<TunnelEntranceInfo>& getEntrances() const { return m_entrances; }
 
+    // record the outcome of a bee's attempt to cross the given entrance (which must be one of this tunnel's)
+    void recordCrossing(const TunnelEntranceInfo* pEntrance, bool isEntry, bool success, int numRebounds);
+    void resetCrossingStats();
+
+    // Combined crossing stats over all entrances, optionally restricted to one net type; entries and/or
+    // exits are included as requested. Takes time proportional to the number of entrances.
+    CrossingAccumulator getCrossingStats(bool includeEntries, bool includeExits,
+        std::optional<NetType> netType = std::nullopt) const;
+
     const std::vector<pb::Line2D>& getBoundaries() const { return m_boundaries; }
     const std::vector<pb::Pos2D>&  getBoundaryUnitVectors() const { return m_boundaryUnitVectors; }
     const std::vector<pb::Pos2D>&  getBoundaryNormals() const { return m_boundaryNormals; }
@@ -112,6 +176,7 @@ private:
     float m_y;                                      // top-left y position of tunnel in environment coordinates
     float m_width;                                  // width of the tunnel
     float m_height;                                 // height of the tunnel
+    int m_index {0};                                // position of this tunnel in Environment::getTunnels()
     std::vector<pb::Line2D> m_boundaries;
     std::vector<pb::Pos2D> m_boundaryUnitVectors;   // unit vectors parallel to the boundaries, pointing in the direction of increasing coordinate (e.g. for top wall, pointing right; for left wall, pointing down etc)
     std::vector<pb::Pos2D> m_boundaryNormals;       // unit vectors perpendicular to the boundaries, pointing outwards from the tunnel
@@ -0,0 +1,96 @@
+/**
+ * @file
+ *
+ * Declaration of the VisSnapshot struct and the VisSnapshotBuffer class, which pass the state of a
+ * running simulation to LocalVis for drawing
+ */
+
+#ifndef _VISSNAPSHOT_H
+#define _VISSNAPSHOT_H
+
+#include "utils.h"
+#include "Flowmap.h"
+#include <vector>
+#include <atomic>
+#include <cstdint>
+
+class Environment;
+
+
+struct VisBeeSnapshot {
+    float x;
+    float y;
+    float angle;
+    float hue;
+    int entranceUsedID;         // ID of the last tunnel entrance the bee used, or -1 if none
+    std::uint32_t trailStart;   // index of the bee's first trail point in VisSnapshot::trailPoints
+    std::uint32_t trailLen;     // number of trail points (oldest first)
+};
+
+/**
+ * Everything LocalVis needs to draw the changing parts of the environment at one iteration. The static
+ * parts (tunnels, barriers, hives, patches and plant positions) don't change during a run, so are drawn
+ * from the environment directly.
+ */
+struct VisSnapshot {
+    void capture(Environment& env, int iteration, bool withFlowmap);
+
+    int iteration {-1};
+    std::uint64_t serial {0};                   // set when published, so the renderer can tell when the snapshot has changed
+
+    std::vector<VisBeeSnapshot> bees;
+    std::vector<pb::Pos2D> trailPoints;         // the last vis-bee-path-draw-len path points of every bee
+    std::vector<int> plantVisitCounts;          // in the order of Environment::getAllPlants()
+    double successfulVisitFraction {0.0};
+
+    bool heatmapValid {false};                  // whether the environment keeps a normalised heatmap
+    int heatmapW {0};
+    int heatmapH {0};
+    std::vector<double> heatmapNormalised;      // heatmapW x heatmapH, indexed by x * heatmapH + y
+
+    bool flowmapValid {false};                  // only captured when requested
+    int flowmapW {0};
+    int flowmapH {0};
+    int flowmapMaxCount {0};
+    std::vector<FlowmapCell> flowmapCells;      // flowmapW x flowmapH, indexed by x * flowmapH + y
+};
+
+
+/**
+ * A lock-free double buffer of snapshots between one producer (the simulation thread) and one consumer
+ * (the render thread).
+ *
+ * The producer only captures a new snapshot when the consumer has taken the previous one, so it never
+ * spends time copying state that won't be drawn: at most one capture per displayed frame. While a
+ * snapshot is waiting to be taken the back buffer belongs to the consumer, otherwise it belongs to the
+ * producer; the front buffer always belongs to the consumer.
+ */
+class VisSnapshotBuffer {
+
+public:
+    // producer side
+    bool wanted() const { return !m_bFresh.load(std::memory_order_acquire); }
+    VisSnapshot& back() { return m_snapshots[m_backIndex]; }
+    void publish() {
+        back().serial = ++m_lastSerial;
+        m_bFresh.store(true, std::memory_order_release);
+    }
+
+    // consumer side: swap in the latest published snapshot, if there is one, and return the front buffer
+    const VisSnapshot& acquire() {
+        if (m_bFresh.load(std::memory_order_acquire)) {
+            m_backIndex = 1 - m_backIndex;
+            m_bFresh.store(false, std::memory_order_release);
+        }
+        return m_snapshots[1 - m_backIndex];
+    }
+    const VisSnapshot& front() const { return m_snapshots[1 - m_backIndex]; }
+
+private:
+    VisSnapshot m_snapshots[2];
+    int m_backIndex {0};
+    std::uint64_t m_lastSerial {0};             // only used by the producer
+    std::atomic<bool> m_bFresh {false};         // the back buffer holds a snapshot the consumer hasn't taken yet
+};
+
+#endif /* _VISSNAPSHOT_H */
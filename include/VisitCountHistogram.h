@@ -0,0 +1,48 @@
+/**
+ * @file
+ *
+ * Declaration of the VisitCountHistogram class
+ */
+
+#ifndef _VISITCOUNTHISTOGRAM_H
+#define _VISITCOUNTHISTOGRAM_H
+
+#include <vector>
+#include <cstddef>
+
+class Plant;
+
+
+/**
+ * The distribution of visit counts over a set of plants (the ones counted for the successful visit
+ * fraction), kept up to date as bees visit them rather than recalculated by scanning the plants.
+ *
+ * The histogram has one bin per visit count, from 0 up to the highest count reached so far, so the
+ * whole distribution can be read in time proportional to the number of bins. The number of plants
+ * whose count is in the successful visit range (Params::minVisitCountSuccess to
+ * Params::maxVisitCountSuccess) is tracked alongside, so the successful visit fraction can be read
+ * in constant time, and other statistics of the distribution (such as its variance) cheaply.
+ */
+class VisitCountHistogram {
+
+public:
+    VisitCountHistogram() {}
+    ~VisitCountHistogram() {}
+
+    void reset(const std::vector<Plant*>& plants);  // rebuild from the plants' current visit counts
+    void recordVisit(int newVisitCount);            // one of the plants has just gone up to newVisitCount visits
+
+    std::size_t numPlants() const { return m_numPlants; }
+    long numInSuccessRange() const { return m_numInSuccessRange; }
+    const std::vector<long>& counts() const { return m_counts; } // counts()[v] is the number of plants with v visits
+    double variance() const;                        // variance of the plants' visit counts
+
+private:
+    static bool inSuccessRange(int visitCount);
+
+    std::vector<long> m_counts;
+    std::size_t m_numPlants {0};
+    long m_numInSuccessRange {0};
+};
+
+#endif /* _VISITCOUNTHISTOGRAM_H */
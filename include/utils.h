@@ -73,13 +73,39 @@ namespace Polybee {
 
     struct PosAndDir2D {
         float x, y;
-        float angle; // direction in radians
+        Pos2D dir; // direction as a unit vector
 
-        PosAndDir2D(float x = 0.0f, float y = 0.0f, float angle = 0.0f) : x(x), y(y), angle(angle) {}
+        PosAndDir2D(float x = 0.0f, float y = 0.0f, const Pos2D& dir = Pos2D(1.0f, 0.0f)) : x(x), y(y), dir(dir) {}
 
-        void setToZero() { x = 0.0f; y = 0.0f; angle = 0.0f; }
+        float angle() const { return dir.angle(); } // direction in radians (only calculated when needed)
+        void setToZero() { x = 0.0f; y = 0.0f; dir.set(1.0f, 0.0f); }
     };
 
+    // Sine and cosine of a small angle (|a| <= pi/2) by Taylor polynomials, accurate to within about 1e-7
+    // over that range. This avoids calls to libm's trig functions in per-step code such as bee movement.
+    inline void sinCosSmallAngle(float a, float& s, float& c) {
+        const float a2 = a * a;
+        s = a * (1.0f - a2 / 6.0f * (1.0f - a2 / 20.0f * (1.0f - a2 / 42.0f * (1.0f - a2 / 72.0f * (1.0f - a2 / 110.0f * (1.0f - a2 / 156.0f))))));
+        c = 1.0f - a2 / 2.0f * (1.0f - a2 / 12.0f * (1.0f - a2 / 30.0f * (1.0f - a2 / 56.0f * (1.0f - a2 / 90.0f * (1.0f - a2 / 132.0f)))));
+    }
+
+    // Rotate the unit vector v by angle a (radians). Small angles (|a| <= pi/2) use sinCosSmallAngle(),
+    // larger ones fall back to std::sin/std::cos. The result is pulled back to unit length with one Newton
+    // step of 1/sqrt (which needs no sqrt itself), so rounding errors do not accumulate over many rotations.
+    inline Pos2D rotateUnitVector(const Pos2D& v, float a) {
+        float s, c;
+        if (std::abs(a) <= 1.5707963f) {
+            sinCosSmallAngle(a, s, c);
+        }
+        else {
+            s = std::sin(a);
+            c = std::cos(a);
+        }
+        Pos2D r(v.x * c - v.y * s, v.x * s + v.y * c);
+        const float scale = 1.5f - 0.5f * (r.x * r.x + r.y * r.y);
+        return r * scale;
+    }
+
     struct Line2D {
         Pos2D start, end;
 
@@ -15,6 +15,7 @@
 #include <format>
 #include <algorithm>
 #include <cmath>
+#include <limits>
 
 // initialise static members
 const float Bee::m_sTunnelWallBuffer {0.1f};
@@ -73,6 +74,8 @@ void TryingToCrossEntranceState::reset() {
 // Bee methods
 
 Bee::Bee(Hive* pHive, Environment* pEnv) :
+    m_homingWaypoints(pEnv->episodeArena()),
+    m_entranceCrossingRecords(pEnv->episodeArena()),
     m_pHive(pHive), m_pEnv(pEnv)
 {
     assert(Params::initialised());
@@ -83,7 +86,7 @@ Bee::Bee(Hive* pHive, Environment* pEnv) :
     m_prevPos = m_pos;
     m_distDir.param(std::uniform_real_distribution<float>::param_type(-Params::beeMaxDirDelta, Params::beeMaxDirDelta));
     m_colorHue = m_pPolyBeeCore->m_uniformProbDistrib(m_pPolyBeeCore->m_rngEngine) * 360.0f;
-    m_inTunnel = m_pEnv->inTunnel(m_pos.x, m_pos.y);
+    m_pTunnel = m_pEnv->tunnelAt(m_pos.x, m_pos.y);
     m_currentBoutDuration = 0;
     m_currentHiveDuration = 0;
     m_state = BeeState::FORAGING;
@@ -96,11 +99,15 @@ void Bee::setDirAccordingToHive()
 {
     assert(m_pHive != nullptr);
     switch (m_pHive->direction()) {
-    case 0: m_angle = -std::numbers::pi_v<float> / 2.0f; break; // North
-    case 1: m_angle = 0.0f; break; // East
-    case 2: m_angle = std::numbers::pi_v<float> / 2.0f; break; // South
-    case 3: m_angle = std::numbers::pi_v<float>; break; // West
-    case 4: m_angle = m_pPolyBeeCore->m_angle2PiDistrib(m_pPolyBeeCore->m_rngEngine); break; // Random
+    case 0: m_heading.set(0.0f, -1.0f); break; // North
+    case 1: m_heading.set(1.0f, 0.0f); break; // East
+    case 2: m_heading.set(0.0f, 1.0f); break; // South
+    case 3: m_heading.set(-1.0f, 0.0f); break; // West
+    case 4: { // Random
+        float angle = m_pPolyBeeCore->m_angle2PiDistrib(m_pPolyBeeCore->m_rngEngine);
+        m_heading.set(std::cos(angle), std::sin(angle));
+        break;
+    }
     default:
         pb::msg_error_and_exit(std::format("Invalid hive direction {} specified for hive at ({},{}). Must be 0=North, 1=East, 2=South, 3=West, or 4=Random.",
             m_pHive->direction(), m_pHive->x(), m_pHive->y()));
@@ -108,24 +115,27 @@ void Bee::setDirAccordingToHive()
 }
 
 
+// Advance the bee by one step. Features is the SimFeatures bundle for the current configuration,
+// which lets code for unused features be compiled out of the step loop.
+template<typename Features>
 void Bee::update() {
     m_prevPos = m_pos;
     switch (m_state)
     {
     case BeeState::FORAGING:
-        forage();
+        forage<Features>();
         break;
     case BeeState::ON_FLOWER:
-        stayOnFlower();
+        stayOnFlower<Features>();
         break;
     case BeeState::RETURN_TO_HIVE_INSIDE_TUNNEL:
-        returnToHiveInsideTunnel();
+        returnToHiveInsideTunnel<Features>();
         break;
     case BeeState::RETURN_TO_HIVE_OUTSIDE_TUNNEL:
-        returnToHiveOutsideTunnel();
+        returnToHiveOutsideTunnel<Features>();
         break;
     case BeeState::IN_HIVE:
-        stayInHive();
+        stayInHive<Features>();
         break;
     default:
         break;
@@ -133,19 +143,21 @@ void Bee::update() {
 }
 
 
+template<typename Features>
 void Bee::forage()
 {
     // update bee's path record with current position
-    updatePathHistory();
+    updatePathHistory<Features>();
 
-    if (m_tryingToCrossEntrance) {
+    // (a bee can only be left trying to cross an entrance if it has been bounced back by a net)
+    if (Features::hasNets && m_tryingToCrossEntrance) {
         // bee is in processes of trying to cross a tunnel entrance and will keep trying until
         // it either succeeds or gives up
         continueTryingToCrossEntrance();
     }
     else {
         // normal foraging update
-        bool stillForaging = normalForagingUpdate();
+        bool stillForaging = normalForagingUpdate<Features>();
         if (!stillForaging) {
             return; // bee's state has changed, so we can exit right now
         }
@@ -162,12 +174,14 @@ void Bee::forage()
     }
     */
 
-    // deplete bee's energy level
-    m_energy -= Params::beeEnergyDepletionPerStep;
+    if constexpr (Features::hasEnergetics) {
+        // deplete bee's energy level
+        m_energy -= Params::beeEnergyDepletionPerStep;
 
-    if (m_energy <= Params::beeEnergyMinThreshold || m_energy >= Params::beeEnergyMaxThreshold) {
-        // bee has either run out of energy, or collected as much as it wants. Either way, return to hive!
-        switchToReturnToHive();
+        if (m_energy <= Params::beeEnergyMinThreshold || m_energy >= Params::beeEnergyMaxThreshold) {
+            // bee has either run out of energy, or collected as much as it wants. Either way, return to hive!
+            switchToReturnToHive();
+        }
     }
 }
 
@@ -175,6 +189,7 @@ void Bee::forage()
 // Normal foraging update when not trying to cross tunnel entrance.
 // Returns true if bee is still foraging, false if its state has changed (e.g. it has landed on a flower).
 //
+template<typename Features>
 bool Bee::normalForagingUpdate()
 {
     // Normal foraging update when not trying to cross tunnel entrance
@@ -182,7 +197,7 @@ bool Bee::normalForagingUpdate()
 
     // work out where bee would like to go next, following "forage nearest flower" strategy
     // or step in random direction if no nearby flowers found
-    auto forageNextStepInfoOpt = forageNearestFlower();
+    auto forageNextStepInfoOpt = forageNearestFlower<Features>();
 
     if (forageNextStepInfoOpt.has_value()) {
         float rnd = m_pPolyBeeCore->m_uniformProbDistrib(m_pPolyBeeCore->m_rngEngine);
@@ -193,13 +208,13 @@ bool Bee::normalForagingUpdate()
         else {
             // move in random direction with a fixed step length
             // (N.B. we are not yet considering Levy flights here)
-            forageNextStepInfo.desiredMove = moveInRandomDirection();
+            forageNextStepInfo.desiredMove = moveInRandomDirection<Features>();
         }
     }
     else {
         // no nearby unvisited flowers found, so move in random direction with a fixed step length
         // (N.B. we are not yet considering Levy flights here)
-        forageNextStepInfo.desiredMove = moveInRandomDirection();
+        forageNextStepInfo.desiredMove = moveInRandomDirection<Features>();
     }
 
     // keep within bounds of environment (we don't need to do this if the bee has already landed on a flower)
@@ -208,25 +223,27 @@ bool Bee::normalForagingUpdate()
     }
 
     // check if new position would involve crossing tunnel boundary
-    bool newPosInTunnel = m_pEnv->inTunnel(forageNextStepInfo.desiredMove.x, forageNextStepInfo.desiredMove.y);
-    if ((m_inTunnel && newPosInTunnel) || (!m_inTunnel && !newPosInTunnel)) {
+    const Tunnel* pNewPosTunnel = m_pEnv->tunnelAt(forageNextStepInfo.desiredMove.x, forageNextStepInfo.desiredMove.y);
+    if (pNewPosTunnel == m_pTunnel) {
         // no boundary crossing, so we can just move to the new position at this point
-        m_angle = forageNextStepInfo.desiredMove.angle;
+        m_heading = forageNextStepInfo.desiredMove.dir;
         m_pos.x = forageNextStepInfo.desiredMove.x;
         m_pos.y = forageNextStepInfo.desiredMove.y;
 
         if (forageNextStepInfo.landedOnFlower) {
             // bee has just landed on its target flower, so we just need to update the state
             // of the bee and of the flower to reflect this
-            forageNextStepInfo.pTargetFlower->incrementVisitCount();
+            m_pEnv->recordFlowerVisit(forageNextStepInfo.pTargetFlower);
             addToRecentlyVisitedPlants(forageNextStepInfo.pTargetFlower);
-            switchToOnFlower(forageNextStepInfo.pTargetFlower);
+            switchToOnFlower<Features>(forageNextStepInfo.pTargetFlower);
             return false; // bee is no longer foraging
         }
     }
     else {
         // desired move crosses tunnel boundary, so we need to figure out if bee can enter/exit the tunnel at this point
-        attemptToCrossTunnelBoundaryWhileForaging(forageNextStepInfo.desiredMove);
+        // (tunnels never overlap or touch, so if the bee is in a tunnel this is the boundary it is crossing, otherwise
+        // it is the boundary of the tunnel it wants to move into)
+        attemptToCrossTunnelBoundaryWhileForaging<Features>(forageNextStepInfo.desiredMove, m_pTunnel ? *m_pTunnel : *pNewPosTunnel);
     }
 
     // nudge bee away from tunnel walls if too close, to avoid any numerical issues
@@ -255,7 +272,8 @@ bool Bee::normalForagingUpdate()
 //   so we ajust its position to be at the point of intersection with the tunnel
 //   boundary, and align its direction along the wall.
 //
-void Bee::attemptToCrossTunnelBoundaryWhileForaging(pb::PosAndDir2D& desiredMove)
+template<typename Features>
+void Bee::attemptToCrossTunnelBoundaryWhileForaging(pb::PosAndDir2D& desiredMove, const Tunnel& tunnel)
 {
     // TODO - temp code
     if (m_state != BeeState::FORAGING) {
@@ -264,7 +282,7 @@ void Bee::attemptToCrossTunnelBoundaryWhileForaging(pb::PosAndDir2D& desiredMove
 
     assert(m_state == BeeState::FORAGING);
 
-    auto intersectInfo = m_pEnv->getTunnel().intersectsTunnelBoundary(m_pos.x, m_pos.y, desiredMove.x, desiredMove.y);
+    auto intersectInfo = tunnel.intersectsTunnelBoundary(m_pos.x, m_pos.y, desiredMove.x, desiredMove.y);
 
     if (!intersectInfo.intersects) {
         pb::msg_error_and_exit(
@@ -275,18 +293,19 @@ void Bee::attemptToCrossTunnelBoundaryWhileForaging(pb::PosAndDir2D& desiredMove
         // Initialise m_currentCrossingInfo struct as this is the start of a new crossing attempt
         m_currentCrossingInfo.entranceID = intersectInfo.pEntranceUsed->id;
         m_currentCrossingInfo.netType = intersectInfo.pEntranceUsed->netType;
-        m_currentCrossingInfo.isEntry = !m_inTunnel; // if we're currently outside the tunnel, then we're trying to enter it, and vice versa
+        m_currentCrossingInfo.isEntry = !inTunnel(); // if we're currently outside the tunnel, then we're trying to enter it, and vice versa
+        m_currentCrossingInfo.pEntrance = intersectInfo.pEntranceUsed;
 
         // bee wants to enter/exit via a tunnel entrance, so we need to determine whether it can
-        // successfully do so based on the net type at this entrance
+        // successfully do so based on the net type at this entrance. (The random number is drawn
+        // even if there are no nets, so that the sequence of random numbers doesn't depend on that.)
         float rnd = m_pPolyBeeCore->m_uniformProbDistrib(m_pPolyBeeCore->m_rngEngine);
-        float probExit = intersectInfo.pEntranceUsed->probExit();
-        if (rnd < probExit) {
+        if (!Features::hasNets || rnd < intersectInfo.pEntranceUsed->probExit()) {
             // the bee passed through an entrance, so it can move to the new position
-            m_angle = desiredMove.angle;
+            m_heading = desiredMove.dir;
             m_pos.x = desiredMove.x;
             m_pos.y = desiredMove.y;
-            m_inTunnel = !m_inTunnel;
+            m_pTunnel = inTunnel() ? nullptr : &tunnel;
             m_pLastTunnelEntrance = intersectInfo.pEntranceUsed;
             recordCurrentCrossingInfo(true); // mark current crossing info as successful and add it to records
         }
@@ -296,7 +315,7 @@ void Bee::attemptToCrossTunnelBoundaryWhileForaging(pb::PosAndDir2D& desiredMove
             // reinitialise m_tryCrossState, so that it will continue trying to cross the entrance
             // in subsequent updates until it either succeeds or gives up after a maximum number of attempts.
             m_tryingToCrossEntrance = true;
-            m_tryCrossState.set(m_pos, intersectInfo, &(m_pEnv->getTunnel()));
+            m_tryCrossState.set(m_pos, intersectInfo, &tunnel);
         }
     }
     else {
@@ -308,17 +327,25 @@ void Bee::attemptToCrossTunnelBoundaryWhileForaging(pb::PosAndDir2D& desiredMove
         // and align its direction to be along the wall, in the direction closest to its desired movement direction
         float dx = intersectInfo.intersectedLine.end.x - intersectInfo.intersectedLine.start.x;
         float dy = intersectInfo.intersectedLine.end.y - intersectInfo.intersectedLine.start.y;
-        m_angle = alignAngleWithLine(desiredMove.angle, dx, dy);
+        m_heading = alignDirWithLine(desiredMove.dir, dx, dy);
     }
 }
 
 
-// Add current crossing info to the appropriate records vector and reset it for the next crossing attempt
+// Add current crossing info to the crossing stats of the entrance concerned (and, if requested, to the bee's
+// own records) and reset it for the next crossing attempt
 void Bee::recordCurrentCrossingInfo(bool success)
 {
     m_currentCrossingInfo.success = success;
 
-    m_entranceCrossingRecords.push_back(m_currentCrossingInfo); // add current crossing info to records of all crossing attempts (both successful and unsuccessful)
+    if (m_currentCrossingInfo.pEntrance != nullptr) {
+        m_pEnv->getTunnel(m_currentCrossingInfo.pEntrance->tunnelIndex).recordCrossing(m_currentCrossingInfo.pEntrance, m_currentCrossingInfo.isEntry,
+            success, m_currentCrossingInfo.numRebounds);
+    }
+
+    if (Params::recordBeeCrossings) {
+        m_entranceCrossingRecords.push_back(m_currentCrossingInfo); // add current crossing info to records of all crossing attempts (both successful and unsuccessful)
+    }
 
     /*
     if (m_currentCrossingInfo.entering) {
@@ -355,7 +382,7 @@ void Bee::continueTryingToCrossEntrance()
         // Next we move perpendicular to the wall by the rebound length. We need to make sure we move in the right
         // direction (i.e. towards the outside of the tunnel if we're trying to get in, and towards the inside of the
         // tunnel if we're trying to get out).
-        pb::Pos2D reboundDir = m_tryCrossState.normalUnitVector * (m_inTunnel ? -1.0f : 1.0f); // if we're trying to get out of the tunnel, we want
+        pb::Pos2D reboundDir = m_tryCrossState.normalUnitVector * (inTunnel() ? -1.0f : 1.0f); // if we're trying to get out of the tunnel, we want
 
         // Now actually move the bee having calculated where it should go
         m_pos = newReboundStartPos + (reboundDir * m_tryCrossState.reboundLen);
@@ -374,12 +401,12 @@ void Bee::continueTryingToCrossEntrance()
         // We need to make sure we move in the right direction (i.e. towards the net from the outside, and
         // away from the net from the inside). We can work this out based on whether the bee is currently
         // in the tunnel or not, and modify the normal vector accordingly.
-        pb::Pos2D desiredMoveDir = m_tryCrossState.normalUnitVector * (m_inTunnel ? 1.0f : -1.0f); // if we're in the tunnel, we want to move in the direction of the normal vector, to try to get out. If we're outside the tunnel, we want to move in the opposite direction of the normal vector, to try to get in.);
+        pb::Pos2D desiredMoveDir = m_tryCrossState.normalUnitVector * (inTunnel() ? 1.0f : -1.0f); // if we're in the tunnel, we want to move in the direction of the normal vector, to try to get out. If we're outside the tunnel, we want to move in the opposite direction of the normal vector, to try to get in.);
         pb::Pos2D desiredMove = m_pos + (desiredMoveDir * m_tryCrossState.crossLen);
 
         // Now work out the consequences of the desired move, i.e. whether the bee would intersect with the
         // tunnel boundary as it tries to move there.
-        auto intersectInfo = m_pEnv->getTunnel().intersectsTunnelBoundary(m_pos.x, m_pos.y, desiredMove.x, desiredMove.y);
+        auto intersectInfo = m_tryCrossState.tunnel()->intersectsTunnelBoundary(m_pos.x, m_pos.y, desiredMove.x, desiredMove.y);
 
         // And deal with the consequences depending on whether it intersects with the tunnel boundary, and whether
         // it crosses an entrance or just hits the wall
@@ -411,10 +438,10 @@ void Bee::continueTryingToCrossEntrance()
             float probExit = intersectInfo.pEntranceUsed->probExit();
             if (rnd < probExit) {
                 // the bee passed through an entrance, so it can move to the new position
-                m_angle = desiredMoveDir.angle();
+                m_heading = desiredMoveDir;
                 m_pos.x = desiredMove.x;
                 m_pos.y = desiredMove.y;
-                m_inTunnel = !m_inTunnel;
+                m_pTunnel = inTunnel() ? nullptr : m_tryCrossState.tunnel();
                 m_pLastTunnelEntrance = intersectInfo.pEntranceUsed;
                 recordCurrentCrossingInfo(true);  // mark current crossing info as successful and add it to records
 
@@ -451,21 +478,21 @@ void Bee::continueTryingToCrossEntrance()
 }
 
 
-// Calculate the angle of the line defined by (line_dx, line_dy) in the direction along
-// the line that is closest to desiredAngle. This is used, for example, when a bee hits a
+// Calculate the unit vector along the line defined by (line_dx, line_dy) in the direction along
+// the line that is closest to desiredDir. This is used, for example, when a bee hits a
 // tunnel wall and we want to align its direction along the wall.
 //
-float Bee::alignAngleWithLine(float desiredAngle, float line_dx, float line_dy) const
+pb::Pos2D Bee::alignDirWithLine(const pb::Pos2D& desiredDir, float line_dx, float line_dy) const
 {
-    float lineAngle = std::atan2(line_dy, line_dx);
+    pb::Pos2D lineDir = pb::Pos2D(line_dx, line_dy).normalized();
 
-    // Use dot product to determine which direction along the line is closer to desiredAngle
-    float dotProduct = line_dx * std::cos(desiredAngle) + line_dy * std::sin(desiredAngle);
+    // Use dot product to determine which direction along the line is closer to desiredDir
+    float dotProduct = line_dx * desiredDir.x + line_dy * desiredDir.y;
 
     if (dotProduct >= 0.0f) {
-        return lineAngle;
+        return lineDir;
     } else {
-        return lineAngle + std::numbers::pi_v<float>;
+        return lineDir * -1.0f;
     }
 }
 
@@ -483,23 +510,23 @@ void Bee::keepMoveWithinEnvironment(pb::PosAndDir2D& desiredMove) const
     if (desiredMove.x < 0.0f) {
         // off left edge
         desiredMove.x = 0.0f;
-        desiredMove.angle = alignAngleWithLine(desiredMove.angle, LR.x, LR.y);
+        desiredMove.dir = alignDirWithLine(desiredMove.dir, LR.x, LR.y);
     }
     else if (desiredMove.x > Params::envW) {
         // off right edge
         desiredMove.x = Params::envW;
-        desiredMove.angle = alignAngleWithLine(desiredMove.angle, LR.x, LR.y);
+        desiredMove.dir = alignDirWithLine(desiredMove.dir, LR.x, LR.y);
     }
 
     if (desiredMove.y < 0.0f) {
         // off top edge
         desiredMove.y = 0.0f;
-        desiredMove.angle = alignAngleWithLine(desiredMove.angle, TB.x, TB.y);
+        desiredMove.dir = alignDirWithLine(desiredMove.dir, TB.x, TB.y);
     }
     else if (desiredMove.y > Params::envH) {
         // off bottom edge
         desiredMove.y = Params::envH;
-        desiredMove.angle = alignAngleWithLine(desiredMove.angle, TB.x, TB.y);
+        desiredMove.dir = alignDirWithLine(desiredMove.dir, TB.x, TB.y);
     }
 }
 
@@ -509,10 +536,9 @@ void Bee::keepMoveWithinEnvironment(pb::PosAndDir2D& desiredMove) const
 //
 void Bee::nudgeAwayFromTunnelWalls()
 {
-    auto& tunnel = m_pEnv->getTunnel();
-
-    if (m_inTunnel) {
-        // bee is inside the tunnel: ensure it stays a minimum distance away from the walls
+    if (m_pTunnel != nullptr) {
+        // bee is inside a tunnel: ensure it stays a minimum distance away from the walls
+        const Tunnel& tunnel = *m_pTunnel;
 
         // check left/right walls
         if (m_pos.x <= tunnel.x() + m_sTunnelWallBuffer) {
@@ -530,27 +556,31 @@ void Bee::nudgeAwayFromTunnelWalls()
         }
     }
     else {
-        // bee is outside the tunnel: check if it's within the wall buffer zone, and nudge it out further if so
-
-        // check left/right walls
-        if ((m_pos.y >= tunnel.y()) && (m_pos.y <= tunnel.y() + tunnel.height())) {
-            // bee is within the vertical range of the tunnel, so check horizontal distance
-            if ((m_pos.x < tunnel.x() + tunnel.width() / 2.0f) && (m_pos.x >= tunnel.x() - m_sTunnelWallBuffer)) {
-                m_pos.x = tunnel.x() - m_sTunnelWallBuffer;
+        // bee is outside the tunnels: check if it's within the wall buffer zone of any of them, and nudge it out further if so
+        // (only the tunnels registered in the obstacle grid cell the bee is in can be close enough to matter)
+        for (int tunnelIndex : m_pEnv->getNearbyTunnels(m_pos.x, m_pos.y)) {
+            const Tunnel& tunnel = m_pEnv->getTunnels()[tunnelIndex];
+
+            // check left/right walls
+            if ((m_pos.y >= tunnel.y()) && (m_pos.y <= tunnel.y() + tunnel.height())) {
+                // bee is within the vertical range of the tunnel, so check horizontal distance
+                if ((m_pos.x < tunnel.x() + tunnel.width() / 2.0f) && (m_pos.x >= tunnel.x() - m_sTunnelWallBuffer)) {
+                    m_pos.x = tunnel.x() - m_sTunnelWallBuffer;
+                }
+                else if ((m_pos.x >= tunnel.x() + tunnel.width() / 2.0f) && (m_pos.x <= tunnel.x() + tunnel.width() + m_sTunnelWallBuffer)) {
+                    m_pos.x = tunnel.x() + tunnel.width() + m_sTunnelWallBuffer;
+                }
             }
-            else if ((m_pos.x >= tunnel.x() + tunnel.width() / 2.0f) && (m_pos.x <= tunnel.x() + tunnel.width() + m_sTunnelWallBuffer)) {
-                m_pos.x = tunnel.x() + tunnel.width() + m_sTunnelWallBuffer;
-            }
-        }
 
-        // check top/bottom walls
-        if ((m_pos.x >= tunnel.x()) && (m_pos.x <= tunnel.x() + tunnel.width())) {
-            // bee is within the horizontal range of the tunnel, so check vertical distance
-            if ((m_pos.y < tunnel.y() + tunnel.height() / 2.0f) && (m_pos.y >= tunnel.y() - m_sTunnelWallBuffer)) {
-                m_pos.y = tunnel.y() - m_sTunnelWallBuffer;
-            }
-            else if ((m_pos.y >= tunnel.y() + tunnel.height() / 2.0f) && (m_pos.y <= tunnel.y() + tunnel.height() + m_sTunnelWallBuffer)) {
-                m_pos.y = tunnel.y() + tunnel.height() + m_sTunnelWallBuffer;
+            // check top/bottom walls
+            if ((m_pos.x >= tunnel.x()) && (m_pos.x <= tunnel.x() + tunnel.width())) {
+                // bee is within the horizontal range of the tunnel, so check vertical distance
+                if ((m_pos.y < tunnel.y() + tunnel.height() / 2.0f) && (m_pos.y >= tunnel.y() - m_sTunnelWallBuffer)) {
+                    m_pos.y = tunnel.y() - m_sTunnelWallBuffer;
+                }
+                else if ((m_pos.y >= tunnel.y() + tunnel.height() / 2.0f) && (m_pos.y <= tunnel.y() + tunnel.height() + m_sTunnelWallBuffer)) {
+                    m_pos.y = tunnel.y() + tunnel.height() + m_sTunnelWallBuffer;
+                }
             }
         }
     }
@@ -573,11 +603,13 @@ void Bee::nudgeAwayFromTunnelWalls()
 // Note, this method is not const because it uses m_distDir which updates its internal state
 // each time it is called.
 //
+template<typename Features>
 std::optional<ForageNextStepInfo> Bee::forageNearestFlower()
 {
     ForageNextStepInfo result;
 
-    auto plantInfo = m_pEnv->selectNearbyUnvisitedPlant(m_pos.x, m_pos.y, m_recentlyVisitedPlants);
+    auto plantInfo = m_pEnv->selectNearbyUnvisitedPlant<Features::hasBarriers, Features::hasBeeInteractions>(
+        m_pos.x, m_pos.y, m_recentlyVisitedPlants);
 
     if (plantInfo.has_value()) {
         Plant* pPlant = plantInfo.value();
@@ -588,11 +620,17 @@ std::optional<ForageNextStepInfo> Bee::forageNearestFlower()
 
         float dx = pPlant->x() - m_pos.x;
         float dy = pPlant->y() - m_pos.y;
-        float angleToPlant = std::atan2(dy, dx); // angle from bee to plant
+        float distToPlantSq = (dx * dx + dy * dy);
 
-        result.desiredMove.angle = angleToPlant;
+        if (distToPlantSq > 0.0f) {
+            // unit vector from bee to plant (if the bee is already on the plant, keep its current heading)
+            float distToPlant = std::sqrt(distToPlantSq);
+            result.desiredMove.dir.set(dx / distToPlant, dy / distToPlant);
+        }
+        else {
+            result.desiredMove.dir = m_heading;
+        }
 
-        float distToPlantSq = (dx * dx + dy * dy);
         if (distToPlantSq <= (Params::beeStepLength * Params::beeStepLength)) {
             // plant is within one step length, so just go directly to it
             result.desiredMove.x = pPlant->x();
@@ -601,8 +639,8 @@ std::optional<ForageNextStepInfo> Bee::forageNearestFlower()
         }
         else {
             // plant is further away than one step length, so just head in its direction
-            result.desiredMove.x = m_pos.x + Params::beeStepLength * std::cos(angleToPlant);
-            result.desiredMove.y = m_pos.y + Params::beeStepLength * std::sin(angleToPlant);
+            result.desiredMove.x = m_pos.x + Params::beeStepLength * result.desiredMove.dir.x;
+            result.desiredMove.y = m_pos.y + Params::beeStepLength * result.desiredMove.dir.y;
         }
 
         return result;
@@ -622,6 +660,7 @@ std::optional<ForageNextStepInfo> Bee::forageNearestFlower()
 //
 // The returned position will NOT be such that the bee has to cross a barrier. Checks are
 // made in this code and potential moves that would cross a barrier are discounted.
+template<typename Features>
 pb::PosAndDir2D Bee::moveInRandomDirection(int attemptNumber /*=0*/)
 {
     static const float minMoveLen = 0.01f;
@@ -629,9 +668,15 @@ pb::PosAndDir2D Bee::moveInRandomDirection(int attemptNumber /*=0*/)
 
     pb::PosAndDir2D result;
 
-    result.angle = m_angle + m_distDir(m_pPolyBeeCore->m_rngEngine);
-    result.x = m_pos.x + Params::beeStepLength * std::cos(result.angle);
-    result.y = m_pos.y + Params::beeStepLength * std::sin(result.angle);
+    // perturb the current heading by a random rotation of up to beeMaxDirDelta either way
+    result.dir = pb::rotateUnitVector(m_heading, m_distDir(m_pPolyBeeCore->m_rngEngine));
+    result.x = m_pos.x + Params::beeStepLength * result.dir.x;
+    result.y = m_pos.y + Params::beeStepLength * result.dir.y;
+
+    if constexpr (!Features::hasBarriers) {
+        // no barriers in the environment, so there is nothing that can block the move
+        return result;
+    }
 
     // check for collision with barriers
     auto distOpt = m_pEnv->distanceToNearestObstructingBarrier(m_pos.x, m_pos.y, result.x, result.y);
@@ -654,14 +699,14 @@ pb::PosAndDir2D Bee::moveInRandomDirection(int attemptNumber /*=0*/)
             // if the distance to the nearest barrier is above a minimum threshold,
             // just move in the same direction but not as far as the barrier
             if (shorterMoveLen > minMoveLen) {
-                result.x = m_pos.x + shorterMoveLen * std::cos(result.angle);
-                result.y = m_pos.y + shorterMoveLen * std::sin(result.angle);
+                result.x = m_pos.x + shorterMoveLen * result.dir.x;
+                result.y = m_pos.y + shorterMoveLen * result.dir.y;
                 return result;
             }
             // if the distance to the nearest barrier is below the minimum threshold, recursively
             // trying moving in a diffent direction up to a fixed maximum number of attempts
             else if (attemptNumber < maxAttempts) {
-                return moveInRandomDirection(attemptNumber + 1);
+                return moveInRandomDirection<Features>(attemptNumber + 1);
             }
             else {
                 // if we've exceeded the maximum number of attempts, just stay in the same position for this update
@@ -679,8 +724,13 @@ pb::PosAndDir2D Bee::moveInRandomDirection(int attemptNumber /*=0*/)
 
 
 // record current position in path history, trimming to maximum length if necessary
+template<typename Features>
 void Bee::updatePathHistory()
 {
+    if constexpr (!Features::recordPaths) {
+        return;
+    }
+
     // add current position to path
     m_path.push_back(m_pos);
 
@@ -703,19 +753,23 @@ void Bee::addToRecentlyVisitedPlants(Plant* pPlant)
 }
 
 
+template<typename Features>
 void Bee::switchToOnFlower(Plant* pPlant)
 {
     m_state = BeeState::ON_FLOWER;
-    m_energy += pPlant->extractNectar(Params::beeEnergyBoostPerFlower); // boost bee's energy on visiting a flower
+    if constexpr (Features::hasEnergetics) {
+        m_energy += pPlant->extractNectar(Params::beeEnergyBoostPerFlower, m_pPolyBeeCore->currentIteration()); // boost bee's energy on visiting a flower
+    }
     m_currentFlowerDuration = 0;
     // we don't reset bout duration here, as the bee is still in the same foraging bout
 }
 
 
+template<typename Features>
 void Bee::stayOnFlower()
 {
     m_currentFlowerDuration++;
-    updatePathHistory();
+    updatePathHistory<Features>();
     if (m_currentFlowerDuration >= Params::beeOnFlowerDuration) {
         // finished resting in hive, so restart foraging
         m_state = BeeState::FORAGING;
@@ -731,9 +785,10 @@ void Bee::switchToReturnToHive()
     m_currentBoutDuration = 0;
     unsetTryingToCrossEntranceState();
 
-    if (m_inTunnel) {
+    if (m_pTunnel != nullptr) {
         // bee is inside tunnel, so set state to return to hive inside tunnel
         m_state = BeeState::RETURN_TO_HIVE_INSIDE_TUNNEL;
+        m_pHomingTunnel = m_pTunnel;
         calculateWaypointsInsideTunnel();
     }
     else {
@@ -754,22 +809,23 @@ void Bee::unsetTryingToCrossEntranceState()
 // Follow waypoints to return to end point while inside tunnel.
 // End point is this hive is it is inside the tunnel, or the last tunnel entrance used
 // to exit the tunnel if hive is outside tunnel.
+template<typename Features>
 void Bee::returnToHiveInsideTunnel()
 {
     // update bee's path record with current position
-    updatePathHistory();
+    updatePathHistory<Features>();
 
     // move towards next waypoint
-    bool reachedWaypoint = headToNextWaypoint();
+    bool reachedWaypoint = headToNextWaypoint<Features>();
 
     if (reachedWaypoint) {
         m_homingWaypoints.pop_front();
         if (m_homingWaypoints.empty()) {
             // reached final waypoint
-            if (m_pHive->inTunnel()) {
+            if (m_pHive->tunnel() == m_pHomingTunnel) {
                 // bee is now at hive
                 m_state = BeeState::IN_HIVE;
-                m_inTunnel = true;
+                m_pTunnel = m_pHomingTunnel;
                 m_currentHiveDuration = 0;
                 setDirAccordingToHive();
             }
@@ -786,13 +842,14 @@ void Bee::returnToHiveInsideTunnel()
 // Follow waypoints to return to end point while outside tunnel.
 // End point is hive if it is outside tunnel, or last tunnel entrance used to
 // enter tunnel if hive is inside tunnel.
+template<typename Features>
 void Bee::returnToHiveOutsideTunnel()
 {
     // update bee's path record with current position
-    updatePathHistory();
+    updatePathHistory<Features>();
 
     // move towards next waypoint
-    bool reachedWaypoint = headToNextWaypoint();
+    bool reachedWaypoint = headToNextWaypoint<Features>();
 
     if (reachedWaypoint) {
         m_homingWaypoints.pop_front();
@@ -802,13 +859,14 @@ void Bee::returnToHiveOutsideTunnel()
                 // we've been following waypoints outside the tunnel, but the hive is inside the tunnel,
                 // so now calculate waypoints inside tunnel to get to hive
                 m_state = BeeState::RETURN_TO_HIVE_INSIDE_TUNNEL;
+                m_pHomingTunnel = m_pHive->tunnel();
                 calculateWaypointsInsideTunnel();
             }
             else {
                 // we've been following waypoints outside the tunnel, and the hive is also outside the tunnel,
                 // so we're now at the hive
                 m_state = BeeState::IN_HIVE;
-                m_inTunnel = false;
+                m_pTunnel = nullptr;
                 m_currentHiveDuration = 0;
                 setDirAccordingToHive();
             }
@@ -823,6 +881,7 @@ void Bee::returnToHiveOutsideTunnel()
 // Does NOT remove the waypoint from the list even if it is reached - that is the caller's
 // responsibility if this method returned true.
 //
+template<typename Features>
 bool Bee::headToNextWaypoint()
 {
     assert(!m_homingWaypoints.empty());
@@ -836,7 +895,7 @@ bool Bee::headToNextWaypoint()
 
     // Set orientation to face the waypoint
     if (distToWaypoint > FLOAT_COMPARISON_EPSILON) {
-        m_angle = std::atan2(moveVector.y, moveVector.x);
+        m_heading = moveVector * (1.0f / distToWaypoint);
     }
 
     if (distToWaypoint <= Params::beeStepLength) {
@@ -850,8 +909,7 @@ bool Bee::headToNextWaypoint()
             // NB we assume that m_pLastTunnelEntrance refers to the same entrance as the waypoint being
             // targeted - this is ensured by the logic in calculateWaypointsAroundTunnel() and
             // calculateWaypointsInsideTunnel()
-            float probExit = m_pLastTunnelEntrance->probExit();
-            if (rnd < probExit) {
+            if (!Features::hasNets || rnd < m_pLastTunnelEntrance->probExit()) {
                 // the bee passed through an entrance, so it can move to the waypoint
                 reachedWaypoint = true;
                 stepLength = distToWaypoint;
@@ -906,8 +964,9 @@ bool Bee::nextWaypointIsTunnelEntrance() const
         return false;
     }
 
-    // If bee is in tunnel and hive is outside, or vice versa, last waypoint must be tunnel entrance
-    if (m_inTunnel != m_pHive->inTunnel()) {
+    // If bee is in tunnel and hive is outside, or vice versa (or they are in different tunnels),
+    // last waypoint must be tunnel entrance
+    if (m_pTunnel != m_pHive->tunnel()) {
         return true;
     }
 
@@ -917,10 +976,11 @@ bool Bee::nextWaypointIsTunnelEntrance() const
 
 
 // Stay in hive for required duration, then switch to foraging state
+template<typename Features>
 void Bee::stayInHive()
 {
     m_currentHiveDuration++;
-    updatePathHistory();
+    updatePathHistory<Features>();
     if (m_currentHiveDuration >= Params::beeInHiveDuration) {
         // finished resting in hive, so start a new foraging bout
         m_state = BeeState::FORAGING;
@@ -931,14 +991,14 @@ void Bee::stayInHive()
 }
 
 
-// Calculate waypoints to end point when bee is inside tunnel.
+// Calculate waypoints to end point when bee is inside tunnel (m_pHomingTunnel).
 // The end point is the hive if it is inside the tunnel, or the last tunnel entrance used
 // to enter the tunnel if the hive is outside the tunnel.
 void Bee::calculateWaypointsInsideTunnel()
 {
     m_homingWaypoints.clear();
 
-    if (m_pHive->inTunnel()) {
+    if (m_pHive->tunnel() == m_pHomingTunnel) {
         // hive is inside tunnel - just set single waypoint straight to hive
         m_homingWaypoints.push_back(m_pHive->pos());
         return;
@@ -946,7 +1006,11 @@ void Bee::calculateWaypointsInsideTunnel()
 
     // If we get to this point, the hive is outside the tunnel.
     // Set a single waypoint at the last tunnel entrance used to exit the tunnel
-    assert(m_pLastTunnelEntrance != nullptr);
+    // (which should always be one of this tunnel's entrances, as it is the one the bee came in by)
+    assert(m_pHomingTunnel != nullptr);
+    if (m_pLastTunnelEntrance == nullptr || m_pLastTunnelEntrance->tunnelIndex != m_pHomingTunnel->index()) {
+        m_pLastTunnelEntrance = nearestEntrance(*m_pHomingTunnel);
+    }
 
     pb::Pos2D entranceCentre(
         ((m_pLastTunnelEntrance->x1 + m_pLastTunnelEntrance->x2) / 2.0f),
@@ -965,183 +1029,54 @@ void Bee::calculateWaypointsInsideTunnel()
 }
 
 
-// Calculate waypoints to navigate around the tunnel from current position to end point.
-// The end point is the hive if it is outside the tunnel, or the last tunnel entrance used
-// to enter the tunnel if the hive is inside the tunnel.
+// Calculate waypoints to navigate around the tunnels from current position to end point.
+// The end point is the hive if it is outside the tunnels, or the last tunnel entrance used
+// to enter the hive's tunnel if the hive is inside a tunnel (or, if the bee last used an
+// entrance of some other tunnel, the nearest entrance of the hive's tunnel).
+// The routes themselves are precomputed by the environment's HomingRouteTable.
 void Bee::calculateWaypointsAroundTunnel()
 {
     m_homingWaypoints.clear();
 
-    float endPointX, endPointY;
+    const HomingRouteTable& routes = m_pEnv->getHomingRoutes();
+    int destNode;
 
     if (m_pHive->inTunnel()) {
-        endPointX = m_pLastTunnelEntrance->x1 + (m_pLastTunnelEntrance->x2 - m_pLastTunnelEntrance->x1) / 2.0f;
-        endPointY = m_pLastTunnelEntrance->y1 + (m_pLastTunnelEntrance->y2 - m_pLastTunnelEntrance->y1) / 2.0f;
-    }
-    else {
-        endPointX = m_pHive->x();
-        endPointY = m_pHive->y();
-    }
-
-    auto& tunnel = m_pEnv->getTunnel();
-    float tx = tunnel.x();
-    float ty = tunnel.y();
-    float tw = tunnel.width();
-    float th = tunnel.height();
-    float buffer = m_sTunnelWallBuffer;
-
-    // Check if direct path to end point intersects tunnel
-    if (!lineIntersectsTunnel(m_pos.x, m_pos.y, endPointX, endPointY)) {
-        // Direct path is clear, just go straight to end point
-        m_homingWaypoints.push_back(pb::Pos2D(endPointX, endPointY));
-        return;
-    }
-
-    // Direct path blocked, need to navigate around tunnel
-    // Define the four corner waypoints (with buffer distance applied outward)
-    pb::Pos2D topLeft(tx - buffer, ty - buffer);
-    pb::Pos2D topRight(tx + tw + buffer, ty - buffer);
-    pb::Pos2D bottomLeft(tx - buffer, ty + th + buffer);
-    pb::Pos2D bottomRight(tx + tw + buffer, ty + th + buffer);
-
-    // Determine which quadrant the bee is in relative to tunnel center
-    float centerX = tx + tw / 2.0f;
-    float centerY = ty + th / 2.0f;
-
-    // Calculate which corners to use based on bee and hive positions
-    // We'll evaluate different paths and choose the shortest
-
-    struct PathOption {
-        std::deque<pb::Pos2D> waypoints;
-        float totalDistance;
-    };
-
-    std::vector<PathOption> pathOptions;
-
-    // Helper to calculate distance between two points
-    auto distance = [](float x1, float y1, float x2, float y2) -> float {
-        float dx = x2 - x1;
-        float dy = y2 - y1;
-        return std::sqrt(dx * dx + dy * dy);
-    };
-
-    // Helper to calculate total path distance
-    auto calculatePathDistance = [&](const std::deque<pb::Pos2D>& waypoints) -> float {
-        float total = 0.0f;
-        float prevX = m_pos.x;
-        float prevY = m_pos.y;
-        for (const auto& wp : waypoints) {
-            total += distance(prevX, prevY, wp.x, wp.y);
-            prevX = wp.x;
-            prevY = wp.y;
-        }
-        return total;
-    };
-
-    // Try different routing options:
-    // 1. Via top-left corner
-    pathOptions.push_back({{topLeft, pb::Pos2D(endPointX, endPointY)}, 0.0f});
-
-    // 2. Via top-right corner
-    pathOptions.push_back({{topRight, pb::Pos2D(endPointX, endPointY)}, 0.0f});
-
-    // 3. Via bottom-left corner
-    pathOptions.push_back({{bottomLeft, pb::Pos2D(endPointX, endPointY)}, 0.0f});
-
-    // 4. Via bottom-right corner
-    pathOptions.push_back({{bottomRight, pb::Pos2D(endPointX, endPointY)}, 0.0f});
-
-    // 5. Via top-left then top-right
-    pathOptions.push_back({{topLeft, topRight, pb::Pos2D(endPointX, endPointY)}, 0.0f});
-
-    // 6. Via top-right then bottom-right
-    pathOptions.push_back({{topRight, bottomRight, pb::Pos2D(endPointX, endPointY)}, 0.0f});
-
-    // 7. Via bottom-right then bottom-left
-    pathOptions.push_back({{bottomRight, bottomLeft, pb::Pos2D(endPointX, endPointY)}, 0.0f});
-
-    // 8. Via bottom-left then top-left
-    pathOptions.push_back({{bottomLeft, topLeft, pb::Pos2D(endPointX, endPointY)}, 0.0f});
-
-    // Calculate distances and filter out paths that still intersect the tunnel
-    std::vector<PathOption> validPaths;
-    for (auto& option : pathOptions) {
-        bool valid = true;
-        float prevX = m_pos.x;
-        float prevY = m_pos.y;
-
-        // Check each segment of the path
-        for (const auto& wp : option.waypoints) {
-            if (lineIntersectsTunnel(prevX, prevY, wp.x, wp.y)) {
-                valid = false;
-                break;
-            }
-            prevX = wp.x;
-            prevY = wp.y;
+        const Tunnel& hiveTunnel = *m_pHive->tunnel();
+        if (m_pLastTunnelEntrance == nullptr || m_pLastTunnelEntrance->tunnelIndex != hiveTunnel.index()) {
+            m_pLastTunnelEntrance = nearestEntrance(hiveTunnel);
         }
-
-        if (valid) {
-            option.totalDistance = calculatePathDistance(option.waypoints);
-            validPaths.push_back(option);
-        }
-    }
-
-    // Choose the shortest valid path
-    if (!validPaths.empty()) {
-        auto shortest = std::min_element(validPaths.begin(), validPaths.end(),
-            [](const PathOption& a, const PathOption& b) {
-                return a.totalDistance < b.totalDistance;
-            });
-
-        m_homingWaypoints = shortest->waypoints;
+        destNode = routes.entranceNode(hiveTunnel.index(), m_pLastTunnelEntrance - hiveTunnel.getEntrances().data());
     }
     else {
-        // Fallback: if no valid path found (shouldn't happen), just add end point as waypoint
-        // and let the collision detection handle it
-        m_homingWaypoints.push_back(pb::Pos2D(endPointX, endPointY));
+        destNode = routes.hiveNode(m_pHive - m_pEnv->getHives().data());
     }
+
+    routes.route(m_pos, destNode, m_homingWaypoints);
 }
 
 
-// Check if a line segment from (x1, y1) to (x2, y2) intersects the tunnel rectangle
-// (excluding entrances - this is a simple geometric check)
-bool Bee::lineIntersectsTunnel(float x1, float y1, float x2, float y2) const
+// Return the entrance of the given tunnel whose centre is closest to the bee's current position
+const TunnelEntranceInfo* Bee::nearestEntrance(const Tunnel& tunnel) const
 {
-    auto& tunnel = m_pEnv->getTunnel();
-    float tx = tunnel.x();
-    float ty = tunnel.y();
-    float tw = tunnel.width();
-    float th = tunnel.height();
-
-    // Check if either endpoint is inside the tunnel
-    if ((x1 >= tx && x1 <= tx + tw && y1 >= ty && y1 <= ty + th) ||
-        (x2 >= tx && x2 <= tx + tw && y2 >= ty && y2 <= ty + th)) {
-        return true;
+    const auto& entrances = tunnel.getEntrances();
+    assert(!entrances.empty());
+
+    const TunnelEntranceInfo* pNearest = nullptr;
+    float nearestDistSq = std::numeric_limits<float>::max();
+    for (const TunnelEntranceInfo& entrance : entrances) {
+        float distSq = pb::distanceSq(m_pos.x, m_pos.y, (entrance.x1 + entrance.x2) / 2.0f, (entrance.y1 + entrance.y2) / 2.0f);
+        if (distSq < nearestDistSq) {
+            nearestDistSq = distSq;
+            pNearest = &entrance;
+        }
     }
-
-    // Check if line segment intersects any of the four tunnel edges
-    // Using parametric line intersection test for each edge
-
-    auto lineSegmentIntersect = [](float p1x, float p1y, float p2x, float p2y,
-                                    float p3x, float p3y, float p4x, float p4y) -> bool {
-        float d = (p2x - p1x) * (p4y - p3y) - (p2y - p1y) * (p4x - p3x);
-        if (std::abs(d) < FLOAT_COMPARISON_EPSILON) return false; // parallel
-
-        float t = ((p3x - p1x) * (p4y - p3y) - (p3y - p1y) * (p4x - p3x)) / d;
-        float u = ((p3x - p1x) * (p2y - p1y) - (p3y - p1y) * (p2x - p1x)) / d;
-
-        return (t >= 0.0f && t <= 1.0f && u >= 0.0f && u <= 1.0f);
-    };
-
-    // Check against top edge
-    if (lineSegmentIntersect(x1, y1, x2, y2, tx, ty, tx + tw, ty)) return true;
-    // Check against bottom edge
-    if (lineSegmentIntersect(x1, y1, x2, y2, tx, ty + th, tx + tw, ty + th)) return true;
-    // Check against left edge
-    if (lineSegmentIntersect(x1, y1, x2, y2, tx, ty, tx, ty + th)) return true;
-    // Check against right edge
-    if (lineSegmentIntersect(x1, y1, x2, y2, tx + tw, ty, tx + tw, ty + th)) return true;
-
-    return false;
+    return pNearest;
 }
 
+
+// Instantiate the step loop for every combination of simulation features, so that
+// Environment::update() can use whichever one matches the current configuration
+#define POLYBEE_INSTANTIATE_BEE_UPDATE(...) template void Bee::update<__VA_ARGS__>();
+POLYBEE_FOR_EACH_SIM_FEATURES(POLYBEE_INSTANTIATE_BEE_UPDATE)
+#undef POLYBEE_INSTANTIATE_BEE_UPDATE
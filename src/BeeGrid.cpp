@@ -0,0 +1,36 @@
+/**
+ * @file
+ *
+ * Implementation of the BeeGrid class
+ */
+
+#include "BeeGrid.h"
+#include "Bee.h"
+#include <cmath>
+
+
+void BeeGrid::initialise(float width, float height, float cellSize)
+{
+    clear();
+
+    m_cellSize = cellSize;
+    m_gridW = std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(width / m_cellSize)));
+    m_gridH = std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(height / m_cellSize)));
+    m_cellStart.assign(m_gridW * m_gridH + 1, 0);
+}
+
+
+void BeeGrid::clear()
+{
+    m_x.clear();
+    m_y.clear();
+    m_beeIndices.clear();
+    m_states.clear();
+    m_cellStart.assign(m_gridW * m_gridH + 1, 0);
+}
+
+
+void BeeGrid::rebuild(const std::vector<Bee>& bees)
+{
+    rebuild(bees, [](const Bee&) { return true; });
+}
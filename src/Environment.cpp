@@ -8,12 +8,16 @@
 #include "Bee.h"
 #include "PolyBeeCore.h"
 #include "Params.h"
+#include "StartupCache.h"
 #include "utils.h"
 #include <format>
 #include <cassert>
 #include <algorithm>
-#include <fstream>
-#include <sstream>
+#include <cmath>
+
+
+std::mutex Environment::s_paramsObstaclesMutex;
+std::shared_ptr<const ObstacleLayout> Environment::s_pParamsObstacles;
 
 
 Environment::Environment() {
@@ -25,7 +29,7 @@ void Environment::initialise(PolyBeeCore* pCore)
     m_pPolyBeeCore = pCore;
     m_width = Params::envW;
     m_height = Params::envH;
-    initialiseTunnel();
+    initialiseTunnels();
     initialiseBarriers();
     initialisePlants();
     if (!(Params::bEvolve && Params::evolveSpec.evolveHivePositions)) {
@@ -34,25 +38,46 @@ void Environment::initialise(PolyBeeCore* pCore)
     initialiseHeatmap();
     initialiseTargetHeatmap();
     initialiseFlowmap();
+    initialiseBeeGrid();
 }
 
 
-void Environment::initialiseTunnel()
+void Environment::initialiseTunnels()
 {
-    // initialise tunnel from Params (also adds entrances)
-    m_tunnel.initialise(Params::tunnelX, Params::tunnelY, Params::tunnelW, Params::tunnelH, this);
+    // initialise the main tunnel and any extra tunnels from Params (also adds entrances).
+    // The vector is sized first and never resized afterwards, as entrances and bees hold pointers into it
+    m_tunnels.clear();
+    m_tunnels.resize(1 + Params::extraTunnelSpecs.size());
+    m_tunnels[0].initialise(Params::tunnelX, Params::tunnelY, Params::tunnelW, Params::tunnelH, this, 0);
+    for (size_t i = 0; i < Params::extraTunnelSpecs.size(); ++i) {
+        const TunnelSpec& spec = Params::extraTunnelSpecs[i];
+        m_tunnels[i + 1].initialise(spec.x, spec.y, spec.w, spec.h, this, static_cast<int>(i + 1));
+    }
 }
 
 
 void Environment::initialiseBarriers() {
-    initialiseBarriers(Params::barrierSpecs);
+    // The barriers from Params (and the tunnels) are the same for every core, so their layout is only
+    // built once per process and shared. A core whose barriers are evolved gets a layout of its own when
+    // initialiseBarriers(barrierSpecs) is called with the barriers from a decision vector.
+    std::lock_guard<std::mutex> lock(s_paramsObstaclesMutex);
+    if (!s_pParamsObstacles) {
+        s_pParamsObstacles = buildObstacleLayout(Params::barrierSpecs);
+    }
+    m_pObstacles = s_pParamsObstacles;
 }
 
 
 void Environment::initialiseBarriers(const std::vector<BarrierSpec>& barrierSpecs)
 {
-    m_allBarriers.clear();
-    m_barrierGrid.clear();
+    m_pObstacles = buildObstacleLayout(barrierSpecs);
+}
+
+
+std::shared_ptr<const ObstacleLayout> Environment::buildObstacleLayout(const std::vector<BarrierSpec>& barrierSpecs) const
+{
+    auto pLayout = std::make_shared<ObstacleLayout>();
+    ObstacleLayout& layout = *pLayout;
 
     // Calculate total number of barriers and max barrier length
     int totalBarriers = 0;
@@ -64,21 +89,21 @@ void Environment::initialiseBarriers(const std::vector<BarrierSpec>& barrierSpec
             maxBarrierLength = spec.length();
         }
     }
-    m_allBarriers.reserve(totalBarriers);
+    layout.barriers.reserve(totalBarriers);
 
-    // initialise barrier grid (NB this stores pointers instead of Barrier objects)
+    // initialise obstacle grid (NB this stores pointers instead of Barrier objects)
     // - first determine the size of each cell in the grid. We want this to be at least as large as
     //   the longest barrier, so that we know that a 3x3 group of cells centered on a bee's current position
     //   will contain all barriers that the bee might possibly come across in its next potential move.
     //   In the (unlikely) case that all barriers are shorter than the bee's visual range, we use the bee's visual range
     //   as the cell size, so that we know that the 3x3 group of cells will contain all barriers near plants that
     //   the bee might be trying to visit.
-    m_barrierGridCellSize = std::max(maxBarrierLength, Params::beeVisualRange); // size of each cell in spatial index grid
-    m_barrierGridW = static_cast<size_t>(std::ceil(m_width / m_barrierGridCellSize));
-    m_barrierGridH = static_cast<size_t>(std::ceil(m_height / m_barrierGridCellSize));
-    m_barrierGrid.resize(m_barrierGridW, std::vector<std::vector<Barrier*>>(m_barrierGridH));
+    layout.cellSize = std::max(maxBarrierLength, Params::beeVisualRange); // size of each cell in spatial index grid
+    layout.gridW = static_cast<size_t>(std::ceil(m_width / layout.cellSize));
+    layout.gridH = static_cast<size_t>(std::ceil(m_height / layout.cellSize));
+    layout.grid.resize(layout.gridW, std::vector<ObstacleGridCell>(layout.gridH));
 
-    // initialise barriers from Params
+    // initialise barriers
     for (const BarrierSpec& spec : barrierSpecs)
     {
         float startX = spec.x1;
@@ -93,12 +118,36 @@ void Environment::initialiseBarriers(const std::vector<BarrierSpec>& barrierSpec
                 float thisStartY = startY + (j * spec.dy);
                 float thisEndY = endY + (j * spec.dy);
 
-                // create a barrier and add to m_allBarriers
-                m_allBarriers.emplace_back(thisStartX, thisStartY, thisEndX, thisEndY);
+                // create a barrier and add to the layout's barriers
+                layout.barriers.emplace_back(thisStartX, thisStartY, thisEndX, thisEndY);
 
                 // add pointer to this barrier in the spatial grid (based on the midpoint of the barrier)
-                auto [gridi, gridj] = envPosToBarrierGridIndex((thisStartX + thisEndX) / 2.0f, (thisStartY + thisEndY) / 2.0f);
-                m_barrierGrid[gridi][gridj].push_back(&m_allBarriers.back());
+                auto [gridi, gridj] = layout.gridIndex((thisStartX + thisEndX) / 2.0f, (thisStartY + thisEndY) / 2.0f);
+                layout.grid[gridi][gridj].barriers.push_back(&layout.barriers.back());
+            }
+        }
+    }
+
+    addTunnelsToObstacleGrid(layout);
+
+    return pLayout;
+}
+
+
+// Add each tunnel to every cell of the obstacle grid that its walls, plus the wall buffer that
+// bees keep outside them, overlap. Tunnels are well separated (see Params::checkConsistency()), so
+// a cell will hardly ever list more than one or two, whatever the total number of tunnels. Tunnels
+// are recorded by index, as each core has its own Tunnel objects but they all have the same geometry.
+void Environment::addTunnelsToObstacleGrid(ObstacleLayout& layout) const
+{
+    const float buffer = Bee::tunnelWallBuffer();
+    for (size_t t = 0; t < m_tunnels.size(); ++t) {
+        const Tunnel& tunnel = m_tunnels[t];
+        auto [iMin, jMin] = layout.gridIndex(tunnel.x() - buffer, tunnel.y() - buffer);
+        auto [iMax, jMax] = layout.gridIndex(tunnel.x() + tunnel.width() + buffer, tunnel.y() + tunnel.height() + buffer);
+        for (int i = static_cast<int>(iMin); i <= static_cast<int>(iMax); ++i) {
+            for (int j = static_cast<int>(jMin); j <= static_cast<int>(jMax); ++j) {
+                layout.grid[i][j].tunnels.push_back(static_cast<int>(t));
             }
         }
     }
@@ -140,12 +189,6 @@ void Environment::initialisePlants(const std::vector<PatchSpec>& patchSpecs, boo
     // Reserve space for all plants to prevent reallocation and pointer invalidation
     m_allPlants.reserve(totalPlants);
 
-    // initialise plant grid (NB this stores pointers instead of Plant objects)
-    m_plantGridCellSize = Params::beeVisualRange; // size of each cell in spatial index grid
-    m_plantGridW = static_cast<size_t>(std::ceil(m_width / m_plantGridCellSize));
-    m_plantGridH = static_cast<size_t>(std::ceil(m_height / m_plantGridCellSize));
-    m_plantGrid.resize(m_plantGridW, std::vector<std::vector<Plant*>>(m_plantGridH));
-
     // initialise plant patches from Params
     for (const PatchSpec& spec : allPatchSpecs)
     {
@@ -170,13 +213,10 @@ void Environment::initialisePlants(const std::vector<PatchSpec>& patchSpecs, boo
                     // create a plant at x,y and add to m_allPlants
                     m_allPlants.emplace_back(plantX, plantY, spec.speciesID);
 
-                    // add pointer to this plant in the spatial grid
-                    auto [i,j] = envPosToPlantGridIndex(plantX, plantY);
-                    m_plantGrid[i][j].push_back(&m_allPlants.back());
-
                     // if we're not ignoring this patch, add a pointer to the plant to the list of all plants
                     // to be included in the Successful Visit Fraction calculation
                     if (!spec.ignoreForSVF) {
+                        m_allPlants.back().setCountedForSVF(true);
                         m_plantsForSVFCalc.push_back(&m_allPlants.back());
                     }
 
@@ -186,33 +226,23 @@ void Environment::initialisePlants(const std::vector<PatchSpec>& patchSpecs, boo
             }
         }
     }
-}
-
 
-// Convert environment position (x,y) to grid index for m_plantGrid
-pb::Pos2D Environment::envPosToPlantGridIndex(float x, float y) const
-{
-    //assert(x >= 0.0f && x < m_width + FLOAT_COMPARISON_EPSILON);
-    //assert(y >= 0.0f && y < m_height + FLOAT_COMPARISON_EPSILON);
+    // build the spatial index of the plants (cell size is the bee's visual range, so a bee can only
+    // see plants in its own cell and the eight around it)
+    m_plantStore.initialise(m_allPlants, m_width, m_height, Params::beeVisualRange);
 
-    float gridx = x / m_plantGridCellSize;
-    float gridy = y / m_plantGridCellSize;
-
-    int i = std::clamp(static_cast<int>(gridx), 0, static_cast<int>(m_plantGridW)-1);
-    int j = std::clamp(static_cast<int>(gridy), 0, static_cast<int>(m_plantGridH)-1);
-
-    return pb::Pos2D(i, j);
+    m_visitCountHistogram.reset(m_plantsForSVFCalc);
 }
 
 
-// Convert environment position (x,y) to grid index for m_barrierGrid
-pb::Pos2D Environment::envPosToBarrierGridIndex(float x, float y) const
+// Convert environment position (x,y) to grid index for the obstacle grid
+pb::Pos2D ObstacleLayout::gridIndex(float x, float y) const
 {
-    float gridx = x / m_barrierGridCellSize;
-    float gridy = y / m_barrierGridCellSize;
+    float gridx = x / cellSize;
+    float gridy = y / cellSize;
 
-    int i = std::clamp(static_cast<int>(gridx), 0, static_cast<int>(m_barrierGridW)-1);
-    int j = std::clamp(static_cast<int>(gridy), 0, static_cast<int>(m_barrierGridH)-1);
+    int i = std::clamp(static_cast<int>(gridx), 0, static_cast<int>(gridW)-1);
+    int j = std::clamp(static_cast<int>(gridy), 0, static_cast<int>(gridH)-1);
 
     return pb::Pos2D(i, j);
 }
@@ -226,6 +256,9 @@ void Environment::initialiseHivesAndBees(const std::vector<HiveSpec>& hiveSpecs)
         const HiveSpec& spec = hiveSpecs[i];
         m_hives.emplace_back(spec.x, spec.y, spec.direction, this);
     }
+    // the tunnel entrances have already been set for this run (by PolyBeeEvolve, if evolving them),
+    // so the homing routes to the entrances and hives can be worked out now
+    m_homingRoutes.initialise(m_tunnels, m_hives, Bee::tunnelWallBuffer());
     initialiseBees();
 }
 
@@ -247,6 +280,10 @@ void Environment::initialiseBees()
 
     int numHives = static_cast<int>(m_hives.size());
     int numBeesPerHive = Params::numBees / numHives;
+    if (m_beeFraction < 1.0f) {
+        // reduced-fidelity screening run: keep at least one bee per hive
+        numBeesPerHive = std::max(1, static_cast<int>(numBeesPerHive * m_beeFraction));
+    }
 
     for (Hive& hive : m_hives) {
         for (int j = 0; j < numBeesPerHive; ++j) {
@@ -254,7 +291,7 @@ void Environment::initialiseBees()
         }
     }
 
-    if (numBeesPerHive * numHives < Params::numBees) {
+    if (m_beeFraction >= 1.0f && numBeesPerHive * numHives < Params::numBees) {
         pb::msg_warning(std::format("Number of bees ({0}) is not a multiple of number of hives ({1}). Created {2} bees instead of the requested {0}.",
             Params::numBees, numHives, numBeesPerHive * numHives));
     }
@@ -263,6 +300,15 @@ void Environment::initialiseBees()
 
 void Environment::initialiseHeatmap() {
     m_heatmap.initialise(&m_bees);
+
+    // the reference heatmaps, high EMD and target heatmap are the same for every core, so they are only
+    // worked out once per process and shared
+    m_pInvariants = StartupCache::environmentInvariants(m_heatmap);
+    m_heatmap.setReferenceHeatmaps(
+        std::shared_ptr<const std::vector<std::vector<double>>>(m_pInvariants, &m_pInvariants->uniformTargetNormalised),
+        std::shared_ptr<const std::vector<std::vector<double>>>(m_pInvariants, &m_pInvariants->antiTargetNormalised),
+        m_pInvariants->highEmd);
+
     if (!(Params::bEvolve && Params::evolveObjective != EvolveObjective::EMD_TO_TARGET_HEATMAP)) {
         pb::msg_info(std::format("Initial EMD between uniform target and anti-target heatmaps: {:.6f}",
             m_heatmap.high_emd()));
@@ -278,92 +324,9 @@ void Environment::initialiseTargetHeatmap()
         return;
     }
 
-    // Ensure core heatmap has been initialised
-    assert(m_heatmap.size_x() > 0 && m_heatmap.size_y() > 0);
-
-    // Check if target heatmap file exists and can be opened
-    std::string filename = Params::strTargetHeatmapFilename;
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        pb::msg_error_and_exit("Cannot open target heatmap file: " + filename);
-    }
-
-    // Get expected dimensions from the core heatmap
-    int expectedWidth = m_heatmap.size_x();
-    int expectedHeight = m_heatmap.size_y();
-
-    // Read CSV data
-    std::vector<std::vector<double>> targetData;
-    std::string line;
-
-    while (std::getline(file, line)) {
-        if (line.empty()) continue; // Skip empty lines
-
-        std::vector<double> row;
-        std::stringstream ss(line);
-        std::string cell;
-
-        while (std::getline(ss, cell, ',')) {
-            try {
-                double value = std::stod(cell);
-                row.push_back(value);
-            } catch (const std::exception& e) {
-                pb::msg_error_and_exit("Invalid numeric value in target heatmap CSV file: " + cell);
-            }
-        }
-
-        if (!row.empty()) {
-            targetData.push_back(row);
-        }
-    }
-
-    file.close();
-
-    // Check dimensions match
-    if (targetData.empty()) {
-        pb::msg_error_and_exit("Target heatmap file is empty: " + filename);
-    }
-
-    int actualHeight = static_cast<int>(targetData.size());
-    int actualWidth = static_cast<int>(targetData[0].size());
-
-    if (actualHeight != expectedHeight || actualWidth != expectedWidth) {
-        pb::msg_error_and_exit(
-            std::format("Target heatmap dimensions ({}x{} do not match core heatmap dimensions ({}x{})",
-                actualWidth, actualHeight, expectedWidth, expectedHeight));
-    }
-
-    // Check all rows have the same width
-    for (size_t i = 0; i < targetData.size(); ++i) {
-        if (static_cast<int>(targetData[i].size()) != expectedWidth) {
-            pb::msg_error_and_exit(std::format("Inconsistent row width in CSV file at row {}", i + 1));
-        }
-    }
-
-    // Transpose the matrix before storing, because we access these matrices as [x][y] elsewhere
-    std::vector<std::vector<double>> transposed(expectedWidth, std::vector<double>(expectedHeight));
-    for (int i = 0; i < expectedHeight; ++i) {
-        for (int j = 0; j < expectedWidth; ++j) {
-            transposed[j][i] = targetData[i][j];
-        }
-    }
-
-    // Check that the normalised data sums to 1.0
-    double sum = 0.0;
-    for (const auto& col : transposed) {
-        for (double v : col) {
-            sum += v;
-        }
-    }
-    constexpr double NORMALISATION_TOLERANCE = 1e-4;
-    if (std::abs(sum - 1.0) > NORMALISATION_TOLERANCE) {
-        pb::msg_error_and_exit(std::format(
-            "Target heatmap data does not sum to 1.0 (sum = {:.8f}, tolerance = {:.0e}): {}",
-            sum, NORMALISATION_TOLERANCE, filename));
-    }
-
-    // Store the transposed data
-    m_rawTargetHeatmapNormalised = std::move(transposed);
+    // the file has already been read and checked by StartupCache (see initialiseHeatmap()), and the
+    // result is shared by all cores via m_pInvariants
+    assert(m_pInvariants && !m_pInvariants->targetHeatmapNormalised.empty());
 }
 
 
@@ -372,6 +335,18 @@ void Environment::initialiseFlowmap() {
 }
 
 
+// The bee grid's cells must be at least as large as the largest radius the bees query it with. They
+// are also kept large enough that there are no more cells than bees, so that rebuilding the grid each
+// step takes time proportional to the number of bees however small the query radius.
+void Environment::initialiseBeeGrid() {
+    float cellSize = Params::beeOccupiedFlowerRadius;
+    if (Params::numBees > 0) {
+        cellSize = std::max(cellSize, std::sqrt(m_width * m_height / Params::numBees));
+    }
+    m_onFlowerBeeGrid.initialise(m_width, m_height, cellSize);
+}
+
+
 // Reset the environment to its initial state suitable for a new simulation run
 //
 // This method resets are changeable state and stochastic elements of the environment,
@@ -388,13 +363,16 @@ void Environment::resetForNewRun(
     // TODO - as the class is developed, ensure all relevant state is reset here
     resetHivesAndBees(hiveSpecs);
     resetPlants(bridgeSpecs);
+    for (Tunnel& tunnel : m_tunnels) {
+        tunnel.resetCrossingStats();
+    }
     m_heatmap.reset();
     m_flowmap.reset();
 }
 
 
 void Environment::resetPlants(const std::vector<PatchSpec>& bridgeSpecs) {
-    m_plantGrid.clear();
+    m_plantStore.clear();
     m_allPlants.clear();
     m_plantsForSVFCalc.clear();
     initialisePlants(bridgeSpecs, true);
@@ -408,24 +386,56 @@ void Environment::resetHivesAndBees(const std::vector<HiveSpec>& hiveSpecs) {
 }
 
 
-void Environment::update(int timestep) {
-    // update bee positions
-    for (Bee& bee : m_bees) {
-        bee.update();
-    }
+// Work out which of the optional features handled by the step loop are used by the current
+// configuration, so that PolyBeeCore::run() can pick the matching instantiation of the loop.
+// Anything that is switched off here must make no difference to the simulation's behaviour.
+SimFeatureFlags Environment::simFeatureFlags() const {
+    SimFeatureFlags flags;
+
+    flags.hasBarriers = !m_pObstacles->barriers.empty();
+
+    flags.hasNets = std::any_of(m_tunnels.begin(), m_tunnels.end(), [](const Tunnel& tunnel) {
+        const auto& entrances = tunnel.getEntrances();
+        return std::any_of(entrances.begin(), entrances.end(),
+            [](const TunnelEntranceInfo& e) { return e.netType != NetType::NONE; });
+    });
+
+    // with no energy gained or lost, a bee's energy never changes from its initial level, so only
+    // matters if that level is already outside the thresholds (which sends bees straight home)
+    flags.hasEnergetics = !(Params::beeEnergyDepletionPerStep == 0.0f &&
+                            Params::beeEnergyBoostPerFlower == 0.0f &&
+                            Params::beeInitialEnergy > Params::beeEnergyMinThreshold &&
+                            Params::beeInitialEnergy < Params::beeEnergyMaxThreshold);
+
+    flags.recordPaths = (Params::beePathRecordLen != 0);
+    flags.recordFlowmap = (Params::flowmapUpdatePeriod > 0);
+    flags.hasBeeInteractions = Params::beeAvoidOccupiedFlowers;
+
+    return flags;
+}
 
-    m_heatmap.update();
-    if (Params::flowmapUpdatePeriod > 0 && timestep % Params::flowmapUpdatePeriod == 0) {
-        m_flowmap.update();
+
+// The memory resource for transient allocations made while stepping the simulation
+// (see EpisodeArena)
+std::pmr::memory_resource* Environment::episodeArena() const {
+    assert(m_pPolyBeeCore != nullptr);
+    return &m_pPolyBeeCore->getEpisodeArena();
+}
+
+
+const Tunnel* Environment::tunnelAt(float x, float y) const {
+    for (int tunnelIndex : getNearbyTunnels(x, y)) {
+        if (m_tunnels[tunnelIndex].contains(x, y)) {
+            return &m_tunnels[tunnelIndex];
+        }
     }
+    return nullptr;
 }
 
 
-bool Environment::inTunnel(float x, float y) const {
-    return (x >= m_tunnel.x() &&
-            x <= m_tunnel.x() + m_tunnel.width() &&
-            y >= m_tunnel.y() &&
-            y <= m_tunnel.y() + m_tunnel.height());
+const std::vector<int>& Environment::getNearbyTunnels(float x, float y) const {
+    auto [i, j] = m_pObstacles->gridIndex(x, y);
+    return m_pObstacles->grid[static_cast<size_t>(i)][static_cast<size_t>(j)].tunnels;
 }
 
 
@@ -440,33 +450,48 @@ bool Environment::inTunnel(float x, float y) const {
 // This method considers only plants within visual range. If more than one unvisited plant is found,
 // it uses a distance-weighted random selection to pick one.
 //
+// If CheckBarriers is false, barriers are ignored (this is used when the caller knows there aren't any).
+//
+// If AvoidOccupied is true, plants that another bee is already on are skipped too (see flowerOccupied()).
+// This relies on the bee grid having been rebuilt for the current step.
+//
+template<bool CheckBarriers, bool AvoidOccupied>
 std::optional<Plant*> Environment::selectNearbyUnvisitedPlant(float x, float y, const std::vector<Plant*>& visited) const
 {
-    std::vector<NearbyPlantInfo> visiblePlants;
+    std::pmr::vector<NearbyPlantInfo> visiblePlants(episodeArena());
 
     float rangeSq = Bee::visualRange() * Bee::visualRange();
+    const Tunnel* pBeeTunnel = tunnelAt(x, y);
 
-    auto nearbyPlants = getNearbyPlants(x, y);
-    for (Plant* pPlant : nearbyPlants) {
+    // first find the plants in the local 3x3 grid cells that are within visual range
+    std::size_t numInRange = m_plantStore.gatherWithinRange(x, y, rangeSq);
+
+    for (std::size_t n = 0; n < numInRange; ++n) {
+        std::uint32_t index = m_plantStore.index(n);
+        Plant* pPlant = m_plantStore.plant(index);
         if (std::find(visited.begin(), visited.end(), pPlant) != visited.end()) {
             continue;  // Skip already visited plants
         }
 
-        float distSq = pb::distanceSq(x, y, pPlant->x(), pPlant->y()); // squared distance to plant
-
-        // check if plant is within visual range
-        if (distSq <= rangeSq) {
-            // ... next check if it is obstructed by the tunnel walls
-            if (m_tunnel.intersectsTunnelBoundary(x, y, pPlant->x(), pPlant->y()).intersects) {
-                continue; // Skip plants that are obstructed by the tunnel
-            }
-            // ... finally, check if it is obstructed by a barrier.
-            if (pathObstructedByBarrier(x, y, pPlant->x(), pPlant->y())) {
-                continue; // Skip plants that are obstructed by a barrier
-            }
+        float plantX = m_plantStore.x(index);
+        float plantY = m_plantStore.y(index);
 
-            visiblePlants.emplace_back(pPlant, std::sqrt(distSq));
+        // ... next check if it is obstructed by the tunnel walls
+        // (tunnels are well apart, so the line of sight crosses a tunnel wall exactly when the plant and the
+        // bee are not in the same tunnel, or not both outside all tunnels)
+        if (tunnelAt(plantX, plantY) != pBeeTunnel) {
+            continue; // Skip plants that are obstructed by the tunnel
+        }
+        // ... then, if required, check whether another bee is already on it
+        if (AvoidOccupied && flowerOccupied(pPlant)) {
+            continue; // Skip plants that are occupied
+        }
+        // ... finally, check if it is obstructed by a barrier.
+        if (CheckBarriers && pathObstructedByBarrier(x, y, plantX, plantY)) {
+            continue; // Skip plants that are obstructed by a barrier
         }
+
+        visiblePlants.emplace_back(pPlant, std::sqrt(m_plantStore.distSq(n)));
     }
 
     if (visiblePlants.empty()) {
@@ -484,21 +509,38 @@ std::optional<Plant*> Environment::selectNearbyUnvisitedPlant(float x, float y,
     }
 }
 
+template std::optional<Plant*> Environment::selectNearbyUnvisitedPlant<true, false>(float, float, const std::vector<Plant*>&) const;
+template std::optional<Plant*> Environment::selectNearbyUnvisitedPlant<false, false>(float, float, const std::vector<Plant*>&) const;
+template std::optional<Plant*> Environment::selectNearbyUnvisitedPlant<true, true>(float, float, const std::vector<Plant*>&) const;
+template std::optional<Plant*> Environment::selectNearbyUnvisitedPlant<false, true>(float, float, const std::vector<Plant*>&) const;
+
+
+// A flower is occupied if, at the start of the current step, a bee on a flower was within
+// Params::beeOccupiedFlowerRadius of it. (Bees that land or leave during the step are seen from the
+// next step, so the result doesn't depend on the order in which bees are updated.) The grid only holds
+// the bees that were on a flower, so any bee it finds in range will do.
+bool Environment::flowerOccupied(const Plant* pPlant) const
+{
+    return m_onFlowerBeeGrid.anyWithinRange(pPlant->x(), pPlant->y(), Params::beeOccupiedFlowerRadius,
+        [](std::uint32_t, float) { return true; });
+}
+
 
 // Return a flat vector of all barriers in the local 3x3 grid cells around the given position
 // The x and y parameters are experessed in environment coordinates (not grid indices)
 //
-std::vector<Barrier*> Environment::getNearbyBarriers(float x, float y) const
+std::pmr::vector<const Barrier*> Environment::getNearbyBarriers(float x, float y) const
 {
-    std::vector<Barrier*> nearbyBarriers;
+    std::pmr::vector<const Barrier*> nearbyBarriers(episodeArena());
 
-    auto [i, j] = envPosToBarrierGridIndex(x, y);
+    const auto& grid = m_pObstacles->grid;
+    auto [i, j] = m_pObstacles->gridIndex(x, y);
 
     for (int di = -1; di <= 1; ++di) {
         for (int dj = -1; dj <= 1; ++dj) {
-            if (i + di >= 0 && i + di < m_barrierGrid.size() &&
-                j + dj >= 0 && j + dj < m_barrierGrid[i + di].size()) {
-                const auto& cell = m_barrierGrid[i + di][j + dj];
+            if (i + di >= 0 && i + di < grid.size() &&
+                j + dj >= 0 && j + dj < grid[i + di].size()) {
+                const auto& cell = grid[i + di][j + dj].barriers;
                 nearbyBarriers.insert(nearbyBarriers.end(), cell.begin(), cell.end());
             }
         }
@@ -515,7 +557,7 @@ bool Environment::pathObstructedByBarrier(float x1, float y1, float x2, float y2
     pb::Line2D pathLine(pb::Pos2D(x1, y1), pb::Pos2D(x2, y2));
     float midX = (x1 + x2) / 2.0f;
     float midY = (y1 + y2) / 2.0f;
-    std::vector<Barrier*> nearbyBarriers = getNearbyBarriers(midX, midY);
+    auto nearbyBarriers = getNearbyBarriers(midX, midY);
 
 
     for (const Barrier* pBarrier : nearbyBarriers) {
@@ -539,7 +581,7 @@ std::optional<float> Environment::distanceToNearestObstructingBarrier(float x1,
 
     float midX = (x1 + x2) / 2.0f;
     float midY = (y1 + y2) / 2.0f;
-    std::vector<Barrier*> nearbyBarriers = getNearbyBarriers(midX, midY);
+    auto nearbyBarriers = getNearbyBarriers(midX, midY);
 
     for (const Barrier* pBarrier : nearbyBarriers) {
         auto intersectInfo = pBarrier->line.getIntersectInfo(pathLine);
@@ -557,54 +599,31 @@ std::optional<float> Environment::distanceToNearestObstructingBarrier(float x1,
 }
 
 
-// Return a flat vector of all plants in the local 3x3 grid cells around the given position
-//
-// These are selected purely based upon being present in the local 3x3 grid. This method
-// does NOT take into account whether the plant is within the bee's visual range, nor
-// whether or not it is obstructed by a barrier
-//
-std::vector<Plant*> Environment::getNearbyPlants(float x, float y) const
+// (The count of plants in the successful visit range is kept up to date as bees visit them, so this
+// doesn't need to look at the plants)
+double Environment::getSuccessfulVisitFraction() const
 {
-    std::vector<Plant*> nearbyPlants;
-
-    auto [i, j] = envPosToPlantGridIndex(x, y);
-
-    for (int di = -1; di <= 1; ++di) {
-        for (int dj = -1; dj <= 1; ++dj) {
-            if (i + di >= 0 && i + di < m_plantGrid.size() &&
-                j + dj >= 0 && j + dj < m_plantGrid[i + di].size()) {
-                const auto& cell = m_plantGrid[i + di][j + dj];
-                nearbyPlants.insert(nearbyPlants.end(), cell.begin(), cell.end());
-            }
-        }
+    if (m_allPlants.empty()) {
+        return 0.0;
     }
 
-    return nearbyPlants;
+    return static_cast<double>(m_visitCountHistogram.numInSuccessRange()) / static_cast<double>(m_plantsForSVFCalc.size());
 }
 
 
-double Environment::getSuccessfulVisitFraction() const
+void Environment::recordFlowerVisit(Plant* pPlant)
 {
-    if (m_allPlants.empty()) {
-        return 0.0;
+    pPlant->incrementVisitCount();
+    if (pPlant->countedForSVF()) {
+        m_visitCountHistogram.recordVisit(pPlant->visitCount());
     }
-
-    int successCount = 0;
-    for (const Plant* pPlant : m_plantsForSVFCalc) {
-        int vc = pPlant->visitCount();
-            if (vc >= Params::minVisitCountSuccess && vc <= Params::maxVisitCountSuccess) {
-            ++successCount;
-        }
-    }
-
-    return static_cast<double>(successCount) / static_cast<double>(m_plantsForSVFCalc.size());
 }
 
 
 // Select a plant randomly from the given list, with probability weighted by distance
 // (closer plants have higher probability of being selected)
 // Assumes that the plants vector is non-empty and that all plants in the vector are within visual range.
-Plant* Environment::pickRandomPlantWeightedByDistance(const std::vector<NearbyPlantInfo>& plants) const
+Plant* Environment::pickRandomPlantWeightedByDistance(const std::pmr::vector<NearbyPlantInfo>& plants) const
 {
     assert(!plants.empty());
 
@@ -637,28 +656,23 @@ Plant* Environment::pickRandomPlantWeightedByDistance(const std::vector<NearbyPl
 }
 
 
-EntranceCrossingStats Environment::getEntranceCrossingStats(EntranceCrossingType type) const {
+EntranceCrossingStats Environment::getEntranceCrossingStats(EntranceCrossingType type, std::optional<NetType> netType) const {
 
     EntranceCrossingStats stats;
 
-    int numAttempts = 0;
-    int numSuccesses = 0;
-    int numRebounds = 0;
-    for (const Bee& bee : m_bees) {
-        const auto& records = bee.entranceCrossingRecords();
-        for (const auto& record : records) {
-            if (type == EntranceCrossingType::ALL ||
-                (type == EntranceCrossingType::ENTRY && record.isEntry) ||
-                (type == EntranceCrossingType::EXIT && !record.isEntry)) {
-                numAttempts++;
-                numSuccesses += record.success ? 1 : 0;
-                numRebounds += record.numRebounds;
-            }
-        }
+    // the tunnels keep running totals for each entrance, so this is cheap enough to call every step if need be
+    CrossingAccumulator acc;
+    for (const Tunnel& tunnel : m_tunnels) {
+        acc.merge(tunnel.getCrossingStats(
+            (type == EntranceCrossingType::ALL || type == EntranceCrossingType::ENTRY),
+            (type == EntranceCrossingType::ALL || type == EntranceCrossingType::EXIT),
+            netType));
     }
 
-    stats.successRate = numAttempts > 0 ? static_cast<float>(numSuccesses) / static_cast<float>(numAttempts) : 0.0f;
-    stats.meanRebounds = numAttempts > 0 ? static_cast<float>(numRebounds) / static_cast<float>(numAttempts) : 0.0f;
+    stats.numAttempts = acc.attempts;
+    stats.successRate = acc.successRate();
+    stats.meanRebounds = acc.meanRebounds();
+    stats.sdRebounds = std::sqrt(acc.reboundVariance());
 
     return stats;
 }
@@ -0,0 +1,57 @@
+/**
+ * @file
+ *
+ * Implementation of the EpisodeArena class
+ */
+
+#include "EpisodeArena.h"
+#include <algorithm>
+
+
+EpisodeArena::EpisodeArena() :
+    m_heap(this),
+    m_pool(&m_heap)
+{
+}
+
+
+void EpisodeArena::release()
+{
+    m_pool.release();
+    m_episodeStats.reset();
+}
+
+
+void* EpisodeArena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    ++m_episodeStats.numAllocations;
+    ++m_totalStats.numAllocations;
+    return m_pool.allocate(bytes, alignment);
+}
+
+
+void EpisodeArena::do_deallocate(void* p, std::size_t bytes, std::size_t alignment)
+{
+    m_pool.deallocate(p, bytes, alignment);
+}
+
+
+void* EpisodeArena::HeapResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    void* p = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    for (EpisodeArenaStats* pStats : {&m_pArena->m_episodeStats, &m_pArena->m_totalStats}) {
+        ++pStats->numHeapAllocations;
+        pStats->heapBytes += bytes;
+        pStats->peakHeapBytes = std::max(pStats->peakHeapBytes, pStats->heapBytes);
+    }
+    return p;
+}
+
+
+void EpisodeArena::HeapResource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment)
+{
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    for (EpisodeArenaStats* pStats : {&m_pArena->m_episodeStats, &m_pArena->m_totalStats}) {
+        pStats->heapBytes -= std::min(pStats->heapBytes, bytes);
+    }
+}
@@ -72,13 +72,17 @@ void Flowmap::update() {
         if (cellY >= m_numCellsY) cellY = m_numCellsY - 1;
 
         pb::Pos2D deltaMovement = bee.deltaMovement();
-        if (deltaMovement.x == 0.0f && deltaMovement.y == 0.0f) {
+        float r2 = deltaMovement.x * deltaMovement.x + deltaMovement.y * deltaMovement.y;
+        if (r2 == 0.0f) {
             continue; // bee didn't move this step (e.g. on flower or in hive) — no direction to record
         }
-        float theta = std::atan2(deltaMovement.y, deltaMovement.x);
 
-        m_cells[cellX][cellY].thetas.push_back(theta);
-        m_cells[cellX][cellY].count++;
+        // accumulate the double-angle unit vector (cos 2theta, sin 2theta) of the movement direction, using
+        // cos 2theta = (x^2 - y^2) / r^2 and sin 2theta = 2xy / r^2 so that no trig functions are needed
+        FlowmapCell& cell = m_cells[cellX][cellY];
+        cell.sumCosTwoTheta += (deltaMovement.x * deltaMovement.x - deltaMovement.y * deltaMovement.y) / r2;
+        cell.sumSinTwoTheta += 2.0f * deltaMovement.x * deltaMovement.y / r2;
+        cell.count++;
     }
 }
 
@@ -88,16 +92,10 @@ void Flowmap::calculateFlow() {
     for (int x = 0; x < m_numCellsX; ++x) {
         for (auto& cell : m_cells[x]) {
             if (cell.count > 0) {
-                // calculate average flow vector by summing unit vectors for each movement angle and dividing by count
-                float sumSinTwoTheta = 0.0f;
-                float sumCosTwoTheta = 0.0f;
-                for (float theta : cell.thetas) {
-                    float twoTheta = 2.0f * theta; // multiply by 2 to get the headless direction in the range [0, 2*pi)
-                    sumSinTwoTheta += std::sin(twoTheta);
-                    sumCosTwoTheta += std::cos(twoTheta);
-                }
-                float avgSinTwoTheta = sumSinTwoTheta / cell.count;
-                float avgCosTwoTheta = sumCosTwoTheta / cell.count;
+                // calculate average flow vector from the sums of the double-angle unit vectors for each movement
+                // (doubling the angle maps the headless direction onto the range [0, 2*pi))
+                float avgSinTwoTheta = static_cast<float>(cell.sumSinTwoTheta / cell.count);
+                float avgCosTwoTheta = static_cast<float>(cell.sumCosTwoTheta / cell.count);
 
                 // calculate predominant movement axis as the angle of the average flow vector
                 // (divide by 2 to get the headless direction back in the range [0, pi))
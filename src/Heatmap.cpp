@@ -14,11 +14,12 @@
  * compute the Earth Mover's Distance (EMD) between this heatmap and another
  * (e.g. a target distribution), via emd(). This is used by PolyBeeEvolve to
  * score how closely a simulated bee-visitation heatmap matches a desired
- * target. Two convenience reference distributions are also precomputed in
- * initialise() for this purpose: a uniform target (equal density in every
- * cell) and an anti-target (all density in the single top-left cell), and
- * m_highEmd records the EMD between those two as a reference "worst case"
- * distance.
+ * target. Two convenience reference distributions are also available for this
+ * purpose: a uniform target (equal density in every cell) and an anti-target
+ * (all density in the single top-left cell), and m_highEmd records the EMD
+ * between those two as a reference "worst case" distance. These are the same
+ * for every environment in a process, so they are computed once by
+ * StartupCache and shared by all heatmaps via setReferenceHeatmaps().
  */
 
 #include "Heatmap.h"
@@ -28,10 +29,12 @@
 #include <opencv2/opencv.hpp> // for OpenCV EMD calculation
 #include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <chrono>
 #include <format>
 #include <limits>
 #include <vector>
+#include <utility>
 
 
 Heatmap::Heatmap(bool calcNormalised) : m_bCalcNormalised(calcNormalised),
@@ -64,24 +67,18 @@ void Heatmap::initialise(std::vector<Bee>* bees) {
     for (int x = 0; x < m_numCellsX; ++x) {
         m_cells[x].resize(m_numCellsY, 0);  // initialize all counts to zero
     }
+}
 
-    // set up the uniform target heatmap (for use in PolyBeeEvolve)
-    m_uniformTargetNormalised.resize(m_numCellsX);
-    for (int x = 0; x < m_numCellsX; ++x) {
-        m_uniformTargetNormalised[x].resize(m_numCellsY, 1.0 / (m_numCellsX * m_numCellsY));
-    }
 
-    // set up the anti-target heatmap (for use in PolyBeeEvolve)
-    // Note: The anti-target heatmap is a degenerate case where all the density is
-    // concentrated in a single cell (the top-left cell). This is useful for testing
-    // the EMD calculation and as a challenging target for optimization.
-    m_antiTargetNormalised.resize(m_numCellsX);
-    for (int x = 0; x < m_numCellsX; ++x) {
-        m_antiTargetNormalised[x].resize(m_numCellsY, 0.0f);
-    }
-    m_antiTargetNormalised[0][0] = 1.0f;
+void Heatmap::setReferenceHeatmaps(std::shared_ptr<const std::vector<std::vector<double>>> pUniformTargetNormalised,
+                                   std::shared_ptr<const std::vector<std::vector<double>>> pAntiTargetNormalised,
+                                   float highEmd) {
+    assert(pUniformTargetNormalised && pUniformTargetNormalised->size() == m_numCellsX);
+    assert(pAntiTargetNormalised && pAntiTargetNormalised->size() == m_numCellsX);
 
-    m_highEmd = emd(m_uniformTargetNormalised, m_antiTargetNormalised);
+    m_pUniformTargetNormalised = std::move(pUniformTargetNormalised);
+    m_pAntiTargetNormalised = std::move(pAntiTargetNormalised);
+    m_highEmd = highEmd;
 }
 
 
@@ -155,15 +152,49 @@ void Heatmap::calcNormalised() {
 
 
 // Wrapper to call the selected EMD implementation
-float Heatmap::emd(const std::vector<std::vector<double>>& target) const
+float Heatmap::emd(const std::vector<std::vector<double>>& target, EmdBackend backend) const
 {
-    return emd_opencv(m_cellsNormalised, target);
+    return emd(m_cellsNormalised, target, backend);
 }
 
 float Heatmap::emd(const std::vector<std::vector<double>>& heatmap1,
-                   const std::vector<std::vector<double>>& heatmap2) const
+                   const std::vector<std::vector<double>>& heatmap2, EmdBackend backend) const
 {
-    return emd_opencv(heatmap1, heatmap2);
+    switch (backend) {
+    case EmdBackend::SINKHORN:
+        return emd_sinkhorn(heatmap1, heatmap2);
+    case EmdBackend::SLICED:
+        return emd_sliced(heatmap1, heatmap2);
+    case EmdBackend::MULTISCALE:
+        return emd_multiscale(heatmap1, heatmap2);
+    default:
+        return emd_opencv(heatmap1, heatmap2);
+    }
+}
+
+
+// Merge each block of factor x factor cells into a single cell by summing their values, so a normalised
+// heatmap stays normalised. Partial blocks at the edges are merged into a (smaller) cell of their own.
+// EMD between coarsened heatmaps is measured in coarse cells, so multiply it by factor to get an
+// approximation of the EMD between the original heatmaps.
+std::vector<std::vector<double>> Heatmap::coarsened(const std::vector<std::vector<double>>& heatmap, int factor)
+{
+    assert(factor >= 1);
+    if (factor == 1 || heatmap.empty()) {
+        return heatmap;
+    }
+
+    std::size_t numX = (heatmap.size() + factor - 1) / factor;
+    std::size_t numY = (heatmap[0].size() + factor - 1) / factor;
+    std::vector<std::vector<double>> result(numX, std::vector<double>(numY, 0.0));
+
+    for (std::size_t x = 0; x < heatmap.size(); ++x) {
+        for (std::size_t y = 0; y < heatmap[x].size(); ++y) {
+            result[x / factor][y / factor] += heatmap[x][y];
+        }
+    }
+
+    return result;
 }
 
 
@@ -175,18 +206,7 @@ float Heatmap::emd(const std::vector<std::vector<double>>& heatmap1,
 float Heatmap::emd_opencv(const std::vector<std::vector<double>>& heatmap1,
                           const std::vector<std::vector<double>>& heatmap2) const
 {
-    if (!m_bCalcNormalised) {
-        pb::msg_error_and_exit("In Heatmap::emd_opencv(): Normalised heatmap calculation was not enabled.");
-    }
-
-    if (heatmap1.size() != heatmap2.size() ||
-        (heatmap1.size() > 0 && heatmap1[0].size() != heatmap2[0].size())) {
-        pb::msg_error_and_exit(
-            std::format("Heatmaps must have the same dimensions for EMD calculation. Given sizes are {}x{} and {}x{}.",
-                heatmap1.size(), heatmap1.empty() ? 0 : heatmap1[0].size(),
-                heatmap2.size(), heatmap2.empty() ? 0 : heatmap2[0].size())
-        );
-    }
+    checkEmdArguments(heatmap1, heatmap2, "emd_opencv");
 
     if (heatmap1.empty()) {
         return 0.0f;
@@ -259,6 +279,449 @@ float Heatmap::emd_opencv(const std::vector<std::vector<double>>& heatmap1,
 }
 
 
+void Heatmap::checkEmdArguments(const std::vector<std::vector<double>>& heatmap1,
+                                const std::vector<std::vector<double>>& heatmap2, const char* method) const
+{
+    if (!m_bCalcNormalised) {
+        pb::msg_error_and_exit(std::format("In Heatmap::{}(): Normalised heatmap calculation was not enabled.", method));
+    }
+
+    if (heatmap1.size() != heatmap2.size() ||
+        (heatmap1.size() > 0 && heatmap1[0].size() != heatmap2[0].size())) {
+        pb::msg_error_and_exit(
+            std::format("Heatmaps must have the same dimensions for EMD calculation. Given sizes are {}x{} and {}x{}.",
+                heatmap1.size(), heatmap1.empty() ? 0 : heatmap1[0].size(),
+                heatmap2.size(), heatmap2.empty() ? 0 : heatmap2[0].size())
+        );
+    }
+}
+
+
+namespace {
+
+    constexpr double LOG_ZERO = -1e30; // stands in for log(0) so that differences between log values stay finite
+
+    // exp(-d) for d >= 0, to within about 5e-14 relative, written as plain arithmetic (rather than calling
+    // std::exp) so that the loops that use it vectorise. d is capped at 40, where exp(-d) < 5e-18 is far
+    // below the precision that logAddExp() needs. exp(-d/128) is found from its Taylor series (to within
+    // the rounding error, as |d/128| <= 0.3125) and squared seven times.
+    inline double expOfNegative(double d)
+    {
+        constexpr double MAX_D = 40.0;
+        const double x = -std::min(d, MAX_D) * (1.0 / 128.0);
+        double r = 1.0 / 479001600.0;
+        r = r * x + 1.0 / 39916800.0;
+        r = r * x + 1.0 / 3628800.0;
+        r = r * x + 1.0 / 362880.0;
+        r = r * x + 1.0 / 40320.0;
+        r = r * x + 1.0 / 5040.0;
+        r = r * x + 1.0 / 720.0;
+        r = r * x + 1.0 / 120.0;
+        r = r * x + 1.0 / 24.0;
+        r = r * x + 1.0 / 6.0;
+        r = r * x + 0.5;
+        r = r * x + 1.0;
+        r = r * x + 1.0;
+        r *= r;
+        r *= r;
+        r *= r;
+        r *= r;
+        r *= r;
+        r *= r;
+        r *= r;
+        return r;
+    }
+
+    // log(1 + t) for 0 <= t <= 1, to within about 5e-16 relative, again as plain arithmetic. It uses
+    // log(1 + t) = 2 atanh(s) with s = t / (2 + t) <= 1/3, whose series has converged by the s^33 term.
+    inline double log1pOfUnit(double t)
+    {
+        const double s = t / (2.0 + t);
+        const double s2 = s * s;
+        double r = 1.0 / 33.0;
+        r = r * s2 + 1.0 / 31.0;
+        r = r * s2 + 1.0 / 29.0;
+        r = r * s2 + 1.0 / 27.0;
+        r = r * s2 + 1.0 / 25.0;
+        r = r * s2 + 1.0 / 23.0;
+        r = r * s2 + 1.0 / 21.0;
+        r = r * s2 + 1.0 / 19.0;
+        r = r * s2 + 1.0 / 17.0;
+        r = r * s2 + 1.0 / 15.0;
+        r = r * s2 + 1.0 / 13.0;
+        r = r * s2 + 1.0 / 11.0;
+        r = r * s2 + 1.0 / 9.0;
+        r = r * s2 + 1.0 / 7.0;
+        r = r * s2 + 1.0 / 5.0;
+        r = r * s2 + 1.0 / 3.0;
+        r = r * s2 + 1.0;
+        return 2.0 * s * r;
+    }
+
+    // log(exp(x) + exp(y)), to within about 1e-14 absolute of the value from std::exp and std::log1p
+    inline double logAddExp(double x, double y)
+    {
+        return std::max(x, y) + log1pOfUnit(expOfNegative(std::abs(x - y)));
+    }
+
+    // Sum of n values, kept in two interleaved partial sums so that the additions vectorise (a single
+    // running sum is a chain of dependent additions, which the compiler can't reorder). The pair of sums
+    // fills one 128-bit vector, the width available on every x86-64 processor.
+    double sumOf(const double* values, std::size_t n)
+    {
+        double sum0 = 0.0;
+        double sum1 = 0.0;
+        const std::size_t numPairs = n / 2;
+        for (std::size_t b = 0; b < numPairs; ++b) {
+            sum0 += values[2 * b];
+            sum1 += values[2 * b + 1];
+        }
+        double total = sum0 + sum1;
+        if (n % 2 != 0) {
+            total += values[n - 1];
+        }
+        return total;
+    }
+
+    // Copy two heatmaps into flat arrays (index x * sizeY + y), each scaled to unit mass. Returns false,
+    // setting result, if either heatmap is empty, in which case the EMD is taken to be the mass of the
+    // other one, as in emd_opencv().
+    bool flattenForEmd(const std::vector<std::vector<double>>& heatmap1, const std::vector<std::vector<double>>& heatmap2,
+                       std::vector<double>& p, std::vector<double>& q, float& result)
+    {
+        const std::size_t numX = heatmap1.size();
+        const std::size_t numY = numX > 0 ? heatmap1[0].size() : 0;
+        p.assign(numX * numY, 0.0);
+        q.assign(numX * numY, 0.0);
+
+        double mass1 = 0.0;
+        double mass2 = 0.0;
+        for (std::size_t x = 0; x < numX; ++x) {
+            for (std::size_t y = 0; y < numY; ++y) {
+                p[x * numY + y] = (heatmap1[x][y] > FLOAT_COMPARISON_EPSILON) ? heatmap1[x][y] : 0.0;
+                q[x * numY + y] = (heatmap2[x][y] > FLOAT_COMPARISON_EPSILON) ? heatmap2[x][y] : 0.0;
+                mass1 += p[x * numY + y];
+                mass2 += q[x * numY + y];
+            }
+        }
+
+        if (mass1 <= 0.0 || mass2 <= 0.0) {
+            result = static_cast<float>(mass1 + mass2);
+            return false;
+        }
+
+        for (std::size_t i = 0; i < p.size(); ++i) {
+            p[i] /= mass1;
+            q[i] /= mass2;
+        }
+        return true;
+    }
+
+    // Earth mover's distance between two 1D distributions of unit mass on cells of unit width
+    double emd1d(const std::vector<double>& p, const std::vector<double>& q)
+    {
+        double cumDiff = 0.0;
+        double dist = 0.0;
+        for (std::size_t i = 0; i < p.size(); ++i) {
+            cumDiff += p[i] - q[i];
+            dist += std::abs(cumDiff);
+        }
+        return dist;
+    }
+
+    /**
+     * Convolution of a (log-domain) grid with the kernel exp(-d/eps), where d is the L1 distance between
+     * cells, as needed by the Sinkhorn iterations. The kernel is separable, so it is applied along one
+     * axis and then the other, and along each axis it is a two-sided exponential, so it can be applied
+     * with one forward and one backward recursive pass rather than a sum over all pairs of cells. That
+     * makes each application O(number of cells) rather than O(cells^2).
+     *
+     * The recursion runs along the outer index of the arrays, and the inner loops run over the
+     * independent lines, which are contiguous, so they vectorise. The pass along the other axis works
+     * on a transposed copy. logAddExp() avoids calls to std::exp and std::log1p, which would keep the
+     * loops scalar, and Heatmap.cpp is compiled with -fno-trapping-math (see CMakeLists.txt) so that
+     * the compiler can turn its min and max into vector selects.
+     *
+     * If weighted is set for an axis, the kernel along that axis is d * exp(-d/eps) instead, which is
+     * what is needed to add up the transport cost along that axis.
+     */
+    class LaplaceKernel {
+    public:
+        LaplaceKernel(std::size_t numX, std::size_t numY, double eps) :
+            m_numX(numX), m_numY(numY), m_invEps(1.0 / eps),
+            m_transposed(numX * numY), m_work(numX * numY), m_fwd0(numX * numY), m_bwd0(numX * numY),
+            m_fwd1(numX * numY), m_bwd1(numX * numY) {}
+
+        // out[i] = log sum_j exp(in[j] - d(i,j)/eps) (times d along a weighted axis)
+        void apply(const std::vector<double>& in, std::vector<double>& out, bool weightX = false, bool weightY = false)
+        {
+            transpose(in.data(), m_transposed.data(), m_numX, m_numY);
+            applyAlongOuter(m_transposed.data(), m_work.data(), m_numY, m_numX, weightY);
+            transpose(m_work.data(), m_transposed.data(), m_numY, m_numX);
+            out.resize(in.size());
+            applyAlongOuter(m_transposed.data(), out.data(), m_numX, m_numY, weightX);
+        }
+
+    private:
+        static void transpose(const double* in, double* out, std::size_t n, std::size_t m)
+        {
+            for (std::size_t k = 0; k < n; ++k) {
+                for (std::size_t l = 0; l < m; ++l) {
+                    out[l * n + k] = in[k * m + l];
+                }
+            }
+        }
+
+        // Apply the 1D kernel along the outer index of an n x m array (m independent lines of length n)
+        void applyAlongOuter(const double* in, double* out, std::size_t n, std::size_t m, bool weighted)
+        {
+            double* fwd0 = m_fwd0.data();   // log sum over k' <= k of in[k'] exp(-(k-k')/eps)
+            double* bwd0 = m_bwd0.data();   // log sum over k' >= k of in[k'] exp(-(k'-k)/eps)
+            double* fwd1 = m_fwd1.data();   // log sum over k' < k of in[k'] (k-k') exp(-(k-k')/eps)
+            double* bwd1 = m_bwd1.data();   // log sum over k' > k of in[k'] (k'-k) exp(-(k'-k)/eps)
+            const double invEps = m_invEps;
+
+            for (std::size_t l = 0; l < m; ++l) {
+                fwd0[l] = in[l];
+                fwd1[l] = LOG_ZERO;
+                bwd0[(n - 1) * m + l] = in[(n - 1) * m + l];
+                bwd1[(n - 1) * m + l] = LOG_ZERO;
+            }
+            for (std::size_t k = 1; k < n; ++k) {
+                const double* inK = in + k * m;
+                const double* prev0 = fwd0 + (k - 1) * m;
+                const double* prev1 = fwd1 + (k - 1) * m;
+                double* cur0 = fwd0 + k * m;
+                double* cur1 = fwd1 + k * m;
+                for (std::size_t l = 0; l < m; ++l) {
+                    cur0[l] = logAddExp(inK[l], prev0[l] - invEps);
+                }
+                if (weighted) {
+                    for (std::size_t l = 0; l < m; ++l) {
+                        cur1[l] = logAddExp(prev1[l], prev0[l]) - invEps;
+                    }
+                }
+            }
+            for (std::size_t k = n - 1; k-- > 0;) {
+                const double* inK = in + k * m;
+                const double* next0 = bwd0 + (k + 1) * m;
+                const double* next1 = bwd1 + (k + 1) * m;
+                double* cur0 = bwd0 + k * m;
+                double* cur1 = bwd1 + k * m;
+                for (std::size_t l = 0; l < m; ++l) {
+                    cur0[l] = logAddExp(inK[l], next0[l] - invEps);
+                }
+                if (weighted) {
+                    for (std::size_t l = 0; l < m; ++l) {
+                        cur1[l] = logAddExp(next1[l], next0[l]) - invEps;
+                    }
+                }
+            }
+
+            if (weighted) {
+                for (std::size_t i = 0; i < n * m; ++i) {
+                    out[i] = logAddExp(fwd1[i], bwd1[i]);
+                }
+            }
+            else {
+                for (std::size_t k = 0; k + 1 < n; ++k) {
+                    for (std::size_t l = 0; l < m; ++l) {
+                        out[k * m + l] = logAddExp(fwd0[k * m + l], bwd0[(k + 1) * m + l] - invEps);
+                    }
+                }
+                for (std::size_t l = 0; l < m; ++l) {
+                    out[(n - 1) * m + l] = fwd0[(n - 1) * m + l];
+                }
+            }
+        }
+
+        std::size_t m_numX;
+        std::size_t m_numY;
+        double m_invEps;
+        std::vector<double> m_transposed;
+        std::vector<double> m_work;
+        std::vector<double> m_fwd0;
+        std::vector<double> m_bwd0;
+        std::vector<double> m_fwd1;
+        std::vector<double> m_bwd1;
+    };
+
+} // anonymous namespace
+
+
+// Approximate EMD by entropy-regularised optimal transport, solved with Sinkhorn iterations in the log
+// domain (so that small values of Params::emdSinkhornEpsilon don't underflow), using the separable
+// kernel above so that each iteration is linear in the number of cells.
+//  - Returns the transport cost of the regularised plan, so once the iterations have converged it is
+//    an upper bound on the exact EMD: 0 <= sinkhorn - exact <= eps * (H(p) + H(q)), where H is the
+//    entropy (in nats) of each normalised heatmap, which is at most 2 * eps * ln(number of cells).
+//    This worst case is loose: the plan mostly spreads each cell's mass over a few cells around
+//    where the exact plan sends it, so the error is typically a few times eps.
+//  - The iterations stop when the plan's marginals are within 1e-4 (L1) of the heatmaps, or after
+//    Params::emdSinkhornMaxIterations; a marginal error of delta can change the cost by up to
+//    delta * (size_x + size_y) more in either direction.
+//  - Computational complexity: O(cells) per iteration
+//
+float Heatmap::emd_sinkhorn(const std::vector<std::vector<double>>& heatmap1,
+                            const std::vector<std::vector<double>>& heatmap2) const
+{
+    checkEmdArguments(heatmap1, heatmap2, "emd_sinkhorn");
+
+    std::vector<double> p;
+    std::vector<double> q;
+    float result = 0.0f;
+    if (heatmap1.empty() || !flattenForEmd(heatmap1, heatmap2, p, q, result)) {
+        return result;
+    }
+
+    constexpr double MARGINAL_TOLERANCE = 1e-4;
+    constexpr int CONVERGENCE_CHECK_PERIOD = 10;
+
+    const std::size_t numX = heatmap1.size();
+    const std::size_t numY = heatmap1[0].size();
+    const std::size_t numCells = numX * numY;
+    LaplaceKernel kernel(numX, numY, Params::emdSinkhornEpsilon);
+
+    std::vector<double> logP(numCells);
+    std::vector<double> logQ(numCells);
+    for (std::size_t i = 0; i < numCells; ++i) {
+        logP[i] = (p[i] > 0.0) ? std::log(p[i]) : LOG_ZERO;
+        logQ[i] = (q[i] > 0.0) ? std::log(q[i]) : LOG_ZERO;
+    }
+
+    // scaled dual potentials (f/eps and g/eps), so that the plan is exp(v_i + u_j - d(i,j)/eps)
+    std::vector<double> u(logQ);
+    std::vector<double> v(numCells);
+    std::vector<double> kernelU;
+    std::vector<double> kernelV;
+    kernel.apply(u, kernelU);
+
+    for (int iter = 1; iter <= Params::emdSinkhornMaxIterations; ++iter) {
+        for (std::size_t i = 0; i < numCells; ++i) {
+            v[i] = logP[i] - kernelU[i];
+        }
+        kernel.apply(v, kernelV);
+        for (std::size_t i = 0; i < numCells; ++i) {
+            u[i] = logQ[i] - kernelV[i];
+        }
+        kernel.apply(u, kernelU);
+
+        // the second marginal is now exact, so check how far the first one is from p
+        if (iter % CONVERGENCE_CHECK_PERIOD == 0) {
+            double marginalError = 0.0;
+            for (std::size_t i = 0; i < numCells; ++i) {
+                marginalError += std::abs(std::exp(v[i] + kernelU[i]) - p[i]);
+            }
+            if (marginalError < MARGINAL_TOLERANCE) {
+                break;
+            }
+        }
+    }
+
+    // transport cost of the plan along each axis, divided by the total flow as cv::EMD does
+    std::vector<double> weighted;
+    double flow = 0.0;
+    double cost = 0.0;
+    for (std::size_t i = 0; i < numCells; ++i) {
+        flow += std::exp(v[i] + kernelU[i]);
+    }
+    kernel.apply(u, weighted, true, false);
+    for (std::size_t i = 0; i < numCells; ++i) {
+        cost += std::exp(v[i] + weighted[i]);
+    }
+    kernel.apply(u, weighted, false, true);
+    for (std::size_t i = 0; i < numCells; ++i) {
+        cost += std::exp(v[i] + weighted[i]);
+    }
+
+    return (flow > 0.0) ? static_cast<float>(cost / flow) : 0.0f;
+}
+
+
+// Approximate EMD by the sum of the 1D EMDs between the heatmaps' x and y marginals (their projections
+// onto the two axes, the slices along which the L1 ground distance separates).
+//  - Any transport plan moves mass at least the x marginal distance horizontally and the y marginal
+//    distance vertically, so this is a lower bound: 0 <= exact - sliced. It is exact when the two
+//    heatmaps differ only along one axis, or when each is the product of its marginals, but there is
+//    no upper bound in general (heatmaps with the same marginals have a sliced distance of 0).
+//  - Computational complexity: O(cells) to find the marginals, in loops that vectorise, then
+//    O(size_x + size_y) for the 1D distances
+//
+float Heatmap::emd_sliced(const std::vector<std::vector<double>>& heatmap1,
+                          const std::vector<std::vector<double>>& heatmap2) const
+{
+    checkEmdArguments(heatmap1, heatmap2, "emd_sliced");
+
+    std::vector<double> p;
+    std::vector<double> q;
+    float result = 0.0f;
+    if (heatmap1.empty() || !flattenForEmd(heatmap1, heatmap2, p, q, result)) {
+        return result;
+    }
+
+    const std::size_t numX = heatmap1.size();
+    const std::size_t numY = heatmap1[0].size();
+    std::vector<double> px(numX, 0.0);
+    std::vector<double> qx(numX, 0.0);
+    std::vector<double> py(numY, 0.0);
+    std::vector<double> qy(numY, 0.0);
+    for (std::size_t x = 0; x < numX; ++x) {
+        px[x] = sumOf(p.data() + x * numY, numY);
+    }
+    for (std::size_t x = 0; x < numX; ++x) {
+        qx[x] = sumOf(q.data() + x * numY, numY);
+    }
+    for (std::size_t x = 0; x < numX; ++x) {
+        for (std::size_t y = 0; y < numY; ++y) {
+            py[y] += p[x * numY + y];
+            qy[y] += q[x * numY + y];
+        }
+    }
+
+    return static_cast<float>(emd1d(px, qx) + emd1d(py, qy));
+}
+
+
+// Approximate EMD by the exact EMD between coarsened heatmaps, working from coarse to fine.
+//  - Merging each block of k x k cells into one moves no mass more than (k-1)/2 cells along each axis
+//    (taking each block to be at its centre), so by the triangle inequality k * (EMD between the
+//    coarsened heatmaps) is within 2 * (k-1) cells of the exact EMD.
+//  - Starting with the largest power-of-two k that leaves at least 4 x 4 coarse cells, k is halved
+//    until that bound is no more than Params::emdMultiscaleTolerance times the coarse estimate, and if
+//    it never is, the exact EMD is returned. So heatmaps that are far apart (as most candidates are
+//    early in an optimisation) are compared on a coarse grid, and the error is always within tolerance.
+//  - Computational complexity: that of emd_opencv() on (cells / k^2) cells for each k tried, ending with
+//    the k accepted. In the worst case no coarse level is accepted, and emd_opencv() runs at every level
+//    and then on the full grid, which is slower than emd_opencv() alone. Each level has a quarter of the
+//    cells of the next, so the coarse levels add at most a third of its cost, and less as it is superlinear.
+float Heatmap::emd_multiscale(const std::vector<std::vector<double>>& heatmap1,
+                              const std::vector<std::vector<double>>& heatmap2) const
+{
+    checkEmdArguments(heatmap1, heatmap2, "emd_multiscale");
+
+    if (heatmap1.empty()) {
+        return 0.0f;
+    }
+
+    constexpr std::size_t MIN_COARSE_CELLS = 4; // along each axis
+
+    const std::size_t minSize = std::min(heatmap1.size(), heatmap1[0].size());
+    int factor = 1;
+    while (minSize / (2 * factor) >= MIN_COARSE_CELLS) {
+        factor *= 2;
+    }
+
+    for (; factor > 1; factor /= 2) {
+        float coarseEmd = factor * emd_opencv(coarsened(heatmap1, factor), coarsened(heatmap2, factor));
+        if (2.0f * (factor - 1) <= Params::emdMultiscaleTolerance * coarseEmd) {
+            return coarseEmd;
+        }
+    }
+
+    return emd_opencv(heatmap1, heatmap2);
+}
+
+
 void Heatmap::print(std::ostream& os) const
 {
     print_backend(os, m_cells);
@@ -13,5 +13,5 @@ Hive::Hive(float x, float y, int direction, const Environment* pEnv) :
     m_pos(x, y), m_direction(direction), m_pEnv(pEnv)
 {
     assert(m_pEnv != nullptr);
-    m_inTunnel = m_pEnv->inTunnel(m_pos.x, m_pos.y);
+    m_pTunnel = m_pEnv->tunnelAt(m_pos.x, m_pos.y);
 }
\ No newline at end of file
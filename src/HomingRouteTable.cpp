@@ -0,0 +1,346 @@
+/**
+ * @file
+ *
+ * Implementation of the HomingRouteTable class
+ */
+
+#include "HomingRouteTable.h"
+#include "Tunnel.h"
+#include "Hive.h"
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <limits>
+
+
+namespace {
+
+    constexpr float NO_ROUTE = std::numeric_limits<float>::infinity();
+
+    float distance(const pb::Pos2D& p1, const pb::Pos2D& p2) {
+        float dx = p2.x - p1.x;
+        float dy = p2.y - p1.y;
+        return std::sqrt(dx * dx + dy * dy);
+    }
+
+    constexpr int BVH_LEAF_SIZE = 2;
+    constexpr int BVH_MAX_DEPTH = 64;
+    constexpr float BVH_BOX_PADDING = 0.01f; // so that rounding in the box test never misses a rectangle
+
+    // Does the line segment from p1 to p2 pass through the given box? (slab test)
+    bool segmentHitsBox(const pb::Pos2D& p1, const pb::Pos2D& p2, float minX, float minY, float maxX, float maxY) {
+        float tMin = 0.0f;
+        float tMax = 1.0f;
+        const float start[2] = {p1.x, p1.y};
+        const float delta[2] = {p2.x - p1.x, p2.y - p1.y};
+        const float lo[2] = {minX - BVH_BOX_PADDING, minY - BVH_BOX_PADDING};
+        const float hi[2] = {maxX + BVH_BOX_PADDING, maxY + BVH_BOX_PADDING};
+        for (int axis = 0; axis < 2; ++axis) {
+            if (delta[axis] == 0.0f) {
+                if (start[axis] < lo[axis] || start[axis] > hi[axis]) {
+                    return false;
+                }
+                continue;
+            }
+            float t1 = (lo[axis] - start[axis]) / delta[axis];
+            float t2 = (hi[axis] - start[axis]) / delta[axis];
+            if (t1 > t2) {
+                std::swap(t1, t2);
+            }
+            tMin = std::max(tMin, t1);
+            tMax = std::min(tMax, t2);
+            if (tMin > tMax) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+} // anonymous namespace
+
+
+void HomingRouteTable::initialise(const std::vector<Tunnel>& tunnels, const std::vector<Hive>& hives, float buffer)
+{
+    m_tunnelRects.clear();
+    m_nodes.clear();
+
+    // tunnel corners, with the buffer distance applied outwards
+    for (const Tunnel& tunnel : tunnels) {
+        const Rect rect {tunnel.x(), tunnel.y(), tunnel.width(), tunnel.height()};
+        m_tunnelRects.push_back(rect);
+        m_nodes.push_back(pb::Pos2D(rect.x - buffer, rect.y - buffer));                   // top-left
+        m_nodes.push_back(pb::Pos2D(rect.x + rect.w + buffer, rect.y - buffer));          // top-right
+        m_nodes.push_back(pb::Pos2D(rect.x + rect.w + buffer, rect.y + rect.h + buffer)); // bottom-right
+        m_nodes.push_back(pb::Pos2D(rect.x - buffer, rect.y + rect.h + buffer));          // bottom-left
+    }
+    m_numCorners = m_nodes.size();
+    buildBvh();
+
+    // entrance midpoints
+    m_firstEntranceNodes.clear();
+    for (const Tunnel& tunnel : tunnels) {
+        m_firstEntranceNodes.push_back(m_nodes.size());
+        for (const TunnelEntranceInfo& entrance : tunnel.getEntrances()) {
+            m_nodes.push_back(pb::Pos2D(
+                entrance.x1 + (entrance.x2 - entrance.x1) / 2.0f,
+                entrance.y1 + (entrance.y2 - entrance.y1) / 2.0f));
+        }
+    }
+    m_firstEntranceNodes.push_back(m_nodes.size());
+
+    // hives
+    m_firstHiveNode = m_nodes.size();
+    for (const Hive& hive : hives) {
+        m_nodes.push_back(hive.pos());
+    }
+
+    // direct edges between visible nodes (the corners of a tunnel are only joined to the next corner
+    // of the same tunnel clockwise, but corners of different tunnels are joined both ways)
+    const std::size_t n = m_nodes.size();
+    m_dist.assign(n * n, NO_ROUTE);
+    m_next.assign(n * n, -1);
+    for (std::size_t i = 0; i < n; ++i) {
+        m_dist[i * n + i] = 0.0f;
+        m_next[i * n + i] = static_cast<int>(i);
+        for (std::size_t j = 0; j < n; ++j) {
+            if (j == i) {
+                continue;
+            }
+            if (i < m_numCorners && j < m_numCorners && i / 4 == j / 4 && j != (i / 4) * 4 + (i + 1) % 4) {
+                continue;
+            }
+            if (segmentIsClear(m_nodes[i], m_nodes[j])) {
+                m_dist[i * n + j] = distance(m_nodes[i], m_nodes[j]);
+                m_next[i * n + j] = static_cast<int>(j);
+            }
+        }
+    }
+
+    // Floyd-Warshall, but only allowing routes to pass through corners (a route should never
+    // take a bee via an entrance or another hive on the way to its destination)
+    for (std::size_t k = 0; k < m_numCorners; ++k) {
+        for (std::size_t i = 0; i < n; ++i) {
+            if (m_dist[i * n + k] == NO_ROUTE) {
+                continue;
+            }
+            for (std::size_t j = 0; j < n; ++j) {
+                float d = m_dist[i * n + k] + m_dist[k * n + j];
+                if (d < m_dist[i * n + j]) {
+                    m_dist[i * n + j] = d;
+                    m_next[i * n + j] = m_next[i * n + k];
+                }
+            }
+        }
+    }
+
+    m_reachableFromCorners.assign(n, false);
+    for (std::size_t c = 0; c < m_numCorners; ++c) {
+        for (std::size_t j = 0; j < n; ++j) {
+            if (m_dist[c * n + j] != NO_ROUTE) {
+                m_reachableFromCorners[j] = true;
+            }
+        }
+    }
+}
+
+
+// Build the bounding volume hierarchy over the tunnel rectangles, splitting each node at the median
+// of the rectangles' centres along its longer side
+void HomingRouteTable::buildBvh()
+{
+    m_bvhNodes.clear();
+    m_bvhRects.resize(m_tunnelRects.size());
+    std::iota(m_bvhRects.begin(), m_bvhRects.end(), 0);
+    if (!m_tunnelRects.empty()) {
+        m_bvhNodes.emplace_back();
+        buildBvhNode(0, 0, static_cast<int>(m_bvhRects.size()));
+    }
+}
+
+
+// Fill in the (already allocated) node at the given index of m_bvhNodes for the given range of
+// m_bvhRects, and build its children
+void HomingRouteTable::buildBvhNode(int index, int first, int count)
+{
+    BvhNode node {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                  std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), -1, first, count};
+    for (int k = first; k < first + count; ++k) {
+        const Rect& rect = m_tunnelRects[m_bvhRects[k]];
+        node.minX = std::min(node.minX, rect.x);
+        node.minY = std::min(node.minY, rect.y);
+        node.maxX = std::max(node.maxX, rect.x + rect.w);
+        node.maxY = std::max(node.maxY, rect.y + rect.h);
+    }
+
+    if (count > BVH_LEAF_SIZE) {
+        const bool splitX = (node.maxX - node.minX) >= (node.maxY - node.minY);
+        auto centre = [&](int r) {
+            const Rect& rect = m_tunnelRects[r];
+            return splitX ? rect.x + rect.w / 2.0f : rect.y + rect.h / 2.0f;
+        };
+        const int half = count / 2;
+        std::nth_element(m_bvhRects.begin() + first, m_bvhRects.begin() + first + half, m_bvhRects.begin() + first + count,
+            [&](int a, int b) { return centre(a) < centre(b); });
+
+        // the two children are kept next to each other, so only the index of the first is stored
+        node.left = static_cast<int>(m_bvhNodes.size());
+        node.count = 0;
+        m_bvhNodes.emplace_back();
+        m_bvhNodes.emplace_back();
+        buildBvhNode(node.left, first, half);
+        buildBvhNode(node.left + 1, first + half, count - half);
+    }
+
+    m_bvhNodes[index] = node;
+}
+
+
+// Call pred(tunnelIndex) for each tunnel that the line segment from p1 to p2 touches, stopping as soon
+// as it returns true. Returns true if it did.
+template<typename Pred>
+bool HomingRouteTable::anyRectOnSegment(const pb::Pos2D& p1, const pb::Pos2D& p2, Pred&& pred) const
+{
+    if (m_bvhNodes.empty()) {
+        return false;
+    }
+
+    int stack[BVH_MAX_DEPTH];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const BvhNode& node = m_bvhNodes[stack[--stackSize]];
+        if (!segmentHitsBox(p1, p2, node.minX, node.minY, node.maxX, node.maxY)) {
+            continue;
+        }
+        if (node.count > 0) {
+            for (int k = node.first; k < node.first + node.count; ++k) {
+                if (segmentIntersectsRect(p1, p2, m_tunnelRects[m_bvhRects[k]]) && pred(m_bvhRects[k])) {
+                    return true;
+                }
+            }
+        }
+        else {
+            assert(stackSize + 2 <= BVH_MAX_DEPTH);
+            stack[stackSize++] = node.left + 1;
+            stack[stackSize++] = node.left;
+        }
+    }
+    return false;
+}
+
+
+int HomingRouteTable::hiveNode(std::size_t hiveIndex) const
+{
+    assert(m_firstHiveNode + hiveIndex < m_nodes.size());
+    return static_cast<int>(m_firstHiveNode + hiveIndex);
+}
+
+
+int HomingRouteTable::entranceNode(std::size_t tunnelIndex, std::size_t entranceIndex) const
+{
+    assert(tunnelIndex + 1 < m_firstEntranceNodes.size());
+    assert(m_firstEntranceNodes[tunnelIndex] + entranceIndex < m_firstEntranceNodes[tunnelIndex + 1]);
+    return static_cast<int>(m_firstEntranceNodes[tunnelIndex] + entranceIndex);
+}
+
+
+void HomingRouteTable::route(const pb::Pos2D& pos, int destNode, std::pmr::deque<pb::Pos2D>& waypoints) const
+{
+    assert(destNode >= 0 && static_cast<std::size_t>(destNode) < m_nodes.size());
+    const pb::Pos2D& dest = m_nodes[destNode];
+
+    // Fly straight to the destination if the path is clear, or if there is no route round the tunnels
+    // to it anyway (which is always the case for an entrance), in which case the collision detection
+    // handles it
+    if (!m_reachableFromCorners[destNode] || segmentIsClear(pos, dest)) {
+        waypoints.push_back(dest);
+        return;
+    }
+
+    // Otherwise, head for whichever visible corner of the tunnels in the way gives the shortest route to
+    // the destination, or failing that whichever visible corner of any tunnel does
+    int bestCorner = -1;
+    float bestDist = NO_ROUTE;
+    anyRectOnSegment(pos, dest, [&](int tunnel) {
+        for (int c = 4 * tunnel; c < 4 * tunnel + 4; ++c) {
+            tryCorner(pos, c, destNode, bestCorner, bestDist);
+        }
+        return false;
+    });
+    if (bestCorner < 0) {
+        for (int c = 0; c < static_cast<int>(m_numCorners); ++c) {
+            tryCorner(pos, c, destNode, bestCorner, bestDist);
+        }
+    }
+
+    if (bestCorner < 0) {
+        // Fallback: if no valid path found, just add end point as waypoint and let the collision
+        // detection handle it
+        waypoints.push_back(dest);
+        return;
+    }
+
+    for (int node = bestCorner; node != destNode; node = next(node, destNode)) {
+        waypoints.push_back(m_nodes[node]);
+    }
+    waypoints.push_back(dest);
+}
+
+
+// Make the given corner the best first waypoint so far if its route to the destination is shorter than
+// the best so far (or as short, and it comes first), and it can be seen from pos. Ties go to the lowest
+// numbered corner, so the choice doesn't depend on the order in which corners are tried.
+void HomingRouteTable::tryCorner(const pb::Pos2D& pos, int corner, int destNode, int& bestCorner, float& bestDist) const
+{
+    if (dist(corner, destNode) == NO_ROUTE) {
+        return;
+    }
+    float d = distance(pos, m_nodes[corner]) + dist(corner, destNode);
+    if ((d < bestDist || (d == bestDist && corner < bestCorner)) && segmentIsClear(pos, m_nodes[corner])) {
+        bestDist = d;
+        bestCorner = corner;
+    }
+}
+
+
+// Check that the line segment from p1 to p2 does not touch any of the tunnels
+bool HomingRouteTable::segmentIsClear(const pb::Pos2D& p1, const pb::Pos2D& p2) const
+{
+    return !anyRectOnSegment(p1, p2, [](int) { return true; });
+}
+
+
+// Check if the line segment from p1 to p2 touches the given rectangle
+bool HomingRouteTable::segmentIntersectsRect(const pb::Pos2D& p1, const pb::Pos2D& p2, const Rect& rect) const
+{
+    const float tx = rect.x;
+    const float ty = rect.y;
+    const float tw = rect.w;
+    const float th = rect.h;
+
+    // Check if either endpoint is inside the tunnel
+    auto inside = [&](const pb::Pos2D& p) {
+        return p.x >= tx && p.x <= tx + tw && p.y >= ty && p.y <= ty + th;
+    };
+    if (inside(p1) || inside(p2)) {
+        return true;
+    }
+
+    // Check if line segment intersects any of the four tunnel edges
+    // Using parametric line intersection test for each edge
+    auto lineSegmentIntersect = [&](float p3x, float p3y, float p4x, float p4y) -> bool {
+        float d = (p2.x - p1.x) * (p4y - p3y) - (p2.y - p1.y) * (p4x - p3x);
+        if (std::abs(d) < FLOAT_COMPARISON_EPSILON) return false; // parallel
+
+        float t = ((p3x - p1.x) * (p4y - p3y) - (p3y - p1.y) * (p4x - p3x)) / d;
+        float u = ((p3x - p1.x) * (p2.y - p1.y) - (p3y - p1.y) * (p2.x - p1.x)) / d;
+
+        return (t >= 0.0f && t <= 1.0f && u >= 0.0f && u <= 1.0f);
+    };
+
+    return (lineSegmentIntersect(tx, ty, tx + tw, ty) ||            // top edge
+            lineSegmentIntersect(tx, ty + th, tx + tw, ty + th) ||  // bottom edge
+            lineSegmentIntersect(tx, ty, tx, ty + th) ||            // left edge
+            lineSegmentIntersect(tx + tw, ty, tx + tw, ty + th));   // right edge
+}
@@ -0,0 +1,363 @@
+/**
+ * @file
+ *
+ * Implementation of the IslandTransport class and its implementations
+ */
+
+#include "IslandTransport.h"
+#include "utils.h"
+#include <iostream>
+#include <format>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <cassert>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#ifdef POLYBEE_USE_MPI
+#include <mpi.h>
+#endif
+
+
+//////////////////////////////////////////////////////////////
+// IslandMessage
+
+// Messages are encoded as a flat block of bytes: header fields first, then the free text, then each
+// individual in turn as (ID, decision vector, fitness vector), then the champion (if any), then the
+// island's fitness call and episode counts. Both ends of
+// the transport are always the same polybee executable, so we just use the native representation of
+// each type.
+
+namespace {
+
+    template<typename T>
+    void appendValue(std::vector<char>& buf, const T& value) {
+        const char* p = reinterpret_cast<const char*>(&value);
+        buf.insert(buf.end(), p, p + sizeof(T));
+    }
+
+    void appendDoubles(std::vector<char>& buf, const pagmo::vector_double& v) {
+        appendValue(buf, static_cast<std::uint64_t>(v.size()));
+        const char* p = reinterpret_cast<const char*>(v.data());
+        buf.insert(buf.end(), p, p + v.size() * sizeof(double));
+    }
+
+    template<typename T>
+    T readValue(const std::vector<char>& buf, std::size_t& pos) {
+        if (pos + sizeof(T) > buf.size()) {
+            pb::msg_error_and_exit("IslandMessage::decode - message is truncated");
+        }
+        T value;
+        std::memcpy(&value, buf.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    pagmo::vector_double readDoubles(const std::vector<char>& buf, std::size_t& pos) {
+        auto n = readValue<std::uint64_t>(buf, pos);
+        if (pos + n * sizeof(double) > buf.size()) {
+            pb::msg_error_and_exit("IslandMessage::decode - message is truncated");
+        }
+        pagmo::vector_double v(n);
+        std::memcpy(v.data(), buf.data() + pos, n * sizeof(double));
+        pos += n * sizeof(double);
+        return v;
+    }
+
+} // anonymous namespace
+
+
+std::vector<char> IslandMessage::encode() const
+{
+    std::vector<char> buf;
+    const auto& [ids, dvs, fvs] = inds;
+    assert(ids.size() == dvs.size() && ids.size() == fvs.size());
+
+    appendValue(buf, static_cast<std::uint32_t>(type));
+    appendValue(buf, islandNum);
+    appendValue(buf, gen);
+    appendValue(buf, static_cast<std::uint64_t>(text.size()));
+    buf.insert(buf.end(), text.begin(), text.end());
+    appendValue(buf, static_cast<std::uint64_t>(ids.size()));
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        appendValue(buf, static_cast<std::uint64_t>(ids[i]));
+        appendDoubles(buf, dvs[i]);
+        appendDoubles(buf, fvs[i]);
+    }
+    appendDoubles(buf, championX);
+    appendDoubles(buf, championF);
+    appendValue(buf, numFitnessCalls);
+    appendValue(buf, numEpisodes);
+
+    return buf;
+}
+
+
+IslandMessage IslandMessage::decode(const std::vector<char>& buf)
+{
+    IslandMessage msg;
+    std::size_t pos = 0;
+
+    msg.type = static_cast<IslandMessageType>(readValue<std::uint32_t>(buf, pos));
+    msg.islandNum = readValue<std::uint32_t>(buf, pos);
+    msg.gen = readValue<std::int32_t>(buf, pos);
+    auto textLen = readValue<std::uint64_t>(buf, pos);
+    if (pos + textLen > buf.size()) {
+        pb::msg_error_and_exit("IslandMessage::decode - message is truncated");
+    }
+    msg.text.assign(buf.data() + pos, textLen);
+    pos += textLen;
+
+    auto numInds = readValue<std::uint64_t>(buf, pos);
+    auto& [ids, dvs, fvs] = msg.inds;
+    ids.reserve(numInds);
+    dvs.reserve(numInds);
+    fvs.reserve(numInds);
+    for (std::uint64_t i = 0; i < numInds; ++i) {
+        ids.push_back(readValue<std::uint64_t>(buf, pos));
+        dvs.push_back(readDoubles(buf, pos));
+        fvs.push_back(readDoubles(buf, pos));
+    }
+    msg.championX = readDoubles(buf, pos);
+    msg.championF = readDoubles(buf, pos);
+    msg.numFitnessCalls = readValue<std::uint64_t>(buf, pos);
+    msg.numEpisodes = readValue<std::uint64_t>(buf, pos);
+
+    return msg;
+}
+
+
+//////////////////////////////////////////////////////////////
+// IslandTransport
+
+std::unique_ptr<IslandTransport> IslandTransport::create(const std::string& type, int numWorkers)
+{
+    if (type == "unix") {
+        return std::make_unique<UnixSocketTransport>(numWorkers);
+    }
+#ifdef POLYBEE_USE_MPI
+    if (type == "mpi") {
+        return std::make_unique<MpiTransport>(numWorkers);
+    }
+#else
+    if (type == "mpi") {
+        pb::msg_error_and_exit("Island transport 'mpi' requested but polybee was built without MPI support (configure with -DPOLYBEE_USE_MPI=ON)");
+    }
+#endif
+    pb::msg_error_and_exit(std::format("Unknown island transport '{}'", type));
+}
+
+
+//////////////////////////////////////////////////////////////
+// UnixSocketTransport
+
+UnixSocketTransport::UnixSocketTransport(int numWorkers)
+{
+    m_numWorkers = numWorkers;
+
+    // make sure nothing buffered so far gets written out a second time by each child
+    std::cout.flush();
+    std::cerr.flush();
+    std::fflush(nullptr);
+
+    for (int w = 0; w < numWorkers; ++w) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            pb::msg_error_and_exit(std::format("UnixSocketTransport: socketpair() failed: {}", std::strerror(errno)));
+        }
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            pb::msg_error_and_exit(std::format("UnixSocketTransport: fork() failed: {}", std::strerror(errno)));
+        }
+
+        if (pid == 0) {
+            // child: become worker w, keeping only our own end of our own socket pair
+            for (int fd : m_workerFds) {
+                close(fd);
+            }
+            m_workerFds.clear();
+            m_workerPids.clear();
+            close(fds[0]);
+            m_coordinatorFd = fds[1];
+            m_workerId = w;
+            return;
+        }
+
+        // parent (coordinator)
+        close(fds[1]);
+        m_workerFds.push_back(fds[0]);
+        m_workerPids.push_back(static_cast<int>(pid));
+    }
+}
+
+
+UnixSocketTransport::~UnixSocketTransport()
+{
+    if (isCoordinator()) {
+        for (int fd : m_workerFds) {
+            close(fd);
+        }
+        for (std::size_t w = 0; w < m_workerPids.size(); ++w) {
+            int status = 0;
+            waitpid(m_workerPids[w], &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                pb::msg_warning(std::format("Island worker process {} (pid {}) did not exit cleanly", w, m_workerPids[w]));
+            }
+        }
+    }
+    else if (m_coordinatorFd >= 0) {
+        close(m_coordinatorFd);
+    }
+}
+
+
+void UnixSocketTransport::sendToWorker(int workerId, const IslandMessage& msg)
+{
+    assert(isCoordinator());
+    assert(workerId >= 0 && workerId < static_cast<int>(m_workerFds.size()));
+    sendFrame(m_workerFds[workerId], msg.encode());
+}
+
+
+IslandMessage UnixSocketTransport::receiveFromWorker(int workerId)
+{
+    assert(isCoordinator());
+    assert(workerId >= 0 && workerId < static_cast<int>(m_workerFds.size()));
+    return IslandMessage::decode(receiveFrame(m_workerFds[workerId], std::format("worker {}", workerId)));
+}
+
+
+void UnixSocketTransport::sendToCoordinator(const IslandMessage& msg)
+{
+    assert(!isCoordinator());
+    sendFrame(m_coordinatorFd, msg.encode());
+}
+
+
+IslandMessage UnixSocketTransport::receiveFromCoordinator()
+{
+    assert(!isCoordinator());
+    return IslandMessage::decode(receiveFrame(m_coordinatorFd, "coordinator"));
+}
+
+
+// Each frame is the payload length (8 bytes) followed by the payload itself
+void UnixSocketTransport::sendFrame(int fd, const std::vector<char>& payload)
+{
+    std::uint64_t len = payload.size();
+    auto writeAll = [fd](const char* p, std::size_t n) {
+        while (n > 0) {
+            ssize_t written = write(fd, p, n);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                pb::msg_error_and_exit(std::format("UnixSocketTransport: write failed: {}", std::strerror(errno)));
+            }
+            p += written;
+            n -= static_cast<std::size_t>(written);
+        }
+    };
+    writeAll(reinterpret_cast<const char*>(&len), sizeof(len));
+    writeAll(payload.data(), payload.size());
+}
+
+
+std::vector<char> UnixSocketTransport::receiveFrame(int fd, const std::string& peer)
+{
+    auto readAll = [fd, &peer](char* p, std::size_t n) {
+        while (n > 0) {
+            ssize_t got = read(fd, p, n);
+            if (got < 0) {
+                if (errno == EINTR) continue;
+                pb::msg_error_and_exit(std::format("UnixSocketTransport: read from {} failed: {}", peer, std::strerror(errno)));
+            }
+            if (got == 0) {
+                pb::msg_error_and_exit(std::format("UnixSocketTransport: connection to {} closed unexpectedly", peer));
+            }
+            p += got;
+            n -= static_cast<std::size_t>(got);
+        }
+    };
+    std::uint64_t len = 0;
+    readAll(reinterpret_cast<char*>(&len), sizeof(len));
+    std::vector<char> payload(len);
+    readAll(payload.data(), payload.size());
+    return payload;
+}
+
+
+//////////////////////////////////////////////////////////////
+// MpiTransport
+
+#ifdef POLYBEE_USE_MPI
+
+MpiTransport::MpiTransport(int numWorkers)
+{
+    MPI_Init(nullptr, nullptr);
+
+    int rank = 0;
+    int size = 0;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    if (size != numWorkers + 1) {
+        pb::msg_error_and_exit(std::format("MpiTransport: island-procs={} requires exactly {} MPI ranks, but {} were launched",
+            numWorkers, numWorkers + 1, size));
+    }
+
+    m_numWorkers = numWorkers;
+    m_workerId = rank - 1; // rank 0 is the coordinator
+}
+
+
+MpiTransport::~MpiTransport()
+{
+    MPI_Finalize();
+}
+
+
+void MpiTransport::sendToWorker(int workerId, const IslandMessage& msg)
+{
+    sendTo(workerId + 1, msg);
+}
+
+
+IslandMessage MpiTransport::receiveFromWorker(int workerId)
+{
+    return receiveFrom(workerId + 1);
+}
+
+
+void MpiTransport::sendToCoordinator(const IslandMessage& msg)
+{
+    sendTo(0, msg);
+}
+
+
+IslandMessage MpiTransport::receiveFromCoordinator()
+{
+    return receiveFrom(0);
+}
+
+
+void MpiTransport::sendTo(int rank, const IslandMessage& msg)
+{
+    std::vector<char> buf = msg.encode();
+    MPI_Send(buf.data(), static_cast<int>(buf.size()), MPI_CHAR, rank, 0, MPI_COMM_WORLD);
+}
+
+
+IslandMessage MpiTransport::receiveFrom(int rank)
+{
+    MPI_Status status;
+    MPI_Probe(rank, 0, MPI_COMM_WORLD, &status);
+    int count = 0;
+    MPI_Get_count(&status, MPI_CHAR, &count);
+    std::vector<char> buf(count);
+    MPI_Recv(buf.data(), count, MPI_CHAR, rank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    return IslandMessage::decode(buf);
+}
+
+#endif
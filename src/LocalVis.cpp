@@ -32,10 +32,12 @@
 #include "Params.h"
 #include "PolyBeeCore.h"
 #include "Flowmap.h"
+#include "Trajectory.h"
 #include <format>
 #include <chrono>
 #include <thread>
 #include <cmath>
+#include <algorithm>
 
 #if defined(PLATFORM_WEB)
 #include <emscripten/emscripten.h>
@@ -75,8 +77,27 @@ const int FONT_SIZE_LARGE = 40;
 
 const int MAX_DELAY_PER_STEP = 100;
 
+// 8 shades of green for 0-7+ plant visits, all with good contrast against
+// PATCH_BACKGROUND_COLOR (gray: 130,130,130)
+const Color PLANT_COLORS[8] = {
+    {0, 80, 0, 255},      // 0 visits: darkest green
+    {0, 110, 0, 255},     // 1 visit
+    {0, 140, 0, 255},     // 2 visits
+    {0, 170, 0, 255},     // 3 visits
+    {0, 200, 0, 255},     // 4 visits
+    {0, 230, 0, 255},     // 5 visits
+    {50, 255, 50, 255},   // 6 visits
+    {150, 255, 150, 255}, // 7+ visits: lightest green
+};
+
+const double MIN_REPLAY_SPEED = 1.0 / 16.0;  // frames per display frame
+const double MAX_REPLAY_SPEED = 1024.0;
+const int REPLAY_SCRUBBER_HEIGHT = 8;
+const int REPLAY_SCRUBBER_MARGIN = 10;
+
 LocalVis::LocalVis(PolyBeeCore* pPolyBeeCore) :
-    m_pPolyBeeCore{pPolyBeeCore}, m_camera{0}, m_currentEMD{0.0f}, m_currentEMDTime{0}
+    m_pPolyBeeCore{pPolyBeeCore}, m_camera{0}, m_delayPerStep{Params::visDelayPerStep},
+    m_currentEMD{0.0f}, m_currentEMDTime{0}
 {
     SetTraceLogLevel(4); // Level 4 suppresses INFO msgs from RayLib
 
@@ -111,11 +132,27 @@ LocalVis::LocalVis(PolyBeeCore* pPolyBeeCore) :
         // SetWindowSize(, );
     }
 #endif
+
+    // the simulation runs on its own thread, so the display frame rate no longer has to follow it
+    SetTargetFPS(60);
+
+    m_emdWorker = std::thread(&LocalVis::emdWorkerLoop, this);
 }
 
 
 LocalVis::~LocalVis()
 {
+    {
+        std::lock_guard<std::mutex> lock(m_emdMutex);
+        m_bStopEmdWorker = true;
+    }
+    m_emdCv.notify_one();
+    m_emdWorker.join();
+
+    if (m_heatmapTexture.id != 0) {
+        UnloadTexture(m_heatmapTexture);
+    }
+
     // destroy the window and cleanup the OpenGL context
     CloseWindow();
 }
@@ -151,6 +188,13 @@ void LocalVis::updateDrawFrame()
         m_pPolyBeeCore->earlyExit();
     }
 
+    if (replaying()) {
+        advanceReplay();
+    }
+    else {
+        m_snapshots.acquire(); // take the latest snapshot of the simulation, if there is a new one
+    }
+
     // Draw
     //----------------------------------------------------------------------------------
     BeginDrawing();
@@ -177,7 +221,7 @@ void LocalVis::updateDrawFrame()
 
 
         // draw tunnel rectangle and boundary
-        drawTunnel();
+        drawTunnels();
 
         // draw plant patches
         drawPatches();
@@ -193,14 +237,13 @@ void LocalVis::updateDrawFrame()
             drawBees();
         }
 
-        // draw heatmap
-        if (showHeatmap()) {
+        // draw heatmap (not available when replaying)
+        if (showHeatmap() && !replaying()) {
             drawHeatmap();
         }
 
-        // draw flowmap
-        if (m_bShowFlowmap) {
-            m_pPolyBeeCore->m_env.getFlowmap().calculateFlow();
+        // draw flowmap (not available when replaying)
+        if (m_bShowFlowmap && !replaying()) {
             drawFlowmap();
         }
 
@@ -218,17 +261,38 @@ void LocalVis::updateDrawFrame()
 
     // handle input
     processKeyboardInput();
+}
+
 
-    // sleep for a short time to control frame rate if requested
-    if (Params::visDelayPerStep > 0) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(Params::visDelayPerStep));
+void LocalVis::renderWhileRunning(const std::atomic<bool>& bSimFinished)
+{
+    while (!bSimFinished.load(std::memory_order_acquire)) {
+        updateDrawFrame();
     }
 }
 
 
-void LocalVis::drawTunnel()
+// Capture a snapshot for the renderer if it has taken the previous one. This is called by the simulation
+// thread after each step, and by the main thread once the simulation has finished.
+void LocalVis::offerSnapshot(int iteration, Environment& env)
+{
+    if (m_snapshots.wanted()) {
+        m_snapshots.back().capture(env, iteration, m_bShowFlowmap.load(std::memory_order_relaxed));
+        m_snapshots.publish();
+    }
+}
+
+
+void LocalVis::drawTunnels()
+{
+    for (const Tunnel& tunnel : m_pPolyBeeCore->m_env.getTunnels()) {
+        drawTunnel(tunnel);
+    }
+}
+
+
+void LocalVis::drawTunnel(const Tunnel& tunnel)
 {
-    auto& tunnel = m_pPolyBeeCore->m_env.getTunnel();
 
     // draw tunnel rectangle and boundary
     if (!showHeatmap()) {
@@ -239,7 +303,7 @@ void LocalVis::drawTunnel()
         envToDisplayRect({tunnel.x(), tunnel.y(), tunnel.width(), tunnel.height()}), 5.0, TUNNEL_BORDER_COLOR);
 
     // draw tunnel entrances with different colours based on net type
-    auto& entrances = m_pPolyBeeCore->m_env.getTunnel().getEntrances();
+    auto& entrances = tunnel.getEntrances();
     for (const TunnelEntranceInfo& entrance : entrances) {
         Rectangle entranceRect;
         switch (entrance.side) {
@@ -354,38 +418,40 @@ void LocalVis::drawPlants()
         return; // don't draw plants when showing heatmap
     }
 
-    // 8 shades of green for 0-7+ visits, all with good contrast against
-    // PATCH_BACKGROUND_COLOR (gray: 130,130,130)
-    static constexpr Color plantColors[8] = {
-        {0, 80, 0, 255},      // 0 visits: darkest green
-        {0, 110, 0, 255},     // 1 visit
-        {0, 140, 0, 255},     // 2 visits
-        {0, 170, 0, 255},     // 3 visits
-        {0, 200, 0, 255},     // 4 visits
-        {0, 230, 0, 255},     // 5 visits
-        {50, 255, 50, 255},   // 6 visits
-        {150, 255, 150, 255}, // 7+ visits: lightest green
-    };
+    if (replaying()) {
+        drawReplayPlants();
+        return;
+    }
 
-    for (const Plant& plant : m_pPolyBeeCore->m_env.getAllPlants()) {
-        float displayX = envToDisplayX(plant.x());
-        float displayY = envToDisplayY(plant.y());
-        float displaySize = envToDisplayN(HALF_PLANT_SIZE);
-        int colorIdx = std::min(plant.visitCount(), 7);
-        DrawCircleV({ displayX, displayY }, displaySize, plantColors[colorIdx]);
+    // plant positions come from the environment (they don't change during a run), and visit counts from the snapshot
+    const std::vector<Plant>& plants = m_pPolyBeeCore->m_env.getAllPlants();
+    const std::vector<int>& visitCounts = m_snapshots.front().plantVisitCounts;
+    float displaySize = envToDisplayN(HALF_PLANT_SIZE);
+    for (std::size_t p = 0; p < plants.size(); ++p) {
+        float displayX = envToDisplayX(plants[p].x());
+        float displayY = envToDisplayY(plants[p].y());
+        int colorIdx = (p < visitCounts.size()) ? std::min(visitCounts[p], 7) : 0;
+        DrawCircleV({ displayX, displayY }, displaySize, PLANT_COLORS[colorIdx]);
     }
 }
 
 
 void LocalVis::drawStatusText()
 {
+    if (replaying()) {
+        drawReplayStatusText();
+        return;
+    }
+
+    const VisSnapshot& snapshot = m_snapshots.front();
+
     std::string msg;
     if (m_bWaitingForUserToClose) {
-        msg = std::format("Finished {} iterations. Press ESC to exit", m_pPolyBeeCore->m_iIteration);
+        msg = std::format("Finished {} iterations. Press ESC to exit", snapshot.iteration);
     }
     else {
         msg = std::format("Iteration target {}. Current iteration {}\nSim speed {}",
-            Params::numIterations, m_pPolyBeeCore->m_iIteration, MAX_DELAY_PER_STEP - Params::visDelayPerStep);
+            Params::numIterations, snapshot.iteration, MAX_DELAY_PER_STEP - Params::visDelayPerStep);
     }
     DrawText(msg.c_str(), 10, 10, FONT_SIZE_REG, RAYWHITE);
 
@@ -404,13 +470,23 @@ void LocalVis::drawStatusText()
         else {
             targetStr = "provided target";
         }
-        DrawText(std::format("EMD (OpenCV) to {}: {:.4f} :: {} microseconds", targetStr, m_currentEMD, m_currentEMDTime).c_str(),
-            10, GetScreenHeight() - EMDVerticalOffset, FONT_SIZE_REG, RAYWHITE);
+        std::string emdStr;
+        {
+            std::lock_guard<std::mutex> lock(m_emdMutex);
+            if (m_currentEMDIteration < 0) {
+                emdStr = std::format("EMD (OpenCV) to {}: calculating...", targetStr);
+            }
+            else {
+                emdStr = std::format("EMD (OpenCV) to {}: {:.4f} at iteration {} :: {} microseconds",
+                    targetStr, m_currentEMD, m_currentEMDIteration, m_currentEMDTime);
+            }
+        }
+        DrawText(emdStr.c_str(), 10, GetScreenHeight() - EMDVerticalOffset, FONT_SIZE_REG, RAYWHITE);
         SVFVerticalOffset = 60;
     }
 
     if (m_bShowSVF) {
-        DrawText(std::format("SVF: {:.2f}%", m_pPolyBeeCore->getSuccessfulVisitFraction() * 100.0f).c_str(),
+        DrawText(std::format("SVF: {:.2f}%", snapshot.successfulVisitFraction * 100.0f).c_str(),
             10, GetScreenHeight() - SVFVerticalOffset, FONT_SIZE_REG, RAYWHITE);
     }
 }
@@ -422,31 +498,18 @@ void LocalVis::processKeyboardInput()
         m_bShowHelpOverlay = !m_bShowHelpOverlay;
     }
 
-    if (IsKeyPressed(KEY_H)) {
-        rotateDrawState();
+    if (replaying()) {
+        // playback controls replace pause, speed, display mode and EMD/SVF/flowmap controls
+        processReplayInput();
     }
-
-    if (IsKeyPressed(KEY_P)) {
-        m_bPaused = !m_bPaused;
-        m_pPolyBeeCore->pauseSimulation(m_bPaused);
+    else {
+        processSimulationInput();
     }
 
     if (IsKeyPressed(KEY_T)) {
         m_bShowTrails = !m_bShowTrails;
     }
 
-    if (IsKeyPressed(KEY_E)) {
-        m_bShowEMD = !m_bShowEMD;
-    }
-
-    if (IsKeyPressed(KEY_S)) {
-        m_bShowSVF = !m_bShowSVF;
-    }
-
-    if (IsKeyPressed(KEY_F)) {
-        m_bShowFlowmap = !m_bShowFlowmap;
-    }
-
     if (IsKeyPressed(KEY_ONE)) {
         m_trailColourMode = TrailColourMode::RANDOM;
     }
@@ -455,14 +518,6 @@ void LocalVis::processKeyboardInput()
         m_trailColourMode = TrailColourMode::ENTRANCE_USED;
     }
 
-    if (IsKeyDown(KEY_MINUS) || IsKeyDown(KEY_KP_SUBTRACT)) {
-        Params::visDelayPerStep = std::min(MAX_DELAY_PER_STEP, Params::visDelayPerStep+5);
-    }
-
-    if (IsKeyDown(KEY_EQUAL) || IsKeyDown(KEY_KP_ADD)) {
-        Params::visDelayPerStep = std::max(0, Params::visDelayPerStep-5);
-    }
-
     // Camera zoom controls
     // Uses log scaling to provide consistent zoom speed
     m_camera.zoom = expf(logf(m_camera.zoom) + ((float)GetMouseWheelMove()*0.1f));
@@ -491,9 +546,65 @@ void LocalVis::processKeyboardInput()
 }
 
 
+void LocalVis::processSimulationInput()
+{
+    if (IsKeyPressed(KEY_H)) {
+        rotateDrawState();
+    }
+
+    if (IsKeyPressed(KEY_P)) {
+        m_bPaused = !m_bPaused;
+        m_pPolyBeeCore->pauseSimulation(m_bPaused);
+    }
+
+    if (IsKeyPressed(KEY_E)) {
+        m_bShowEMD = !m_bShowEMD;
+    }
+
+    if (IsKeyPressed(KEY_S)) {
+        m_bShowSVF = !m_bShowSVF;
+    }
+
+    if (IsKeyPressed(KEY_F)) {
+        m_bShowFlowmap = !m_bShowFlowmap;
+    }
+
+    if (IsKeyDown(KEY_MINUS) || IsKeyDown(KEY_KP_SUBTRACT)) {
+        Params::visDelayPerStep = std::min(MAX_DELAY_PER_STEP, Params::visDelayPerStep+5);
+        m_delayPerStep.store(Params::visDelayPerStep, std::memory_order_relaxed);
+    }
+
+    if (IsKeyDown(KEY_EQUAL) || IsKeyDown(KEY_KP_ADD)) {
+        Params::visDelayPerStep = std::max(0, Params::visDelayPerStep-5);
+        m_delayPerStep.store(Params::visDelayPerStep, std::memory_order_relaxed);
+    }
+}
+
+
 void LocalVis::showHelpOverlay()
 {
-    const char* helpText =
+    const char* replayHelpText =
+        "Replay controls:\n"
+        "\n"
+        "?:\tToggle this help menu\n"
+        "P or Space:\tPause/resume playback\n"
+        ", / .:\tStep back/forward one frame (while paused)\n"
+        "Home / End:\tGo to first/last frame\n"
+        "Backspace:\tReverse playback direction\n"
+        "Click or drag on bar at bottom: Seek\n"
+        "\n"
+        "+:\tPlay faster\n"
+        "-:\tPlay slower\n"
+        "\n"
+        "T:\tToggle bee trails on/off\n"
+        "\n"
+        "Mouse Wheel: Zoom in/out\n"
+        "Arrow Keys: Pan camera\n"
+        "R:\tReset camera zoom and position\n"
+        "\n"
+        "ESC or Close Button: Exit program";
+
+    const char* helpText = replaying() ? replayHelpText :
         "Controls:\n"
         "\n"
         "?:\tToggle this help menu\n"
@@ -533,6 +644,8 @@ void LocalVis::continueUntilClosed()
     m_bWaitingForUserToClose = true;
     while (!WindowShouldClose()) // Detect window close button or ESC key
     {
+        // the simulation thread has finished, so this thread now takes the snapshots itself
+        offerSnapshot(m_pPolyBeeCore->m_iIteration, m_pPolyBeeCore->m_env);
         updateDrawFrame();
     }
 }
@@ -565,36 +678,34 @@ void LocalVis::drawBees()
             4.0f, HIVE_COLOR);
     }
 
-    // draw bees
-    for (const Bee& bee : m_pPolyBeeCore->getBees()) {
-        std::vector<Vector2> BeeShapeAbs = BEE_SHAPE;
-        for (Vector2& v : BeeShapeAbs) {
-            v = Vector2Scale(Vector2Rotate(v, bee.angle()), BEE_SCALING_FACTOR);
-            v.x += envToDisplayX(bee.x());
-            v.y += envToDisplayY(bee.y());
-        }
+    if (replaying()) {
+        drawReplayBees();
+        return;
+    }
 
-        DrawTriangle(BeeShapeAbs[0], BeeShapeAbs[1], BeeShapeAbs[2], ColorFromHSV(bee.colorHue(), 0.7f, 0.9f));
-        DrawTriangleLines(BeeShapeAbs[0], BeeShapeAbs[1], BeeShapeAbs[2], BLACK);
+    // draw bees
+    const VisSnapshot& snapshot = m_snapshots.front();
+    for (const VisBeeSnapshot& bee : snapshot.bees) {
+        drawBeeShape(bee.x, bee.y, bee.angle, bee.hue);
 
         // draw bee path trail if enabled and if the bee has a path to draw
-        if (m_bShowTrails && !(bee.path().empty())) {
-            size_t pathIdxMax = bee.path().size()-1;
+        if (m_bShowTrails && bee.trailLen > 0) {
+            const pb::Pos2D* path = snapshot.trailPoints.data() + bee.trailStart;
+            size_t pathIdxMax = bee.trailLen-1;
             int drawCount = 0;
             Color trailColor;
 
             switch (m_trailColourMode) {
             case TrailColourMode::RANDOM: {
-                trailColor = ColorFromHSV(bee.colorHue(), 0.3f, 0.7f);
+                trailColor = ColorFromHSV(bee.hue, 0.3f, 0.7f);
                 break;
             }
             case TrailColourMode::ENTRANCE_USED: {
-                const TunnelEntranceInfo* pEntranceUsed = bee.entranceUsed();
-                if (pEntranceUsed == nullptr) {
-                    trailColor = ColorFromHSV(bee.colorHue(), 0.3f, 0.7f); // if bee hasn't used an entrance yet, just use its colour hue for trail
+                if (bee.entranceUsedID < 0) {
+                    trailColor = ColorFromHSV(bee.hue, 0.3f, 0.7f); // if bee hasn't used an entrance yet, just use its colour hue for trail
                 }
                 else {
-                    trailColor = entranceColorFromEntranceID(pEntranceUsed->id);
+                    trailColor = entranceColorFromEntranceID(bee.entranceUsedID);
                 }
                 break;
             }
@@ -605,16 +716,16 @@ void LocalVis::drawBees()
 
             // first draw the line segment from the bee's current position back to the most recent point in its path
             size_t i = pathIdxMax;
-            Vector2 p1 = { envToDisplayX(bee.path()[i].x), envToDisplayY(bee.path()[i].y) };
-            Vector2 p2 = { envToDisplayX(bee.x()), envToDisplayY(bee.y()) };
+            Vector2 p1 = { envToDisplayX(path[i].x), envToDisplayY(path[i].y) };
+            Vector2 p2 = { envToDisplayX(bee.x), envToDisplayY(bee.y) };
             DrawLineEx(p1, p2, BEE_PATH_THICKNESS, ColorAlpha(trailColor, 1.0f));
             ++drawCount;
 
             // and now draw line segments for the rest of the path, fading out as we go back in time, until we reach
             // the maximum number of segments to draw or the end of the path
             for (; i >= 1 && drawCount < Params::visBeePathDrawLen; --i) {
-                Vector2 p1 = { envToDisplayX(bee.path()[i-1].x), envToDisplayY(bee.path()[i-1].y) };
-                Vector2 p2 = { envToDisplayX(bee.path()[i].x), envToDisplayY(bee.path()[i].y) };
+                Vector2 p1 = { envToDisplayX(path[i-1].x), envToDisplayY(path[i-1].y) };
+                Vector2 p2 = { envToDisplayX(path[i].x), envToDisplayY(path[i].y) };
                 float alpha = 1.0f - ((pathIdxMax - static_cast<float>(i)) / Params::visBeePathDrawLen); // fade out older parts of path
                 DrawLineEx(p1, p2, BEE_PATH_THICKNESS, ColorAlpha(trailColor, alpha));
                 ++drawCount;
@@ -624,19 +735,31 @@ void LocalVis::drawBees()
 }
 
 
+void LocalVis::drawBeeShape(float x, float y, float angle, float hue)
+{
+    Vector2 beeShapeAbs[3];
+    for (std::size_t v = 0; v < 3; ++v) {
+        beeShapeAbs[v] = Vector2Scale(Vector2Rotate(BEE_SHAPE[v], angle), BEE_SCALING_FACTOR);
+        beeShapeAbs[v].x += envToDisplayX(x);
+        beeShapeAbs[v].y += envToDisplayY(y);
+    }
+
+    DrawTriangle(beeShapeAbs[0], beeShapeAbs[1], beeShapeAbs[2], ColorFromHSV(hue, 0.7f, 0.9f));
+    DrawTriangleLines(beeShapeAbs[0], beeShapeAbs[1], beeShapeAbs[2], BLACK);
+}
+
+
 void LocalVis::drawHeatmap()
 {
-    const Heatmap& heatmap = m_pPolyBeeCore->getHeatmap();
-    if (!heatmap.isNormalisedCalculated()) {
+    const VisSnapshot& snapshot = m_snapshots.front();
+    if (!snapshot.heatmapValid) {
         DrawText("Normalised heatmap not available!", 100, 100, 20, RAYWHITE);
         return;
     }
 
-    int numCellsX = heatmap.size_x();
-    int numCellsY = heatmap.size_y();
+    int numCellsX = snapshot.heatmapW;
+    int numCellsY = snapshot.heatmapH;
     int numCells = numCellsX * numCellsY;
-    int cellW = envToDisplayN(Params::envW) / numCellsX;
-    int cellH = envToDisplayN(Params::envH) / numCellsY;
 
     // Helper lambda to convert normalized value [0,1] to blue-red heatmap color
     auto getHeatmapColor = [](float normalized) -> Color {
@@ -682,37 +805,110 @@ void LocalVis::drawHeatmap()
         return Color{r, g, b, 128}; // Semi-transparent for overlay
     };
 
-    // Draw heatmap cells using normalized values
-    const auto& cellsNormalised = heatmap.cellsNormalised();
-    for (int x = 0; x < numCellsX; ++x) {
-        for (int y = 0; y < numCellsY; ++y) {
-            float normalizedValue = cellsNormalised[x][y];
-            float valueToPlot = normalizedValue * (numCells / 3.0); // scale for better visibility
-            Color color = getHeatmapColor(valueToPlot);
-
-            DrawRectangle(DISPLAY_MARGIN_LEFT + m_displayOffset.x + x * cellW,
-                DISPLAY_MARGIN_TOP + m_displayOffset.y + y * cellH, cellW, cellH, color);
+    // (re)create the texture if the heatmap size has changed
+    if (m_heatmapTexture.id == 0 || m_heatmapTexture.width != numCellsX || m_heatmapTexture.height != numCellsY) {
+        if (m_heatmapTexture.id != 0) {
+            UnloadTexture(m_heatmapTexture);
+        }
+        Image image = GenImageColor(numCellsX, numCellsY, BLANK);
+        m_heatmapTexture = LoadTextureFromImage(image);
+        UnloadImage(image);
+        SetTextureFilter(m_heatmapTexture, TEXTURE_FILTER_POINT);
+        m_heatmapPixels.resize(numCells);
+        m_heatmapTextureSerial = 0;
+    }
 
-            // Draw cell borders for better visibility
-            DrawRectangleLines(DISPLAY_MARGIN_LEFT + m_displayOffset.x + x * cellW,
-                DISPLAY_MARGIN_TOP + m_displayOffset.y + y * cellH, cellW, cellH, DARKGRAY);
+    // colour the cells using normalized values, and upload them all at once when the snapshot has changed
+    if (m_heatmapTextureSerial != snapshot.serial) {
+        for (int x = 0; x < numCellsX; ++x) {
+            for (int y = 0; y < numCellsY; ++y) {
+                float normalizedValue = snapshot.heatmapNormalised[x * numCellsY + y];
+                float valueToPlot = normalizedValue * (numCells / 3.0); // scale for better visibility
+                m_heatmapPixels[y * numCellsX + x] = getHeatmapColor(valueToPlot);
+            }
         }
+        UpdateTexture(m_heatmapTexture, m_heatmapPixels.data());
+        m_heatmapTextureSerial = snapshot.serial;
     }
 
-    if (m_bShowEMD && !m_bPaused && !m_bWaitingForUserToClose)
+    // draw the texture with one texel per cell, stretched over the environment
+    float cellSize = static_cast<float>(Params::heatmapCellSize);
+    Rectangle heatmapRect = envToDisplayRect({ 0.0f, 0.0f, numCellsX * cellSize, numCellsY * cellSize });
+    DrawTexturePro(m_heatmapTexture, { 0.0f, 0.0f, static_cast<float>(numCellsX), static_cast<float>(numCellsY) },
+        heatmapRect, { 0.0f, 0.0f }, 0.0f, WHITE);
+
+    // Draw cell borders for better visibility
+    float cellW = heatmapRect.width / numCellsX;
+    float cellH = heatmapRect.height / numCellsY;
+    for (int x = 0; x <= numCellsX; ++x) {
+        DrawLineV({ heatmapRect.x + x * cellW, heatmapRect.y },
+            { heatmapRect.x + x * cellW, heatmapRect.y + heatmapRect.height }, DARKGRAY);
+    }
+    for (int y = 0; y <= numCellsY; ++y) {
+        DrawLineV({ heatmapRect.x, heatmapRect.y + y * cellH },
+            { heatmapRect.x + heatmapRect.width, heatmapRect.y + y * cellH }, DARKGRAY);
+    }
+
+    if (m_bShowEMD) {
+        requestEMD(snapshot);
+    }
+}
+
+
+// Pass the snapshot's heatmap to the EMD worker thread, unless it is still busy or has already
+// been given this iteration's heatmap
+void LocalVis::requestEMD(const VisSnapshot& snapshot)
+{
     {
+        std::lock_guard<std::mutex> lock(m_emdMutex);
+        if (m_bEmdRequested || m_bEmdBusy || m_emdInputIteration == snapshot.iteration) {
+            return;
+        }
+
+        m_emdInput.resize(snapshot.heatmapW);
+        for (int x = 0; x < snapshot.heatmapW; ++x) {
+            auto column = snapshot.heatmapNormalised.begin() + x * snapshot.heatmapH;
+            m_emdInput[x].assign(column, column + snapshot.heatmapH);
+        }
+        m_emdInputIteration = snapshot.iteration;
+        m_bEmdRequested = true;
+    }
+    m_emdCv.notify_one();
+}
+
+
+void LocalVis::emdWorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_emdMutex);
+    while (true) {
+        m_emdCv.wait(lock, [this]() { return m_bEmdRequested || m_bStopEmdWorker; });
+        if (m_bStopEmdWorker) {
+            return;
+        }
+        m_bEmdRequested = false;
+        m_bEmdBusy = true;
+        int iteration = m_emdInputIteration;
+
+        // the render thread leaves m_emdInput alone while the worker is busy, so the lock can be released
+        lock.unlock();
         auto start = std::chrono::high_resolution_clock::now();
         const Environment& env = m_pPolyBeeCore->getEnvironment();
+        const Heatmap& heatmap = env.getHeatmap();
+        float emd;
         if (env.getRawTargetHeatmapNormalised().empty()) {
-            m_currentEMD = heatmap.emd(heatmap.uniformTargetNormalised());
+            emd = heatmap.emd(m_emdInput, heatmap.uniformTargetNormalised());
         }
         else {
-            m_currentEMD = heatmap.emd(env.getRawTargetHeatmapNormalised());
+            emd = heatmap.emd(m_emdInput, env.getRawTargetHeatmapNormalised());
         }
         auto end = std::chrono::high_resolution_clock::now();
+        lock.lock();
+
+        m_currentEMD = emd;
         m_currentEMDTime = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        m_currentEMDIteration = iteration;
+        m_bEmdBusy = false;
     }
-
 }
 
 
@@ -722,19 +918,21 @@ void LocalVis::drawHeatmap()
 // (darker = stronger alignment to the dominant axis).
 void LocalVis::drawFlowmap()
 {
-    const Flowmap& flowmap = m_pPolyBeeCore->m_env.getFlowmap();
-    const auto& cells = flowmap.cells();
+    const VisSnapshot& snapshot = m_snapshots.front();
+    if (!snapshot.flowmapValid) {
+        return; // the simulation thread hasn't captured the flowmap yet
+    }
 
-    int numCellsX = flowmap.size_x();
-    int numCellsY = flowmap.size_y();
+    int numCellsX = snapshot.flowmapW;
+    int numCellsY = snapshot.flowmapH;
     int cellW = envToDisplayN(Params::envW) / numCellsX;
     int cellH = envToDisplayN(Params::envH) / numCellsY;
 
-    int maxCount = flowmap.max_count();
+    int maxCount = snapshot.flowmapMaxCount;
 
     for (int x = 0; x < numCellsX; ++x) {
         for (int y = 0; y < numCellsY; ++y) {
-            const FlowmapCell& cell = cells[x][y];
+            const FlowmapCell& cell = snapshot.flowmapCells[x * numCellsY + y];
 
             if (cell.strength <= 0.0f || cell.count == 0) {
                 continue;
@@ -787,4 +985,156 @@ void LocalVis::drawFlowmap()
     DrawText("0.0", legendX, legendY + legendHeight + 5, 12, RAYWHITE);
     DrawText("1.0", legendX + legendWidth - 20, legendY + legendHeight + 5, 12, RAYWHITE);
     */
-}
\ No newline at end of file
+}
+
+
+//////////////////////////////////////////////////////////////
+// Replay mode
+//
+// The static parts of the scene (environment, tunnels, patches, barriers and hives) are drawn from the
+// current environment as usual. Bees and plants are drawn from the current frame of the trajectory,
+// and bee trails from the bees' positions in the preceding frames. Heatmap, flowmap, EMD and SVF
+// displays are not available.
+
+void LocalVis::replay(const TrajectoryReader& reader)
+{
+    m_pReplay = &reader;
+    m_replayFramePos = 0.0;
+    m_replaySpeed = 1.0;
+    m_replayCountsFrame = SIZE_MAX;
+    m_drawState = DrawState::BEES;
+    m_bShowFlowmap = false;
+
+    while (!WindowShouldClose()) // Detect window close button or ESC key
+    {
+        updateDrawFrame();
+    }
+
+    m_pReplay = nullptr;
+}
+
+
+void LocalVis::advanceReplay()
+{
+    if (m_bPaused) {
+        return;
+    }
+
+    const double lastFrame = static_cast<double>(m_pReplay->numFrames() - 1);
+    m_replayFramePos = std::clamp(m_replayFramePos + m_replaySpeed, 0.0, lastFrame);
+}
+
+
+void LocalVis::drawReplayBees()
+{
+    const std::size_t frame = replayFrame();
+    const std::size_t numBees = m_pReplay->numBees();
+    const TrajectoryBeeRecord* pBees = m_pReplay->beeRecords(frame);
+
+    // trails are drawn back over the frames covering the last vis-bee-path-draw-len iterations
+    const std::size_t trailFrames = m_bShowTrails ?
+        std::min(frame, static_cast<std::size_t>(Params::visBeePathDrawLen) / m_pReplay->header().frameInterval) : 0;
+
+    for (std::size_t b = 0; b < numBees; ++b) {
+        // (the entrance each bee used isn't recorded, so trails are always coloured by the bee's own hue)
+        Color trailColor = ColorFromHSV(m_pReplay->beeHue(b), 0.3f, 0.7f);
+        for (std::size_t t = 0; t < trailFrames; ++t) {
+            const TrajectoryBeeRecord& p1 = m_pReplay->beeRecords(frame - t - 1)[b];
+            const TrajectoryBeeRecord& p2 = m_pReplay->beeRecords(frame - t)[b];
+            float alpha = 1.0f - (static_cast<float>(t) / static_cast<float>(trailFrames)); // fade out older parts of path
+            DrawLineEx({ envToDisplayX(p1.x), envToDisplayY(p1.y) }, { envToDisplayX(p2.x), envToDisplayY(p2.y) },
+                BEE_PATH_THICKNESS, ColorAlpha(trailColor, alpha));
+        }
+    }
+
+    for (std::size_t b = 0; b < numBees; ++b) {
+        drawBeeShape(pBees[b].x, pBees[b].y, pBees[b].angle, m_pReplay->beeHue(b));
+    }
+}
+
+
+void LocalVis::drawReplayPlants()
+{
+    const std::size_t frame = replayFrame();
+    if (frame != m_replayCountsFrame) {
+        m_pReplay->visitCountsAt(frame, m_replayVisitCounts);
+        m_replayCountsFrame = frame;
+    }
+
+    float displaySize = envToDisplayN(HALF_PLANT_SIZE);
+    for (std::size_t p = 0; p < m_pReplay->numPlants(); ++p) {
+        int colorIdx = static_cast<int>(std::min<std::uint32_t>(m_replayVisitCounts[p], 7));
+        DrawCircleV({ envToDisplayX(m_pReplay->plantX(p)), envToDisplayY(m_pReplay->plantY(p)) }, displaySize, PLANT_COLORS[colorIdx]);
+    }
+}
+
+
+void LocalVis::drawReplayStatusText()
+{
+    const std::size_t frame = replayFrame();
+    std::string msg = std::format("Replaying {}\nIteration {} (frame {} of {}), speed {:g} frames per display frame",
+        m_pReplay->filename(), m_pReplay->iteration(frame), frame + 1, m_pReplay->numFrames(), m_replaySpeed);
+    DrawText(msg.c_str(), 10, 10, FONT_SIZE_REG, RAYWHITE);
+
+    if (m_bPaused) {
+        DrawText("PAUSED", 10, 50, FONT_SIZE_LARGE, RAYWHITE);
+    }
+
+    // scrubber bar showing the position in the trajectory
+    int barX = REPLAY_SCRUBBER_MARGIN;
+    int barY = GetScreenHeight() - REPLAY_SCRUBBER_MARGIN - REPLAY_SCRUBBER_HEIGHT;
+    int barW = GetScreenWidth() - 2 * REPLAY_SCRUBBER_MARGIN;
+    float fraction = (m_pReplay->numFrames() > 1) ?
+        static_cast<float>(frame) / static_cast<float>(m_pReplay->numFrames() - 1) : 1.0f;
+    DrawRectangle(barX, barY, barW, REPLAY_SCRUBBER_HEIGHT, DARKGRAY);
+    DrawRectangle(barX, barY, static_cast<int>(barW * fraction), REPLAY_SCRUBBER_HEIGHT, RAYWHITE);
+}
+
+
+void LocalVis::processReplayInput()
+{
+    const double lastFrame = static_cast<double>(m_pReplay->numFrames() - 1);
+
+    if (IsKeyPressed(KEY_P) || IsKeyPressed(KEY_SPACE)) {
+        m_bPaused = !m_bPaused;
+    }
+
+    if (IsKeyPressed(KEY_PERIOD)) {
+        m_replayFramePos = std::min(std::floor(m_replayFramePos) + 1.0, lastFrame);
+    }
+
+    if (IsKeyPressed(KEY_COMMA)) {
+        m_replayFramePos = std::max(std::floor(m_replayFramePos) - 1.0, 0.0);
+    }
+
+    if (IsKeyPressed(KEY_HOME)) {
+        m_replayFramePos = 0.0;
+    }
+
+    if (IsKeyPressed(KEY_END)) {
+        m_replayFramePos = lastFrame;
+    }
+
+    if (IsKeyPressed(KEY_BACKSPACE)) {
+        m_replaySpeed = -m_replaySpeed;
+    }
+
+    if (IsKeyPressed(KEY_EQUAL) || IsKeyPressed(KEY_KP_ADD)) {
+        m_replaySpeed = std::copysign(std::min(std::abs(m_replaySpeed) * 2.0, MAX_REPLAY_SPEED), m_replaySpeed);
+    }
+
+    if (IsKeyPressed(KEY_MINUS) || IsKeyPressed(KEY_KP_SUBTRACT)) {
+        m_replaySpeed = std::copysign(std::max(std::abs(m_replaySpeed) / 2.0, MIN_REPLAY_SPEED), m_replaySpeed);
+    }
+
+    // seek by clicking or dragging on the scrubber bar
+    if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
+        Vector2 mouse = GetMousePosition();
+        int barY = GetScreenHeight() - REPLAY_SCRUBBER_MARGIN - REPLAY_SCRUBBER_HEIGHT;
+        int barW = GetScreenWidth() - 2 * REPLAY_SCRUBBER_MARGIN;
+        if (mouse.y >= barY - REPLAY_SCRUBBER_MARGIN && barW > 0) {
+            float fraction = std::clamp((mouse.x - REPLAY_SCRUBBER_MARGIN) / static_cast<float>(barW), 0.0f, 1.0f);
+            m_replayFramePos = std::round(fraction * lastFrame);
+        }
+    }
+}
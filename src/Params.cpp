@@ -8,6 +8,7 @@
 #include <vector>
 #include <string>
 #include <regex>
+#include <algorithm>
 #include <filesystem>
 #include <boost/program_options.hpp>
 
@@ -19,6 +20,10 @@ namespace po = boost::program_options;
 // Simulation control
 std::string Params::strRngSeed;
 int Params::numIterations;
+int Params::numReplicates;
+int Params::replicateThreads;
+bool Params::replicateOutputFiles;
+std::string Params::threadAffinity;
 
 // Environment configuration
 float Params::envW;
@@ -30,6 +35,7 @@ float Params::tunnelH;
 float Params::tunnelX;
 float Params::tunnelY;
 std::vector<EntranceSpec> Params::entranceSpecs;
+std::vector<TunnelSpec> Params::extraTunnelSpecs;
 
 // Tunnel exit net properties
 float Params::netAntibirdExitProb;
@@ -48,6 +54,12 @@ float Params::plantDefaultJitter;
 
 // Flower configuration
 float Params::flowerInitialNectar;
+float Params::flowerNectarRegenRate;
+float Params::flowerNectarCap;
+std::string Params::flowerNectarRegenCurvePvt;
+std::string Params::flowerNectarRegenSpeciesPvt;
+NectarRegenSpec Params::flowerNectarRegen;
+std::vector<NectarRegenSpec> Params::flowerNectarRegenSpecies;
 int Params::minVisitCountSuccess;
 int Params::maxVisitCountSuccess;
 
@@ -67,6 +79,8 @@ float Params::beeEnergyBoostPerFlower;
 int Params::beeOnFlowerDuration;
 float Params::beeEnergyMinThreshold;
 float Params::beeEnergyMaxThreshold;
+bool Params::beeAvoidOccupiedFlowers;
+float Params::beeOccupiedFlowerRadius;
 
 // Hive configuration
 std::vector<HiveSpec> Params::hiveSpecs;
@@ -75,17 +89,36 @@ std::vector<HiveSpec> Params::hiveSpecs;
 bool Params::bEvolve;
 EvolveObjective Params::evolveObjective;
 int Params::evolveObjectivePvt;
+std::vector<EvolveObjective> Params::evolveObjectives;
+std::string Params::evolveObjectivesPvt;
+std::string Params::evolveMoAlgorithm;
+EmdBackend Params::evolveEmdApprox;
+std::string Params::evolveEmdApproxPvt;
+int Params::evolveEmdExactGen;
+float Params::emdSinkhornEpsilon;
+int Params::emdSinkhornMaxIterations;
+float Params::emdMultiscaleTolerance;
 EvolveSpec Params::evolveSpec;
 std::string Params::evolveSpecPvt;
 std::string Params::strTargetHeatmapFilename;
 int Params::numConfigsPerGen;
 int Params::numTrialsPerConfig;
+std::vector<FidelityStage> Params::fidelitySchedule;
+std::string Params::fidelitySchedulePvt;
+bool Params::surrogate;
+float Params::surrogateSimulateFraction;
+float Params::surrogateKappa;
+int Params::surrogateMaxArchive;
+bool Params::commonRandomNumbers;
 int Params::numGenerations;
 int Params::numIslands;
 int Params::migrationPeriod;
 int Params::migrationNumReplace;
 int Params::migrationNumSelect;
 bool Params::useDiverseAlgorithms;
+bool Params::asyncIslands;
+int Params::islandProcs;
+std::string Params::islandTransport;
 bool Params::bridgeOverlapsAllowed;
 
 // Logging and output
@@ -95,6 +128,10 @@ int Params::flowmapUpdatePeriod;
 std::string Params::logDir;
 std::string Params::logFilenamePrefix;
 bool Params::logging;
+bool Params::recordBeeCrossings;
+bool Params::recordTrajectory;
+int Params::trajectoryFrameInterval;
+std::string Params::startupCacheDir;
 bool Params::bCommandLineQuiet;
 
 // Visualisation
@@ -102,6 +139,7 @@ bool Params::bVis;
 float Params::visCellSize;
 int Params::visDelayPerStep;
 int Params::visBeePathDrawLen;
+std::string Params::replayFilename;
 
 // Options that can be specified on command line but are not in a config file
 std::string Params::strConfigFilename = "polybee.cfg";
@@ -182,6 +220,10 @@ void Params::initRegistry()
     REGISTRY.emplace_back("plant-default-spacing", "plantDefaultSpacing", ParamType::FLOAT, &plantDefaultSpacing, 10.0f, "Default plant spacing for bridge patches when evolving bridge positions");
     REGISTRY.emplace_back("plant-default-jitter", "plantDefaultJitter", ParamType::FLOAT, &plantDefaultJitter, 0.1f, "Default plant jitter (std dev) for bridge patches when evolving bridge positions");
     REGISTRY.emplace_back("flower-initial-nectar", "flowerInitialNectar", ParamType::FLOAT, &flowerInitialNectar, 100.0f, "Initial nectar amount for each flower");
+    REGISTRY.emplace_back("flower-nectar-regen-rate", "flowerNectarRegenRate", ParamType::FLOAT, &flowerNectarRegenRate, 0.0f, "Rate at which flowers regenerate nectar: amount per step for the linear curve, or fraction of the shortfall below the cap per step for the saturating curve (0 = no regeneration)");
+    REGISTRY.emplace_back("flower-nectar-cap", "flowerNectarCap", ParamType::FLOAT, &flowerNectarCap, 0.0f, "Nectar amount at which regeneration stops (0 = flower-initial-nectar)");
+    REGISTRY.emplace_back("flower-nectar-regen-curve", "flowerNectarRegenCurve", ParamType::STRING, &flowerNectarRegenCurvePvt, "linear", "How flowers regenerate nectar: linear (a fixed amount per step) or saturating (a fixed fraction of the shortfall below the cap per step)");
+    REGISTRY.emplace_back("flower-nectar-regen-species", "flowerNectarRegenSpecies", ParamType::STRING, &flowerNectarRegenSpeciesPvt, "", "Nectar regeneration for particular species, overriding the flower-nectar-regen-* and flower-nectar-cap parameters (format: s:c,r,m[;s:c,r,m...] where s=species id, c=curve (linear or saturating), r=rate, m=cap (0 = flower-initial-nectar))");
     REGISTRY.emplace_back("num-bees", "numBees", ParamType::INT, &numBees, 50, "Number of bees in the simulation");
     REGISTRY.emplace_back("bee-max-dir-delta", "beeMaxDirDelta", ParamType::FLOAT, &beeMaxDirDelta, 0.4f, "Maximum change in direction (radians) per step");
     REGISTRY.emplace_back("bee-step-length", "beeStepLength", ParamType::FLOAT, &beeStepLength, 20.0f, "How far a bee moves forward at each time step");
@@ -197,19 +239,41 @@ void Params::initRegistry()
     REGISTRY.emplace_back("bee-on-flower-duration", "beeOnFlowerDuration", ParamType::INT, &beeOnFlowerDuration, 5, "Number of simulation steps a bee will stay on a flower having landed on it");
     REGISTRY.emplace_back("bee-energy-min-threshold", "beeEnergyMinThreshold", ParamType::FLOAT, &beeEnergyMinThreshold, 0.0f, "Lower threshold of bee's energy store below which it will return to hive to replenish");
     REGISTRY.emplace_back("bee-energy-max-threshold", "beeEnergyMaxThreshold", ParamType::FLOAT, &beeEnergyMaxThreshold, 100.0f, "Upper threshold of bee's energy store above which it will return to hive after successful foraging");
+    REGISTRY.emplace_back("bee-avoid-occupied-flowers", "beeAvoidOccupiedFlowers", ParamType::BOOL, &beeAvoidOccupiedFlowers, false, "Bees do not choose a flower that another bee is already on");
+    REGISTRY.emplace_back("bee-occupied-flower-radius", "beeOccupiedFlowerRadius", ParamType::FLOAT, &beeOccupiedFlowerRadius, 1.0f, "Distance from a flower within which a bee on a flower makes it occupied (used if bee-avoid-occupied-flowers is true)");
     REGISTRY.emplace_back("num-iterations", "numIterations", ParamType::INT, &numIterations, 100, "Number of iterations to run the simulation");
+    REGISTRY.emplace_back("replicates", "numReplicates", ParamType::INT, &numReplicates, 1, "Number of replicate runs of a normal simulation to perform in this process, each with its own seed derived from rng-seed (not used when evolving)");
+    REGISTRY.emplace_back("replicate-threads", "replicateThreads", ParamType::INT, &replicateThreads, 0, "Number of threads to run replicates across (0 = one per hardware thread)");
+    REGISTRY.emplace_back("replicate-output-files", "replicateOutputFiles", ParamType::BOOL, &replicateOutputFiles, false, "Write each replicate's own heatmap, flowmap and run info files as well as the replicates results and aggregate files");
+    REGISTRY.emplace_back("thread-affinity", "threadAffinity", ParamType::STRING, &threadAffinity, "none", "How to pin island and replicate threads to CPUs (Linux only): none, compact (fill one NUMA node before the next), scatter (spread consecutive threads over the NUMA nodes), or an explicit list of CPU sets such as 0-3;8-11 (thread k uses set k modulo the number of sets)");
     REGISTRY.emplace_back("evolve", "bEvolve", ParamType::BOOL, &bEvolve, false, "Run optimization to match output heatmap against target heatmap");
-    REGISTRY.emplace_back("evolve-objective", "evolveObjective", ParamType::INT, &evolveObjectivePvt, 0, "Optimization objective: 0=EMD to target heatmap, 1=Fraction of flowers in successful visit range");
+    REGISTRY.emplace_back("evolve-objective", "evolveObjective", ParamType::INT, &evolveObjectivePvt, 0, "Optimization objective: 0=EMD to target heatmap, 1=Fraction of flowers in successful visit range, 2=Tunnel entrance crossing success rate, 3=Variance of flower visit counts");
+    REGISTRY.emplace_back("evolve-objectives", "evolveObjectives", ParamType::STRING, &evolveObjectivesPvt, "", "Comma-separated list of two or more objectives (numbered as for evolve-objective) to optimise together, computing all of them from each simulated episode and evolving a Pareto front (empty = single objective given by evolve-objective)");
+    REGISTRY.emplace_back("evolve-emd-approx", "evolveEmdApprox", ParamType::STRING, &evolveEmdApproxPvt, "none", "Cheaper approximation to the EMD objective used before generation evolve-emd-exact-gen: none, sinkhorn (entropy-regularised transport, an upper bound), sliced (distance between row and column marginals, a lower bound) or multiscale (exact EMD on a coarsened heatmap)");
+    REGISTRY.emplace_back("evolve-emd-exact-gen", "evolveEmdExactGen", ParamType::INT, &evolveEmdExactGen, 0, "Generation from which the EMD objective is computed exactly, when evolve-emd-approx is not none (the populations are re-evaluated with the exact EMD at that generation; 0 = use the approximation throughout)");
+    REGISTRY.emplace_back("emd-sinkhorn-epsilon", "emdSinkhornEpsilon", ParamType::FLOAT, &emdSinkhornEpsilon, 0.5f, "Entropic regularisation of the sinkhorn EMD approximation, in heatmap cells (smaller is more accurate but needs more iterations)");
+    REGISTRY.emplace_back("emd-sinkhorn-max-iterations", "emdSinkhornMaxIterations", ParamType::INT, &emdSinkhornMaxIterations, 500, "Maximum number of iterations of the sinkhorn EMD approximation");
+    REGISTRY.emplace_back("emd-multiscale-tolerance", "emdMultiscaleTolerance", ParamType::FLOAT, &emdMultiscaleTolerance, 0.2f, "Largest error bound accepted by the multiscale EMD approximation, as a fraction of the EMD (finer grids are tried until the bound is met)");
+    REGISTRY.emplace_back("evolve-mo-algorithm", "evolveMoAlgorithm", ParamType::STRING, &evolveMoAlgorithm, "nsga2", "Pareto optimiser used when evolve-objectives lists more than one objective: nsga2 or moead");
     REGISTRY.emplace_back("evolve-spec", "evolveSpec", ParamType::STRING, &evolveSpecPvt, "", "Specification for what to evolve (format: [E:n,w][;][H:i,o,f][;][B:n,w][;][X:n,w] where [E:n=num entrances, w=entrance width], [H:i=num hives inside tunnel, o=num hives outside tunnel, f=num hives free to be inside or outside], [B:n=num bridges, w=bridge width], [X:n=num barriers, w=barrier width])");
     REGISTRY.emplace_back("min-visit-count-success", "minVisitCountSuccess", ParamType::INT, &minVisitCountSuccess, 1, "Minimum number of bee visits for successful pollination");
     REGISTRY.emplace_back("max-visit-count-success", "maxVisitCountSuccess", ParamType::INT, &maxVisitCountSuccess, 1000, "Maximum number of bee visits for successful pollination");
     REGISTRY.emplace_back("num-trials-per-config", "numTrialsPerConfig", ParamType::INT, &numTrialsPerConfig, 1, "Number of trials to run for each configuration/individual in each generation");
+    REGISTRY.emplace_back("fidelity-schedule", "fidelitySchedule", ParamType::STRING, &fidelitySchedulePvt, "", "Multi-fidelity screening stages run before full-fidelity evaluation of each candidate (format: i,b,c:p[;i,b,c:p...] where i=fraction of num-iterations, b=fraction of num-bees, c=heatmap coarsening factor, p=fraction of candidates promoted to the next stage; empty = evaluate every candidate at full fidelity)");
+    REGISTRY.emplace_back("surrogate", "surrogate", ParamType::BOOL, &surrogate, false, "Pre-screen candidates with a Gaussian process model of fitness trained on the candidates simulated so far, and only simulate those predicted to be promising or too uncertain to rule out");
+    REGISTRY.emplace_back("surrogate-simulate-fraction", "surrogateSimulateFraction", ParamType::FLOAT, &surrogateSimulateFraction, 0.3f, "In surrogate mode, a candidate is simulated if its lower confidence bound is at least as good as this quantile of the fitnesses simulated so far");
+    REGISTRY.emplace_back("surrogate-kappa", "surrogateKappa", ParamType::FLOAT, &surrogateKappa, 1.0f, "In surrogate mode, number of predicted standard deviations subtracted from a candidate's predicted fitness to give its lower confidence bound");
+    REGISTRY.emplace_back("surrogate-max-archive", "surrogateMaxArchive", ParamType::INT, &surrogateMaxArchive, 400, "In surrogate mode, maximum number of simulated candidates (the most recent) used to fit the model");
+    REGISTRY.emplace_back("common-random-numbers", "commonRandomNumbers", ParamType::BOOL, &commonRandomNumbers, false, "Reseed trial k of every configuration in a generation from the same (generation, k) seed, so that competing configurations are compared under common random numbers");
     REGISTRY.emplace_back("num-configs-per-gen", "numConfigsPerGen", ParamType::INT, &numConfigsPerGen, 50, "Number of configurations/inidividuals to test during each generation (if using multiple islands, this is the number per island)");
     REGISTRY.emplace_back("num-generations", "numGenerations", ParamType::INT, &numGenerations, 50, "Number of generations to run the optimization process");
     REGISTRY.emplace_back("num-islands", "numIslands", ParamType::INT, &numIslands, 1, "Number of islands of evolving populations (when num-islands=1, there is just a single population with no migration)");
     REGISTRY.emplace_back("migration-period", "migrationPeriod", ParamType::INT, &migrationPeriod, 10, "Period (number of generations) between each migration event when using multiple islands");
     REGISTRY.emplace_back("migration-num-replace", "migrationNumReplace", ParamType::INT, &migrationNumReplace, 1, "Number of individuals on an Island that can be replaced by migrants at each migration event");
     REGISTRY.emplace_back("use-diverse-algorithms", "useDiverseAlgorithms", ParamType::BOOL, &useDiverseAlgorithms, false, "Use diverse optimisation algorithms on each island (when num-islands > 1)");
+    REGISTRY.emplace_back("island-procs", "islandProcs", ParamType::INT, &islandProcs, 0, "Number of worker processes to distribute the islands across, with migration between them coordinated by this process (0 = run all islands as threads in this process)");
+    REGISTRY.emplace_back("island-transport", "islandTransport", ParamType::STRING, &islandTransport, "unix", "Transport used between island worker processes when island-procs > 0: unix (Unix domain sockets to forked workers) or mpi (requires an MPI-enabled build)");
+    REGISTRY.emplace_back("async-islands", "asyncIslands", ParamType::BOOL, &asyncIslands, false, "Let each island evolve at its own pace without waiting for the others, migrating via a shared pool at its own generation milestones (when num-islands > 1)");
     REGISTRY.emplace_back("bridge-overlaps-allowed", "bridgeOverlapsAllowed", ParamType::BOOL, &bridgeOverlapsAllowed, false, "If false, attempt to resolve bridge/patch overlaps by shifting the bridge; if no valid position is found the bridge is removed");
     REGISTRY.emplace_back("migration-num-select", "migrationNumSelect", ParamType::INT, &migrationNumSelect, 1, "Number of individuals on an Island that can be selected for migration at each migration event");
     REGISTRY.emplace_back("target-heatmap-filename", "strTargetHeatmapFilename", ParamType::STRING, &strTargetHeatmapFilename, "", "CSV file containing target heatmap for optimization");
@@ -220,7 +284,12 @@ void Params::initRegistry()
     REGISTRY.emplace_back("vis-cell-size", "visCellSize", ParamType::FLOAT, &visCellSize, 1.0f, "Size of an individual cell for visualisation");
     REGISTRY.emplace_back("vis-delay-per-step", "visDelayPerStep", ParamType::INT, &visDelayPerStep, 100, "Delay (in milliseconds) per step when visualising");
     REGISTRY.emplace_back("vis-bee-path-draw-len", "visBeePathDrawLen", ParamType::INT, &visBeePathDrawLen, 250, "Maximum number of path segments to draw for each bee");
+    REGISTRY.emplace_back("replay", "replayFilename", ParamType::STRING, &replayFilename, "", "Trajectory file (written by record-trajectory) to replay in the visualiser instead of running a simulation; use it with the config file written by the recorded run");
     REGISTRY.emplace_back("logging", "logging", ParamType::BOOL, &logging, true, "Determines whether output files are written at the end of a run");
+    REGISTRY.emplace_back("record-bee-crossings", "recordBeeCrossings", ParamType::BOOL, &recordBeeCrossings, false, "Keep a per-bee record of every tunnel entrance crossing attempt (for debugging only; crossing stats are accumulated per entrance regardless)");
+    REGISTRY.emplace_back("record-trajectory", "recordTrajectory", ParamType::BOOL, &recordTrajectory, false, "Write a binary trajectory file of the run (bee positions and states, and plant visit counts) to the log directory, for later replay in the visualiser with the replay option (not used when evolving)");
+    REGISTRY.emplace_back("trajectory-frame-interval", "trajectoryFrameInterval", ParamType::INT, &trajectoryFrameInterval, 1, "Record a trajectory frame every N iterations when record-trajectory is true");
+    REGISTRY.emplace_back("startup-cache-dir", "startupCacheDir", ParamType::STRING, &startupCacheDir, "", "Directory in which to cache the target heatmap and other set-up results that depend only on the heatmap dimensions and target heatmap file, so later runs with the same set-up start faster (empty = only cache them within this process)");
     REGISTRY.emplace_back("log-dir", "logDir", ParamType::STRING, &logDir, ".", "Directory for output files");
     REGISTRY.emplace_back("log-filename-prefix", "logFilenamePrefix", ParamType::STRING, &logFilenamePrefix, "polybee", "Prefix for output file names");
     REGISTRY.emplace_back("rng-seed", "strRngSeed", ParamType::STRING, &strRngSeed, "", "Seed (an alphanumeric string) for random number generator (0=random seed)");
@@ -244,19 +313,25 @@ std::vector<HiveSpec> parse_hive_positions(const std::vector<std::string>& hive_
     return hives;
 }
 
-// Helper function to parse tunnel entrance positions from strings of the form "e1,e2:s[:t]"
-// (e1 and e2 are floats, s is side int 0-3, t is optional net type int 0=NONE, 1=ANTIBIRD, 2=ANTIHAIL)
+// Helper function to parse tunnel entrance positions from strings of the form "e1,e2:s[:t[:k]]"
+// (e1 and e2 are floats, s is side int 0-3, t is optional net type int 0=NONE, 1=ANTIBIRD, 2=ANTIHAIL,
+// k is optional tunnel number int, 0=main tunnel, n=nth extra tunnel)
 std::vector<EntranceSpec> parse_tunnel_entrance_positions(const std::vector<std::string>& tunnel_strings) {
     std::vector<EntranceSpec> entrances;
     std::string regex_str_p1 = R"((\d+|\d+\.\d+),(\d+|\d+\.\d+):([0-3]))";  // e1,e2:s
     std::string regex_str_p2 = R"(:([0-2]))";                               // :t (net type)
+    std::string regex_str_p3 = R"(:(\d+))";                                 // :k (tunnel number)
 
     std::regex pos_regex_basic(regex_str_p1);
     std::regex pos_regex_with_net(regex_str_p1 + regex_str_p2);
+    std::regex pos_regex_with_tunnel(regex_str_p1 + regex_str_p2 + regex_str_p3);
 
     for (const auto& tunnel_str : tunnel_strings) {
         std::smatch match;
-        if (std::regex_match(tunnel_str, match, pos_regex_with_net)) {
+        if (std::regex_match(tunnel_str, match, pos_regex_with_tunnel)) {
+            NetType netType = static_cast<NetType>(std::stoi(match[4]));
+            entrances.emplace_back(std::stof(match[1]), std::stof(match[2]), std::stoi(match[3]), netType, std::stoi(match[5]));
+        } else if (std::regex_match(tunnel_str, match, pos_regex_with_net)) {
             NetType netType = static_cast<NetType>(std::stoi(match[4]));
             entrances.emplace_back(std::stof(match[1]), std::stof(match[2]), std::stoi(match[3]), netType);
         } else if (std::regex_match(tunnel_str, match, pos_regex_basic)) {
@@ -268,6 +343,23 @@ std::vector<EntranceSpec> parse_tunnel_entrance_positions(const std::vector<std:
     return entrances;
 }
 
+// Helper function to parse extra tunnel specifications from strings of the form "x,y,w,h"
+// (all floats)
+std::vector<TunnelSpec> parse_tunnel_specs(const std::vector<std::string>& tunnel_strings) {
+    std::vector<TunnelSpec> tunnels;
+    std::regex tunnel_regex(R"((\d+|\d+\.\d+),(\d+|\d+\.\d+),(\d+|\d+\.\d+),(\d+|\d+\.\d+))"); // x,y,w,h
+
+    for (const auto& tunnel_str : tunnel_strings) {
+        std::smatch match;
+        if (std::regex_match(tunnel_str, match, tunnel_regex)) {
+            tunnels.emplace_back(std::stof(match[1]), std::stof(match[2]), std::stof(match[3]), std::stof(match[4]));
+        } else {
+            throw std::invalid_argument("Invalid extra tunnel specification: " + tunnel_str);
+        }
+    }
+    return tunnels;
+}
+
 // Helper function to parse barrier specifications from strings of the form "x1,y1:x2,y2[:nrx,dx[:nry,dy]]"
 // (x1,y1,x2,y2,dx,dy are floats, nrx, nry are ints)
 std::vector<BarrierSpec> parse_barrier_positions(const std::vector<std::string>& barrier_strings) {
@@ -396,6 +488,108 @@ EvolveSpec parse_evolve_spec(const std::string& evolve_spec_str) {
 }
 
 
+// Helper function to parse a fidelity schedule from a string of the form "i,b,c:p[;i,b,c:p...]"
+// (i, b and p are floats, c is an int)
+std::vector<FidelityStage> parse_fidelity_schedule(const std::string& schedule_str) {
+    std::vector<FidelityStage> stages;
+    std::regex stage_regex(R"((\d*\.?\d+),(\d*\.?\d+),(\d+):(\d*\.?\d+))");
+
+    std::stringstream ss(schedule_str);
+    std::string stage_str;
+    while (std::getline(ss, stage_str, ';')) {
+        if (stage_str.empty()) {
+            continue;
+        }
+        std::smatch match;
+        if (std::regex_match(stage_str, match, stage_regex)) {
+            stages.emplace_back(std::stof(match[1]), std::stof(match[2]), std::stoi(match[3]), std::stof(match[4]));
+        } else {
+            pb::msg_error_and_exit(std::format("Error in parameters: fidelity-schedule stage '{}' is invalid. Each stage should be in the format i,b,c:p, e.g., 0.25,0.5,2:0.3", stage_str));
+        }
+    }
+    return stages;
+}
+
+
+// Helper function to parse a list of evolve objectives from a string of the form "o,o[,o...]" (each o is an int)
+std::vector<EvolveObjective> parse_evolve_objectives(const std::string& objectives_str) {
+    std::vector<EvolveObjective> objectives;
+    std::regex objective_regex(R"(\s*(\d+)\s*)");
+
+    std::stringstream ss(objectives_str);
+    std::string objective_str;
+    while (std::getline(ss, objective_str, ',')) {
+        std::smatch match;
+        if (!std::regex_match(objective_str, match, objective_regex) || std::stoi(match[1]) > 3) {
+            pb::msg_error_and_exit(std::format("Error in parameters: evolve-objectives entry '{}' is invalid. Each entry should be an objective number from 0 to 3", objective_str));
+        }
+        EvolveObjective objective = static_cast<EvolveObjective>(std::stoi(match[1]));
+        if (std::find(objectives.begin(), objectives.end(), objective) != objectives.end()) {
+            pb::msg_error_and_exit(std::format("Error in parameters: evolve-objectives lists objective {} more than once", std::stoi(match[1])));
+        }
+        objectives.push_back(objective);
+    }
+    return objectives;
+}
+
+
+// Helper function to parse an EMD approximation name ("none", "sinkhorn", "sliced" or "multiscale")
+EmdBackend parse_emd_approx(const std::string& approx_str) {
+    if (approx_str == "none") {
+        return EmdBackend::EXACT;
+    }
+    if (approx_str == "sinkhorn") {
+        return EmdBackend::SINKHORN;
+    }
+    if (approx_str == "sliced") {
+        return EmdBackend::SLICED;
+    }
+    if (approx_str == "multiscale") {
+        return EmdBackend::MULTISCALE;
+    }
+    pb::msg_error_and_exit(std::format("Error in parameters: EMD approximation '{}' is invalid. It should be none, sinkhorn, sliced or multiscale", approx_str));
+    return EmdBackend::EXACT;
+}
+
+
+// Helper function to parse a nectar regeneration curve name ("linear" or "saturating")
+NectarRegenCurve parse_nectar_regen_curve(const std::string& curve_str) {
+    if (curve_str == "linear") {
+        return NectarRegenCurve::LINEAR;
+    }
+    if (curve_str == "saturating") {
+        return NectarRegenCurve::SATURATING;
+    }
+    pb::msg_error_and_exit(std::format("Error in parameters: nectar regeneration curve '{}' is invalid. It should be linear or saturating", curve_str));
+    return NectarRegenCurve::LINEAR;
+}
+
+
+// Helper function to parse per-species nectar regeneration from a string of the form "s:c,r,m[;s:c,r,m...]"
+// (s is an int, c is a curve name, r and m are floats; a cap of 0 means the initial nectar amount)
+std::vector<NectarRegenSpec> parse_nectar_regen_species(const std::string& species_str, float initialNectar) {
+    std::vector<NectarRegenSpec> specs;
+    std::regex spec_regex(R"((\d+):(\w+),(\d*\.?\d+),(\d*\.?\d+))");
+
+    std::stringstream ss(species_str);
+    std::string spec_str;
+    while (std::getline(ss, spec_str, ';')) {
+        if (spec_str.empty()) {
+            continue;
+        }
+        std::smatch match;
+        if (std::regex_match(spec_str, match, spec_regex)) {
+            float cap = std::stof(match[4]);
+            specs.emplace_back(std::stoi(match[1]), parse_nectar_regen_curve(match[2]), std::stof(match[3]),
+                (cap > 0.0f) ? cap : initialNectar);
+        } else {
+            pb::msg_error_and_exit(std::format("Error in parameters: flower-nectar-regen-species entry '{}' is invalid. Each entry should be in the format s:c,r,m, e.g., 2:saturating,0.01,50", spec_str));
+        }
+    }
+    return specs;
+}
+
+
 // Initialise all parameters using configuartion file and command line specs if given, otherwise
 // using default values
 void Params::initialise(int argc, char* argv[])
@@ -459,7 +653,15 @@ void Params::initialise(int argc, char* argv[])
         // Special case for tunnel entrance positions (multiple allowed)
         config.add_options()
             ("tunnel-entrance", po::value<std::vector<std::string>>()->multitoken(),
-             "Tunnel entrance specification in format e1,e2:s[:t] where e1 and e2 are positions of edges of entrance along the specified side of tunnel (position being the distance measured from one end of that side), and s is the side (0=North, 1=East, 2=South, 3=West), e.g., --tunnel-entrance 5.5,10.0:0 --tunnel-entrance 3.0,6.0:2. The optional t specifies the net type (0=NONE, 1=ANTIBIRD, 2=ANTIHAIL), e.g., --tunnel-entrance 5.5,10.0:0:1. Default value if not specified is 0 (NONE)");
+             "Tunnel entrance specification in format e1,e2:s[:t] where e1 and e2 are positions of edges of entrance along the specified side of tunnel (position being the distance measured from one end of that side), and s is the side (0=North, 1=East, 2=South, 3=West), e.g., --tunnel-entrance 5.5,10.0:0 --tunnel-entrance 3.0,6.0:2. The optional t specifies the net type (0=NONE, 1=ANTIBIRD, 2=ANTIHAIL), e.g., --tunnel-entrance 5.5,10.0:0:1. Default value if not specified is 0 (NONE). "
+             "If a net type is given it may be followed by k, the tunnel the entrance belongs to (0=the main tunnel, n=the nth extra-tunnel; default 0), e.g., --tunnel-entrance 5.5,10.0:0:1:2");
+
+        // Special case for extra tunnels (multiple allowed)
+        config.add_options()
+            ("extra-tunnel", po::value<std::vector<std::string>>()->multitoken(),
+             "Extra tunnel specification in format x,y,w,h where x,y is the top-left corner of the tunnel (in environment coordinates) and w,h are its width and height. "
+             "The main tunnel is defined by tunnel-x, tunnel-y, tunnel-width and tunnel-height; extra tunnels are numbered from 1 in the order they are given, "
+             "e.g., --extra-tunnel 600,100,450,600");
 
         // Special case for barrier positions (multiple allowed)
         config.add_options()
@@ -534,6 +736,10 @@ void Params::initialise(int argc, char* argv[])
             entranceSpecs = parse_tunnel_entrance_positions(vm["tunnel-entrance"].as<std::vector<std::string>>());
         }
 
+        if (vm.count("extra-tunnel")) {
+            extraTunnelSpecs = parse_tunnel_specs(vm["extra-tunnel"].as<std::vector<std::string>>());
+        }
+
         if (vm.count("barrier")) {
             barrierSpecs = parse_barrier_positions(vm["barrier"].as<std::vector<std::string>>());
         }
@@ -577,12 +783,29 @@ void Params::initialise(int argc, char* argv[])
 
 
 // methods
+const NectarRegenSpec& Params::nectarRegenSpec(int speciesID)
+{
+    for (const NectarRegenSpec& spec : flowerNectarRegenSpecies) {
+        if (spec.speciesID == speciesID) {
+            return spec;
+        }
+    }
+    return flowerNectarRegen;
+}
+
+
 void Params::calculateDerivedParams()
 {
     if (!evolveSpecPvt.empty()) {
         evolveSpec = parse_evolve_spec(evolveSpecPvt);
     }
 
+    fidelitySchedule = parse_fidelity_schedule(fidelitySchedulePvt);
+
+    flowerNectarRegen = NectarRegenSpec(0, parse_nectar_regen_curve(flowerNectarRegenCurvePvt), flowerNectarRegenRate,
+        (flowerNectarCap > 0.0f) ? flowerNectarCap : flowerInitialNectar);
+    flowerNectarRegenSpecies = parse_nectar_regen_species(flowerNectarRegenSpeciesPvt, flowerInitialNectar);
+
     switch (evolveObjectivePvt) {
     case 0:
         evolveObjective = EvolveObjective::EMD_TO_TARGET_HEATMAP;
@@ -590,13 +813,27 @@ void Params::calculateDerivedParams()
     case 1:
         evolveObjective = EvolveObjective::FRACTION_FLOWERS_SUCCESSFUL_VISIT_RANGE;
         break;
+    case 2:
+        evolveObjective = EvolveObjective::ENTRANCE_CROSSING_SUCCESS_RATE;
+        break;
+    case 3:
+        evolveObjective = EvolveObjective::VISIT_COUNT_VARIANCE;
+        break;
     default:
         pb::msg_error_and_exit(std::format(
             "Invalid value for evolve-objective: {}. Valid values are 0=EMD to target heatmap, "
-            "1=Fraction of flowers in successful visit range",
+            "1=Fraction of flowers in successful visit range, 2=Tunnel entrance crossing success rate, "
+            "3=Variance of flower visit counts",
             evolveObjectivePvt)
         );
     }
+
+    evolveEmdApprox = parse_emd_approx(evolveEmdApproxPvt);
+
+    evolveObjectives = parse_evolve_objectives(evolveObjectivesPvt);
+    if (evolveObjectives.empty()) {
+        evolveObjectives.push_back(evolveObjective);
+    }
 }
 
 
@@ -651,7 +888,11 @@ void Params::print(std::ostream& os, bool bGenerateForConfigFile)
             }
             os << valsep << coordOpen << entranceSpecs[i].e1 << "," << entranceSpecs[i].e2 << coordClose
                 << ":" << entranceSpecs[i].side
-                << ":" << static_cast<int>(entranceSpecs[i].netType) << linesep;
+                << ":" << static_cast<int>(entranceSpecs[i].netType);
+            if (entranceSpecs[i].tunnel != 0) {
+                os << ":" << entranceSpecs[i].tunnel;
+            }
+            os << linesep;
         }
     }
     else {
@@ -660,6 +901,21 @@ void Params::print(std::ostream& os, bool bGenerateForConfigFile)
         }
     }
 
+    // print extra tunnel info
+    if (!extraTunnelSpecs.empty()) {
+        if (!bGenerateForConfigFile) {
+            os << "~~~ Extra Tunnels: ~~~~~~~~~~~~~~~~" << linesep;
+        }
+        for (size_t i = 0; i < extraTunnelSpecs.size(); ++i) {
+            os << "extra-tunnel";
+            if (!bGenerateForConfigFile) {
+                os << (i+1);
+            }
+            os << valsep << coordOpen << extraTunnelSpecs[i].x << "," << extraTunnelSpecs[i].y << ","
+               << extraTunnelSpecs[i].w << "," << extraTunnelSpecs[i].h << coordClose << linesep;
+        }
+    }
+
     // print barrier info
     if (!bGenerateForConfigFile) {
         os << "~~~ Barriers: ~~~~~~~~~~~~~~~~~~~~~" << linesep;
@@ -815,6 +1071,32 @@ void Params::checkConsistency()
         pb::msg_error_and_exit(std::format("Parameter 'barrier-pass-prob' must be between 0.0 and 1.0, but is {}", barrierPassProb));
     }
 
+    // check tunnels are inside the environment and well apart from each other (a bee must never be
+    // able to step from one tunnel straight into another), and that every entrance is on a tunnel
+    {
+        std::vector<TunnelSpec> allTunnels {TunnelSpec(tunnelX, tunnelY, tunnelW, tunnelH)};
+        allTunnels.insert(allTunnels.end(), extraTunnelSpecs.begin(), extraTunnelSpecs.end());
+        for (size_t i = 0; i < allTunnels.size(); ++i) {
+            const TunnelSpec& t = allTunnels[i];
+            if (i > 0 && (t.w <= 0.0f || t.h <= 0.0f || t.x + t.w > envW || t.y + t.h > envH)) {
+                pb::msg_error_and_exit(std::format("Extra tunnel {} must have positive size and lie within the environment", i));
+            }
+            for (size_t j = 0; j < i; ++j) {
+                const TunnelSpec& u = allTunnels[j];
+                float gapX = std::max(u.x - (t.x + t.w), t.x - (u.x + u.w));
+                float gapY = std::max(u.y - (t.y + t.h), t.y - (u.y + u.h));
+                if (std::max(gapX, gapY) <= 2.0f * beeStepLength) {
+                    pb::msg_error_and_exit(std::format("Tunnels {} and {} overlap or are too close together (they must be more than 2 x bee-step-length apart)", j, i));
+                }
+            }
+        }
+        for (const EntranceSpec& spec : entranceSpecs) {
+            if (spec.tunnel < 0 || spec.tunnel >= static_cast<int>(allTunnels.size())) {
+                pb::msg_error_and_exit(std::format("A tunnel entrance refers to tunnel {}, but there are only {} tunnels", spec.tunnel, allTunnels.size()));
+            }
+        }
+    }
+
     // check at least one hive is specified
     if (hiveSpecs.empty() && !(bEvolve && evolveSpec.evolveHivePositions)) {
         pb::msg_error_and_exit("At least one hive must be specified using the 'hive' parameter");
@@ -825,8 +1107,29 @@ void Params::checkConsistency()
         if (strTargetHeatmapFilename.empty()) {
             pb::msg_error_and_exit("Parameter 'target-heatmap-filename' must be specified if 'evolve' is true");
         }
-        if (evolveObjectivePvt < 0 || evolveObjectivePvt > 1) {
-            pb::msg_error_and_exit("Parameter 'evolve-objective' must be 0 (EMD to target heatmap) or 1 (Fraction of flowers in successful visit range)");
+        if (evolveObjectivePvt < 0 || evolveObjectivePvt > 3) {
+            pb::msg_error_and_exit("Parameter 'evolve-objective' must be 0 (EMD to target heatmap), 1 (Fraction of flowers in successful visit range), 2 (Tunnel entrance crossing success rate) or 3 (Variance of flower visit counts)");
+        }
+        if (!evolveObjectivesPvt.empty() && evolveObjectives.size() < 2) {
+            pb::msg_error_and_exit("Parameter 'evolve-objectives' must list at least two objectives (use 'evolve-objective' for a single objective)");
+        }
+        if (multiObjective()) {
+            if (evolveMoAlgorithm != "nsga2" && evolveMoAlgorithm != "moead") {
+                pb::msg_error_and_exit("Parameter 'evolve-mo-algorithm' must be either 'nsga2' or 'moead'");
+            }
+            if (evolveMoAlgorithm == "nsga2" && numConfigsPerGen % 4 != 0) {
+                pb::msg_error_and_exit("Parameter 'num-configs-per-gen' must be a multiple of 4 when evolving with nsga2");
+            }
+            if (evolveMoAlgorithm == "moead" && (evolveSpec.evolveEntrancePositions || evolveSpec.evolveHivePositions || evolveSpec.evolveBarrierPositions)) {
+                // entrance sides, hive directions and barrier orientations are integer decision variables
+                pb::msg_error_and_exit("Parameter 'evolve-mo-algorithm' can only be 'moead' if 'evolve-spec' only evolves bridge positions, as moead cannot handle integer decision variables");
+            }
+            if (surrogate || !fidelitySchedule.empty()) {
+                pb::msg_error_and_exit("Parameter 'evolve-objectives' cannot be used with 'surrogate' or 'fidelity-schedule', which rank candidates on a single fitness value");
+            }
+            if (useDiverseAlgorithms) {
+                pb::msg_error_and_exit("Parameters 'evolve-objectives' and 'use-diverse-algorithms' cannot be used together");
+            }
         }
         if (numConfigsPerGen < 7) {
             pb::msg_error_and_exit("Parameter 'num-trials-per-gen' must be greater than or equal to 7 if 'evolve' is true");
@@ -840,6 +1143,64 @@ void Params::checkConsistency()
         if (migrationPeriod <= 0 && numIslands > 1) {
             pb::msg_error_and_exit("Parameter 'migration-period' must be greater than zero if 'num-islands' is greater than 1");
         }
+        if (islandProcs < 0) {
+            pb::msg_error_and_exit("Parameter 'island-procs' must not be negative");
+        }
+        if (islandProcs > 0) {
+            if (numIslands <= 1 || islandProcs > numIslands) {
+                pb::msg_error_and_exit("Parameter 'island-procs' must be no greater than 'num-islands', and 'num-islands' must be greater than 1");
+            }
+            if (asyncIslands) {
+                pb::msg_error_and_exit("Parameters 'island-procs' and 'async-islands' cannot be used together");
+            }
+            if (islandTransport != "unix" && islandTransport != "mpi") {
+                pb::msg_error_and_exit("Parameter 'island-transport' must be either 'unix' or 'mpi'");
+            }
+        }
+        if (evolveEmdApprox != EmdBackend::EXACT) {
+            if (evolveEmdExactGen < 0) {
+                pb::msg_error_and_exit("Parameter 'evolve-emd-exact-gen' must not be negative");
+            }
+            if (std::find(evolveObjectives.begin(), evolveObjectives.end(), EvolveObjective::EMD_TO_TARGET_HEATMAP) == evolveObjectives.end()) {
+                pb::msg_warning("Parameter 'evolve-emd-approx' is set but the EMD is not being optimised, so it will be ignored");
+            }
+            if (surrogate || !fidelitySchedule.empty()) {
+                // the surrogate model and the screening thresholds would be left with approximate values after the switch
+                pb::msg_error_and_exit("Parameter 'evolve-emd-approx' cannot be used with 'surrogate' or 'fidelity-schedule'");
+            }
+            if (asyncIslands && numIslands > 1 && evolveEmdExactGen > 0) {
+                // an island that has switched to the exact EMD could receive migrants from one that has not,
+                // and an approximate score could then outrank every exact one and become the champion
+                pb::msg_error_and_exit("Parameter 'evolve-emd-exact-gen' must be 0 when 'evolve-emd-approx' is used with 'async-islands'");
+            }
+            if (evolveEmdApprox == EmdBackend::SINKHORN && (emdSinkhornEpsilon <= 0.0f || emdSinkhornMaxIterations < 1)) {
+                pb::msg_error_and_exit("Parameters 'emd-sinkhorn-epsilon' and 'emd-sinkhorn-max-iterations' must be greater than zero");
+            }
+            if (evolveEmdApprox == EmdBackend::MULTISCALE && emdMultiscaleTolerance <= 0.0f) {
+                pb::msg_error_and_exit("Parameter 'emd-multiscale-tolerance' must be greater than zero");
+            }
+        }
+        if (surrogate) {
+            if (surrogateSimulateFraction <= 0.0f || surrogateSimulateFraction > 1.0f) {
+                pb::msg_error_and_exit("Parameter 'surrogate-simulate-fraction' must be in the range (0.0, 1.0]");
+            }
+            if (surrogateKappa < 0.0f) {
+                pb::msg_error_and_exit("Parameter 'surrogate-kappa' must not be negative");
+            }
+            if (surrogateMaxArchive < numConfigsPerGen) {
+                pb::msg_error_and_exit("Parameter 'surrogate-max-archive' must be at least 'num-configs-per-gen'");
+            }
+        }
+        for (const auto& stage : fidelitySchedule) {
+            if (stage.iterationFraction <= 0.0f || stage.iterationFraction > 1.0f ||
+                stage.beeFraction <= 0.0f || stage.beeFraction > 1.0f ||
+                stage.promoteFraction <= 0.0f || stage.promoteFraction > 1.0f) {
+                pb::msg_error_and_exit("Parameter 'fidelity-schedule' must have iteration, bee and promotion fractions in the range (0.0, 1.0]");
+            }
+            if (stage.heatmapCoarsening < 1) {
+                pb::msg_error_and_exit("Parameter 'fidelity-schedule' must have heatmap coarsening factors of at least 1");
+            }
+        }
         if (evolveSpec.entranceWidth >= Params::tunnelW || evolveSpec.entranceWidth >= Params::tunnelH) {
             pb::msg_error_and_exit("Parameter 'evolve-spec' specifies an entrance width that is larger than the tunnel dimensions");
         }
@@ -857,6 +1218,73 @@ void Params::checkConsistency()
         }
     }
 
+    if (trajectoryFrameInterval < 1) {
+        pb::msg_error_and_exit(std::format("Parameter 'trajectory-frame-interval' must be at least 1, but is {}", trajectoryFrameInterval));
+    }
+
+    if (numReplicates < 1) {
+        pb::msg_error_and_exit(std::format("Parameter 'replicates' must be at least 1, but is {}", numReplicates));
+    }
+
+    if (replicateThreads < 0) {
+        pb::msg_error_and_exit(std::format("Parameter 'replicate-threads' must not be negative, but is {}", replicateThreads));
+    }
+
+    if (numReplicates > 1) {
+        if (bEvolve) {
+            pb::msg_error_and_exit("Parameter 'replicates' cannot be greater than 1 when 'evolve' is true");
+        }
+        if (bVis) {
+            pb::msg_error_and_exit("Parameter 'replicates' cannot be greater than 1 when 'visualise' is true");
+        }
+        if (recordTrajectory) {
+            pb::msg_error_and_exit("Parameter 'record-trajectory' cannot be used when 'replicates' is greater than 1");
+        }
+    }
+
+    if (flowerNectarCap < 0.0f) {
+        pb::msg_error_and_exit(std::format("Parameter 'flower-nectar-cap' must be >= 0.0, but is {}", flowerNectarCap));
+    }
+    {
+        std::vector<NectarRegenSpec> allRegenSpecs = flowerNectarRegenSpecies;
+        allRegenSpecs.push_back(flowerNectarRegen);
+        for (const NectarRegenSpec& spec : allRegenSpecs) {
+            std::string paramName = (spec.speciesID == 0) ? "flower-nectar-regen-rate" :
+                std::format("flower-nectar-regen-species (species {})", spec.speciesID);
+            if (spec.rate < 0.0f) {
+                pb::msg_error_and_exit(std::format("Parameter '{}' rate must be >= 0.0, but is {}", paramName, spec.rate));
+            }
+            if (spec.curve == NectarRegenCurve::SATURATING && spec.rate > 1.0f) {
+                pb::msg_error_and_exit(std::format(
+                    "Parameter '{}' rate must be between 0.0 and 1.0 for the saturating curve, but is {}", paramName, spec.rate));
+            }
+        }
+    }
+
+    if (beeAvoidOccupiedFlowers && beeOccupiedFlowerRadius <= 0.0f) {
+        pb::msg_error_and_exit(std::format("Parameter 'bee-occupied-flower-radius' must be > 0.0, but is {}", beeOccupiedFlowerRadius));
+    }
+
+    // check thread-affinity is a known policy or a list of CPU sets (e.g. "0-3;8-11" or "0,2,4,6")
+    {
+        static const std::regex cpuSetsRegex(R"(^\d+(-\d+)?(,\d+(-\d+)?)*(;\d+(-\d+)?(,\d+(-\d+)?)*)*$)");
+        if (threadAffinity != "none" && threadAffinity != "compact" && threadAffinity != "scatter" &&
+            !std::regex_match(threadAffinity, cpuSetsRegex)) {
+            pb::msg_error_and_exit(std::format(
+                "Parameter 'thread-affinity' must be none, compact, scatter or a list of CPU sets such as 0-3;8-11, but is '{}'",
+                threadAffinity));
+        }
+    }
+
+    if (!replayFilename.empty()) {
+        if (!bVis) {
+            pb::msg_error_and_exit("Parameter 'replay' requires 'visualise' to be true");
+        }
+        if (bEvolve) {
+            pb::msg_error_and_exit("Parameter 'replay' cannot be used when 'evolve' is true");
+        }
+    }
+
     if (bVis) {
         if (visBeePathDrawLen > beePathRecordLen) {
             pb::msg_warning(
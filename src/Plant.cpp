@@ -6,6 +6,8 @@
 
 #include "Plant.h"
 #include "Params.h"
+#include <algorithm>
+#include <cmath>
 #include <cassert>
 
 
@@ -14,10 +16,38 @@ Plant::Plant(float x, float y, int speciesID)
 {
     assert(Params::initialised());
     m_nectarAmount = Params::flowerInitialNectar;
+    m_pNectarRegen = &Params::nectarRegenSpec(speciesID);
 }
 
 
-float Plant::extractNectar(float amountWanted) {
+// The amount of nectar at the given step, which must not be earlier than the last time nectar was
+// extracted. Regeneration never takes a flower above its cap, but a flower that starts above the cap
+// keeps what it has until bees take it below.
+float Plant::nectarAmount(int timestep) const
+{
+    assert(timestep >= m_nectarStep);
+
+    const NectarRegenSpec& regen = *m_pNectarRegen;
+    if (regen.rate == 0.0f || m_nectarAmount >= regen.cap || timestep == m_nectarStep) {
+        return m_nectarAmount;
+    }
+
+    const float steps = static_cast<float>(timestep - m_nectarStep);
+    switch (regen.curve) {
+    case NectarRegenCurve::LINEAR:
+        return std::min(regen.cap, m_nectarAmount + regen.rate * steps);
+    case NectarRegenCurve::SATURATING:
+        // each step closes a fraction 'rate' of the gap to the cap
+        return regen.cap - (regen.cap - m_nectarAmount) * std::pow(1.0f - regen.rate, steps);
+    }
+    return m_nectarAmount;
+}
+
+
+float Plant::extractNectar(float amountWanted, int timestep) {
+    m_nectarAmount = nectarAmount(timestep);
+    m_nectarStep = timestep;
+
     float amountExtracted = 0.0f;
     if (m_nectarAmount >= amountWanted) {
         amountExtracted = amountWanted;
@@ -0,0 +1,122 @@
+/**
+ * @file
+ *
+ * Implementation of the PlantStore class
+ */
+
+#include "PlantStore.h"
+#include "Plant.h"
+#include <algorithm>
+#include <cmath>
+
+
+void PlantStore::initialise(std::vector<Plant>& plants, float width, float height, float cellSize)
+{
+    clear();
+
+    m_cellSize = cellSize;
+    m_gridW = static_cast<std::size_t>(std::ceil(width / m_cellSize));
+    m_gridH = static_cast<std::size_t>(std::ceil(height / m_cellSize));
+
+    // counting sort of the plants by cell, keeping plants within a cell in their original order
+    std::vector<std::size_t> plantCells;
+    plantCells.reserve(plants.size());
+    m_cellStart.assign(m_gridW * m_gridH + 1, 0);
+    for (const Plant& plant : plants) {
+        plantCells.push_back(cellIndex(plant.x(), plant.y()));
+        ++m_cellStart[plantCells.back() + 1];
+    }
+    for (std::size_t c = 0; c < m_gridW * m_gridH; ++c) {
+        m_cellStart[c + 1] += m_cellStart[c];
+    }
+
+    m_x.resize(plants.size());
+    m_y.resize(plants.size());
+    m_plants.resize(plants.size());
+    std::vector<std::uint32_t> nextInCell(m_cellStart.begin(), m_cellStart.end() - 1);
+    for (std::size_t p = 0; p < plants.size(); ++p) {
+        std::uint32_t index = nextInCell[plantCells[p]]++;
+        m_x[index] = plants[p].x();
+        m_y[index] = plants[p].y();
+        m_plants[index] = &plants[p];
+    }
+
+    // size the scratch buffers for the largest 3x3 neighbourhood
+    std::size_t maxNeighbourhood = 0;
+    for (std::size_t i = 0; i < m_gridW; ++i) {
+        for (std::size_t j = 0; j < m_gridH; ++j) {
+            std::size_t n = 0;
+            for (std::size_t ci = (i > 0 ? i - 1 : 0); ci <= std::min(i + 1, m_gridW - 1); ++ci) {
+                std::size_t firstCell = ci * m_gridH + (j > 0 ? j - 1 : 0);
+                std::size_t lastCell = ci * m_gridH + std::min(j + 1, m_gridH - 1);
+                n += m_cellStart[lastCell + 1] - m_cellStart[firstCell];
+            }
+            maxNeighbourhood = std::max(maxNeighbourhood, n);
+        }
+    }
+    m_scratchDistSq.resize(maxNeighbourhood);
+    m_scratchIndices.resize(maxNeighbourhood);
+}
+
+
+void PlantStore::clear()
+{
+    m_x.clear();
+    m_y.clear();
+    m_plants.clear();
+    m_cellStart.clear();
+    m_scratchDistSq.clear();
+    m_scratchIndices.clear();
+}
+
+
+std::size_t PlantStore::gatherWithinRange(float x, float y, float rangeSq) const
+{
+    if (m_plants.empty()) {
+        return 0;
+    }
+
+    const std::size_t cell = cellIndex(x, y);
+    const std::size_t i = cell / m_gridH;
+    const std::size_t j = cell % m_gridH;
+
+    const float* px = m_x.data();
+    const float* py = m_y.data();
+    float* distSq = m_scratchDistSq.data();
+    std::uint32_t* indices = m_scratchIndices.data();
+
+    std::size_t numFound = 0;
+    for (std::size_t ci = (i > 0 ? i - 1 : 0); ci <= std::min(i + 1, m_gridW - 1); ++ci) {
+        // the cells (ci, j-1), (ci, j) and (ci, j+1) are one contiguous range
+        const std::uint32_t first = m_cellStart[ci * m_gridH + (j > 0 ? j - 1 : 0)];
+        const std::uint32_t last = m_cellStart[ci * m_gridH + std::min(j + 1, m_gridH - 1) + 1];
+        const std::uint32_t len = last - first;
+
+        // squared distances for the whole range (this loop vectorises)
+        float* rangeDistSq = distSq + numFound;
+        for (std::uint32_t k = 0; k < len; ++k) {
+            float dx = px[first + k] - x;
+            float dy = py[first + k] - y;
+            rangeDistSq[k] = dx * dx + dy * dy;
+        }
+
+        // compact the ones within range to the front, in place and without branching
+        // (the write position never gets ahead of the read position)
+        for (std::uint32_t k = 0; k < len; ++k) {
+            const float d = rangeDistSq[k];
+            distSq[numFound] = d;
+            indices[numFound] = first + k;
+            numFound += (d <= rangeSq) ? 1 : 0;
+        }
+    }
+
+    return numFound;
+}
+
+
+std::size_t PlantStore::cellIndex(float x, float y) const
+{
+    int i = std::clamp(static_cast<int>(x / m_cellSize), 0, static_cast<int>(m_gridW) - 1);
+    int j = std::clamp(static_cast<int>(y / m_cellSize), 0, static_cast<int>(m_gridH) - 1);
+    return static_cast<std::size_t>(i) * m_gridH + static_cast<std::size_t>(j);
+}
@@ -8,6 +8,7 @@
 #include "Params.h"
 #include "LocalVis.h"
 #include "Bee.h"
+#include "ThreadAffinity.h"
 #include "utils.h"
 #include "polybeeConfig.h"
 #include <opencv2/core/version.hpp>
@@ -18,10 +19,15 @@
 #include <format>
 #include <chrono>
 #include <fstream>
+#include <thread>
+#include <atomic>
 
 // Initialise static members
 std::size_t PolyBeeCore::m_sNextIslandNum = 0;
 
+// how often the simulation thread checks whether it has been unpaused
+const int PAUSED_POLL_INTERVAL_MS = 10;
+
 
 // Constructor
 PolyBeeCore::PolyBeeCore(int argc, char* argv[]) :
@@ -41,6 +47,8 @@ PolyBeeCore::PolyBeeCore(int argc, char* argv[]) :
         std::cout << "~~~~~~~~~~" << std::endl;
     }
 
+    ThreadAffinity::initialise();
+
     if (Params::hiveSpecs.empty()  && !(Params::bEvolve && Params::evolveSpec.evolveHivePositions)) {
         pb::msg_error_and_exit("No hive positions have been defined!");
     }
@@ -58,11 +66,15 @@ PolyBeeCore::PolyBeeCore(int argc, char* argv[]) :
 
 
 // Copy constructor to create a new PolyBeeCore instance as a copy of an existing one
+// (the island number is given explicitly because in multi-process island mode each
+// process only creates cores for the islands it hosts)
 //
-PolyBeeCore::PolyBeeCore(const PolyBeeCore& other, const std::string& rngSeedStr) :
+PolyBeeCore::PolyBeeCore(const PolyBeeCore& other, const std::string& rngSeedStr, std::size_t islandNum) :
     m_pLocalVis {nullptr},
-    m_islandNum {m_sNextIslandNum++}
+    m_islandNum {islandNum}
 {
+    m_sNextIslandNum = std::max(m_sNextIslandNum, islandNum + 1);
+
     assert(Params::initialised); // Params must have been initialised before copying PolyBeeCore
 
     seedRng(&rngSeedStr);
@@ -94,16 +106,39 @@ void PolyBeeCore::generateTimestampString()
 
 void PolyBeeCore::run(bool logIfRequested)
 {
-    // main simulation loop
-    while (!stopCriteriaReached()) {
-        if (!m_bPaused) {
-            ++m_iIteration;
-            m_env.update(m_iIteration); // update environment state, including bee positions and heatmap
-        }
+    // record a trajectory of the run if requested (subject to the same conditions as the other output files)
+    if (logIfRequested && Params::recordTrajectory && m_islandNum == 0) {
+        m_pTrajectoryRecorder = std::make_unique<TrajectoryRecorder>(
+            outputFilename("trajectory", "pbtraj"), m_env, Params::trajectoryFrameInterval);
+    }
 
-        if (Params::bVis && m_pLocalVis) {
-            m_pLocalVis->updateDrawFrame();
-        }
+    // run the simulation loop specialised for the features that the current configuration uses
+    auto runLoop = [this]() {
+        dispatchSimFeatures(m_env.simFeatureFlags(), [this]<typename Features>() {
+            runSimulationLoop<Features>();
+        });
+    };
+
+    if (m_pLocalVis) {
+        // the window belongs to this thread, so run the simulation on a thread of its own and draw
+        // snapshots of it here until it finishes (or the user closes the window)
+        std::atomic<bool> bSimFinished {false};
+        std::thread simThread([&]() {
+            runLoop();
+            bSimFinished.store(true, std::memory_order_release);
+        });
+        m_pLocalVis->renderWhileRunning(bSimFinished);
+        simThread.join();
+    }
+    else {
+        runLoop();
+    }
+
+    if (m_pTrajectoryRecorder) {
+        m_pTrajectoryRecorder->finish();
+        pb::msg_info(std::format("Trajectory ({} frames) written to file: {}",
+            m_pTrajectoryRecorder->numFrames(), m_pTrajectoryRecorder->filename()));
+        m_pTrajectoryRecorder.reset();
     }
 
     // log output files if the user has requested it AND the caller of the method has requested it,
@@ -123,6 +158,52 @@ void PolyBeeCore::run(bool logIfRequested)
 }
 
 
+// main simulation loop
+template<typename Features>
+void PolyBeeCore::runSimulationLoop()
+{
+    while (!stopCriteriaReached()) {
+        if (!m_bPaused) {
+            ++m_iIteration;
+            m_env.update<Features>(m_iIteration); // update environment state, including bee positions and heatmap
+
+            if (m_pTrajectoryRecorder) {
+                m_pTrajectoryRecorder->update(m_iIteration, m_env);
+            }
+        }
+
+        if (Params::bVis && m_pLocalVis) {
+            // hand the renderer a snapshot if it is ready for one, then wait if the user has slowed the simulation
+            // down (or, while paused, just long enough not to spin)
+            m_pLocalVis->offerSnapshot(m_iIteration, m_env);
+            int delay = m_bPaused ? PAUSED_POLL_INTERVAL_MS : m_pLocalVis->delayPerStep();
+            if (delay > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+            }
+        }
+    }
+}
+
+
+// Replay a recorded trajectory in the visualiser. The environment (tunnels, barriers, hives and so on)
+// comes from the current config, which should be the config file written by the recorded run; the bees
+// and the plants' visit counts come from the trajectory file.
+void PolyBeeCore::replay()
+{
+    assert(m_pLocalVis);
+
+    TrajectoryReader reader(Params::replayFilename);
+    if (reader.numBees() != m_env.getBees().size() || reader.numPlants() != m_env.getAllPlants().size()) {
+        pb::msg_warning(std::format("Trajectory file {} has {} bees and {} plants, but the config gives {} bees and {} plants. "
+            "Was it recorded with a different config?", reader.filename(), reader.numBees(), reader.numPlants(),
+            m_env.getBees().size(), m_env.getAllPlants().size()));
+    }
+    pb::msg_info(std::format("Replaying {} frames from trajectory file {}", reader.numFrames(), reader.filename()));
+
+    m_pLocalVis->replay(reader);
+}
+
+
 // Reset the environment to its initial state suitable for a new simulation run
 //
 // This method resets are changeable state and stochastic elements of the environment,
@@ -137,6 +218,11 @@ void::PolyBeeCore::resetForNewRun(
     m_bEarlyExitRequested = false;
     m_bPaused = false;
 
+    // the bees are the only things that hold on to memory from the episode arena between steps, so once
+    // they have gone the whole arena can be released in one go
+    m_env.clearBees();
+    m_episodeArena.release();
+
     // reset environment (including bees, heatmap etc)
     m_env.resetForNewRun(hiveSpecs, bridgeSpecs);
 }
@@ -147,13 +233,17 @@ void PolyBeeCore::writeOutputFiles() const
     // write config to file
     writeConfigFile();
 
+    // write heatmaps, flowmap and run info
+    writeResultFiles();
+}
+
+
+void PolyBeeCore::writeResultFiles() const
+{
     // write flowmap to file if it has been calculated
     const Flowmap& flowmap = m_env.getFlowmapConst();
     if (!flowmap.empty()) {
-        std::string flowmapFilename = std::format("{0}/{1}flowmap-{2}.csv",
-            Params::logDir,
-            Params::logFilenamePrefix.empty() ? "" : (Params::logFilenamePrefix + "-"),
-            m_timestampStr);
+        std::string flowmapFilename = outputFilename("flowmap", "csv");
         std::ofstream flowmapFile(flowmapFilename);
         if (!flowmapFile) {
             pb::msg_warning(
@@ -171,10 +261,7 @@ void PolyBeeCore::writeOutputFiles() const
 
     // write heatmap to file
     const Heatmap& heatmap = m_env.getHeatmap();
-    std::string heatmapFilename = std::format("{0}/{1}heatmap-{2}.csv",
-        Params::logDir,
-        Params::logFilenamePrefix.empty() ? "" : (Params::logFilenamePrefix + "-"),
-        m_timestampStr);
+    std::string heatmapFilename = outputFilename("heatmap", "csv");
     std::ofstream heatmapFile(heatmapFilename);
     if (!heatmapFile) {
         pb::msg_warning(
@@ -190,10 +277,7 @@ void PolyBeeCore::writeOutputFiles() const
     }
 
     // write normalised heatmap to file
-    std::string normHeatmapFilename = std::format("{0}/{1}heatmap-normalised-{2}.csv",
-        Params::logDir,
-        Params::logFilenamePrefix.empty() ? "" : (Params::logFilenamePrefix + "-"),
-        m_timestampStr);
+    std::string normHeatmapFilename = outputFilename("heatmap-normalised", "csv");
     std::ofstream normHeatmapFile(normHeatmapFilename);
     if (!normHeatmapFile) {
         pb::msg_warning(
@@ -209,10 +293,7 @@ void PolyBeeCore::writeOutputFiles() const
     }
 
     // write general run info to file
-    std::string infoFilename = std::format("{0}/{1}run-info-{2}.txt",
-        Params::logDir,
-        Params::logFilenamePrefix.empty() ? "" : (Params::logFilenamePrefix + "-"),
-        m_timestampStr);
+    std::string infoFilename = outputFilename("run-info", "txt");
     std::ofstream infoFile(infoFilename);
     if (!infoFile) {
         pb::msg_warning(
@@ -229,13 +310,22 @@ void PolyBeeCore::writeOutputFiles() const
 }
 
 
-void PolyBeeCore::writeConfigFile() const
+// Full path of the output file with the given tag (e.g. "heatmap") and extension for this run
+std::string PolyBeeCore::outputFilename(const std::string& tag, const std::string& extension) const
 {
-    // write config to file
-    std::string configFilename = std::format("{0}/{1}config-{2}.cfg",
+    return std::format("{0}/{1}{2}-{3}.{4}",
         Params::logDir,
         Params::logFilenamePrefix.empty() ? "" : (Params::logFilenamePrefix + "-"),
-        m_timestampStr);
+        tag,
+        m_timestampStr,
+        extension);
+}
+
+
+void PolyBeeCore::writeConfigFile() const
+{
+    // write config to file
+    std::string configFilename = outputFilename("config", "cfg");
     std::ofstream configFile(configFilename);
     if (!configFile) {
         pb::msg_warning(
@@ -280,9 +370,32 @@ void PolyBeeCore::printRunInfo(std::ostream& os, const std::string& filename) co
         Params::maxVisitCountSuccess,
         m_env.getSuccessfulVisitFraction());
 
+    // the distribution of visit counts behind the SVF, as "visits:plants" for each visit count that occurred
+    const VisitCountHistogram& visitHistogram = m_env.getVisitCountHistogram();
+    os << std::format("Visit count histogram ({} plants counted for SVF):", visitHistogram.numPlants());
+    const std::vector<long>& visitCounts = visitHistogram.counts();
+    for (std::size_t v = 0; v < visitCounts.size(); ++v) {
+        if (visitCounts[v] > 0) {
+            os << std::format(" {}:{}", v, visitCounts[v]);
+        }
+    }
+    os << "\n";
+
     EntranceCrossingStats crossingStats = m_env.getEntranceCrossingStats(EntranceCrossingType::ALL);
     os << std::format("Tunnel entrance crossing success rate: {:.2f}%\n", crossingStats.successRate * 100.0f);
-    os << std::format("Mean number of rebounds per tunnel entrance crossing attempt: {:.2f}\n", crossingStats.meanRebounds);
+    os << std::format("Mean number of rebounds per tunnel entrance crossing attempt: {:.2f} (sd {:.2f}, {} attempts)\n",
+        crossingStats.meanRebounds, crossingStats.sdRebounds, crossingStats.numAttempts);
+    for (auto [netType, netName] : {std::pair{NetType::ANTIBIRD, "anti-bird"}, std::pair{NetType::ANTIHAIL, "anti-hail"}}) {
+        EntranceCrossingStats netStats = m_env.getEntranceCrossingStats(EntranceCrossingType::ALL, netType);
+        if (netStats.numAttempts > 0) {
+            os << std::format("  through {} netting: {} attempts, success rate {:.2f}%, mean rebounds {:.2f}\n",
+                netName, netStats.numAttempts, netStats.successRate * 100.0f, netStats.meanRebounds);
+        }
+    }
+
+    const EpisodeArenaStats& arenaStats = m_episodeArena.episodeStats();
+    os << std::format("Episode arena: {} allocations served using {} heap allocations (peak {:.1f} KB)\n",
+        arenaStats.numAllocations, arenaStats.numHeapAllocations, arenaStats.peakHeapBytes / 1024.0);
 }
 
 
@@ -345,5 +458,24 @@ void PolyBeeCore::earlyExit()
 
 bool PolyBeeCore::stopCriteriaReached()
 {
-    return (m_iIteration >= Params::numIterations || m_bEarlyExitRequested);
+    return (m_iIteration >= iterationLimit() || m_bEarlyExitRequested);
+}
+
+
+int PolyBeeCore::iterationLimit() const
+{
+    if (m_iterationFraction >= 1.0f) {
+        return Params::numIterations;
+    }
+    return std::max(1, static_cast<int>(Params::numIterations * m_iterationFraction));
+}
+
+
+// Set the fraction of num-iterations and num-bees used by subsequent runs (takes effect at the next
+// call to resetForNewRun). Used by PolyBeeEvolve to screen candidates at reduced fidelity; pass 1.0 for
+// both to return to full fidelity.
+void PolyBeeCore::setFidelity(float iterationFraction, float beeFraction)
+{
+    m_iterationFraction = iterationFraction;
+    m_env.setBeeFraction(beeFraction);
 }
@@ -7,6 +7,7 @@
 #include "PolyBeeEvolve.h"
 #include "PolyBeeCore.h"
 #include "Params.h"
+#include "ThreadAffinity.h"
 #include "utils.h"
 #include <numbers>
 #include <pagmo/types.hpp>
@@ -27,6 +28,9 @@
 //#include <pagmo/algorithms/sade.hpp>   // not suitable for stochastic problems
 #include <pagmo/algorithms/gaco.hpp>
 #include <pagmo/algorithms/pso_gen.hpp>
+#include <pagmo/algorithms/nsga2.hpp>
+#include <pagmo/algorithms/moead.hpp>
+#include <pagmo/utils/multi_objective.hpp>
 //#include <pagmo/algorithms/cmaes.hpp> // produces an error (tries to use side=5) at end of first generation
 //#include <pagmo/algorithms/xnes.hpp>  // produces an error (tries to use side=5) at end of first generation
 #include <fstream>
@@ -36,8 +40,13 @@
 #include <format>
 #include <cassert>
 #include <numeric>
+#include <cmath>
 #include <algorithm>
 #include <random>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <unistd.h>
 
 
 // Constructor
@@ -157,9 +166,11 @@ PolyBeeOptimization::PolyBeeOptimization(PolyBeeEvolve* ptr, const EvolveSpec& s
 // Implementation of the objective function.
 pagmo::vector_double PolyBeeOptimization::fitness(const pagmo::vector_double &dv) const
 {
-    std::vector<double> fitnessValues;
+    // keep each island on its own CPUs (if a thread-affinity policy is set), whichever of pagmo's
+    // threads is evaluating it
+    ThreadAffinity::pinCurrentThread(m_islandNum);
+
     PolyBeeCore& core = m_pPolyBeeEvolve->polyBeeCore(m_islandNum);
-    const Environment& env = core.getEnvironment();
     bool firstCall = (core.isMasterCore() && core.evaluationCount() == 0);
 
     assert(dv.size() == m_numFloatVars + m_numIntegerVars);
@@ -188,55 +199,104 @@ pagmo::vector_double PolyBeeOptimization::fitness(const pagmo::vector_double &dv
         std::cout << "~~~~~~~~~~" << std::endl;
     }
 
-    for (int i = 0; i < Params::numTrialsPerConfig; ++i)
-    {
-        core.incrementEvaluationCount();
-        // for each replicate run we need to reset all parts of the simulation that have changing state,
-        // i.e. hives, bees and plants
-        core.resetForNewRun(
-            //
-            // if we're evolving hive positions, use the hive specs derived from the decision vector, otherwise
-            // use the regular hive specs from Params
-            (Params::evolveSpec.evolveHivePositions ? hiveSpecs : Params::hiveSpecs),
-            //
-            // env.resetForNewRun() will treat these bridge specs as additional to the regular plant patches in
-            // Params::patchSpecs, so no need to do anything special with them here.
-            bridgeSpecs
-        );
-        core.run(false); // false = do not log output files during the run
+    const int num_evals_per_gen = Params::numConfigsPerGen * Params::numTrialsPerConfig;
+    const int gen = static_cast<int>(core.evaluationCount()) / num_evals_per_gen;
+    const int eval_in_gen = static_cast<int>(core.evaluationCount()) % num_evals_per_gen;
+    const int config_num = eval_in_gen / Params::numTrialsPerConfig;
+
+    // if we're evolving hive positions, use the hive specs derived from the decision vector, otherwise
+    // use the regular hive specs from Params
+    const std::vector<HiveSpec>& runHiveSpecs = (Params::evolveSpec.evolveHivePositions ? hiveSpecs : Params::hiveSpecs);
+
+    // In surrogate-assisted mode the candidate is first pre-screened by the island's surrogate model, and is
+    // only simulated if the model predicts that it is promising or is too uncertain about it to rule it out.
+    // A candidate that is not simulated is given the model's predicted fitness.
+    std::optional<double> surrogateFitness;
+    SurrogatePrediction prediction;
+    if (Params::surrogate) {
+        bool simulate = m_pPolyBeeEvolve->surrogatePreScreen(m_islandNum, gen, dv, m_lowerBounds, m_upperBounds, prediction);
+        if (prediction.valid) {
+            pb::msg_info(std::format("isl {} gen {} cnf {} surrogate predicts {:.5f} +/- {:.5f} threshold {:.5f} {}",
+                core.getIslandNum(), gen, config_num, prediction.mean, prediction.stdDev, prediction.threshold,
+                simulate ? "simulated" : "skipped"));
+        }
+        if (!simulate) {
+            surrogateFitness = prediction.mean;
+        }
+    }
 
-        double objValue = 0.0;
-        switch (Params::evolveObjective) {
-            case EvolveObjective::EMD_TO_TARGET_HEATMAP: {
-                const Heatmap& runHeatmap = core.getHeatmap();
-                objValue = runHeatmap.emd(env.getRawTargetHeatmapNormalised());
-                break;
-            }
-            case EvolveObjective::FRACTION_FLOWERS_SUCCESSFUL_VISIT_RANGE: {
-                // N.B. we negate the fraction of successfully visited flowers here because pagmo minimizes
-                // the objective function, but we want to maximize this fraction
-                objValue = -(core.getSuccessfulVisitFraction());
-                break;
-            }
-            default: {
-                pb::msg_error_and_exit(std::format("Invalid evolve objective {} specified in Params::evolveObjective",
-                    Params::evolveObjectivePvt));
-            }
+    // In multi-fidelity mode the candidate is first screened at each stage of the fidelity schedule in turn,
+    // and only goes on to full-fidelity evaluation if it is promoted at every stage. A candidate that is
+    // rejected is given a penalised fitness that ranks it below every fully evaluated candidate.
+    // (Neither mode is used with multiple objectives, so both only look at the first objective.)
+    std::vector<pagmo::vector_double> trialObjValues; // [trial][objective]
+    std::optional<double> rejectedFitness;
+
+    // the values of one objective over all the trials
+    auto objectiveTrialValues = [](const std::vector<pagmo::vector_double>& values, std::size_t objective) {
+        std::vector<double> column;
+        column.reserve(values.size());
+        for (const auto& trialValues : values) {
+            column.push_back(trialValues[objective]);
+        }
+        return column;
+    };
+
+    for (std::size_t s = 0; s < Params::fidelitySchedule.size() && !surrogateFitness; ++s) {
+        const FidelityStage& stage = Params::fidelitySchedule[s];
+        core.setFidelity(stage.iterationFraction, stage.beeFraction);
+        const double screenValue = pb::median(objectiveTrialValues(
+            runTrials(core, runHiveSpecs, bridgeSpecs, gen, stage.heatmapCoarsening), 0));
+        core.setFidelity(1.0f, 1.0f);
+
+        double threshold = 0.0;
+        bool promoted = m_pPolyBeeEvolve->promoteCandidate(m_islandNum, s, screenValue, threshold);
+        pb::msg_info(std::format("isl {} gen {} cnf {} fidelity stage {} screen {:.5f} threshold {:.5f} {}",
+            core.getIslandNum(), gen, config_num, s, screenValue, threshold, promoted ? "promoted" : "rejected"));
+
+        if (!promoted) {
+            rejectedFitness = m_pPolyBeeEvolve->rejectedFitness(m_islandNum, screenValue, threshold);
+            break;
         }
+    }
+
+    if (!surrogateFitness && !rejectedFitness) {
+        trialObjValues = runTrials(core, runHiveSpecs, bridgeSpecs, gen, 1);
+    }
 
-        fitnessValues.push_back(objValue);
+    // count a full set of trials for every configuration whatever fidelity it was evaluated at, so that
+    // the generation and configuration numbers can still be derived from the evaluation count
+    core.incrementEvaluationCount(Params::numTrialsPerConfig);
+    core.incrementFitnessCallCount();
+
+    // the fitness vector holds the median over the trials of each objective separately
+    pagmo::vector_double medianObjValues;
+    if (surrogateFitness || rejectedFitness) {
+        medianObjValues.push_back(surrogateFitness ? *surrogateFitness : *rejectedFitness);
+    }
+    else {
+        for (std::size_t k = 0; k < Params::evolveObjectives.size(); ++k) {
+            medianObjValues.push_back(pb::median(objectiveTrialValues(trialObjValues, k)));
+        }
     }
+    const double medianObjValue = medianObjValues[0];
 
-    const double medianObjValue = pb::median(fitnessValues);
+    if (!Params::fidelitySchedule.empty() && !trialObjValues.empty()) {
+        m_pPolyBeeEvolve->recordFullFidelityValue(m_islandNum, medianObjValue);
+    }
 
-    int num_evals_per_gen = Params::numConfigsPerGen * Params::numTrialsPerConfig;
-    int gen = (core.evaluationCount()-1) / num_evals_per_gen;
-    int eval_in_gen = (core.evaluationCount()-1) % num_evals_per_gen;
-    int config_num = eval_in_gen / Params::numTrialsPerConfig;
+    if (Params::surrogate) {
+        m_pPolyBeeEvolve->recordSurrogateResult(m_islandNum, config_num, dv, prediction,
+            !trialObjValues.empty(), medianObjValue);
+    }
 
-    // Output some info about the current configuration and its fitness value
-    std::string msg = std::format("isl {} gen {} evl {} cnf {} mdF {:.5f} ",
-        core.getIslandNum(), gen, core.evaluationCount(), config_num, medianObjValue);
+    // Output some info about the current configuration and its fitness value(s)
+    std::string fitnessStr;
+    for (std::size_t k = 0; k < medianObjValues.size(); ++k) {
+        fitnessStr += std::format("{}{:.5f}", (k > 0) ? "," : "", medianObjValues[k]);
+    }
+    std::string msg = std::format("isl {} gen {} evl {} cnf {} mdF {} ",
+        core.getIslandNum(), gen, core.evaluationCount(), config_num, fitnessStr);
     if (Params::evolveSpec.evolveEntrancePositions) {
         msg += "/e/ ";
         for (int i = 0; i < entranceSpecs.size(); ++i) {
@@ -263,7 +323,125 @@ pagmo::vector_double PolyBeeOptimization::fitness(const pagmo::vector_double &dv
     }
     pb::msg_info(msg);
 
-    return {medianObjValue};
+    // (the per-generation reports below are skipped while a population is being re-evaluated with the
+    // exact EMD, as those evaluations repeat the generation's configuration numbers)
+    if (config_num == Params::numConfigsPerGen - 1 && !core.isRescoring()) {
+        // report how well the episode arena has been absorbing the transient allocations on this island
+        const EpisodeArenaStats& arenaStats = core.getEpisodeArena().totalStats();
+        pb::msg_info(std::format("isl {} gen {} episode arena: {} allocations served using {} heap allocations (peak {:.1f} KB per run)",
+            core.getIslandNum(), gen, arenaStats.numAllocations, arenaStats.numHeapAllocations,
+            arenaStats.peakHeapBytes / 1024.0));
+    }
+
+    if (Params::commonRandomNumbers && !core.isRescoring()) {
+        // with multiple objectives, the variance reduction is reported for the first one. Only candidates
+        // that were simulated in full have trial values, so with multi-fidelity screening or the surrogate
+        // the statistics cover the candidates that got through, not the whole generation.
+        m_pPolyBeeEvolve->recordTrialValues(m_islandNum, gen, config_num, objectiveTrialValues(trialObjValues, 0));
+    }
+
+    return medianObjValues;
+}
+
+
+// a private helper method for PolyBeeOptimization::fitness() that runs num-trials-per-config trials of the
+// configuration that has already been applied to the core's environment, and returns the value of each
+// objective in Params::evolveObjectives for each trial. All the objectives are read from the same simulated
+// episode, so optimising several of them together costs no more simulation than optimising one.
+// In multi-fidelity mode heatmapCoarsening > 1 is used to compute the EMD on a coarser grid.
+std::vector<pagmo::vector_double> PolyBeeOptimization::runTrials(PolyBeeCore& core, const std::vector<HiveSpec>& hiveSpecs,
+    const std::vector<PatchSpec>& bridgeSpecs, int gen, int heatmapCoarsening) const
+{
+    std::vector<pagmo::vector_double> trialValues;
+
+    // In common-random-numbers mode each trial reseeds the core's RNG from a (generation, trial) seed, so
+    // we save the engine state here and restore it afterwards to leave the core's own stream untouched
+    std::mt19937 savedRngEngine;
+    if (Params::commonRandomNumbers) {
+        savedRngEngine = core.m_rngEngine;
+    }
+
+    for (int i = 0; i < Params::numTrialsPerConfig; ++i)
+    {
+        if (Params::commonRandomNumbers) {
+            // trial i of every configuration in this generation sees the same plant jitter and bee decisions
+            std::vector<std::uint32_t> seedData(Params::strRngSeed.begin(), Params::strRngSeed.end());
+            seedData.push_back(static_cast<std::uint32_t>(gen));
+            seedData.push_back(static_cast<std::uint32_t>(i));
+            std::seed_seq seed(seedData.begin(), seedData.end());
+            core.m_rngEngine.seed(seed);
+        }
+
+        // for each replicate run we need to reset all parts of the simulation that have changing state,
+        // i.e. hives, bees and plants.
+        // env.resetForNewRun() will treat the bridge specs as additional to the regular plant patches in
+        // Params::patchSpecs, so no need to do anything special with them here.
+        core.resetForNewRun(hiveSpecs, bridgeSpecs);
+        core.run(false); // false = do not log output files during the run
+        core.incrementEpisodeCount();
+
+        pagmo::vector_double objValues;
+        for (EvolveObjective objective : Params::evolveObjectives) {
+            objValues.push_back(objectiveValue(core, objective, gen, heatmapCoarsening));
+        }
+        trialValues.push_back(std::move(objValues));
+    }
+
+    if (Params::commonRandomNumbers) {
+        core.m_rngEngine = savedRngEngine;
+    }
+
+    return trialValues;
+}
+
+
+// a private helper method for runTrials() that reads the value of the given objective from the episode the
+// core has just run. Before generation evolve-emd-exact-gen the EMD is computed with the approximation
+// selected by evolve-emd-approx (if any).
+double PolyBeeOptimization::objectiveValue(const PolyBeeCore& core, EvolveObjective objective, int gen,
+    int heatmapCoarsening) const
+{
+    const Environment& env = core.getEnvironment();
+    double objValue = 0.0;
+    switch (objective) {
+        case EvolveObjective::EMD_TO_TARGET_HEATMAP: {
+            const Heatmap& runHeatmap = core.getHeatmap();
+            const bool useApprox = (Params::evolveEmdExactGen == 0 || gen < Params::evolveEmdExactGen);
+            const EmdBackend backend = useApprox ? Params::evolveEmdApprox : EmdBackend::EXACT;
+            if (heatmapCoarsening > 1) {
+                // scale back up to (approximately) the units of the full resolution EMD
+                objValue = heatmapCoarsening * runHeatmap.emd(
+                    Heatmap::coarsened(runHeatmap.cellsNormalised(), heatmapCoarsening),
+                    Heatmap::coarsened(env.getRawTargetHeatmapNormalised(), heatmapCoarsening), backend);
+            }
+            else {
+                objValue = runHeatmap.emd(env.getRawTargetHeatmapNormalised(), backend);
+            }
+            break;
+        }
+        case EvolveObjective::FRACTION_FLOWERS_SUCCESSFUL_VISIT_RANGE: {
+            // N.B. we negate the fraction of successfully visited flowers here because pagmo minimizes
+            // the objective function, but we want to maximize this fraction
+            objValue = -(core.getSuccessfulVisitFraction());
+            break;
+        }
+        case EvolveObjective::ENTRANCE_CROSSING_SUCCESS_RATE: {
+            // negated for the same reason as above
+            objValue = -(env.getEntranceCrossingStats(EntranceCrossingType::ALL).successRate);
+            break;
+        }
+        case EvolveObjective::VISIT_COUNT_VARIANCE: {
+            // a lower variance means the visits are spread more evenly over the flowers
+            objValue = env.getVisitCountHistogram().variance();
+            break;
+        }
+        default: {
+            pb::msg_error_and_exit(std::format("Invalid evolve objective {} specified in Params::evolveObjectives",
+                static_cast<int>(objective)));
+        }
+    }
+
+    return objValue;
 }
 
 
@@ -644,17 +822,47 @@ std::string select_random::get_extra_info() const
 }
 
 
-PolyBeeEvolve::PolyBeeEvolve(PolyBeeCore& core) : m_masterPolyBeeCore(core)
-{}
+PolyBeeEvolve::PolyBeeEvolve(PolyBeeCore& core) :
+    m_masterPolyBeeCore(core),
+    m_crnStats(std::max(Params::numIslands, 1)),
+    m_fidelityStats(std::max(Params::numIslands, 1)),
+    m_surrogateStats(std::max(Params::numIslands, 1))
+{
+    for (auto& stats : m_fidelityStats) {
+        stats.recentScores.resize(Params::fidelitySchedule.size());
+    }
+}
 
 
 void PolyBeeEvolve::evolve()
 {
+    auto start = std::chrono::steady_clock::now();
+
     if (Params::numIslands <= 1) {
         evolveSinglePop();
+    } else if (Params::islandProcs > 0) {
+        evolveMultiProcess();
+    } else if (Params::asyncIslands) {
+        evolveArchipelagoAsync();
     } else {
         evolveArchipelago();
     }
+
+    // report throughput over the islands hosted by this process (or, for the coordinator in multi-process
+    // island mode, by all the workers), so thread placement policies can be compared.
+    // This counts the episodes actually simulated, as the evaluation count also includes the trials of
+    // candidates that were skipped by the surrogate or rejected during fidelity screening.
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::size_t numFitnessCalls = m_masterPolyBeeCore.fitnessCallCount() + m_workerFitnessCallCount;
+    std::size_t numEpisodes = m_masterPolyBeeCore.episodeCount() + m_workerEpisodeCount;
+    for (const auto& pCore : m_islandPolyBeeCores) {
+        if (pCore) {
+            numFitnessCalls += pCore->fitnessCallCount();
+            numEpisodes += pCore->episodeCount();
+        }
+    }
+    pb::msg_info(std::format("Completed {} fitness calls, simulating {} episodes in {:.2f} s ({:.2f} episodes/s, thread affinity {})",
+        numFitnessCalls, numEpisodes, seconds, (seconds > 0.0) ? numEpisodes / seconds : 0.0, ThreadAffinity::policyName()));
 }
 
 
@@ -665,11 +873,280 @@ PolyBeeCore& PolyBeeEvolve::polyBeeCore(std::size_t islandNum)
     } else {
         // NB Indices in this vector are offset by 1 compared to island number (island 0 is the master PolyBeeCore)!
         assert(islandNum - 1 < m_islandPolyBeeCores.size());
+        assert(m_islandPolyBeeCores[islandNum - 1]); // null if the island is hosted by another process
         return *m_islandPolyBeeCores[islandNum - 1];
     }
 }
 
 
+void PolyBeeEvolve::recordTrialValues(std::size_t islandNum, int gen, int configNum, const std::vector<double>& values)
+{
+    assert(islandNum < m_crnStats.size());
+    CrnStats& stats = m_crnStats[islandNum];
+
+    if (gen != stats.gen) {
+        stats.gen = gen;
+        stats.trialValues.clear();
+    }
+    if (!values.empty()) {
+        stats.trialValues.push_back(values); // empty if the configuration was rejected in multi-fidelity mode
+    }
+
+    if (configNum == Params::numConfigsPerGen - 1) {
+        reportCrnStats(islandNum);
+    }
+}
+
+
+// Decide whether a candidate passes a stage of the fidelity schedule, by comparing its screening score with
+// the last num-configs-per-gen scores seen at that stage on the island. Screening starts once a quarter of
+// a generation's scores (and at least two) are in, with the threshold taken from that partial window, so
+// that most of generation 0, which is the largest and most random population, is screened too.
+bool PolyBeeEvolve::promoteCandidate(std::size_t islandNum, std::size_t stage, double screenValue, double& threshold)
+{
+    assert(islandNum < m_fidelityStats.size());
+    assert(stage < m_fidelityStats[islandNum].recentScores.size());
+    auto& scores = m_fidelityStats[islandNum].recentScores[stage];
+
+    scores.push_back(screenValue);
+    if (scores.size() > static_cast<std::size_t>(Params::numConfigsPerGen)) {
+        scores.pop_front();
+    }
+
+    const std::size_t minScores = std::max<std::size_t>(2, (static_cast<std::size_t>(Params::numConfigsPerGen) + 3) / 4);
+    if (scores.size() < minScores) {
+        threshold = screenValue;
+        return true;
+    }
+
+    // lower is better, so the cut-off is the score of the last candidate within the promote fraction
+    std::vector<double> sorted(scores.begin(), scores.end());
+    std::sort(sorted.begin(), sorted.end());
+    const float promoteFraction = Params::fidelitySchedule[stage].promoteFraction;
+    std::size_t numPromoted = std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(promoteFraction * sorted.size())));
+    threshold = sorted[std::min(numPromoted, sorted.size()) - 1];
+
+    return (screenValue <= threshold);
+}
+
+
+void PolyBeeEvolve::recordFullFidelityValue(std::size_t islandNum, double value)
+{
+    assert(islandNum < m_fidelityStats.size());
+    auto& worst = m_fidelityStats[islandNum].worstFullFidelityValue;
+    if (!worst || value > *worst) {
+        worst = value;
+    }
+}
+
+
+// A rejected candidate is ranked just below the worst candidate evaluated at full fidelity so far, by
+// however far its screening score fell short of the promotion threshold, so that rejected candidates
+// never displace fully evaluated ones but are still ordered amongst themselves
+double PolyBeeEvolve::rejectedFitness(std::size_t islandNum, double screenValue, double threshold) const
+{
+    assert(islandNum < m_fidelityStats.size());
+    const auto& worst = m_fidelityStats[islandNum].worstFullFidelityValue;
+    return (worst ? *worst : threshold) + (screenValue - threshold);
+}
+
+
+// Decide whether a candidate should be simulated, based on the island's surrogate model. The model is
+// refitted to the island's archive of simulated candidates at the first candidate of each generation. Until
+// the archive holds a generation's worth of candidates every candidate is simulated. After that, a candidate
+// is simulated only if its optimistic (lower confidence bound) predicted fitness is at least as good as the
+// surrogate-simulate-fraction quantile of the fitnesses in the archive.
+bool PolyBeeEvolve::surrogatePreScreen(std::size_t islandNum, int gen, const pagmo::vector_double& dv,
+    const pagmo::vector_double& lowerBounds, const pagmo::vector_double& upperBounds, SurrogatePrediction& prediction)
+{
+    assert(islandNum < m_surrogateStats.size());
+    SurrogateStats& stats = m_surrogateStats[islandNum];
+
+    if (!stats.model) {
+        stats.model = std::make_unique<Surrogate>(lowerBounds, upperBounds);
+    }
+
+    if (gen != stats.gen) {
+        stats.gen = gen;
+        stats.numCandidates = 0;
+        stats.numSimulated = 0;
+        stats.predicted.clear();
+        stats.actual.clear();
+
+        if (stats.archiveY.size() >= static_cast<std::size_t>(Params::numConfigsPerGen)) {
+            std::vector<pagmo::vector_double> xs(stats.archiveX.begin(), stats.archiveX.end());
+            std::vector<double> ys(stats.archiveY.begin(), stats.archiveY.end());
+            stats.model->fit(xs, ys);
+
+            std::sort(ys.begin(), ys.end());
+            std::size_t idx = static_cast<std::size_t>(Params::surrogateSimulateFraction * (ys.size() - 1));
+            stats.threshold = ys[std::min(idx, ys.size() - 1)];
+        }
+    }
+
+    ++stats.numCandidates;
+
+    if (!stats.model->isFitted()) {
+        prediction.valid = false;
+        return true;
+    }
+
+    auto [mean, stdDev] = stats.model->predict(dv);
+    prediction.valid = true;
+    prediction.mean = mean;
+    prediction.stdDev = stdDev;
+    prediction.threshold = stats.threshold;
+
+    return (mean - Params::surrogateKappa * stdDev <= stats.threshold);
+}
+
+
+void PolyBeeEvolve::recordSurrogateResult(std::size_t islandNum, int configNum, const pagmo::vector_double& dv,
+    const SurrogatePrediction& prediction, bool simulated, double value)
+{
+    assert(islandNum < m_surrogateStats.size());
+    SurrogateStats& stats = m_surrogateStats[islandNum];
+
+    if (simulated) {
+        ++stats.numSimulated;
+        ++stats.totalSimulated;
+
+        stats.archiveX.push_back(dv);
+        stats.archiveY.push_back(value);
+        if (stats.archiveY.size() > static_cast<std::size_t>(Params::surrogateMaxArchive)) {
+            stats.archiveX.pop_front();
+            stats.archiveY.pop_front();
+        }
+
+        if (prediction.valid) {
+            stats.predicted.push_back(prediction.mean);
+            stats.actual.push_back(value);
+        }
+    }
+    ++stats.totalCandidates;
+
+    if (configNum == Params::numConfigsPerGen - 1) {
+        reportSurrogateStats(islandNum);
+    }
+}
+
+
+// Report how many candidates the surrogate let through to simulation in the latest generation, and how
+// accurate its predictions were for those candidates (the only ones whose true fitness we know). As the
+// surrogate is only used to rank candidates, the rank correlation matters more than the RMSE.
+void PolyBeeEvolve::reportSurrogateStats(std::size_t islandNum) const
+{
+    const SurrogateStats& stats = m_surrogateStats[islandNum];
+    std::string msg = std::format("isl {} gen {} surrogate simulated {}/{} configs (total {}/{})",
+        islandNum, stats.gen, stats.numSimulated, stats.numCandidates, stats.totalSimulated, stats.totalCandidates);
+
+    const std::size_t n = stats.predicted.size();
+    if (n >= 2) {
+        double sse = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            sse += (stats.predicted[i] - stats.actual[i]) * (stats.predicted[i] - stats.actual[i]);
+        }
+
+        // Spearman rank correlation (ties are ranked arbitrarily)
+        auto ranks = [n](const std::vector<double>& v) {
+            std::vector<std::size_t> order(n);
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&v](std::size_t a, std::size_t b) { return v[a] < v[b]; });
+            std::vector<double> r(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                r[order[i]] = static_cast<double>(i);
+            }
+            return r;
+        };
+        std::vector<double> rp = ranks(stats.predicted);
+        std::vector<double> ra = ranks(stats.actual);
+        double d2 = 0.0;
+        for (std::size_t i = 0; i < n; ++i) {
+            d2 += (rp[i] - ra[i]) * (rp[i] - ra[i]);
+        }
+        double rho = 1.0 - 6.0 * d2 / (static_cast<double>(n) * (static_cast<double>(n) * n - 1.0));
+
+        msg += std::format("; on {} simulated configs RMSE {:.5f}, rank correlation {:.3f}", n, std::sqrt(sse / n), rho);
+    }
+
+    pb::msg_info(msg);
+}
+
+
+// Report how much common random numbers reduced the noise in comparisons between the configurations
+// evaluated on an island in the latest generation. For each pair of configurations (a, b) we compare
+// the variance of the per-trial differences a_k - b_k with var(a) + var(b), which is what the variance
+// of the differences would be if the trials of a and b were independent. The ratio of the two (summed
+// over all pairs) is the factor by which CRN has reduced the variance of the comparisons, so the same
+// selection accuracy could be had with about that fraction of num-trials-per-config.
+void PolyBeeEvolve::reportCrnStats(std::size_t islandNum)
+{
+    CrnStats& stats = m_crnStats[islandNum];
+    const auto& tv = stats.trialValues;
+
+    auto variance = [](const std::vector<double>& v) {
+        if (v.size() < 2) return 0.0;
+        double mean = std::accumulate(v.begin(), v.end(), 0.0) / v.size();
+        double ss = 0.0;
+        for (double x : v) { ss += (x - mean) * (x - mean); }
+        return ss / (v.size() - 1);
+    };
+
+    std::vector<double> vars;
+    vars.reserve(tv.size());
+    for (const auto& v : tv) {
+        vars.push_back(variance(v));
+    }
+
+    double sumVarDiff = 0.0;
+    double sumVarIndep = 0.0;
+    std::size_t numPairs = 0;
+    std::vector<double> diffs;
+
+    for (std::size_t a = 0; a < tv.size(); ++a) {
+        for (std::size_t b = a + 1; b < tv.size(); ++b) {
+            std::size_t n = std::min(tv[a].size(), tv[b].size());
+            diffs.resize(n);
+            for (std::size_t k = 0; k < n; ++k) {
+                diffs[k] = tv[a][k] - tv[b][k];
+            }
+            sumVarDiff += variance(diffs);
+            sumVarIndep += vars[a] + vars[b];
+            ++numPairs;
+        }
+    }
+
+    if (numPairs == 0 || sumVarIndep <= 0.0) {
+        return;
+    }
+
+    stats.sumVarDiff += sumVarDiff;
+    stats.sumVarIndep += sumVarIndep;
+
+    double ratio = sumVarDiff / sumVarIndep;
+    double cumRatio = stats.sumVarDiff / stats.sumVarIndep;
+    pb::msg_info(std::format("isl {} gen {} CRN variance ratio var(a-b)/(var(a)+var(b)) {:.3f} ({:.1f}% reduction over {} pairs "
+        "of the {}/{} configs simulated in full); cumulative {:.3f} ({:.1f}% reduction, equivalent to {:.1f} independent trials per config)",
+        islandNum, stats.gen, ratio, 100.0 * (1.0 - ratio), numPairs, tv.size(), Params::numConfigsPerGen,
+        cumRatio, 100.0 * (1.0 - cumRatio),
+        (cumRatio > 0.0) ? Params::numTrialsPerConfig / cumRatio : 0.0));
+}
+
+
+// The Pareto optimiser used in place of sga when there is more than one objective. Both keep a population
+// of num-configs-per-gen and evaluate that many new candidates each generation, as sga does.
+pagmo::algorithm PolyBeeEvolve::multiObjectiveAlgorithm(unsigned int numGens) const
+{
+    if (Params::evolveMoAlgorithm == "moead") {
+        // weights from a low-discrepancy sequence work with any population size (a grid of weights doesn't),
+        // and the neighbourhood of each weight can't be larger than the rest of the population
+        auto neighbours = static_cast<pagmo::pop_size_t>(std::min(20, Params::numConfigsPerGen - 1));
+        return pagmo::algorithm{pagmo::moead(numGens, "low discrepancy", "tchebycheff", neighbours)};
+    }
+    return pagmo::algorithm{pagmo::nsga2(numGens)};
+}
+
+
 void PolyBeeEvolve::evolveSinglePop() {
     // 1 - Instantiate a pagmo problem constructing it from a UDP
     // (user defined problem).
@@ -682,7 +1159,7 @@ void PolyBeeEvolve::evolveSinglePop() {
     //pagmo::algorithm algo{pagmo::sade(numGensForAlgo)};   // not suitable for stochastic problems
     //pagmo::algorithm algo {pagmo::gaco(numGensForAlgo)};
     //pagmo::algorithm algo {pagmo::pso_gen(numGensForAlgo)};
-    pagmo::algorithm algo {pagmo::sga(numGensForAlgo)};
+    pagmo::algorithm algo = Params::multiObjective() ? multiObjectiveAlgorithm(numGensForAlgo) : pagmo::algorithm{pagmo::sga(numGensForAlgo)};
     //pagmo::algorithm algo {pagmo::cmaes(numGensForAlgo)}; // produces an error (tries to use side=5) at end of first generation
     //pagmo::algorithm algo {pagmo::xnes(numGensForAlgo)};  // produces an error (tries to use side=5) at end of first generation
 
@@ -698,7 +1175,22 @@ void PolyBeeEvolve::evolveSinglePop() {
     pagmo::population pop{prob, static_cast<unsigned int>(Params::numConfigsPerGen), pop_seed};
 
     // 4 - Evolve the population
-    pop = algo.evolve(pop);
+    if (isEmdSwitchGen(Params::evolveEmdExactGen)) {
+        // evolve up to the generation at which the EMD becomes exact, re-evaluate the population, then
+        // evolve it for the remaining generations
+        int numGensBeforeSwitch = Params::evolveEmdExactGen - 1;
+        int numGensAfterSwitch = numGensForAlgo - numGensBeforeSwitch;
+        pagmo::algorithm algoBefore = Params::multiObjective() ? multiObjectiveAlgorithm(numGensBeforeSwitch) : pagmo::algorithm{pagmo::sga(numGensBeforeSwitch)};
+        algoBefore.set_seed(algo_seed);
+        pop = algoBefore.evolve(pop);
+        pop = rescoredWithExactEmd(pop, 0);
+        algo = Params::multiObjective() ? multiObjectiveAlgorithm(numGensAfterSwitch) : pagmo::algorithm{pagmo::sga(numGensAfterSwitch)};
+        algo.set_seed(algo_seed + 1);
+        pop = algo.evolve(pop);
+    }
+    else {
+        pop = algo.evolve(pop);
+    }
 
     // 5 - Output the population
     writeResultsFile(algo, pop, true);
@@ -735,70 +1227,7 @@ void PolyBeeEvolve::evolveArchipelago()
     arc.set_migrant_handling(pagmo::migrant_handling::evict);
 
     // 3. Create islands and add them to the archipelago
-    for (size_t i = 0; i < Params::numIslands; ++i)
-    {
-        if (i > 0) {
-            // Create a copy of the master PolyBeeCore for this island
-            // First, create a unique seed string for this island, but derived from the master RNG seed string
-            std::string islandSeedStr = Params::strRngSeed + std::to_string(i);
-            // NB Indices in this vector are offset by 1 compared to island number (island 0 is the master PolyBeeCore) -
-            // this is handled by the polyBeeCore() method
-            m_islandPolyBeeCores.push_back(std::make_unique<PolyBeeCore>(m_masterPolyBeeCore, islandSeedStr));
-        }
-
-        // 3a - Instantiate a pagmo problem constructing it from a UDP (user defined problem).
-        pagmo::problem prob{PolyBeeOptimization{this, Params::evolveSpec, i}};
-
-        // 3b - Instantiate a pagmo algorithm
-        pagmo::algorithm algo;
-
-        if (!Params::useDiverseAlgorithms) {
-            algo = pagmo::algorithm{ pagmo::sga(1) }; // we will be evolving one generation at a time in the main loop below
-        }
-        else {
-            switch (i % 3) {
-            case 0:
-                algo = pagmo::algorithm{ pagmo::sga(1) }; // we will be evolving one generation at a time in the main loop below
-                break;
-            case 1:
-                algo = pagmo::algorithm{ pagmo::pso_gen(1) };
-                break;
-            case 2:
-                algo = pagmo::algorithm{ pagmo::gaco(1, static_cast<unsigned int>(Params::numConfigsPerGen / 5)) }; // smaller population for gaco
-                break;
-            default:
-                pb::msg_error_and_exit("PolyBeeEvolve::evolveArchipelago - unexpected algorithm selection case");
-            }
-        }
-
-        // ensure that the Pagmo RNG seed is determined by our own RNG, so runs can be reproduced
-        // by just ensuring we use the same seed for our own RNG
-        unsigned int algo_seed = static_cast<unsigned int>(m_masterPolyBeeCore.m_uniformIntDistrib(m_masterPolyBeeCore.m_rngEngine));
-        algo.set_seed(algo_seed);
-
-        // 3c - Instantiate a population
-        // (again, taking care to seed the population RNG from our own RNG)
-        unsigned int pop_seed = static_cast<unsigned int>(m_masterPolyBeeCore.m_uniformIntDistrib(m_masterPolyBeeCore.m_rngEngine));
-
-        // Note - when we create the population in the following line, an initial round of fitness evaluations
-        // will be performed for all individuals in the population. We'll refer to this as generation 0
-        pagmo::population pop{prob, static_cast<unsigned int>(Params::numConfigsPerGen), pop_seed};
-
-        // 3d - Add the island to the archipelago
-        //
-        // Selection policy options are:
-        // * Best (pagmo::select_best) - selects best individuals for migration
-        // * Random (select_random) - selects random individuals for migration regardless of fitness
-        //
-        // Replacement policy options are:
-        // * Fair (pagmo::fair_replace) - replaces worst individuals only if migrant is better
-        // * Random (replace_random) - replaces randomly selected individuals regardless of fitness
-        arc.push_back(pagmo::island{algo,
-            pop,
-            replace_random{m_masterPolyBeeCore, static_cast<pagmo::pop_size_t>(Params::migrationNumReplace)}, // randomly selected individuals can be replaced by migrants
-            select_random{m_masterPolyBeeCore, static_cast<pagmo::pop_size_t>(Params::migrationNumSelect)}   // randomly selected individuals can be selected for migration
-        });
-    }
+    addIslandsToArchipelago(arc);
 
     // Print connections for ring
     if (!Params::bCommandLineQuiet) {
@@ -837,6 +1266,11 @@ void PolyBeeEvolve::evolveArchipelago()
         // Phase 1: Local evolution (no migration)
         pb::msg_info(std::format("  Running {} local generations...", numGensBetweenMigrations));
         for (int localGen = 0; localGen < numGensBetweenMigrations; ++localGen) {
+            if (isEmdSwitchGen(globalGen)) {
+                for (size_t i = 0; i < arc.size(); ++i) {
+                    arc[i].set_population(rescoredWithExactEmd(arc[i].get_population(), i));
+                }
+            }
             for (size_t i = 0; i < arc.size(); ++i) {
                 pb::msg_info(std::format("    Initiating generation {} on island {}...", globalGen, i));
                 arc[i].evolve();
@@ -856,6 +1290,11 @@ void PolyBeeEvolve::evolveArchipelago()
         // Phase 2: Migration event
         if (!allDone) {
             pb::msg_info("  Performing a generation with migration...");
+            if (isEmdSwitchGen(globalGen)) {
+                for (size_t i = 0; i < arc.size(); ++i) {
+                    arc[i].set_population(rescoredWithExactEmd(arc[i].get_population(), i));
+                }
+            }
             arc.evolve();
             arc.wait_check();
             showBestIndividuals(arc, globalGen);
@@ -880,41 +1319,627 @@ void PolyBeeEvolve::evolveArchipelago()
 }
 
 
-void PolyBeeEvolve::showBestIndividuals(const pagmo::archipelago& arc, int gen) const
+// Create Params::numIslands islands, each with its own problem, algorithm and population, and add them
+// to the archipelago. Cores for islands other than island 0 are created here too.
+//
+// In multi-process island mode each of the numProcs processes calls this with its own procId, and only
+// creates the islands it hosts (those with islandNum % numProcs == procId). The algorithm and population
+// seeds are still drawn from the master RNG for every island, so each island is seeded exactly as it
+// would be if all islands were run in a single process. Returns the numbers of the islands created.
+std::vector<std::size_t> PolyBeeEvolve::addIslandsToArchipelago(pagmo::archipelago& arc, int numProcs, int procId)
 {
-    double best_f = std::numeric_limits<double>::max();
-    size_t best_i = 0;
-
-    pb::msg_info(std::format("Generation {} best individuals:", gen));
+    std::vector<std::size_t> islandNums;
 
-    for (size_t i = 0; i < arc.size(); ++i)
+    for (size_t i = 0; i < Params::numIslands; ++i)
     {
-        const auto* pPBO = arc[i].get_population().get_problem().extract<PolyBeeOptimization>();
-        assert(pPBO != nullptr);
-
-        double island_best = arc[i].get_population().champion_f()[0];
-        pb::msg_info(std::format("  Best fitness for island {}: {:.5f}", i, island_best));
-
-        auto champ = arc[i].get_population().champion_x();
-        std::string best_indiv;
-        for (size_t i = 0; i < champ.size(); ++i) {
-            if (i > 0) { best_indiv += ", "; }
-            best_indiv += (i < pPBO->m_numFloatVars) ? std::format("{:.5f}", champ[i]) : std::format("{}", champ[i]);
-        }
-        pb::msg_info(std::format("  Best individual for island {}: {}", i, best_indiv));
+        const bool hosted = (static_cast<int>(i % numProcs) == procId);
 
-        if (island_best < best_f) {
-            best_f = island_best;
-            best_i = i;
-            champ = arc[i].get_population().champion_x();
+        if (i > 0) {
+            if (hosted) {
+                // Create a copy of the master PolyBeeCore for this island
+                // First, create a unique seed string for this island, but derived from the master RNG seed string
+                std::string islandSeedStr = Params::strRngSeed + std::to_string(i);
+                // NB Indices in this vector are offset by 1 compared to island number (island 0 is the master PolyBeeCore) -
+                // this is handled by the polyBeeCore() method.
+                // The core is created on a thread pinned to the island's CPUs, so that its environment is allocated
+                // on the NUMA node it will be run on (when a thread-affinity policy is set)
+                ThreadAffinity::runOnPinnedThread(i, [&]() {
+                    m_islandPolyBeeCores.push_back(std::make_unique<PolyBeeCore>(m_masterPolyBeeCore, islandSeedStr, i));
+                });
+            }
+            else {
+                m_islandPolyBeeCores.push_back(nullptr); // this island is hosted by another process
+            }
         }
-    }
 
-    pb::msg_info(std::format("  Overall best fitness: {:.5f} (island {})", best_f, best_i));
-}
+        // 3a - Instantiate a pagmo problem constructing it from a UDP (user defined problem).
+        pagmo::problem prob{PolyBeeOptimization{this, Params::evolveSpec, i}};
 
+        // 3b - Instantiate a pagmo algorithm
+        pagmo::algorithm algo;
 
-void PolyBeeEvolve::writeResultsFileArchipelago(const pagmo::archipelago& arc, bool alsoToStdout) const
+        if (Params::multiObjective()) {
+            algo = multiObjectiveAlgorithm(1); // again evolving one generation at a time
+        }
+        else if (!Params::useDiverseAlgorithms) {
+            algo = pagmo::algorithm{ pagmo::sga(1) }; // we will be evolving one generation at a time in the main loop below
+        }
+        else {
+            switch (i % 3) {
+            case 0:
+                algo = pagmo::algorithm{ pagmo::sga(1) }; // we will be evolving one generation at a time in the main loop below
+                break;
+            case 1:
+                algo = pagmo::algorithm{ pagmo::pso_gen(1) };
+                break;
+            case 2:
+                algo = pagmo::algorithm{ pagmo::gaco(1, static_cast<unsigned int>(Params::numConfigsPerGen / 5)) }; // smaller population for gaco
+                break;
+            default:
+                pb::msg_error_and_exit("PolyBeeEvolve::evolveArchipelago - unexpected algorithm selection case");
+            }
+        }
+
+        // ensure that the Pagmo RNG seed is determined by our own RNG, so runs can be reproduced
+        // by just ensuring we use the same seed for our own RNG
+        unsigned int algo_seed = static_cast<unsigned int>(m_masterPolyBeeCore.m_uniformIntDistrib(m_masterPolyBeeCore.m_rngEngine));
+        algo.set_seed(algo_seed);
+
+        // 3c - Instantiate a population
+        // (again, taking care to seed the population RNG from our own RNG)
+        unsigned int pop_seed = static_cast<unsigned int>(m_masterPolyBeeCore.m_uniformIntDistrib(m_masterPolyBeeCore.m_rngEngine));
+
+        if (!hosted) {
+            continue;
+        }
+
+        // Note - when we create the population in the following line, an initial round of fitness evaluations
+        // will be performed for all individuals in the population. We'll refer to this as generation 0
+        pagmo::population pop{prob, static_cast<unsigned int>(Params::numConfigsPerGen), pop_seed};
+
+        // 3d - Add the island to the archipelago
+        //
+        // Selection policy options are:
+        // * Best (pagmo::select_best) - selects best individuals for migration
+        // * Random (select_random) - selects random individuals for migration regardless of fitness
+        //
+        // Replacement policy options are:
+        // * Fair (pagmo::fair_replace) - replaces worst individuals only if migrant is better
+        // * Random (replace_random) - replaces randomly selected individuals regardless of fitness
+        arc.push_back(pagmo::island{algo,
+            pop,
+            replace_random{m_masterPolyBeeCore, static_cast<pagmo::pop_size_t>(Params::migrationNumReplace)}, // randomly selected individuals can be replaced by migrants
+            select_random{m_masterPolyBeeCore, static_cast<pagmo::pop_size_t>(Params::migrationNumSelect)}   // randomly selected individuals can be selected for migration
+        });
+        islandNums.push_back(i);
+    }
+
+    return islandNums;
+}
+
+
+// Asynchronous version of evolveArchipelago() (used when async-islands=true).
+// Each island is driven by its own thread and evolves at its own pace, so a fast island never sits idle
+// waiting for a slow one (e.g. when use-diverse-algorithms=true mixes sga, pso_gen and gaco). Pagmo's own
+// migration machinery is disabled (the archipelago topology is left unconnected); instead, whenever an
+// island reaches one of its own migration milestones it exchanges individuals with its ring neighbours
+// via a shared MigrantPool.
+void PolyBeeEvolve::evolveArchipelagoAsync()
+{
+    assert(Params::numIslands > 0);
+    assert(Params::migrationPeriod > 0);
+
+    // 1. Create an archipelago with multiple islands, with no pagmo-managed migration between them
+    pagmo::archipelago arc;
+    arc.set_topology(pagmo::topology{pagmo::unconnected{}});
+
+    // 2. Create islands and add them to the archipelago
+    addIslandsToArchipelago(arc);
+
+    MigrantPool pool(arc.size());
+
+    if (!Params::bCommandLineQuiet) {
+        std::string msg = "Asynchronous island info:\n";
+        for (size_t i = 0; i < arc.size(); ++i) {
+            msg += std::format("Island {} [using alg: {}] sends migrants to:\n", i, arc[i].get_algorithm().get_name());
+            for (auto dest : pool.ringNeighbours(i)) {
+                msg += std::format(" Island {} ", dest);
+            }
+            msg += "\n";
+        }
+        pb::msg_info(msg);
+    }
+
+    // 3. Evolve each island in its own thread until it has completed all of its generations
+    std::vector<int> islandGens(arc.size(), 0);
+    std::vector<std::thread> threads;
+    threads.reserve(arc.size());
+
+    for (size_t i = 0; i < arc.size(); ++i) {
+        threads.emplace_back([this, &arc, &pool, &islandGens, i]() {
+            evolveIslandAsync(arc[i], i, pool, islandGens[i]);
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    // 4 - Output the population
+    writeResultsFileArchipelago(arc, false, islandGens);
+}
+
+
+// Multi-process version of evolveArchipelago() (used when island-procs > 0).
+// The islands are shared out round-robin among Params::islandProcs worker processes (island i runs on worker
+// i % island-procs). Within each worker its islands evolve in lock-step, as in evolveArchipelago(), but
+// migration between all islands is routed through the coordinator process, which reproduces the ring
+// topology used by evolveArchipelago(). With the default "unix" transport the workers are forked from
+// this process; with the "mpi" transport every MPI rank runs this method and rank 0 is the coordinator.
+void PolyBeeEvolve::evolveMultiProcess()
+{
+    assert(Params::numIslands > 1);
+    assert(Params::islandProcs > 0);
+    assert(Params::migrationPeriod > 0);
+
+    auto transport = IslandTransport::create(Params::islandTransport, Params::islandProcs);
+
+    if (transport->isCoordinator()) {
+        runIslandCoordinator(*transport);
+    } else {
+        runIslandWorker(*transport);
+
+        // The worker's results have all gone to the coordinator, which reports the run, so exit here
+        // rather than returning to main() as if this process were the coordinator. The transport is
+        // closed first (so an MPI rank still finalises), but no other teardown is needed.
+        transport.reset();
+        std::cout.flush();
+        std::cerr.flush();
+        std::fflush(nullptr);
+        _exit(0);
+    }
+}
+
+
+void PolyBeeEvolve::runIslandCoordinator(IslandTransport& transport)
+{
+    const std::size_t numIslands = static_cast<std::size_t>(Params::numIslands);
+    const int numWorkers = transport.numWorkers();
+    MigrantPool pool(numIslands);
+
+    // number of islands hosted by each worker
+    std::vector<int> numHosted(numWorkers, 0);
+    for (std::size_t i = 0; i < numIslands; ++i) {
+        ++numHosted[i % numWorkers];
+    }
+
+    if (!Params::bCommandLineQuiet) {
+        std::string msg = std::format("Multi-process island info (transport: {}):\n", transport.name());
+        for (std::size_t i = 0; i < numIslands; ++i) {
+            msg += std::format("Island {} [on worker {}] sends migrants to:\n", i, i % numWorkers);
+            for (auto dest : pool.ringNeighbours(i)) {
+                msg += std::format(" Island {} ", dest);
+            }
+            msg += "\n";
+        }
+        pb::msg_info(msg);
+    }
+
+    // Route migrants at each migration event: collect the emigrants from every island, share
+    // them out among the ring neighbours, then send each island whatever is destined for it
+    for (int gen = 1; gen < Params::numGenerations; ++gen) {
+        if (!isMigrationGen(gen)) {
+            continue;
+        }
+
+        for (int w = 0; w < numWorkers; ++w) {
+            for (int k = 0; k < numHosted[w]; ++k) {
+                IslandMessage msg = transport.receiveFromWorker(w);
+                if (msg.type != IslandMessageType::EMIGRANTS || msg.gen != gen) {
+                    pb::msg_error_and_exit(std::format("Unexpected message from island worker {} at generation {}", w, gen));
+                }
+                auto destinations = pool.postToNeighbours(msg.islandNum, msg.inds);
+                logEmigration(msg.inds, destinations, msg.islandNum, gen);
+            }
+        }
+
+        for (std::size_t i = 0; i < numIslands; ++i) {
+            IslandMessage msg;
+            msg.type = IslandMessageType::IMMIGRANTS;
+            msg.islandNum = static_cast<std::uint32_t>(i);
+            msg.gen = gen;
+            msg.inds = pool.collect(i);
+            transport.sendToWorker(static_cast<int>(i % numWorkers), msg);
+        }
+    }
+
+    // Collect the final population of every island
+    std::vector<IslandMessage> results(numIslands);
+    for (int w = 0; w < numWorkers; ++w) {
+        for (int k = 0; k < numHosted[w]; ++k) {
+            IslandMessage msg = transport.receiveFromWorker(w);
+            if (msg.type != IslandMessageType::RESULT || msg.islandNum >= numIslands) {
+                pb::msg_error_and_exit(std::format("Unexpected message from island worker {} at end of run", w));
+            }
+            m_workerFitnessCallCount += msg.numFitnessCalls;
+            m_workerEpisodeCount += msg.numEpisodes;
+            results[msg.islandNum] = std::move(msg);
+        }
+    }
+
+    writeResultsFileMultiProcess(results, false);
+}
+
+
+void PolyBeeEvolve::runIslandWorker(IslandTransport& transport)
+{
+    // 1. Create the islands hosted by this worker, with no pagmo-managed migration between them
+    pagmo::archipelago arc;
+    arc.set_topology(pagmo::topology{pagmo::unconnected{}});
+    std::vector<std::size_t> islandNums = addIslandsToArchipelago(arc, transport.numWorkers(), transport.workerId());
+
+    pb::msg_info(std::format("Island worker {} hosting {} islands", transport.workerId(), islandNums.size()));
+
+    // 2. Evolve the islands, exchanging migrants with the coordinator at each migration event
+    for (int gen = 1; gen < Params::numGenerations; ++gen) {
+        if (isEmdSwitchGen(gen)) {
+            for (size_t k = 0; k < arc.size(); ++k) {
+                arc[k].set_population(rescoredWithExactEmd(arc[k].get_population(), islandNums[k]));
+            }
+        }
+        for (size_t k = 0; k < arc.size(); ++k) {
+            arc[k].evolve();
+        }
+        for (size_t k = 0; k < arc.size(); ++k) {
+            arc[k].wait_check();
+        }
+        for (size_t k = 0; k < arc.size(); ++k) {
+            showBestIndividual(arc[k].get_population(), islandNums[k], gen);
+        }
+
+        if (!isMigrationGen(gen)) {
+            continue;
+        }
+
+        for (size_t k = 0; k < arc.size(); ++k) {
+            IslandMessage msg;
+            msg.type = IslandMessageType::EMIGRANTS;
+            msg.islandNum = static_cast<std::uint32_t>(islandNums[k]);
+            msg.gen = gen;
+            msg.inds = selectEmigrants(arc[k].get_population(), islandNums[k]);
+            transport.sendToCoordinator(msg);
+        }
+
+        for (size_t n = 0; n < arc.size(); ++n) {
+            IslandMessage msg = transport.receiveFromCoordinator();
+            auto it = std::find(islandNums.begin(), islandNums.end(), msg.islandNum);
+            if (msg.type != IslandMessageType::IMMIGRANTS || msg.gen != gen || it == islandNums.end()) {
+                pb::msg_error_and_exit(std::format("Island worker {} received an unexpected message at generation {}",
+                    transport.workerId(), gen));
+            }
+            if (!std::get<0>(msg.inds).empty()) {
+                std::size_t k = static_cast<std::size_t>(it - islandNums.begin());
+                int numReplaced = receiveImmigrants(arc[k], islandNums[k], msg.inds);
+                pb::msg_info(std::format("  Island {} received {} migrants at generation {} ({} individuals replaced)",
+                    islandNums[k], std::get<0>(msg.inds).size(), gen, numReplaced));
+            }
+        }
+    }
+
+    // 3. Send the final population of each island back to the coordinator
+    for (size_t k = 0; k < arc.size(); ++k) {
+        const auto pop = arc[k].get_population();
+        IslandMessage msg;
+        msg.type = IslandMessageType::RESULT;
+        msg.islandNum = static_cast<std::uint32_t>(islandNums[k]);
+        msg.gen = Params::numGenerations - 1;
+        msg.text = arc[k].get_algorithm().get_name();
+        msg.inds = {pop.get_ID(), pop.get_x(), pop.get_f()};
+        msg.numFitnessCalls = polyBeeCore(islandNums[k]).fitnessCallCount();
+        msg.numEpisodes = polyBeeCore(islandNums[k]).episodeCount();
+        if (!Params::multiObjective()) {
+            // (there is no single champion with multiple objectives, and the coordinator finds the Pareto front itself)
+            msg.championX = pop.champion_x();
+            msg.championF = pop.champion_f();
+        }
+        transport.sendToCoordinator(msg);
+    }
+}
+
+
+// Thread function for asynchronous island mode: evolve a single island one generation at a time,
+// performing a migration exchange with the MigrantPool every Params::migrationPeriod generations
+void PolyBeeEvolve::evolveIslandAsync(pagmo::island& isl, std::size_t islandNum, MigrantPool& pool, int& gensCompleted)
+{
+    auto startTime = std::chrono::steady_clock::now();
+
+    try {
+        // start at generation 1 (generation 0 is the initial population evaluation)
+        for (int gen = 1; gen < Params::numGenerations; ++gen) {
+            // (no exact-EMD switch here, as evolve-emd-approx with a switch generation is rejected in async mode)
+            isl.evolve();
+            isl.wait_check();
+            gensCompleted = gen;
+
+            showBestIndividual(isl.get_population(), islandNum, gen);
+
+            if (isMigrationGen(gen)) {
+                migrateAsync(isl, islandNum, gen, pool);
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        pb::msg_error_and_exit(std::format("Island {} failed during asynchronous evolution: {}", islandNum, e.what()));
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    pb::msg_info(std::format("Island {} completed {} generations in {:.2f}s ({:.3f} generations/s)",
+        islandNum, gensCompleted, elapsed.count(), (elapsed.count() > 0.0) ? gensCompleted / elapsed.count() : 0.0));
+}
+
+
+// Perform one asynchronous migration event for the specified island: post emigrants to the pool for the
+// island's ring neighbours, then replace individuals with whatever migrants have arrived in its own inbox.
+void PolyBeeEvolve::migrateAsync(pagmo::island& isl, std::size_t islandNum, int gen, MigrantPool& pool)
+{
+    auto emigrants = selectEmigrants(isl.get_population(), islandNum);
+    auto destinations = pool.postToNeighbours(islandNum, emigrants);
+    logEmigration(emigrants, destinations, islandNum, gen);
+
+    // Immigration: whatever has arrived so far from other islands replaces randomly selected individuals
+    auto immigrants = pool.collect(islandNum);
+    if (!std::get<0>(immigrants).empty()) {
+        int numReplaced = receiveImmigrants(isl, islandNum, immigrants);
+        pb::msg_info(std::format("  Island {} received {} migrants at generation {} ({} individuals replaced)",
+            islandNum, std::get<0>(immigrants).size(), gen, numReplaced));
+    }
+}
+
+
+// Select individuals from the population of the specified island for emigration, using the same random
+// selection policy as the synchronous archipelago. This is only called between generations, when the
+// island's PolyBeeCore is not in use by its fitness evaluations, so the policy uses that core's RNG
+// rather than the master's.
+pagmo::individuals_group_t PolyBeeEvolve::selectEmigrants(const pagmo::population& pop, std::size_t islandNum)
+{
+    const pagmo::problem& prob = pop.get_problem();
+    pagmo::individuals_group_t inds{pop.get_ID(), pop.get_x(), pop.get_f()};
+
+    select_random selector{polyBeeCore(islandNum), static_cast<pagmo::pop_size_t>(Params::migrationNumSelect)};
+    return selector.select(inds, prob.get_nx(), prob.get_nix(), prob.get_nobj(),
+        prob.get_nec(), prob.get_nic(), prob.get_c_tol());
+}
+
+
+// Replace randomly selected individuals on the island with the given immigrants, using the same random
+// replacement policy as the synchronous archipelago. Returns the number of individuals replaced.
+int PolyBeeEvolve::receiveImmigrants(pagmo::island& isl, std::size_t islandNum, const pagmo::individuals_group_t& immigrants)
+{
+    pagmo::population pop = isl.get_population();
+    const pagmo::problem& prob = pop.get_problem();
+    pagmo::individuals_group_t inds{pop.get_ID(), pop.get_x(), pop.get_f()};
+
+    replace_random replacer{polyBeeCore(islandNum), static_cast<pagmo::pop_size_t>(Params::migrationNumReplace)};
+    auto replaced = replacer.replace(inds, prob.get_nx(), prob.get_nix(), prob.get_nobj(),
+        prob.get_nec(), prob.get_nic(), prob.get_c_tol(), immigrants);
+
+    const auto& [new_ids, new_dvs, new_fvs] = replaced;
+    int numReplaced = 0;
+    for (pagmo::pop_size_t k = 0; k < new_ids.size(); ++k) {
+        if (new_ids[k] != pop.get_ID()[k]) {
+            pop.set_xf(k, new_dvs[k], new_fvs[k]);
+            ++numReplaced;
+        }
+    }
+    isl.set_population(pop);
+
+    return numReplaced;
+}
+
+
+void PolyBeeEvolve::logEmigration(const pagmo::individuals_group_t& emigrants, const std::vector<std::size_t>& destinations,
+    std::size_t srcIsland, int gen) const
+{
+    const auto& [ids, dvs, fvs] = emigrants;
+    for (std::size_t k = 0; k < ids.size(); ++k) {
+        pb::msg_info(std::format("  At generation {} individual {} (fitness {:.5f}) migrated from Island {} -> {}",
+            gen, ids[k], fvs[k][0], srcIsland, destinations[k]));
+    }
+}
+
+
+// Generations at the end of which a migration event takes place in the asynchronous and multi-process
+// island modes (there is no migration after the final generation)
+bool PolyBeeEvolve::isMigrationGen(int gen) const
+{
+    return (gen % Params::migrationPeriod == 0) && (gen + 1 < Params::numGenerations);
+}
+
+
+// Whether gen is the generation at which the EMD objective switches from the approximation selected by
+// evolve-emd-approx to the exact EMD, so that the population has to be re-evaluated before it is evolved
+bool PolyBeeEvolve::isEmdSwitchGen(int gen) const
+{
+    return Params::evolveEmdApprox != EmdBackend::EXACT &&
+        std::find(Params::evolveObjectives.begin(), Params::evolveObjectives.end(),
+            EvolveObjective::EMD_TO_TARGET_HEATMAP) != Params::evolveObjectives.end() &&
+        gen == Params::evolveEmdExactGen && gen > 0 && gen < Params::numGenerations;
+}
+
+
+// Re-evaluate every individual of a population at the generation where the EMD becomes exact. Otherwise
+// the individuals carried over from earlier generations would keep their approximate fitness, and as an
+// approximation may be biased (sliced is a lower bound, sinkhorn an upper bound), they would either
+// dominate or be dominated by the new ones. A fresh population is built, rather than resetting each
+// individual, so that its champion is also one found with the exact EMD.
+//
+// The evaluations are repeats of the generation's first few evaluations, so the island's evaluation count
+// is put back afterwards to keep the generation and configuration numbers derived from it consistent. For
+// the same reason the core is marked as rescoring while they run, so that fitness() leaves them out of the
+// generation's CRN statistics and episode arena report, which would otherwise be made twice.
+pagmo::population PolyBeeEvolve::rescoredWithExactEmd(const pagmo::population& pop, std::size_t islandNum)
+{
+    PolyBeeCore& core = polyBeeCore(islandNum);
+    const std::size_t savedEvaluationCount = core.evaluationCount();
+
+    pb::msg_info(std::format("Island {}: re-evaluating {} individuals with the exact EMD at generation {}",
+        islandNum, pop.size(), Params::evolveEmdExactGen));
+
+    pagmo::population rescored{pop.get_problem(), 0u, pop.get_seed()};
+    core.setRescoring(true);
+    for (const auto& x : pop.get_x()) {
+        rescored.push_back(x);
+    }
+    core.setRescoring(false);
+
+    core.setEvaluationCount(savedEvaluationCount);
+    return rescored;
+}
+
+
+MigrantPool::MigrantPool(std::size_t numIslands) : m_inboxes(numIslands)
+{}
+
+
+void MigrantPool::post(std::size_t destIsland, const pagmo::individuals_group_t& migrants)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    assert(destIsland < m_inboxes.size());
+    auto& [ids, dvs, fvs] = m_inboxes[destIsland];
+    const auto& [mig_ids, mig_dvs, mig_fvs] = migrants;
+    ids.insert(ids.end(), mig_ids.begin(), mig_ids.end());
+    dvs.insert(dvs.end(), mig_dvs.begin(), mig_dvs.end());
+    fvs.insert(fvs.end(), mig_fvs.begin(), mig_fvs.end());
+}
+
+
+pagmo::individuals_group_t MigrantPool::collect(std::size_t islandNum)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    assert(islandNum < m_inboxes.size());
+    pagmo::individuals_group_t migrants;
+    std::swap(migrants, m_inboxes[islandNum]);
+    return migrants;
+}
+
+
+std::vector<std::size_t> MigrantPool::postToNeighbours(std::size_t srcIsland, const pagmo::individuals_group_t& emigrants)
+{
+    const auto neighbours = ringNeighbours(srcIsland);
+    const auto& [ids, dvs, fvs] = emigrants;
+    std::vector<std::size_t> destinations;
+
+    if (neighbours.empty()) {
+        return destinations;
+    }
+
+    std::vector<pagmo::individuals_group_t> outgoing(neighbours.size());
+    for (std::size_t k = 0; k < ids.size(); ++k) {
+        std::size_t n = k % neighbours.size();
+        auto& [out_ids, out_dvs, out_fvs] = outgoing[n];
+        out_ids.push_back(ids[k]);
+        out_dvs.push_back(dvs[k]);
+        out_fvs.push_back(fvs[k]);
+        destinations.push_back(neighbours[n]);
+    }
+    for (std::size_t n = 0; n < neighbours.size(); ++n) {
+        if (!std::get<0>(outgoing[n]).empty()) {
+            post(neighbours[n], outgoing[n]);
+        }
+    }
+
+    return destinations;
+}
+
+
+std::vector<std::size_t> MigrantPool::ringNeighbours(std::size_t islandNum) const
+{
+    // the same bidirectional ring as pagmo::ring: island i is connected to islands i-1 and i+1
+    const std::size_t n = m_inboxes.size();
+    if (n <= 1) {
+        return {};
+    }
+    std::size_t next = (islandNum + 1) % n;
+    std::size_t prev = (islandNum + n - 1) % n;
+    if (next == prev) {
+        return {next};
+    }
+    return {next, prev};
+}
+
+
+void PolyBeeEvolve::showBestIndividuals(const pagmo::archipelago& arc, int gen) const
+{
+    if (Params::multiObjective()) {
+        // there is no single best individual, so summarise each island's Pareto front and the combined one
+        pb::msg_info(std::format("Generation {} Pareto fronts:", gen));
+        std::vector<pagmo::vector_double> allFvs;
+        for (size_t i = 0; i < arc.size(); ++i) {
+            const auto fvs = arc[i].get_population().get_f();
+            pb::msg_info(std::format("  Island {}: {}", i, paretoSummary(fvs)));
+            allFvs.insert(allFvs.end(), fvs.begin(), fvs.end());
+        }
+        pb::msg_info(std::format("  Overall: {}", paretoSummary(allFvs)));
+        return;
+    }
+
+    double best_f = std::numeric_limits<double>::max();
+    size_t best_i = 0;
+
+    pb::msg_info(std::format("Generation {} best individuals:", gen));
+
+    for (size_t i = 0; i < arc.size(); ++i)
+    {
+        const auto* pPBO = arc[i].get_population().get_problem().extract<PolyBeeOptimization>();
+        assert(pPBO != nullptr);
+
+        double island_best = arc[i].get_population().champion_f()[0];
+        pb::msg_info(std::format("  Best fitness for island {}: {:.5f}", i, island_best));
+
+        auto champ = arc[i].get_population().champion_x();
+        std::string best_indiv;
+        for (size_t i = 0; i < champ.size(); ++i) {
+            if (i > 0) { best_indiv += ", "; }
+            best_indiv += (i < pPBO->m_numFloatVars) ? std::format("{:.5f}", champ[i]) : std::format("{}", champ[i]);
+        }
+        pb::msg_info(std::format("  Best individual for island {}: {}", i, best_indiv));
+
+        if (island_best < best_f) {
+            best_f = island_best;
+            best_i = i;
+            champ = arc[i].get_population().champion_x();
+        }
+    }
+
+    pb::msg_info(std::format("  Overall best fitness: {:.5f} (island {})", best_f, best_i));
+}
+
+
+void PolyBeeEvolve::showBestIndividual(const pagmo::population& pop, std::size_t islandNum, int gen) const
+{
+    if (Params::multiObjective()) {
+        pb::msg_info(std::format("Island {} generation {} {}", islandNum, gen, paretoSummary(pop.get_f())));
+        return;
+    }
+
+    const auto* pPBO = pop.get_problem().extract<PolyBeeOptimization>();
+    assert(pPBO != nullptr);
+
+    auto champ = pop.champion_x();
+    std::string best_indiv;
+    for (size_t i = 0; i < champ.size(); ++i) {
+        if (i > 0) { best_indiv += ", "; }
+        best_indiv += (i < pPBO->m_numFloatVars) ? std::format("{:.5f}", champ[i]) : std::format("{}", champ[i]);
+    }
+
+    pb::msg_info(std::format("Island {} generation {} best fitness: {:.5f}", islandNum, gen, pop.champion_f()[0]));
+    pb::msg_info(std::format("Island {} generation {} best individual: {}", islandNum, gen, best_indiv));
+}
+
+
+void PolyBeeEvolve::writeResultsFileArchipelago(const pagmo::archipelago& arc, bool alsoToStdout,
+    const std::vector<int>& islandGens) const
 {
     // write evolution results to file
     std::string resultsFilename = std::format("{0}/{1}evo-results-{2}.txt",
@@ -931,25 +1956,28 @@ void PolyBeeEvolve::writeResultsFileArchipelago(const pagmo::archipelago& arc, b
                     resultsFilename));
         }
         std::cout << "~~~~~~~~~~ EVOLUTION RESULTS ~~~~~~~~~~" << std::endl;
-        writeResultsFileArchipelagoHelper(std::cout, arc);
+        writeResultsFileArchipelagoHelper(std::cout, arc, islandGens);
     }
     else {
-        writeResultsFileArchipelagoHelper(resultsFile, arc);
+        writeResultsFileArchipelagoHelper(resultsFile, arc, islandGens);
         resultsFile.close();
         pb::msg_info(std::format("Evolution results written to file: {}", resultsFilename));
         if (alsoToStdout) {
             std::cout << "~~~~~~~~~~ EVOLUTION RESULTS ~~~~~~~~~~" << std::endl;
-            writeResultsFileArchipelagoHelper(std::cout, arc);
+            writeResultsFileArchipelagoHelper(std::cout, arc, islandGens);
         }
     }
 }
 
 
 // Helper method to write results to a given output stream
-void PolyBeeEvolve::writeResultsFileArchipelagoHelper(std::ostream& os, const pagmo::archipelago& arc) const
+void PolyBeeEvolve::writeResultsFileArchipelagoHelper(std::ostream& os, const pagmo::archipelago& arc,
+    const std::vector<int>& islandGens) const
 {
     double best_champ_fitness = std::numeric_limits<double>::max();
     pagmo::vector_double best_champ;
+    std::vector<pagmo::vector_double> allDvs; // every island's final population (used with multiple objectives)
+    std::vector<pagmo::vector_double> allFvs;
 
     for (std::size_t i = 0; i < arc.size(); ++i) {
         os << "\n*** Island " << i << " ***" << std::endl;
@@ -957,7 +1985,18 @@ void PolyBeeEvolve::writeResultsFileArchipelagoHelper(std::ostream& os, const pa
         auto pop = arc[i].get_population();
 
         os << "Using algorithm: " << algo.get_name() << std::endl;
+        if (i < islandGens.size()) {
+            // in asynchronous island mode each island keeps its own generation count
+            os << "Generations completed: " << islandGens[i] << std::endl;
+        }
         os << "The population: \n" << pop;
+        if (Params::multiObjective()) {
+            os << "\nIsland " << i << " ";
+            writeParetoFront(os, pop.get_x(), pop.get_f());
+            allDvs.insert(allDvs.end(), pop.get_x().begin(), pop.get_x().end());
+            allFvs.insert(allFvs.end(), pop.get_f().begin(), pop.get_f().end());
+            continue;
+        }
         os << "\nIsland " << i << " champion individual: ";
         auto island_champ = pop.champion_x();
         auto island_champ_fitness = pop.champion_f()[0];
@@ -974,6 +2013,116 @@ void PolyBeeEvolve::writeResultsFileArchipelagoHelper(std::ostream& os, const pa
     }
 
     os << "\n~~~~~~~~~~ Overall Results ~~~~~~~~~~" << std::endl;
+    if (Params::multiObjective()) {
+        os << "Overall ";
+        writeParetoFront(os, allDvs, allFvs);
+        return;
+    }
+    os << "Overall best champion individual: ";
+    for (size_t i = 0; i < best_champ.size(); ++i) {
+        if (i > 0) { os << ", "; }
+        os << best_champ[i];
+    }
+    os << "\nOverall best champion fitness: " << best_champ_fitness << std::endl;
+}
+
+
+void PolyBeeEvolve::writeResultsFileMultiProcess(const std::vector<IslandMessage>& results, bool alsoToStdout) const
+{
+    // write evolution results to file
+    std::string resultsFilename = std::format("{0}/{1}evo-results-{2}.txt",
+        Params::logDir,
+        Params::logFilenamePrefix.empty() ? "" : (Params::logFilenamePrefix + "-"),
+        m_masterPolyBeeCore.getTimestampStr());
+
+    std::ofstream resultsFile(resultsFilename);
+
+    if (!resultsFile) {
+        pb::msg_warning(
+            std::format("Unable to open evol-results output file {} for writing. Results will not be saved to file, printing to stdout instead.",
+                resultsFilename));
+        std::cout << "~~~~~~~~~~ EVOLUTION RESULTS ~~~~~~~~~~" << std::endl;
+        writeResultsFileMultiProcessHelper(std::cout, results);
+    }
+    else {
+        writeResultsFileMultiProcessHelper(resultsFile, results);
+        resultsFile.close();
+        pb::msg_info(std::format("Evolution results written to file: {}", resultsFilename));
+        if (alsoToStdout) {
+            std::cout << "~~~~~~~~~~ EVOLUTION RESULTS ~~~~~~~~~~" << std::endl;
+            writeResultsFileMultiProcessHelper(std::cout, results);
+        }
+    }
+}
+
+
+// Helper method to write results to a given output stream. The island populations have been received from
+// the worker processes as plain (IDs, decision vectors, fitness vectors) groups, so the layout follows that
+// of writeResultsFileArchipelagoHelper() but the population listing is written out here directly.
+void PolyBeeEvolve::writeResultsFileMultiProcessHelper(std::ostream& os, const std::vector<IslandMessage>& results) const
+{
+    double best_champ_fitness = std::numeric_limits<double>::max();
+    pagmo::vector_double best_champ;
+    std::vector<pagmo::vector_double> allDvs; // every island's final population (used with multiple objectives)
+    std::vector<pagmo::vector_double> allFvs;
+
+    for (const auto& result : results) {
+        const auto& [ids, dvs, fvs] = result.inds;
+
+        os << "\n*** Island " << result.islandNum << " ***" << std::endl;
+        os << "Using algorithm: " << result.text << std::endl;
+        os << "Generations completed: " << result.gen << std::endl;
+        os << "The population: \n";
+        os << "List of individuals: \n";
+
+        for (std::size_t k = 0; k < ids.size(); ++k) {
+            os << "#" << k << ":\n";
+            os << "\tID:\t\t\t" << ids[k] << "\n";
+            os << "\tDecision vector:\t";
+            for (std::size_t j = 0; j < dvs[k].size(); ++j) {
+                if (j > 0) { os << ", "; }
+                os << dvs[k][j];
+            }
+            os << "\n\tFitness vector:\t\t";
+            for (std::size_t j = 0; j < fvs[k].size(); ++j) {
+                if (j > 0) { os << ", "; }
+                os << fvs[k][j];
+            }
+            os << "\n";
+        }
+
+        if (Params::multiObjective()) {
+            os << "\nIsland " << result.islandNum << " ";
+            writeParetoFront(os, dvs, fvs);
+            allDvs.insert(allDvs.end(), dvs.begin(), dvs.end());
+            allFvs.insert(allFvs.end(), fvs.begin(), fvs.end());
+            continue;
+        }
+
+        if (result.championF.empty()) {
+            continue;
+        }
+
+        os << "\nIsland " << result.islandNum << " champion individual: ";
+        for (size_t j = 0; j < result.championX.size(); ++j) {
+            if (j > 0) { os << ", "; }
+            os << result.championX[j];
+        }
+        os << "\n";
+        os << "Island " << result.islandNum << " champion fitness: " << result.championF[0] << std::endl;
+
+        if (result.championF[0] < best_champ_fitness) {
+            best_champ_fitness = result.championF[0];
+            best_champ = result.championX;
+        }
+    }
+
+    os << "\n~~~~~~~~~~ Overall Results ~~~~~~~~~~" << std::endl;
+    if (Params::multiObjective()) {
+        os << "Overall ";
+        writeParetoFront(os, allDvs, allFvs);
+        return;
+    }
     os << "Overall best champion individual: ";
     for (size_t i = 0; i < best_champ.size(); ++i) {
         if (i > 0) { os << ", "; }
@@ -1020,6 +2169,10 @@ void PolyBeeEvolve::writeResultsFileHelper(std::ostream& os, const pagmo::algori
     os << "Using algorithm: " << algo.get_name() << std::endl;
     os << "The population: \n" << pop;
     os << "\n";
+    if (Params::multiObjective()) {
+        writeParetoFront(os, pop.get_x(), pop.get_f());
+        return;
+    }
     os << "Champion individual: ";
     auto champ = pop.champion_x();
     for (size_t i = 0; i < champ.size(); ++i) {
@@ -1029,3 +2182,67 @@ void PolyBeeEvolve::writeResultsFileHelper(std::ostream& os, const pagmo::algori
     os << "\n";
     os << "Champion fitness: " << pop.champion_f()[0] << std::endl;
 }
+
+
+// Write the non-dominated individuals among those given (the first front of a non-dominated sort of their
+// fitness vectors), best first on the first objective. Each objective is written as it is minimised, i.e.
+// the fraction of flowers in the successful visit range and the crossing success rate are negated.
+void PolyBeeEvolve::writeParetoFront(std::ostream& os, const std::vector<pagmo::vector_double>& dvs,
+    const std::vector<pagmo::vector_double>& fvs) const
+{
+    static const char* objectiveNames[] = {
+        "EMD to target heatmap",
+        "-(fraction of flowers in successful visit range)",
+        "-(entrance crossing success rate)",
+        "visit count variance"
+    };
+
+    std::vector<pagmo::pop_size_t> front;
+    if (!fvs.empty()) {
+        front = std::get<0>(pagmo::fast_non_dominated_sorting(fvs))[0];
+    }
+    std::sort(front.begin(), front.end(), [&fvs](pagmo::pop_size_t a, pagmo::pop_size_t b) { return fvs[a][0] < fvs[b][0]; });
+
+    os << "Pareto front (" << front.size() << " non-dominated individuals)" << std::endl;
+    os << "Objectives: ";
+    for (std::size_t k = 0; k < Params::evolveObjectives.size(); ++k) {
+        if (k > 0) { os << ", "; }
+        os << objectiveNames[static_cast<int>(Params::evolveObjectives[k])];
+    }
+    os << std::endl;
+
+    for (pagmo::pop_size_t idx : front) {
+        os << "Fitness: ";
+        for (std::size_t k = 0; k < fvs[idx].size(); ++k) {
+            if (k > 0) { os << ", "; }
+            os << fvs[idx][k];
+        }
+        os << "  Individual: ";
+        for (std::size_t j = 0; j < dvs[idx].size(); ++j) {
+            if (j > 0) { os << ", "; }
+            os << dvs[idx][j];
+        }
+        os << std::endl;
+    }
+}
+
+
+// One-line summary of the Pareto front of the given fitness vectors for progress messages: the number of
+// non-dominated individuals and the best value of each objective among them
+std::string PolyBeeEvolve::paretoSummary(const std::vector<pagmo::vector_double>& fvs)
+{
+    if (fvs.empty()) {
+        return "Pareto front is empty";
+    }
+
+    const auto front = std::get<0>(pagmo::fast_non_dominated_sorting(fvs))[0];
+    std::string bests;
+    for (std::size_t k = 0; k < fvs[0].size(); ++k) {
+        double best = std::numeric_limits<double>::max();
+        for (pagmo::pop_size_t idx : front) {
+            best = std::min(best, fvs[idx][k]);
+        }
+        bests += std::format("{}{:.5f}", (k > 0) ? ", " : "", best);
+    }
+    return std::format("Pareto front has {} individuals, best of each objective {}", front.size(), bests);
+}
@@ -0,0 +1,201 @@
+/**
+ * @file
+ *
+ * Implementation of the PolyBeeReplicates class
+ */
+
+#include "PolyBeeReplicates.h"
+#include "Params.h"
+#include "ThreadAffinity.h"
+#include "utils.h"
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <random>
+#include <functional>
+
+
+PolyBeeReplicates::PolyBeeReplicates(PolyBeeCore& core) :
+    m_masterPolyBeeCore(core),
+    m_baseTimestampStr(core.getTimestampStr())
+{
+    std::size_t maxThreads = (Params::replicateThreads > 0) ?
+        static_cast<std::size_t>(Params::replicateThreads) : std::max(1u, std::thread::hardware_concurrency());
+    m_numThreads = std::min(maxThreads, static_cast<std::size_t>(Params::numReplicates));
+
+    m_bHasTarget = !m_masterPolyBeeCore.getEnvironment().getRawTargetHeatmapNormalised().empty();
+
+    // Each thread after the first gets its own copy of the master core. These are created here, one at a
+    // time, rather than by the threads themselves, as creating a core updates some shared counters. (The
+    // seed given here is replaced when each replicate is run.) Each is built on a thread pinned to the
+    // CPUs its worker will run on, so that its memory is allocated on that NUMA node.
+    for (std::size_t t = 1; t < m_numThreads; ++t) {
+        std::size_t coreNum = m_masterPolyBeeCore.getIslandNum() + t;
+        ThreadAffinity::runOnPinnedThread(t, [&]() {
+            m_threadPolyBeeCores.push_back(std::make_unique<PolyBeeCore>(
+                m_masterPolyBeeCore, std::format("{}-thread-{}", Params::strRngSeed, t), coreNum));
+        });
+    }
+}
+
+
+void PolyBeeReplicates::run()
+{
+    pb::msg_info(std::format("Running {} replicates across {} threads", Params::numReplicates, m_numThreads));
+
+    m_scalarNames.clear();
+    if (m_bHasTarget) {
+        m_scalarNames.push_back("final_emd");
+    }
+    m_scalarNames.insert(m_scalarNames.end(),
+        {"successful_visit_fraction", "crossing_success_rate", "mean_rebounds", "crossing_attempts", "seconds"});
+
+    m_aggregators.clear();
+    m_aggregators.reserve(m_numThreads);
+    for (std::size_t t = 0; t < m_numThreads; ++t) {
+        m_aggregators.emplace_back(m_scalarNames, m_masterPolyBeeCore.getEnvironment());
+    }
+
+    if (Params::logging) {
+        m_masterPolyBeeCore.writeConfigFile();
+
+        std::string resultsFilename = m_masterPolyBeeCore.outputFilename("replicates", "csv");
+        m_resultsFile.open(resultsFilename);
+        if (!m_resultsFile) {
+            pb::msg_warning(std::format("Unable to open replicates results file {} for writing.", resultsFilename));
+        }
+        else {
+            m_resultsFile << "replicate,rng_seed";
+            for (const std::string& name : m_scalarNames) {
+                m_resultsFile << "," << name;
+            }
+            m_resultsFile << "\n";
+        }
+    }
+
+    std::atomic<std::size_t> nextReplicate {0};
+    const std::size_t numReplicates = static_cast<std::size_t>(Params::numReplicates);
+
+    auto start = std::chrono::steady_clock::now();
+
+    // each thread takes the next replicate that hasn't been started until there are none left
+    auto worker = [this, &nextReplicate, numReplicates](PolyBeeCore& core, std::size_t threadNum) {
+        ThreadAffinity::pinCurrentThread(threadNum);
+        for (std::size_t r = nextReplicate++; r < numReplicates; r = nextReplicate++) {
+            runReplicate(core, m_aggregators[threadNum], r);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(m_numThreads);
+    for (std::size_t t = 0; t < m_threadPolyBeeCores.size(); ++t) {
+        threads.emplace_back(worker, std::ref(*m_threadPolyBeeCores[t]), t + 1);
+    }
+    if (ThreadAffinity::enabled()) {
+        // the main thread is never pinned, so the master core's replicates get a pinned thread of their own
+        threads.emplace_back(worker, std::ref(m_masterPolyBeeCore), 0);
+    }
+    else {
+        worker(m_masterPolyBeeCore, 0);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    m_masterPolyBeeCore.m_timestampStr = m_baseTimestampStr; // (the master core ran replicates too)
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // merge the threads' aggregators in thread order
+    ReplicateAggregator& aggregate = m_aggregators[0];
+    for (std::size_t t = 1; t < m_aggregators.size(); ++t) {
+        aggregate.merge(m_aggregators[t]);
+    }
+
+    if (Params::logging) {
+        if (m_resultsFile.is_open()) {
+            m_resultsFile.close();
+            pb::msg_info(std::format("Replicates results written to file: {}",
+                m_masterPolyBeeCore.outputFilename("replicates", "csv")));
+        }
+
+        std::string aggregateFilename = m_masterPolyBeeCore.outputFilename("replicates-aggregate", "txt");
+        std::ofstream aggregateFile(aggregateFilename);
+        if (!aggregateFile) {
+            pb::msg_warning(std::format("Unable to open replicates aggregate file {} for writing.", aggregateFilename));
+        }
+        else {
+            aggregate.write(aggregateFile);
+            aggregateFile.close();
+            pb::msg_info(std::format("Replicates aggregate written to file: {}", aggregateFilename));
+        }
+    }
+
+    if (!Params::bCommandLineQuiet) {
+        std::cout << "~~~~~~~~~~ REPLICATES SUMMARY ~~~~~~~~~~\n";
+        printSummary(std::cout, aggregate, seconds);
+        std::cout << "~~~~~~~~~~" << std::endl;
+    }
+
+    m_aggregators.clear();
+}
+
+
+// Run replicate number replicateNum on the given core, which belongs to the calling thread, and fold
+// its results into that thread's aggregator
+void PolyBeeReplicates::runReplicate(PolyBeeCore& core, ReplicateAggregator& aggregator, std::size_t replicateNum)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    std::string rngSeed = std::format("{}-rep-{}", Params::strRngSeed, replicateNum);
+    std::seed_seq seed(rngSeed.begin(), rngSeed.end());
+    core.m_rngEngine.seed(seed);
+    core.m_timestampStr = std::format("{}-rep-{}", m_baseTimestampStr, replicateNum);
+
+    core.resetForNewRun(Params::hiveSpecs, {});
+    core.run(false); // output files are written below, as run() only writes them for the master core
+
+    const Environment& env = core.getEnvironment();
+    std::vector<double> scalars;
+    scalars.reserve(m_scalarNames.size());
+    if (m_bHasTarget) {
+        scalars.push_back(env.getHeatmap().emd(env.getRawTargetHeatmapNormalised()));
+    }
+    scalars.push_back(env.getSuccessfulVisitFraction());
+    EntranceCrossingStats crossingStats = env.getEntranceCrossingStats(EntranceCrossingType::ALL);
+    scalars.push_back(crossingStats.successRate);
+    scalars.push_back(crossingStats.meanRebounds);
+    scalars.push_back(static_cast<double>(crossingStats.numAttempts));
+
+    if (Params::logging && Params::replicateOutputFiles) {
+        core.getEnvironment().getFlowmap().calculateFlow();
+        core.writeResultFiles();
+    }
+
+    scalars.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    aggregator.addRun(env, scalars);
+
+    if (m_resultsFile.is_open()) {
+        std::string line = std::format("{},{}", replicateNum, rngSeed);
+        for (double value : scalars) {
+            line += std::format(",{:.6g}", value);
+        }
+        line += "\n";
+
+        std::lock_guard<std::mutex> lock(m_resultsFileMutex);
+        m_resultsFile << line;
+    }
+}
+
+
+void PolyBeeReplicates::printSummary(std::ostream& os, const ReplicateAggregator& aggregate, double seconds) const
+{
+    os << std::format("Replicates: {} (base RNG seed {}), run across {} threads in {:.2f} s ({:.2f} replicates/s, thread affinity {})\n",
+        aggregate.count(), Params::strRngSeed, m_numThreads, seconds,
+        (seconds > 0.0) ? aggregate.count() / seconds : 0.0, ThreadAffinity::policyName());
+    aggregate.printScalarSummary(os);
+}
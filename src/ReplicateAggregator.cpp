@@ -0,0 +1,164 @@
+/**
+ * @file
+ *
+ * Implementation of the ReplicateAggregator class
+ */
+
+#include "ReplicateAggregator.h"
+#include "Environment.h"
+#include <format>
+#include <cmath>
+#include <cassert>
+
+
+ReplicateAggregator::ReplicateAggregator(const std::vector<std::string>& scalarNames, const Environment& env) :
+    m_scalarNames(scalarNames),
+    m_scalars(scalarNames.size())
+{
+    const Heatmap& heatmap = env.getHeatmap();
+    m_heatmapW = heatmap.size_x();
+    m_heatmapH = heatmap.size_y();
+    m_heatmapCells.resize(static_cast<std::size_t>(m_heatmapW) * m_heatmapH);
+
+    const Flowmap& flowmap = env.getFlowmapConst();
+    m_flowmapW = flowmap.size_x();
+    m_flowmapH = flowmap.size_y();
+    m_flowmapCells.resize(static_cast<std::size_t>(m_flowmapW) * m_flowmapH);
+}
+
+
+// Fold in the results of a finished run
+void ReplicateAggregator::addRun(const Environment& env, const std::vector<double>& scalars)
+{
+    assert(scalars.size() == m_scalars.size());
+
+    ++m_numRuns;
+
+    for (std::size_t i = 0; i < scalars.size(); ++i) {
+        m_scalars[i].stats.add(scalars[i]);
+        m_scalars[i].sketch.add(scalars[i]);
+    }
+
+    const Heatmap& heatmap = env.getHeatmap();
+    if (heatmap.isNormalisedCalculated()) {
+        const auto& cells = heatmap.cellsNormalised();
+        for (int x = 0; x < m_heatmapW; ++x) {
+            for (int y = 0; y < m_heatmapH; ++y) {
+                CellStats& cell = m_heatmapCells[x * m_heatmapH + y];
+                cell.stats.add(cells[x][y]);
+                cell.sketch.add(cells[x][y]);
+            }
+        }
+    }
+
+    const auto& flowCells = env.getFlowmapConst().cells();
+    for (int x = 0; x < m_flowmapW; ++x) {
+        for (int y = 0; y < m_flowmapH; ++y) {
+            const FlowmapCell& flowCell = flowCells[x][y];
+            FlowmapCellSums& sums = m_flowmapCells[x * m_flowmapH + y];
+            sums.count += flowCell.count;
+            sums.sumCosTwoTheta += flowCell.sumCosTwoTheta;
+            sums.sumSinTwoTheta += flowCell.sumSinTwoTheta;
+            sums.countStats.add(flowCell.count);
+        }
+    }
+}
+
+
+void ReplicateAggregator::merge(const ReplicateAggregator& other)
+{
+    assert(other.m_scalars.size() == m_scalars.size());
+    assert(other.m_heatmapCells.size() == m_heatmapCells.size());
+    assert(other.m_flowmapCells.size() == m_flowmapCells.size());
+
+    m_numRuns += other.m_numRuns;
+
+    for (std::size_t i = 0; i < m_scalars.size(); ++i) {
+        m_scalars[i].stats.merge(other.m_scalars[i].stats);
+        m_scalars[i].sketch.merge(other.m_scalars[i].sketch);
+    }
+
+    for (std::size_t c = 0; c < m_heatmapCells.size(); ++c) {
+        m_heatmapCells[c].stats.merge(other.m_heatmapCells[c].stats);
+        m_heatmapCells[c].sketch.merge(other.m_heatmapCells[c].sketch);
+    }
+
+    for (std::size_t c = 0; c < m_flowmapCells.size(); ++c) {
+        m_flowmapCells[c].count += other.m_flowmapCells[c].count;
+        m_flowmapCells[c].sumCosTwoTheta += other.m_flowmapCells[c].sumCosTwoTheta;
+        m_flowmapCells[c].sumSinTwoTheta += other.m_flowmapCells[c].sumSinTwoTheta;
+        m_flowmapCells[c].countStats.merge(other.m_flowmapCells[c].countStats);
+    }
+}
+
+
+// One line per scalar result (quantiles are estimates once there are more replicates than the
+// sketches hold exactly)
+void ReplicateAggregator::printScalarSummary(std::ostream& os) const
+{
+    os << "name,mean,sd,min,q05,median,q95,max\n";
+    for (std::size_t i = 0; i < m_scalars.size(); ++i) {
+        const CellStats& scalar = m_scalars[i];
+        os << std::format("{},{:.6g},{:.6g},{:.6g},{:.6g},{:.6g},{:.6g},{:.6g}\n", m_scalarNames[i],
+            scalar.stats.mean(), scalar.stats.sd(), scalar.stats.min(), scalar.sketch.quantile(0.05),
+            scalar.sketch.quantile(0.5), scalar.sketch.quantile(0.95), scalar.stats.max());
+    }
+}
+
+
+void ReplicateAggregator::write(std::ostream& os) const
+{
+    os << std::format("[replicates]\n{}\n", m_numRuns);
+
+    os << "[scalars]\n";
+    printScalarSummary(os);
+
+    auto heatmapCell = [this](int x, int y) -> const CellStats& { return m_heatmapCells[x * m_heatmapH + y]; };
+    writeGrid(os, "heatmap-normalised-mean", m_heatmapW, m_heatmapH,
+        [&](int x, int y) { return std::format("{:.6g}", heatmapCell(x, y).stats.mean()); });
+    writeGrid(os, "heatmap-normalised-sd", m_heatmapW, m_heatmapH,
+        [&](int x, int y) { return std::format("{:.6g}", heatmapCell(x, y).stats.sd()); });
+    writeGrid(os, "heatmap-normalised-q05", m_heatmapW, m_heatmapH,
+        [&](int x, int y) { return std::format("{:.6g}", heatmapCell(x, y).sketch.quantile(0.05)); });
+    writeGrid(os, "heatmap-normalised-median", m_heatmapW, m_heatmapH,
+        [&](int x, int y) { return std::format("{:.6g}", heatmapCell(x, y).sketch.quantile(0.5)); });
+    writeGrid(os, "heatmap-normalised-q95", m_heatmapW, m_heatmapH,
+        [&](int x, int y) { return std::format("{:.6g}", heatmapCell(x, y).sketch.quantile(0.95)); });
+
+    // the flowmap of all the replicates' movements, in the same format as Flowmap::print()
+    auto flowmapCell = [this](int x, int y) -> const FlowmapCellSums& { return m_flowmapCells[x * m_flowmapH + y]; };
+    writeGrid(os, "flowmap", m_flowmapW, m_flowmapH, [&](int x, int y) {
+        const FlowmapCellSums& sums = flowmapCell(x, y);
+        float axis = 0.0f;
+        float strength = 0.0f;
+        if (sums.count > 0) {
+            float avgSinTwoTheta = static_cast<float>(sums.sumSinTwoTheta / sums.count);
+            float avgCosTwoTheta = static_cast<float>(sums.sumCosTwoTheta / sums.count);
+            axis = 0.5f * std::atan2(avgSinTwoTheta, avgCosTwoTheta);
+            strength = std::sqrt(avgSinTwoTheta * avgSinTwoTheta + avgCosTwoTheta * avgCosTwoTheta);
+        }
+        return std::format("{:.5f}:{:.5f}:{}", axis, strength, sums.count);
+    });
+    writeGrid(os, "flowmap-count-mean", m_flowmapW, m_flowmapH,
+        [&](int x, int y) { return std::format("{:.6g}", flowmapCell(x, y).countStats.mean()); });
+    writeGrid(os, "flowmap-count-sd", m_flowmapW, m_flowmapH,
+        [&](int x, int y) { return std::format("{:.6g}", flowmapCell(x, y).countStats.sd()); });
+}
+
+
+// Write a section header followed by a grid in the same layout as the heatmap and flowmap files
+// (one row per line, cells comma-separated)
+template<typename F>
+void ReplicateAggregator::writeGrid(std::ostream& os, const std::string& section, int sizeX, int sizeY, F cellValue) const
+{
+    os << "[" << section << "]\n";
+    for (int y = 0; y < sizeY; ++y) {
+        for (int x = 0; x < sizeX; ++x) {
+            os << cellValue(x, y);
+            if (x < sizeX - 1) {
+                os << ",";
+            }
+        }
+        os << "\n";
+    }
+}
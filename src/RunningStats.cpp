@@ -0,0 +1,151 @@
+/**
+ * @file
+ *
+ * Implementation of the RunningStats and QuantileSketch classes
+ */
+
+#include "RunningStats.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+
+void RunningStats::add(double x)
+{
+    ++m_count;
+    double delta = x - m_mean;
+    m_mean += delta / static_cast<double>(m_count);
+    m_m2 += delta * (x - m_mean);
+    m_min = std::min(m_min, x);
+    m_max = std::max(m_max, x);
+}
+
+
+// Chan et al.'s method for combining the statistics of two sets of values
+void RunningStats::merge(const RunningStats& other)
+{
+    if (other.m_count == 0) {
+        return;
+    }
+    if (m_count == 0) {
+        *this = other;
+        return;
+    }
+
+    const double n1 = static_cast<double>(m_count);
+    const double n2 = static_cast<double>(other.m_count);
+    const double n = n1 + n2;
+    const double delta = other.m_mean - m_mean;
+
+    m_mean += delta * n2 / n;
+    m_m2 += other.m_m2 + delta * delta * n1 * n2 / n;
+    m_count += other.m_count;
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+}
+
+
+double RunningStats::variance() const
+{
+    return (m_count > 1) ? m_m2 / static_cast<double>(m_count - 1) : 0.0;
+}
+
+
+double RunningStats::sd() const
+{
+    return std::sqrt(variance());
+}
+
+
+void QuantileSketch::add(double x)
+{
+    if (m_levels.empty()) {
+        m_levels.emplace_back();
+        m_levels[0].reserve(m_k);
+    }
+    m_levels[0].push_back(x);
+    ++m_count;
+    if (m_levels[0].size() >= m_k) {
+        compact();
+    }
+}
+
+
+void QuantileSketch::merge(const QuantileSketch& other)
+{
+    if (m_levels.size() < other.m_levels.size()) {
+        m_levels.resize(other.m_levels.size());
+    }
+    for (std::size_t level = 0; level < other.m_levels.size(); ++level) {
+        m_levels[level].insert(m_levels[level].end(), other.m_levels[level].begin(), other.m_levels[level].end());
+    }
+    m_count += other.m_count;
+    compact();
+}
+
+
+// Halve every level that has reached capacity, from the bottom up (promoting values can fill the next
+// level in turn). If a level has an odd number of values, the one left over stays where it is: the
+// largest and the smallest alternately, as always leaving the largest would bias the upper quantiles.
+void QuantileSketch::compact()
+{
+    for (std::size_t level = 0; level < m_levels.size(); ++level) {
+        if (m_levels[level].size() < m_k) {
+            continue;
+        }
+
+        std::vector<double> values = std::move(m_levels[level]);
+        std::sort(values.begin(), values.end());
+        m_levels[level].clear();
+        if (values.size() % 2 == 1) {
+            if (m_bLeaveLargest) {
+                m_levels[level].push_back(values.back());
+                values.pop_back();
+            }
+            else {
+                m_levels[level].push_back(values.front());
+                values.erase(values.begin());
+            }
+            m_bLeaveLargest = !m_bLeaveLargest;
+        }
+
+        if (level + 1 == m_levels.size()) {
+            m_levels.emplace_back();
+        }
+        std::vector<double>& next = m_levels[level + 1];
+        for (std::size_t i = m_bKeepOdd ? 1 : 0; i < values.size(); i += 2) {
+            next.push_back(values[i]);
+        }
+        m_bKeepOdd = !m_bKeepOdd;
+    }
+}
+
+
+double QuantileSketch::quantile(double q) const
+{
+    if (m_count == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    std::vector<std::pair<double, double>> weighted; // (value, weight)
+    double weight = 1.0;
+    double totalWeight = 0.0;
+    for (const std::vector<double>& level : m_levels) {
+        for (double x : level) {
+            weighted.emplace_back(x, weight);
+            totalWeight += weight;
+        }
+        weight *= 2.0;
+    }
+    std::sort(weighted.begin(), weighted.end());
+
+    const double rank = std::clamp(q, 0.0, 1.0) * totalWeight;
+    double cumulative = 0.0;
+    for (const auto& [x, w] : weighted) {
+        cumulative += w;
+        if (cumulative >= rank) {
+            return x;
+        }
+    }
+    return weighted.back().first;
+}
@@ -0,0 +1,311 @@
+/**
+ * @file
+ *
+ * Implementation of the StartupCache class
+ */
+
+#include "StartupCache.h"
+#include "Heatmap.h"
+#include "Params.h"
+#include "utils.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <format>
+#include <cstring>
+#include <cmath>
+#include <cassert>
+#include <unistd.h>
+
+
+std::mutex StartupCache::s_mutex;
+std::map<std::string, std::shared_ptr<const EnvironmentInvariants>> StartupCache::s_entries;
+
+
+namespace {
+
+    constexpr char STARTUP_CACHE_MAGIC[8] = {'P', 'B', 'S', 'C', 'A', 'C', '0', '1'};
+
+    struct StartupCacheFileHeader {
+        char magic[8];
+        std::uint64_t key;
+        std::int32_t numCellsX;
+        std::int32_t numCellsY;
+        float highEmd;
+        std::uint32_t hasTarget;
+    };
+
+    // 64-bit FNV-1a hash
+    constexpr std::uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+    constexpr std::uint64_t FNV_PRIME = 1099511628211ull;
+
+    std::uint64_t fnv1a(const void* data, std::size_t size, std::uint64_t hash = FNV_OFFSET_BASIS)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    // Read a normalised target heatmap from a CSV file (one row per line), check it has the expected
+    // dimensions and sums to 1, and return it transposed, as we access these matrices as [x][y] elsewhere
+    std::vector<std::vector<double>> readTargetHeatmapFile(const std::string& filename, int expectedWidth, int expectedHeight)
+    {
+        std::ifstream file(filename);
+        if (!file.is_open()) {
+            pb::msg_error_and_exit("Cannot open target heatmap file: " + filename);
+        }
+
+        // Read CSV data
+        std::vector<std::vector<double>> targetData;
+        std::string line;
+
+        while (std::getline(file, line)) {
+            if (line.empty()) continue; // Skip empty lines
+
+            std::vector<double> row;
+            std::stringstream ss(line);
+            std::string cell;
+
+            while (std::getline(ss, cell, ',')) {
+                try {
+                    double value = std::stod(cell);
+                    row.push_back(value);
+                } catch (const std::exception& e) {
+                    pb::msg_error_and_exit("Invalid numeric value in target heatmap CSV file: " + cell);
+                }
+            }
+
+            if (!row.empty()) {
+                targetData.push_back(row);
+            }
+        }
+
+        file.close();
+
+        // Check dimensions match
+        if (targetData.empty()) {
+            pb::msg_error_and_exit("Target heatmap file is empty: " + filename);
+        }
+
+        int actualHeight = static_cast<int>(targetData.size());
+        int actualWidth = static_cast<int>(targetData[0].size());
+
+        if (actualHeight != expectedHeight || actualWidth != expectedWidth) {
+            pb::msg_error_and_exit(
+                std::format("Target heatmap dimensions ({}x{} do not match core heatmap dimensions ({}x{})",
+                    actualWidth, actualHeight, expectedWidth, expectedHeight));
+        }
+
+        // Check all rows have the same width
+        for (size_t i = 0; i < targetData.size(); ++i) {
+            if (static_cast<int>(targetData[i].size()) != expectedWidth) {
+                pb::msg_error_and_exit(std::format("Inconsistent row width in CSV file at row {}", i + 1));
+            }
+        }
+
+        // Transpose the matrix
+        std::vector<std::vector<double>> transposed(expectedWidth, std::vector<double>(expectedHeight));
+        for (int i = 0; i < expectedHeight; ++i) {
+            for (int j = 0; j < expectedWidth; ++j) {
+                transposed[j][i] = targetData[i][j];
+            }
+        }
+
+        // Check that the normalised data sums to 1.0
+        double sum = 0.0;
+        for (const auto& col : transposed) {
+            for (double v : col) {
+                sum += v;
+            }
+        }
+        constexpr double NORMALISATION_TOLERANCE = 1e-4;
+        if (std::abs(sum - 1.0) > NORMALISATION_TOLERANCE) {
+            pb::msg_error_and_exit(std::format(
+                "Target heatmap data does not sum to 1.0 (sum = {:.8f}, tolerance = {:.0e}): {}",
+                sum, NORMALISATION_TOLERANCE, filename));
+        }
+
+        return transposed;
+    }
+
+} // anonymous namespace
+
+
+std::shared_ptr<const EnvironmentInvariants> StartupCache::environmentInvariants(const Heatmap& heatmap)
+{
+    // Ensure the heatmap has been initialised
+    assert(heatmap.size_x() > 0 && heatmap.size_y() > 0);
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+
+    std::string entryKey = std::format("{}x{}:{}", heatmap.size_x(), heatmap.size_y(), Params::strTargetHeatmapFilename);
+    auto it = s_entries.find(entryKey);
+    if (it != s_entries.end()) {
+        return it->second;
+    }
+
+    std::shared_ptr<const EnvironmentInvariants> pInvariants;
+    if (Params::startupCacheDir.empty()) {
+        pInvariants = compute(heatmap);
+    }
+    else {
+        std::uint64_t key = diskKey(heatmap);
+        std::string filename = (std::filesystem::path(Params::startupCacheDir) /
+            std::format("polybee-startup-{:016x}.bin", key)).string();
+        pInvariants = load(filename, key, heatmap);
+        if (pInvariants) {
+            pb::msg_info(std::format("Loaded environment invariants from startup cache file {}", filename));
+        }
+        else {
+            pInvariants = compute(heatmap);
+            save(filename, key, *pInvariants);
+        }
+    }
+
+    s_entries.emplace(entryKey, pInvariants);
+    return pInvariants;
+}
+
+
+std::shared_ptr<const EnvironmentInvariants> StartupCache::compute(const Heatmap& heatmap)
+{
+    auto pInvariants = std::make_shared<EnvironmentInvariants>();
+    pInvariants->numCellsX = heatmap.size_x();
+    pInvariants->numCellsY = heatmap.size_y();
+    initialiseReferenceHeatmaps(*pInvariants);
+    pInvariants->highEmd = heatmap.emd(pInvariants->uniformTargetNormalised, pInvariants->antiTargetNormalised);
+    if (!Params::strTargetHeatmapFilename.empty()) {
+        pInvariants->targetHeatmapNormalised =
+            readTargetHeatmapFile(Params::strTargetHeatmapFilename, heatmap.size_x(), heatmap.size_y());
+    }
+    return pInvariants;
+}
+
+
+// Set up the uniform target and anti-target heatmaps (for use in PolyBeeEvolve). These are cheap to
+// build, so they are not saved in cache files.
+// Note: The anti-target heatmap is a degenerate case where all the density is concentrated in a single
+// cell (the top-left cell). This is useful for testing the EMD calculation and as a challenging target
+// for optimization.
+void StartupCache::initialiseReferenceHeatmaps(EnvironmentInvariants& invariants)
+{
+    const int numCellsX = invariants.numCellsX;
+    const int numCellsY = invariants.numCellsY;
+
+    invariants.uniformTargetNormalised.assign(numCellsX,
+        std::vector<double>(numCellsY, 1.0 / (numCellsX * numCellsY)));
+
+    invariants.antiTargetNormalised.assign(numCellsX, std::vector<double>(numCellsY, 0.0f));
+    invariants.antiTargetNormalised[0][0] = 1.0f;
+}
+
+
+// Hash of everything the invariants depend on: the cache file format, the heatmap dimensions and the
+// contents (not the name) of the target heatmap file
+std::uint64_t StartupCache::diskKey(const Heatmap& heatmap)
+{
+    std::int32_t dims[2] = {heatmap.size_x(), heatmap.size_y()};
+    std::uint64_t hash = fnv1a(STARTUP_CACHE_MAGIC, sizeof(STARTUP_CACHE_MAGIC));
+    hash = fnv1a(dims, sizeof(dims), hash);
+
+    if (!Params::strTargetHeatmapFilename.empty()) {
+        std::ifstream file(Params::strTargetHeatmapFilename, std::ios::binary);
+        if (!file.is_open()) {
+            pb::msg_error_and_exit("Cannot open target heatmap file: " + Params::strTargetHeatmapFilename);
+        }
+        std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        hash = fnv1a(contents.data(), contents.size(), hash);
+    }
+
+    return hash;
+}
+
+
+// Load invariants from a cache file, or return nullptr if there is no usable cache file for this key
+std::shared_ptr<const EnvironmentInvariants> StartupCache::load(const std::string& filename, std::uint64_t key,
+    const Heatmap& heatmap)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return nullptr;
+    }
+
+    StartupCacheFileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, STARTUP_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.key != key ||
+        header.numCellsX != heatmap.size_x() ||
+        header.numCellsY != heatmap.size_y() ||
+        header.hasTarget != (Params::strTargetHeatmapFilename.empty() ? 0u : 1u)) {
+        pb::msg_warning(std::format("Ignoring startup cache file {} as it does not match this set-up", filename));
+        return nullptr;
+    }
+
+    auto pInvariants = std::make_shared<EnvironmentInvariants>();
+    pInvariants->numCellsX = header.numCellsX;
+    pInvariants->numCellsY = header.numCellsY;
+    pInvariants->highEmd = header.highEmd;
+    initialiseReferenceHeatmaps(*pInvariants);
+    if (header.hasTarget) {
+        pInvariants->targetHeatmapNormalised.assign(header.numCellsX, std::vector<double>(header.numCellsY));
+        for (auto& col : pInvariants->targetHeatmapNormalised) {
+            if (!file.read(reinterpret_cast<char*>(col.data()), col.size() * sizeof(double))) {
+                pb::msg_warning(std::format("Ignoring startup cache file {} as it is truncated", filename));
+                return nullptr;
+            }
+        }
+    }
+
+    return pInvariants;
+}
+
+
+// Save invariants to a cache file. The file is written under a temporary name and then renamed, so
+// concurrent runs never see a partly written file. Failure is not fatal, as the cache is only an
+// optimisation.
+void StartupCache::save(const std::string& filename, std::uint64_t key, const EnvironmentInvariants& invariants)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(Params::startupCacheDir, ec);
+
+    std::string tmpFilename = std::format("{}.tmp-{}", filename, ::getpid());
+    {
+        std::ofstream file(tmpFilename, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            pb::msg_warning(std::format("Unable to open startup cache file {} for writing", tmpFilename));
+            return;
+        }
+
+        StartupCacheFileHeader header {};
+        std::memcpy(header.magic, STARTUP_CACHE_MAGIC, sizeof(header.magic));
+        header.key = key;
+        header.numCellsX = invariants.numCellsX;
+        header.numCellsY = invariants.numCellsY;
+        header.highEmd = invariants.highEmd;
+        header.hasTarget = invariants.targetHeatmapNormalised.empty() ? 0u : 1u;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        for (const auto& col : invariants.targetHeatmapNormalised) {
+            file.write(reinterpret_cast<const char*>(col.data()), col.size() * sizeof(double));
+        }
+
+        if (!file) {
+            pb::msg_warning(std::format("Unable to write startup cache file {}", tmpFilename));
+            file.close();
+            std::filesystem::remove(tmpFilename, ec);
+            return;
+        }
+    }
+
+    std::filesystem::rename(tmpFilename, filename, ec);
+    if (ec) {
+        pb::msg_warning(std::format("Unable to rename startup cache file {} to {}: {}", tmpFilename, filename, ec.message()));
+        std::filesystem::remove(tmpFilename, ec);
+        return;
+    }
+    pb::msg_info(std::format("Environment invariants written to startup cache file: {}", filename));
+}
@@ -0,0 +1,205 @@
+/**
+ * @file
+ *
+ * Implementation of the Surrogate class
+ */
+
+#include "Surrogate.h"
+#include <cmath>
+#include <cassert>
+#include <numeric>
+#include <limits>
+#include <numbers>
+#include <algorithm>
+
+
+Surrogate::Surrogate(const pagmo::vector_double& lowerBounds, const pagmo::vector_double& upperBounds) :
+    m_lowerBounds(lowerBounds),
+    m_upperBounds(upperBounds)
+{
+    assert(m_lowerBounds.size() == m_upperBounds.size());
+}
+
+
+void Surrogate::fit(const std::vector<pagmo::vector_double>& xs, const std::vector<double>& ys)
+{
+    assert(xs.size() == ys.size());
+    const std::size_t n = xs.size();
+
+    m_xs.clear();
+    m_chol.clear();
+    m_alpha.clear();
+
+    if (n < 2) {
+        return;
+    }
+
+    m_xs.reserve(n);
+    for (const auto& x : xs) {
+        m_xs.push_back(scaled(x));
+    }
+
+    // standardise the targets so that a unit signal variance is appropriate
+    m_yMean = std::accumulate(ys.begin(), ys.end(), 0.0) / n;
+    double ss = 0.0;
+    for (double y : ys) { ss += (y - m_yMean) * (y - m_yMean); }
+    m_yStd = std::sqrt(ss / n);
+    if (m_yStd <= 0.0) {
+        m_yStd = 1.0;
+    }
+    std::vector<double> yStd(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        yStd[i] = (ys[i] - m_yMean) / m_yStd;
+    }
+
+    // choose the length scale and noise level with the highest log marginal likelihood
+    // log p(y) = -1/2 y^T K^-1 y - sum(log L_ii) - n/2 log(2 pi)
+    const double dimScale = std::sqrt(static_cast<double>(std::max<std::size_t>(m_lowerBounds.size(), 1)));
+    const double lengthScales[] = {0.05, 0.1, 0.2, 0.35, 0.5, 1.0};
+    const double noiseVariances[] = {0.001, 0.01, 0.1, 0.3};
+
+    double bestLogLik = -std::numeric_limits<double>::infinity();
+    double bestLengthScale = dimScale;
+    double bestNoiseVariance = noiseVariances[0];
+    std::vector<double> k(n * n);
+    std::vector<double> alpha;
+
+    for (double ls : lengthScales) {
+        for (double nv : noiseVariances) {
+            m_lengthScale = ls * dimScale;
+            m_noiseVariance = nv;
+
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t j = 0; j <= i; ++j) {
+                    double kij = kernel(m_xs[i], m_xs[j]);
+                    k[i * n + j] = kij;
+                    k[j * n + i] = kij;
+                }
+                k[i * n + i] += nv;
+            }
+
+            if (!choleskyFactorise(k, n)) {
+                continue;
+            }
+
+            alpha = yStd;
+            choleskySolve(k, n, alpha);
+
+            double logLik = -0.5 * std::inner_product(yStd.begin(), yStd.end(), alpha.begin(), 0.0)
+                - 0.5 * n * std::log(2.0 * std::numbers::pi);
+            for (std::size_t i = 0; i < n; ++i) {
+                logLik -= std::log(k[i * n + i]);
+            }
+
+            if (logLik > bestLogLik) {
+                bestLogLik = logLik;
+                m_chol = k;
+                m_alpha = alpha;
+                bestLengthScale = m_lengthScale;
+                bestNoiseVariance = m_noiseVariance;
+            }
+        }
+    }
+
+    m_lengthScale = bestLengthScale;
+    m_noiseVariance = bestNoiseVariance;
+}
+
+
+std::pair<double, double> Surrogate::predict(const pagmo::vector_double& x) const
+{
+    assert(isFitted());
+    const std::size_t n = m_xs.size();
+    const std::vector<double> xs = scaled(x);
+
+    std::vector<double> kStar(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        kStar[i] = kernel(xs, m_xs[i]);
+    }
+
+    double mean = std::inner_product(kStar.begin(), kStar.end(), m_alpha.begin(), 0.0);
+
+    // predictive variance of the latent function: k(x,x) - v^T v where L v = k*
+    forwardSubstitute(m_chol, n, kStar);
+    double var = 1.0 - std::inner_product(kStar.begin(), kStar.end(), kStar.begin(), 0.0);
+    var = std::max(var, 0.0);
+
+    return {m_yMean + m_yStd * mean, m_yStd * std::sqrt(var)};
+}
+
+
+std::vector<double> Surrogate::scaled(const pagmo::vector_double& x) const
+{
+    assert(x.size() == m_lowerBounds.size());
+    std::vector<double> result(x.size());
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        double range = m_upperBounds[i] - m_lowerBounds[i];
+        result[i] = (range > 0.0) ? (x[i] - m_lowerBounds[i]) / range : 0.0;
+    }
+    return result;
+}
+
+
+// squared exponential kernel with unit signal variance
+double Surrogate::kernel(const std::vector<double>& a, const std::vector<double>& b) const
+{
+    double d2 = 0.0;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        double d = a[i] - b[i];
+        d2 += d * d;
+    }
+    return std::exp(-0.5 * d2 / (m_lengthScale * m_lengthScale));
+}
+
+
+// in-place Cholesky factorisation of the n x n symmetric matrix k (row major), leaving the lower
+// triangular factor L in the lower triangle. Returns false if k is not positive definite.
+bool Surrogate::choleskyFactorise(std::vector<double>& k, std::size_t n) const
+{
+    for (std::size_t j = 0; j < n; ++j) {
+        double d = k[j * n + j];
+        for (std::size_t p = 0; p < j; ++p) {
+            d -= k[j * n + p] * k[j * n + p];
+        }
+        if (d <= 0.0) {
+            return false;
+        }
+        d = std::sqrt(d);
+        k[j * n + j] = d;
+        for (std::size_t i = j + 1; i < n; ++i) {
+            double s = k[i * n + j];
+            for (std::size_t p = 0; p < j; ++p) {
+                s -= k[i * n + p] * k[j * n + p];
+            }
+            k[i * n + j] = s / d;
+        }
+    }
+    return true;
+}
+
+
+// solve L L^T x = b in place
+void Surrogate::choleskySolve(const std::vector<double>& l, std::size_t n, std::vector<double>& b) const
+{
+    forwardSubstitute(l, n, b);
+    for (std::size_t ii = n; ii-- > 0;) {
+        double s = b[ii];
+        for (std::size_t p = ii + 1; p < n; ++p) {
+            s -= l[p * n + ii] * b[p];
+        }
+        b[ii] = s / l[ii * n + ii];
+    }
+}
+
+
+// solve L x = b in place
+void Surrogate::forwardSubstitute(const std::vector<double>& l, std::size_t n, std::vector<double>& b) const
+{
+    for (std::size_t i = 0; i < n; ++i) {
+        double s = b[i];
+        for (std::size_t p = 0; p < i; ++p) {
+            s -= l[i * n + p] * b[p];
+        }
+        b[i] = s / l[i * n + i];
+    }
+}
@@ -0,0 +1,244 @@
+/**
+ * @file
+ *
+ * Implementation of the ThreadAffinity class
+ */
+
+#include "ThreadAffinity.h"
+#include "Params.h"
+#include "utils.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <exception>
+#include <format>
+#include <limits>
+#include <cassert>
+#include <cctype>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+
+std::string ThreadAffinity::s_policyName {"none"};
+std::vector<std::vector<int>> ThreadAffinity::s_slotCpus;
+std::thread::id ThreadAffinity::s_mainThreadId;
+
+
+void ThreadAffinity::initialise()
+{
+    s_mainThreadId = std::this_thread::get_id();
+    s_slotCpus.clear();
+
+    const std::string& policy = Params::threadAffinity;
+    if (policy == "none") {
+        s_policyName = "none";
+        return;
+    }
+    s_policyName = (policy == "compact" || policy == "scatter") ? policy : "explicit";
+
+#ifndef __linux__
+    pb::msg_warning(std::format("Thread affinity is only supported on Linux, so thread-affinity={} will be ignored", policy));
+    s_policyName = "none";
+    return;
+#else
+    std::vector<int> allowed = allowedCpus();
+    if (allowed.empty()) {
+        pb::msg_warning("Unable to find which CPUs this process may run on, so threads will not be pinned");
+        s_policyName = "none";
+        return;
+    }
+
+    if (s_policyName == "explicit") {
+        std::stringstream ss(policy);
+        std::string set;
+        while (std::getline(ss, set, ';')) {
+            std::vector<int> cpus;
+            for (int cpu : parseCpuList(set)) {
+                if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) {
+                    cpus.push_back(cpu);
+                }
+                else {
+                    pb::msg_warning(std::format("CPU {} in thread-affinity is not available to this process, so will not be used", cpu));
+                }
+            }
+            if (cpus.empty()) {
+                pb::msg_error_and_exit(std::format("No CPU in the set '{}' of parameter 'thread-affinity' is available to this process", set));
+            }
+            s_slotCpus.push_back(cpus);
+        }
+        pb::msg_info(std::format("Thread affinity: {} CPU sets given explicitly", s_slotCpus.size()));
+        return;
+    }
+
+    std::vector<std::vector<int>> nodes = numaNodeCpus(allowed);
+
+    if (s_policyName == "compact") {
+        for (const std::vector<int>& node : nodes) {
+            for (int cpu : node) {
+                s_slotCpus.push_back({cpu});
+            }
+        }
+    }
+    else {
+        // scatter: take the first CPU of each node in turn, then the second, and so on
+        std::size_t maxNodeSize = 0;
+        for (const std::vector<int>& node : nodes) {
+            maxNodeSize = std::max(maxNodeSize, node.size());
+        }
+        for (std::size_t i = 0; i < maxNodeSize; ++i) {
+            for (const std::vector<int>& node : nodes) {
+                if (i < node.size()) {
+                    s_slotCpus.push_back({node[i]});
+                }
+            }
+        }
+    }
+
+    pb::msg_info(std::format("Thread affinity: {} policy over {} CPUs on {} NUMA nodes",
+        s_policyName, s_slotCpus.size(), nodes.size()));
+#endif
+}
+
+
+void ThreadAffinity::pinCurrentThread(std::size_t slot)
+{
+#ifdef __linux__
+    if (s_slotCpus.empty() || std::this_thread::get_id() == s_mainThreadId) {
+        return;
+    }
+
+    // a worker thread may be asked to pin itself many times (e.g. once per fitness evaluation), and
+    // may be handed work for a different slot over time, so only call the kernel when the slot changes
+    thread_local std::size_t t_pinnedIndex = std::numeric_limits<std::size_t>::max();
+    std::size_t index = slot % s_slotCpus.size();
+    if (index == t_pinnedIndex) {
+        return;
+    }
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (int cpu : s_slotCpus[index]) {
+        CPU_SET(cpu, &cpuSet);
+    }
+    if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0) {
+        pb::msg_warning(std::format("Unable to pin thread for slot {} to its CPUs", slot));
+        return;
+    }
+    t_pinnedIndex = index;
+#else
+    (void)slot;
+#endif
+}
+
+
+void ThreadAffinity::runOnPinnedThread(std::size_t slot, const std::function<void()>& f)
+{
+    if (s_slotCpus.empty()) {
+        f();
+        return;
+    }
+
+    std::exception_ptr pException;
+    std::thread thread([&]() {
+        pinCurrentThread(slot);
+        try {
+            f();
+        }
+        catch (...) {
+            pException = std::current_exception();
+        }
+    });
+    thread.join();
+
+    if (pException) {
+        std::rethrow_exception(pException);
+    }
+}
+
+
+// Parse a list of CPUs such as "0-3,8,10-11"
+std::vector<int> ThreadAffinity::parseCpuList(const std::string& list)
+{
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        item.erase(std::remove_if(item.begin(), item.end(), ::isspace), item.end());
+        if (item.empty()) {
+            continue;
+        }
+        auto dash = item.find('-');
+        int first = std::stoi(item.substr(0, dash));
+        int last = (dash == std::string::npos) ? first : std::stoi(item.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+
+// The CPUs the process is currently allowed to run on, in ascending order
+std::vector<int> ThreadAffinity::allowedCpus()
+{
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &cpuSet)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    return cpus;
+}
+
+
+// The allowed CPUs on each NUMA node (nodes with none are left out). If the node topology can't be
+// read, all the allowed CPUs are treated as one node.
+std::vector<std::vector<int>> ThreadAffinity::numaNodeCpus(const std::vector<int>& allowed)
+{
+    std::vector<std::pair<int, std::vector<int>>> nodes; // (node number, CPUs)
+
+    std::error_code ec;
+    const std::filesystem::path nodeDir("/sys/devices/system/node");
+    for (const auto& entry : std::filesystem::directory_iterator(nodeDir, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+            !std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+            continue;
+        }
+
+        std::ifstream file(entry.path() / "cpulist");
+        std::string cpulist;
+        if (!file || !std::getline(file, cpulist)) {
+            continue;
+        }
+
+        std::vector<int> cpus;
+        for (int cpu : parseCpuList(cpulist)) {
+            if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end()) {
+                cpus.push_back(cpu);
+            }
+        }
+        if (!cpus.empty()) {
+            nodes.emplace_back(std::stoi(name.substr(4)), cpus);
+        }
+    }
+
+    std::sort(nodes.begin(), nodes.end());
+
+    std::vector<std::vector<int>> result;
+    for (auto& [nodeNum, cpus] : nodes) {
+        result.push_back(std::move(cpus));
+    }
+    if (result.empty()) {
+        result.push_back(allowed);
+    }
+    return result;
+}
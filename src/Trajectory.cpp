@@ -0,0 +1,341 @@
+/**
+ * @file
+ *
+ * Implementation of the TrajectoryRecorder and TrajectoryReader classes
+ */
+
+#include "Trajectory.h"
+#include "Environment.h"
+#include "Params.h"
+#include "utils.h"
+#include <algorithm>
+#include <format>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+namespace {
+
+    constexpr std::size_t STAGING_BUFFER_SIZE = 1 << 20;            // hand frames to the writer thread in chunks of about this size
+    constexpr std::size_t MIN_MAPPING_SIZE = 16 << 20;              // initial size of the writer's file mapping
+    constexpr std::size_t MAX_CHECKPOINT_BYTES = 64 << 20;          // memory the reader may use for visit count checkpoints
+    constexpr std::size_t MIN_CHECKPOINT_INTERVAL = 64;
+
+} // anonymous namespace
+
+
+//////////////////////////////////////////////////////////////
+// TrajectoryRecorder
+
+TrajectoryRecorder::TrajectoryRecorder(const std::string& filename, const Environment& env, int frameInterval) :
+    m_filename(filename),
+    m_frameInterval(std::max(1, frameInterval))
+{
+    m_fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0) {
+        pb::msg_error_and_exit(std::format("Unable to open trajectory file {} for writing: {}", filename, std::strerror(errno)));
+    }
+
+    const std::vector<Bee>& bees = env.getBees();
+    const std::vector<Plant>& plants = env.getAllPlants();
+
+    m_staging.reserve(STAGING_BUFFER_SIZE);
+
+    TrajectoryFileHeader header {};
+    std::memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+    header.numBees = static_cast<std::uint32_t>(bees.size());
+    header.numPlants = static_cast<std::uint32_t>(plants.size());
+    header.frameInterval = static_cast<std::uint32_t>(m_frameInterval);
+    header.envW = Params::envW;
+    header.envH = Params::envH;
+    append(&header, sizeof(header));
+
+    for (const Bee& bee : bees) {
+        float hue = bee.colorHue();
+        append(&hue, sizeof(hue));
+    }
+
+    m_lastVisitCounts.reserve(plants.size());
+    for (const Plant& plant : plants) {
+        float pos[2] = {plant.x(), plant.y()};
+        append(pos, sizeof(pos));
+        m_lastVisitCounts.push_back(static_cast<std::uint32_t>(plant.visitCount()));
+    }
+
+    m_writer = std::thread(&TrajectoryRecorder::writerLoop, this);
+}
+
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+    finish();
+}
+
+
+void TrajectoryRecorder::recordFrame(int iteration, const Environment& env)
+{
+    const std::vector<Bee>& bees = env.getBees();
+    const std::vector<Plant>& plants = env.getAllPlants();
+
+    m_plantUpdates.clear();
+    for (std::size_t i = 0; i < plants.size(); ++i) {
+        auto visitCount = static_cast<std::uint32_t>(plants[i].visitCount());
+        if (visitCount != m_lastVisitCounts[i]) {
+            m_plantUpdates.push_back({static_cast<std::uint32_t>(i), visitCount});
+            m_lastVisitCounts[i] = visitCount;
+        }
+    }
+
+    TrajectoryFrameHeader frameHeader {iteration, static_cast<std::uint32_t>(m_plantUpdates.size())};
+    append(&frameHeader, sizeof(frameHeader));
+
+    for (const Bee& bee : bees) {
+        TrajectoryBeeRecord record {bee.x(), bee.y(), bee.angle(), static_cast<std::uint32_t>(bee.state())};
+        append(&record, sizeof(record));
+    }
+
+    append(m_plantUpdates.data(), m_plantUpdates.size() * sizeof(TrajectoryPlantUpdate));
+
+    ++m_numFrames;
+
+    if (m_staging.size() >= STAGING_BUFFER_SIZE) {
+        handOver();
+    }
+}
+
+
+void TrajectoryRecorder::append(const void* p, std::size_t bytes)
+{
+    const char* pBytes = static_cast<const char*>(p);
+    m_staging.insert(m_staging.end(), pBytes, pBytes + bytes);
+}
+
+
+void TrajectoryRecorder::handOver()
+{
+    if (m_staging.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_fullBuffers.push_back(std::move(m_staging));
+        if (m_spareBuffers.empty()) {
+            m_staging = std::vector<char>();
+        }
+        else {
+            m_staging = std::move(m_spareBuffers.back());
+            m_spareBuffers.pop_back();
+        }
+    }
+    m_cv.notify_one();
+
+    m_staging.clear();
+    m_staging.reserve(STAGING_BUFFER_SIZE);
+}
+
+
+void TrajectoryRecorder::finish()
+{
+    if (!m_writer.joinable()) {
+        return; // already finished
+    }
+
+    handOver();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bFinishing = true;
+    }
+    m_cv.notify_one();
+    m_writer.join();
+
+    // trim the file to the data actually written
+    if (m_pMapping != nullptr) {
+        ::munmap(m_pMapping, m_mappingSize);
+        m_pMapping = nullptr;
+    }
+    if (::ftruncate(m_fd, static_cast<off_t>(m_fileSize)) != 0) {
+        pb::msg_warning(std::format("Unable to trim trajectory file {}: {}", m_filename, std::strerror(errno)));
+    }
+    ::close(m_fd);
+    m_fd = -1;
+}
+
+
+void TrajectoryRecorder::writerLoop()
+{
+    while (true) {
+        std::vector<char> buf;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]() { return !m_fullBuffers.empty() || m_bFinishing; });
+            if (m_fullBuffers.empty()) {
+                return; // finishing, and everything has been written
+            }
+            buf = std::move(m_fullBuffers.front());
+            m_fullBuffers.pop_front();
+        }
+
+        writeToMapping(buf);
+
+        buf.clear();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_spareBuffers.push_back(std::move(buf));
+    }
+}
+
+
+void TrajectoryRecorder::writeToMapping(const std::vector<char>& buf)
+{
+    std::size_t sizeNeeded = m_fileSize + buf.size();
+    if (sizeNeeded > m_mappingSize) {
+        // grow the file and map it again (doubling, so that this happens rarely)
+        std::size_t newSize = std::max({sizeNeeded, 2 * m_mappingSize, MIN_MAPPING_SIZE});
+        if (m_pMapping != nullptr) {
+            ::munmap(m_pMapping, m_mappingSize);
+            m_pMapping = nullptr;
+        }
+        if (::ftruncate(m_fd, static_cast<off_t>(newSize)) != 0) {
+            pb::msg_error_and_exit(std::format("Unable to extend trajectory file {}: {}", m_filename, std::strerror(errno)));
+        }
+        void* p = ::mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+        if (p == MAP_FAILED) {
+            pb::msg_error_and_exit(std::format("Unable to map trajectory file {}: {}", m_filename, std::strerror(errno)));
+        }
+        m_pMapping = static_cast<char*>(p);
+        m_mappingSize = newSize;
+    }
+
+    std::memcpy(m_pMapping + m_fileSize, buf.data(), buf.size());
+    m_fileSize += buf.size();
+}
+
+
+//////////////////////////////////////////////////////////////
+// TrajectoryReader
+
+TrajectoryReader::TrajectoryReader(const std::string& filename) :
+    m_filename(filename)
+{
+    m_fd = ::open(filename.c_str(), O_RDONLY);
+    if (m_fd < 0) {
+        pb::msg_error_and_exit(std::format("Unable to open trajectory file {}: {}", filename, std::strerror(errno)));
+    }
+
+    struct stat st;
+    if (::fstat(m_fd, &st) != 0) {
+        pb::msg_error_and_exit(std::format("Unable to read trajectory file {}: {}", filename, std::strerror(errno)));
+    }
+    m_size = static_cast<std::size_t>(st.st_size);
+    if (m_size < sizeof(TrajectoryFileHeader)) {
+        pb::msg_error_and_exit(std::format("{} is not a trajectory file (too short)", filename));
+    }
+
+    void* p = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (p == MAP_FAILED) {
+        pb::msg_error_and_exit(std::format("Unable to map trajectory file {}: {}", filename, std::strerror(errno)));
+    }
+    m_pData = static_cast<const char*>(p);
+
+    // header, bee hues and plant positions
+    std::memcpy(&m_header, m_pData, sizeof(m_header));
+    if (std::memcmp(m_header.magic, TRAJECTORY_MAGIC, sizeof(m_header.magic)) != 0) {
+        pb::msg_error_and_exit(std::format("{} is not a trajectory file (or was written by an incompatible version of polybee)", filename));
+    }
+
+    std::size_t pos = sizeof(m_header);
+    std::size_t preambleSize = pos + m_header.numBees * sizeof(float) + m_header.numPlants * 2 * sizeof(float);
+    if (m_size < preambleSize) {
+        pb::msg_error_and_exit(std::format("Trajectory file {} is truncated", filename));
+    }
+    m_beeHues.resize(m_header.numBees);
+    std::memcpy(m_beeHues.data(), m_pData + pos, m_beeHues.size() * sizeof(float));
+    pos += m_beeHues.size() * sizeof(float);
+    m_plantPositions.resize(2 * m_header.numPlants);
+    std::memcpy(m_plantPositions.data(), m_pData + pos, m_plantPositions.size() * sizeof(float));
+    pos += m_plantPositions.size() * sizeof(float);
+
+    // find the start of each frame
+    const std::size_t beeRecordsSize = m_header.numBees * sizeof(TrajectoryBeeRecord);
+    while (pos + sizeof(TrajectoryFrameHeader) <= m_size) {
+        TrajectoryFrameHeader frameHeader;
+        std::memcpy(&frameHeader, m_pData + pos, sizeof(frameHeader));
+        std::size_t frameSize = sizeof(frameHeader) + beeRecordsSize + frameHeader.numPlantUpdates * sizeof(TrajectoryPlantUpdate);
+        if (pos + frameSize > m_size) {
+            break;
+        }
+        m_frameOffsets.push_back(pos);
+        pos += frameSize;
+    }
+    if (pos != m_size) {
+        pb::msg_warning(std::format("Trajectory file {} ends with an incomplete frame, which will be ignored", filename));
+    }
+    if (m_frameOffsets.empty()) {
+        pb::msg_error_and_exit(std::format("Trajectory file {} has no frames", filename));
+    }
+
+    // visit count checkpoints, as far apart as needed to keep within the memory budget
+    std::size_t checkpointBytes = std::max<std::size_t>(1, m_header.numPlants * sizeof(std::uint32_t));
+    std::size_t maxCheckpoints = std::max<std::size_t>(1, MAX_CHECKPOINT_BYTES / checkpointBytes);
+    m_checkpointInterval = std::max(MIN_CHECKPOINT_INTERVAL, (numFrames() + maxCheckpoints - 1) / maxCheckpoints);
+
+    std::vector<std::uint32_t> counts(m_header.numPlants, 0);
+    for (std::size_t frame = 0; frame < numFrames(); ++frame) {
+        applyPlantUpdates(frame, counts);
+        if (frame % m_checkpointInterval == 0) {
+            m_checkpoints.push_back(counts);
+        }
+    }
+}
+
+
+TrajectoryReader::~TrajectoryReader()
+{
+    if (m_pData != nullptr) {
+        ::munmap(const_cast<char*>(m_pData), m_size);
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+
+const TrajectoryFrameHeader& TrajectoryReader::frameHeader(std::size_t frame) const
+{
+    // (every item in the file is a multiple of four bytes, so the records are all suitably aligned)
+    return *reinterpret_cast<const TrajectoryFrameHeader*>(m_pData + m_frameOffsets[frame]);
+}
+
+
+const TrajectoryBeeRecord* TrajectoryReader::beeRecords(std::size_t frame) const
+{
+    return reinterpret_cast<const TrajectoryBeeRecord*>(m_pData + m_frameOffsets[frame] + sizeof(TrajectoryFrameHeader));
+}
+
+
+void TrajectoryReader::applyPlantUpdates(std::size_t frame, std::vector<std::uint32_t>& counts) const
+{
+    const TrajectoryFrameHeader& header = frameHeader(frame);
+    const auto* pUpdates = reinterpret_cast<const TrajectoryPlantUpdate*>(
+        m_pData + m_frameOffsets[frame] + sizeof(TrajectoryFrameHeader) + m_header.numBees * sizeof(TrajectoryBeeRecord));
+    for (std::uint32_t u = 0; u < header.numPlantUpdates; ++u) {
+        if (pUpdates[u].plantIndex < counts.size()) {
+            counts[pUpdates[u].plantIndex] = pUpdates[u].visitCount;
+        }
+    }
+}
+
+
+void TrajectoryReader::visitCountsAt(std::size_t frame, std::vector<std::uint32_t>& counts) const
+{
+    frame = std::min(frame, numFrames() - 1);
+    std::size_t checkpoint = frame / m_checkpointInterval;
+    counts = m_checkpoints[checkpoint];
+    for (std::size_t f = checkpoint * m_checkpointInterval + 1; f <= frame; ++f) {
+        applyPlantUpdates(f, counts);
+    }
+}
@@ -20,7 +20,7 @@ int TunnelEntranceInfo::nextID = 0;
 // TunnelEntranceInfo methods
 
 TunnelEntranceInfo::TunnelEntranceInfo(const EntranceSpec& spec, const Tunnel* pTunnel) :
-    side(spec.side), netType(spec.netType)
+    side(spec.side), tunnelIndex(pTunnel->index()), netType(spec.netType)
 {
     id = nextID++;
 
@@ -70,7 +70,8 @@ Tunnel::Tunnel() {
 }
 
 
-void Tunnel::initialise(float x, float y, float width, float height, Environment* pEnv) {
+void Tunnel::initialise(float x, float y, float width, float height, Environment* pEnv, int index) {
+    m_index = index;
     m_x = x;
     m_y = y;
     m_width = width;
@@ -117,7 +118,9 @@ void Tunnel::addEntrance(const EntranceSpec& spec) {
 void Tunnel::initialiseEntrances(const std::vector<EntranceSpec>& specs) {
     m_entrances.clear();
     for (const EntranceSpec& spec : specs) {
-        addEntrance(spec);
+        if (spec.tunnel == m_index) {
+            addEntrance(spec);
+        }
     }
 }
 
@@ -145,8 +148,8 @@ pb::IntersectInfo Tunnel::intersectsTunnelBoundary(float x1, float y1, float x2,
 {
     assert(m_pEnv != nullptr);
 
-    bool pt1InTunnel = m_pEnv->inTunnel(x1, y1);
-    bool pt2InTunnel = m_pEnv->inTunnel(x2, y2);
+    bool pt1InTunnel = contains(x1, y1);
+    bool pt2InTunnel = contains(x2, y2);
 
     // if both points are in the same region (both in tunnel or both outside), no crossing
     //assert (pt1InTunnel != pt2InTunnel);
@@ -184,3 +187,36 @@ pb::IntersectInfo Tunnel::intersectsTunnelBoundary(float x1, float y1, float x2,
     pb::msg_error_and_exit("Tunnel::intersectsTunnelBoundary(): logic error: expected to find an intersection with tunnel walls when crossing boundary outside entrances.");
     return {false, false}; // to satisfy compiler
 }
+
+
+void Tunnel::recordCrossing(const TunnelEntranceInfo* pEntrance, bool isEntry, bool success, int numRebounds) {
+    assert(pEntrance != nullptr);
+    assert(pEntrance >= m_entrances.data() && pEntrance < m_entrances.data() + m_entrances.size());
+    TunnelEntranceInfo& entrance = m_entrances[pEntrance - m_entrances.data()];
+    (isEntry ? entrance.entryStats : entrance.exitStats).add(success, numRebounds);
+}
+
+
+void Tunnel::resetCrossingStats() {
+    for (TunnelEntranceInfo& entrance : m_entrances) {
+        entrance.entryStats.reset();
+        entrance.exitStats.reset();
+    }
+}
+
+
+CrossingAccumulator Tunnel::getCrossingStats(bool includeEntries, bool includeExits, std::optional<NetType> netType) const {
+    CrossingAccumulator total;
+    for (const TunnelEntranceInfo& entrance : m_entrances) {
+        if (netType.has_value() && entrance.netType != netType.value()) {
+            continue;
+        }
+        if (includeEntries) {
+            total.merge(entrance.entryStats);
+        }
+        if (includeExits) {
+            total.merge(entrance.exitStats);
+        }
+    }
+    return total;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file
+ *
+ * Implementation of the VisSnapshot struct
+ */
+
+#include "VisSnapshot.h"
+#include "Environment.h"
+#include "Params.h"
+#include <algorithm>
+
+
+// Copy the parts of the environment that LocalVis draws. The vectors keep their capacity from one
+// capture to the next, so once the buffers have warmed up a capture doesn't allocate.
+void VisSnapshot::capture(Environment& env, int iter, bool withFlowmap)
+{
+    iteration = iter;
+
+    // bees, with the most recent part of each bee's path for drawing its trail
+    const std::size_t maxTrailLen = static_cast<std::size_t>(std::max(Params::visBeePathDrawLen, 0));
+    bees.clear();
+    trailPoints.clear();
+    for (const Bee& bee : env.getBees()) {
+        const std::vector<pb::Pos2D>& path = bee.path();
+        const std::size_t trailLen = std::min(path.size(), maxTrailLen);
+        const TunnelEntranceInfo* pEntranceUsed = bee.entranceUsed();
+        bees.push_back({bee.x(), bee.y(), bee.angle(), bee.colorHue(),
+            (pEntranceUsed == nullptr) ? -1 : pEntranceUsed->id,
+            static_cast<std::uint32_t>(trailPoints.size()), static_cast<std::uint32_t>(trailLen)});
+        trailPoints.insert(trailPoints.end(), path.end() - trailLen, path.end());
+    }
+
+    const std::vector<Plant>& plants = env.getAllPlants();
+    plantVisitCounts.resize(plants.size());
+    std::transform(plants.begin(), plants.end(), plantVisitCounts.begin(),
+        [](const Plant& plant) { return plant.visitCount(); });
+    successfulVisitFraction = env.getSuccessfulVisitFraction();
+
+    // the heatmap is small, so is always copied
+    const Heatmap& heatmap = env.getHeatmap();
+    heatmapValid = heatmap.isNormalisedCalculated() && !heatmap.cellsNormalised().empty();
+    if (heatmapValid) {
+        heatmapW = heatmap.size_x();
+        heatmapH = heatmap.size_y();
+        heatmapNormalised.resize(static_cast<std::size_t>(heatmapW) * heatmapH);
+        for (int x = 0; x < heatmapW; ++x) {
+            std::copy(heatmap.cellsNormalised()[x].begin(), heatmap.cellsNormalised()[x].end(),
+                heatmapNormalised.begin() + static_cast<std::size_t>(x) * heatmapH);
+        }
+    }
+
+    // the flowmap has to be recalculated before it can be drawn, so is only copied when requested
+    flowmapValid = withFlowmap;
+    if (withFlowmap) {
+        Flowmap& flowmap = env.getFlowmap();
+        flowmap.calculateFlow();
+        flowmapW = flowmap.size_x();
+        flowmapH = flowmap.size_y();
+        flowmapMaxCount = flowmap.max_count();
+        flowmapCells.resize(static_cast<std::size_t>(flowmapW) * flowmapH);
+        for (int x = 0; x < flowmapW; ++x) {
+            std::copy(flowmap.cells()[x].begin(), flowmap.cells()[x].end(),
+                flowmapCells.begin() + static_cast<std::size_t>(x) * flowmapH);
+        }
+    }
+}
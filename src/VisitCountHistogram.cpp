@@ -0,0 +1,68 @@
+/**
+ * @file
+ *
+ * Implementation of the VisitCountHistogram class
+ */
+
+#include "VisitCountHistogram.h"
+#include "Plant.h"
+#include "Params.h"
+#include <algorithm>
+#include <cassert>
+
+
+void VisitCountHistogram::reset(const std::vector<Plant*>& plants)
+{
+    m_counts.assign(1, 0);
+    m_numPlants = plants.size();
+    m_numInSuccessRange = 0;
+
+    for (const Plant* pPlant : plants) {
+        int visitCount = pPlant->visitCount();
+        if (static_cast<std::size_t>(visitCount) >= m_counts.size()) {
+            m_counts.resize(visitCount + 1, 0);
+        }
+        ++m_counts[visitCount];
+        if (inSuccessRange(visitCount)) {
+            ++m_numInSuccessRange;
+        }
+    }
+}
+
+
+void VisitCountHistogram::recordVisit(int newVisitCount)
+{
+    assert(newVisitCount > 0 && static_cast<std::size_t>(newVisitCount) <= m_counts.size());
+    assert(m_counts[newVisitCount - 1] > 0);
+
+    if (static_cast<std::size_t>(newVisitCount) == m_counts.size()) {
+        m_counts.push_back(0);
+    }
+    --m_counts[newVisitCount - 1];
+    ++m_counts[newVisitCount];
+
+    m_numInSuccessRange += (inSuccessRange(newVisitCount) ? 1 : 0) - (inSuccessRange(newVisitCount - 1) ? 1 : 0);
+}
+
+
+double VisitCountHistogram::variance() const
+{
+    if (m_numPlants == 0) {
+        return 0.0;
+    }
+
+    double sum = 0.0;
+    double sumSq = 0.0;
+    for (std::size_t v = 0; v < m_counts.size(); ++v) {
+        sum += static_cast<double>(v) * m_counts[v];
+        sumSq += static_cast<double>(v) * v * m_counts[v];
+    }
+    const double mean = sum / m_numPlants;
+    return std::max(0.0, sumSq / m_numPlants - mean * mean);
+}
+
+
+bool VisitCountHistogram::inSuccessRange(int visitCount)
+{
+    return visitCount >= Params::minVisitCountSuccess && visitCount <= Params::maxVisitCountSuccess;
+}
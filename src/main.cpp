@@ -1,5 +1,6 @@
 #include "PolyBeeCore.h"
 #include "PolyBeeEvolve.h"
+#include "PolyBeeReplicates.h"
 #include "Params.h"
 
 int main(int argc, char **argv)
@@ -12,6 +13,17 @@ int main(int argc, char **argv)
 		PolyBeeEvolve optimizer(polyBeeCore);
 		optimizer.evolve();
 	}
+	else if (!Params::replayFilename.empty())
+	{
+		// replay a recorded run in the visualiser
+		polyBeeCore.replay();
+	}
+	else if (Params::numReplicates > 1)
+	{
+		// run several replicates of a normal simulation in parallel
+		PolyBeeReplicates replicates(polyBeeCore);
+		replicates.run();
+	}
 	else
 	{
 		// run normal simulation
@@ -0,0 +1,327 @@
+#!/usr/bin/env python3
+"""
+Golden-output regression check for PolyBee.
+
+Runs polybee headless on one config file, with a fixed RNG seed and a fixed
+number of iterations, and compares the results with a golden file recorded
+earlier from a known-good build. The run is always done in normal mode
+(evolve=false), so the evolve-mode configs just contribute their environment
+set-ups.
+
+The following are compared:
+  - the raw heatmap (bee-position counts per cell)
+  - flowmap sums (total movement count, and count-weighted sums of the
+    axis and strength values)
+  - successful visit fraction, tunnel entrance crossing stats and (if the
+    config has a target heatmap) the final EMD, from the run-info file
+
+Each quantity is first compared by digest. If the digests match the run is
+reported as exact. Otherwise the values are compared numerically, within the
+given tolerances, and the check passes (reported as "within tolerance") or
+fails. Throughput in bee-steps per second is also reported, along with the
+throughput recorded in the golden file. It is for information only and never
+causes a failure.
+
+Golden files are specific to a platform and toolchain: the standard library's
+random number distributions and maths functions are not identical everywhere.
+Record them with --update on a known-good commit before starting work on a
+change, then check after each step of the work.
+
+The golden files in data/ were recorded on x86-64 Linux with GCC 12.2 and
+libstdc++, from commit c79dd72 (where this script was added). That build was
+linked against stand-ins for OpenCV, pagmo and raylib rather than the real
+libraries. A normal-mode run only uses OpenCV for the final EMD, which the
+stand-in computed with an exact min-cost-flow solver in double precision.
+OpenCV's cv::EMD solves the same problem with a float transportation simplex,
+so its value can differ in the last few digits. For that reason the EMD is
+compared with its own, looser relative tolerance (--emd-rel-tol). The EMD is
+computed from the heatmap, which is still compared with the default
+tolerance, so any change in behaviour still shows up there. Re-recording
+from a build linked against the real OpenCV will make the EMD exact again.
+
+A config that is known not to run headless is listed in NOT_RUNNABLE with the
+reason, and is skipped. Any other config that polybee fails to run, or that
+has no golden file, fails the check.
+
+Exit status: 0 = pass, 1 = fail, 77 = skipped (config listed in NOT_RUNNABLE).
+
+Usage:
+    ./run_golden.py --polybee <exe> --config <file.cfg> [--golden-dir <dir>] [--update]
+"""
+
+import argparse
+import glob
+import hashlib
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+EXIT_PASS = 0
+EXIT_FAIL = 1
+EXIT_SKIP = 77
+
+# Configs that polybee can't run headless in normal mode, and why. These are skipped rather than
+# failed, but any other config that fails to run is a failure.
+NOT_RUNNABLE = {
+    'evolve-4-entrance-1o-hive-positions': 'all its hives are evolved, so it has none in normal mode',
+    'evolve-bridge-and-barrier-tests-EHBX': 'all its hives are evolved, so it has none in normal mode',
+    'evolve-entrance-positions-4-rows': "uses the retired 'bee-forage-duration' parameter",
+    'evolve-entrance-positions-4-rows-with-energetics': "uses the retired 'bee-forage-duration' parameter",
+    'param-config-tests-with-energetics': "uses the retired 'bee-forage-duration' parameter",
+    'test-bee-energetics-1': "uses the retired 'bee-forage-duration' parameter",
+    'polybee-800x800': 'its target heatmap path is not relative to the repository root',
+    'polybee-900x900': 'its target heatmap path is not relative to the repository root',
+}
+
+
+# ---------------------------------------------------------------------------
+# Argument parsing
+# ---------------------------------------------------------------------------
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description='Run polybee on a config file and compare its output with a golden file')
+    parser.add_argument('--polybee', required=True, help='Path to the polybee executable')
+    parser.add_argument('--config', required=True, help='Config file to run')
+    parser.add_argument('--golden-dir', default=str(Path(__file__).resolve().parent / 'data'),
+                        help='Directory holding the golden files (default: data/ next to this script)')
+    parser.add_argument('--iterations', type=int, default=2000,
+                        help='Number of iterations to run (default: 2000)')
+    parser.add_argument('--seed', default='20250101',
+                        help='RNG seed (default: 20250101)')
+    parser.add_argument('--rel-tol', type=float, default=1e-6,
+                        help='Relative tolerance for numeric comparison (default: 1e-6)')
+    parser.add_argument('--emd-rel-tol', type=float, default=1e-3,
+                        help='Relative tolerance for the EMD, which depends on the EMD solver (default: 1e-3)')
+    parser.add_argument('--abs-tol', type=float, default=1e-9,
+                        help='Absolute tolerance for numeric comparison (default: 1e-9)')
+    parser.add_argument('--update', action='store_true',
+                        help='Write (or overwrite) the golden file instead of comparing with it')
+    return parser.parse_args()
+
+
+# ---------------------------------------------------------------------------
+# Running polybee and collecting results
+# ---------------------------------------------------------------------------
+
+def run_polybee(args, log_dir):
+    cmd = [args.polybee,
+           '-c', args.config,
+           '--visualise', 'false',
+           '--evolve', 'false',
+           '--logging', 'true',
+           '--log-dir', log_dir,
+           '--log-filename-prefix', 'golden',
+           '--num-iterations', str(args.iterations),
+           '--rng-seed', args.seed]
+    start = time.perf_counter()
+    proc = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    elapsed = time.perf_counter() - start
+    return proc, elapsed
+
+
+def find_output(log_dir, tag):
+    # output files are named golden-<tag>-<timestamp>.<ext>
+    matches = [f for f in glob.glob(os.path.join(log_dir, f'golden-{tag}-*'))
+               if re.match(rf'golden-{tag}-\d', os.path.basename(f))]
+    return matches[0] if matches else None
+
+
+def read_csv_numbers(path, cell_parser=float):
+    rows = []
+    with open(path) as f:
+        for line in f:
+            line = line.strip().rstrip(',')
+            if line:
+                rows.append([cell_parser(c) for c in line.split(',')])
+    return rows
+
+
+def digest(values):
+    h = hashlib.sha256()
+    h.update(repr(values).encode())
+    return h.hexdigest()[:16]
+
+
+def collect_results(log_dir):
+    """Return a dict of named results, each a list of numbers, from the output files in log_dir"""
+    results = {}
+
+    heatmap_file = find_output(log_dir, 'heatmap')
+    if heatmap_file is None:
+        raise RuntimeError('no heatmap output file was written')
+    heatmap = read_csv_numbers(heatmap_file)
+    results['heatmap'] = [v for row in heatmap for v in row]
+
+    flowmap_file = find_output(log_dir, 'flowmap')
+    if flowmap_file is not None:
+        cells = read_csv_numbers(flowmap_file, lambda c: tuple(float(x) for x in c.split(':')))
+        count = sum(c[2] for row in cells for c in row)
+        axis_sum = sum(c[0] * c[2] for row in cells for c in row)
+        strength_sum = sum(c[1] * c[2] for row in cells for c in row)
+        results['flowmap-sums'] = [count, axis_sum, strength_sum]
+
+    run_info_file = find_output(log_dir, 'run-info')
+    if run_info_file is None:
+        raise RuntimeError('no run-info output file was written')
+    with open(run_info_file) as f:
+        run_info = f.read()
+
+    m = re.search(r'Successful visit fraction[^:]*:\s*([-\d.eE+]+)', run_info)
+    if m:
+        results['svf'] = [float(m.group(1))]
+    m = re.search(r'Final EMD[^:]*:\s*([-\d.eE+]+)', run_info)
+    if m:
+        results['emd'] = [float(m.group(1))]
+    m = re.search(r'crossing success rate:\s*([-\d.eE+]+)%', run_info)
+    if m:
+        results['crossing-success-rate'] = [float(m.group(1))]
+    m = re.search(r'crossing attempt:\s*([-\d.eE+]+)(?: \(sd ([-\d.eE+]+), (\d+) attempts\))?', run_info)
+    if m:
+        results['crossing-rebounds'] = [float(g) for g in m.groups() if g is not None]
+
+    return results
+
+
+def num_bees_from_config(log_dir):
+    config_file = find_output(log_dir, 'config')
+    if config_file is not None:
+        with open(config_file) as f:
+            m = re.search(r'^num-bees\s*=\s*(\d+)', f.read(), re.MULTILINE)
+            if m:
+                return int(m.group(1))
+    return None
+
+
+# ---------------------------------------------------------------------------
+# Golden files
+# ---------------------------------------------------------------------------
+#
+# A golden file is plain text. Comment lines start with '#'; other lines are
+#   <name> <digest> <value1> <value2> ...
+# plus a single 'throughput <bee-steps per second>' line.
+
+def write_golden(path, args, results, throughput):
+    path.parent.mkdir(parents=True, exist_ok=True)
+    with open(path, 'w') as f:
+        f.write(f'# polybee golden output for {Path(args.config).name}\n')
+        f.write(f'# seed {args.seed}, {args.iterations} iterations\n')
+        f.write(f'throughput {throughput:.1f}\n')
+        for name, values in results.items():
+            f.write(f'{name} {digest(values)} ' + ' '.join(repr(v) for v in values) + '\n')
+
+
+def read_golden(path):
+    golden = {}
+    throughput = None
+    with open(path) as f:
+        for line in f:
+            if line.startswith('#') or not line.strip():
+                continue
+            fields = line.split()
+            if fields[0] == 'throughput':
+                throughput = float(fields[1])
+            else:
+                golden[fields[0]] = (fields[1], [float(v) for v in fields[2:]])
+    return golden, throughput
+
+
+def compare(name, golden_entry, values, args):
+    """Compare one named result with its golden entry. Returns (ok, description)"""
+    golden_digest, golden_values = golden_entry
+    if digest(values) == golden_digest:
+        return True, 'exact'
+    if len(values) != len(golden_values):
+        return False, f'size changed from {len(golden_values)} to {len(values)}'
+
+    worst = 0.0
+    worst_index = 0
+    num_diffs = 0
+    ok = True
+    rel_tol = args.emd_rel_tol if name == 'emd' else args.rel_tol
+    for i, (g, v) in enumerate(zip(golden_values, values)):
+        diff = abs(v - g)
+        if diff > 0.0:
+            num_diffs += 1
+        if diff > args.abs_tol + rel_tol * abs(g):
+            ok = False
+        if diff > worst:
+            worst, worst_index = diff, i
+    desc = (f'{num_diffs} of {len(values)} values differ, largest difference {worst:.6g} '
+            f'(at index {worst_index}: golden {golden_values[worst_index]!r}, now {values[worst_index]!r})')
+    return ok, ('within tolerance: ' if ok else 'MISMATCH: ') + desc
+
+
+# ---------------------------------------------------------------------------
+# Main
+# ---------------------------------------------------------------------------
+
+def main():
+    args = parse_args()
+    config_name = Path(args.config).stem
+    golden_path = Path(args.golden_dir) / f'{config_name}.golden'
+
+    if config_name in NOT_RUNNABLE:
+        print(f'SKIP {config_name}: {NOT_RUNNABLE[config_name]}')
+        # (not an error when recording golden files, so that the golden-update target carries on)
+        return EXIT_PASS if args.update else EXIT_SKIP
+
+    if not args.update and not golden_path.exists():
+        print(f'FAIL {config_name}: no golden file at {golden_path}')
+        print('Record golden files from a known-good build with the golden-update target '
+              '(or run this script with --update).')
+        return EXIT_FAIL
+
+    with tempfile.TemporaryDirectory(prefix='polybee-golden-') as log_dir:
+        proc, elapsed = run_polybee(args, log_dir)
+        if proc.returncode != 0:
+            print(f'FAIL {config_name}: polybee exited with status {proc.returncode}')
+            print(proc.stdout[-2000:])
+            return EXIT_FAIL
+
+        try:
+            results = collect_results(log_dir)
+        except RuntimeError as e:
+            print(f'FAIL {config_name}: {e}')
+            return EXIT_FAIL
+
+        num_bees = num_bees_from_config(log_dir)
+
+    throughput = (num_bees or 0) * args.iterations / elapsed if elapsed > 0.0 else 0.0
+
+    if args.update:
+        write_golden(golden_path, args, results, throughput)
+        print(f'UPDATED {golden_path} ({throughput:.0f} bee-steps/s)')
+        return EXIT_PASS
+
+    golden, golden_throughput = read_golden(golden_path)
+
+    all_ok = True
+    all_exact = True
+    for name in sorted(set(golden) | set(results)):
+        if name not in results:
+            ok, desc = False, 'missing from this run'
+        elif name not in golden:
+            ok, desc = False, 'not in golden file'
+        else:
+            ok, desc = compare(name, golden[name], results[name], args)
+        all_ok = all_ok and ok
+        all_exact = all_exact and desc == 'exact'
+        print(f'  {name:<24} {desc}')
+
+    speed = f'throughput {throughput:.0f} bee-steps/s'
+    if golden_throughput:
+        speed += f' ({throughput / golden_throughput:.2f}x golden)'
+    status = 'PASS' if all_ok else 'FAIL'
+    exactness = 'exact' if all_exact else 'not bit-identical'
+    print(f'{status} {config_name}: {exactness}, {speed}')
+
+    return EXIT_PASS if all_ok else EXIT_FAIL
+
+
+if __name__ == '__main__':
+    sys.exit(main())